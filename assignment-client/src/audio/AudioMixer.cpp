@@ -41,6 +41,8 @@
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 
+#include <AudioMixKernels.h>
+#include <AudioSourceMix.h>
 #include <LogHandler.h>
 #include <NetworkAccessManager.h>
 #include <NodeList.h>
@@ -65,6 +67,11 @@ const float DEFAULT_NOISE_MUTING_THRESHOLD = 0.003f;
 const QString AUDIO_MIXER_LOGGING_TARGET_NAME = "audio-mixer";
 const QString AUDIO_ENV_GROUP_KEY = "audio_env";
 const QString AUDIO_BUFFER_GROUP_KEY = "audio_buffer";
+const int DEFAULT_NUM_MIX_THREADS = 1;
+const float DEFAULT_CLUSTER_MIX_DISTANCE = 10.0f;
+
+// a cell needs at least this many listeners before sharing a bed beats mixing each of them on their own
+const int MIN_LISTENERS_PER_CLUSTER = 2;
 
 void attachNewNodeDataToNode(Node *newNode) {
     if (!newNode->getLinkedData()) {
@@ -78,12 +85,42 @@ bool AudioMixer::_printStreamStats = false;
 
 bool AudioMixer::_enableFilter = true;
 
+// mixes one contiguous slice of the frame's listeners or cluster beds on a thread of the mixer's pool
+class MixRangeJob : public QRunnable {
+public:
+    MixRangeJob(AudioMixer* mixer) : _mixer(mixer), _mixRange(NULL), _begin(0), _end(0) { setAutoDelete(false); }
+    
+    void setRange(AudioMixer::MixRangeFunction mixRange, int begin, int end) {
+        _mixRange = mixRange;
+        _begin = begin;
+        _end = end;
+    }
+    
+    virtual void run() {
+        (_mixer->*_mixRange)(_begin, _end, _preMixSamples);
+        _mixer->_mixJobsDone.release();
+    }
+    
+private:
+    AudioMixer* _mixer;
+    AudioMixer::MixRangeFunction _mixRange;
+    int _begin;
+    int _end;
+    
+    // each job has its own scratch buffer so jobs can mix concurrently
+    int16_t _preMixSamples[MIX_BUFFER_SAMPLES];
+};
+
 bool AudioMixer::shouldMute(float quietestFrame) {
     return (quietestFrame > _noiseMutingThreshold);
 }
 
 AudioMixer::AudioMixer(const QByteArray& packet) :
     ThreadedAssignment(packet),
+    _enableSpatialCulling(true),
+    _enableClusterMix(false),
+    _clusterMixDistance(DEFAULT_CLUSTER_MIX_DISTANCE),
+    _numMixThreads(0),
     _trailingSleepRatio(1.0f),
     _minAudibilityThreshold(LOUDNESS_TO_DISTANCE_RATIO / 2.0f),
     _performanceThrottlingRatio(0.0f),
@@ -92,6 +129,7 @@ AudioMixer::AudioMixer(const QByteArray& packet) :
     _numStatFrames(0),
     _sumListeners(0),
     _sumMixes(0),
+    _sumClusterBeds(0),
     _lastPerSecondCallbackTime(usecTimestampNow()),
     _sendAudioStreamStats(false),
     _datagramsReadPerCallStats(0, READ_DATAGRAMS_STATS_WINDOW_SECONDS),
@@ -101,15 +139,38 @@ AudioMixer::AudioMixer(const QByteArray& packet) :
 {
     // constant defined in AudioMixer.h.  However, we don't want to include this here
     // we will soon find a better common home for these audio-related constants
+    
+    setNumMixThreads(DEFAULT_NUM_MIX_THREADS);
+}
+
+AudioMixer::~AudioMixer() {
+    _mixThreadPool.waitForDone();
+    qDeleteAll(_mixJobs);
+}
+
+void AudioMixer::setNumMixThreads(int numMixThreads) {
+    if (numMixThreads < 1) {
+        numMixThreads = 1;
+    }
+    
+    _numMixThreads = numMixThreads;
+    
+    // the mixer thread mixes one slice itself, so the pool only needs the remaining threads
+    _mixThreadPool.waitForDone();
+    _mixThreadPool.setMaxThreadCount(qMax(_numMixThreads - 1, 1));
+    
+    qDeleteAll(_mixJobs);
+    _mixJobs.clear();
+    
+    for (int i = 0; i < _numMixThreads - 1; i++) {
+        _mixJobs.append(new MixRangeJob(this));
+    }
 }
 
 const float ATTENUATION_BEGINS_AT_DISTANCE = 1.0f;
 const float RADIUS_OF_HEAD = 0.076f;
 
-int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* listenerNodeData,
-                                                         const QUuid& streamUUID,
-                                                         PositionalAudioStream* streamToAdd,
-                                                         AvatarAudioStream* listeningNodeStream) {
+bool AudioMixer::shouldMixStreamFrame(PositionalAudioStream* streamToAdd, float& repeatedFrameFadeFactor) const {
     // If repetition with fade is enabled:
     // If streamToAdd could not provide a frame (it was starved), then we'll mix its previously-mixed frame
     // This is preferable to not mixing it at all since that's equivalent to inserting silence.
@@ -117,9 +178,7 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
     // we've repeated that frame in a row, we'll gradually fade that repeated frame into silence.
     // This improves the perceived quality of the audio slightly.
     
-    bool showDebug = false;  // (randFloat() < 0.05f);
-    
-    float repeatedFrameFadeFactor = 1.0f;
+    repeatedFrameFadeFactor = 1.0f;
     
     if (!streamToAdd->lastPopSucceeded()) {
         if (_streamSettings._repetitionWithFade && !streamToAdd->getLastPopOutput().isNull()) {
@@ -127,43 +186,26 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
             // calculate its fade factor, which depends on how many times it's already been repeated.
             repeatedFrameFadeFactor = calculateRepeatedFrameFadeFactor(streamToAdd->getConsecutiveNotMixedCount() - 1);
             if (repeatedFrameFadeFactor == 0.0f) {
-                return 0;
+                return false;
             }
         } else {
-            return 0;
+            return false;
         }
     }
     
     // at this point, we know streamToAdd's last pop output is valid
     
     // if the frame we're about to mix is silent, bail
-    if (streamToAdd->getLastPopOutputLoudness() == 0.0f) {
-        return 0;
-    }
+    return streamToAdd->getLastPopOutputLoudness() != 0.0f;
+}
+
+float AudioMixer::attenuationCoefficientForStream(PositionalAudioStream* streamToAdd, const glm::vec3& listenerPosition,
+                                                  bool sourceIsSelf, float distanceBetween) const {
+    bool showDebug = false;  // (randFloat() < 0.05f);
     
-    float bearingRelativeAngleToSource = 0.0f;
     float attenuationCoefficient = 1.0f;
-    int numSamplesDelay = 0;
-    float weakChannelAmplitudeRatio = 1.0f;
-    
-    //  Is the source that I am mixing my own?
-    bool sourceIsSelf = (streamToAdd == listeningNodeStream);
-    
-    glm::vec3 relativePosition = streamToAdd->getPosition() - listeningNodeStream->getPosition();
-    
-    float distanceBetween = glm::length(relativePosition);
     
-    if (distanceBetween < EPSILON) {
-        distanceBetween = EPSILON;
-    }
-    
-    if (streamToAdd->getLastPopOutputTrailingLoudness() / distanceBetween <= _minAudibilityThreshold) {
-        // according to mixer performance we have decided this does not get to be mixed in
-        // bail out
-        return 0;
-    }
-    
-    ++_sumMixes;
+    glm::vec3 relativePosition = streamToAdd->getPosition() - listenerPosition;
     
     if (streamToAdd->getType() == PositionalAudioStream::Injector) {
         attenuationCoefficient *= reinterpret_cast<InjectedAudioStream*>(streamToAdd)->getAttenuationRatio();
@@ -176,8 +218,6 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         qDebug() << "distance: " << distanceBetween;
     }
     
-    glm::quat inverseOrientation = glm::inverse(listeningNodeStream->getOrientation());
-    
     if (!sourceIsSelf && (streamToAdd->getType() == PositionalAudioStream::Microphone)) {
         //  source is another avatar, apply fixed off-axis attenuation to make them quieter as they turn away from listener
         glm::vec3 rotatedListenerPosition = glm::inverse(streamToAdd->getOrientation()) * relativePosition;
@@ -203,7 +243,7 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
     float attenuationPerDoublingInDistance = _attenuationPerDoublingInDistance;
     for (int i = 0; i < _zonesSettings.length(); ++i) {
         if (_audioZones[_zonesSettings[i].source].contains(streamToAdd->getPosition()) &&
-            _audioZones[_zonesSettings[i].listener].contains(listeningNodeStream->getPosition())) {
+            _audioZones[_zonesSettings[i].listener].contains(listenerPosition)) {
             attenuationPerDoublingInDistance = _zonesSettings[i].coefficient;
             break;
         }
@@ -225,6 +265,48 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         }
     }
     
+    return attenuationCoefficient;
+}
+
+int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* listenerNodeData,
+                                                         const QUuid& streamUUID,
+                                                         PositionalAudioStream* streamToAdd,
+                                                         AvatarAudioStream* listeningNodeStream,
+                                                         int16_t* preMixSamples, int16_t* mixSamples) const {
+    bool showDebug = false;  // (randFloat() < 0.05f);
+    
+    float repeatedFrameFadeFactor = 1.0f;
+    
+    if (!shouldMixStreamFrame(streamToAdd, repeatedFrameFadeFactor)) {
+        return 0;
+    }
+    
+    float bearingRelativeAngleToSource = 0.0f;
+    int numSamplesDelay = 0;
+    float weakChannelAmplitudeRatio = 1.0f;
+    
+    //  Is the source that I am mixing my own?
+    bool sourceIsSelf = (streamToAdd == listeningNodeStream);
+    
+    glm::vec3 relativePosition = streamToAdd->getPosition() - listeningNodeStream->getPosition();
+    
+    float distanceBetween = glm::length(relativePosition);
+    
+    if (distanceBetween < EPSILON) {
+        distanceBetween = EPSILON;
+    }
+    
+    if (streamToAdd->getLastPopOutputTrailingLoudness() / distanceBetween <= _minAudibilityThreshold) {
+        // according to mixer performance we have decided this does not get to be mixed in
+        // bail out
+        return 0;
+    }
+    
+    float attenuationCoefficient = attenuationCoefficientForStream(streamToAdd, listeningNodeStream->getPosition(),
+                                                                   sourceIsSelf, distanceBetween);
+    
+    glm::quat inverseOrientation = glm::inverse(listeningNodeStream->getOrientation());
+    
     if (!sourceIsSelf) {
         //  Compute sample delay for the two ears to create phase panning
         glm::vec3 rotatedSourcePosition = inverseOrientation * relativePosition;
@@ -274,7 +356,6 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         // Mono input to stereo output (item 1 above)
         int OUTPUT_SAMPLES_PER_INPUT_SAMPLE = 2;
         int inputSampleCount = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO / OUTPUT_SAMPLES_PER_INPUT_SAMPLE;
-        int maxOutputIndex = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO;
 
         // attenuation and fade applied to all samples (item 2 above)
         float attenuationAndFade = attenuationCoefficient * repeatedFrameFadeFactor;
@@ -282,83 +363,36 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         // determine which side is weak and delayed (item 3 above)
         bool rightSideWeakAndDelayed = (bearingRelativeAngleToSource > 0.0f);
         
-        // since we're converting from mono to stereo, we'll use these two indices to step through
-        // the output samples. we'll increment each index independently in the loop
-        int leftDestinationIndex = 0;
-        int rightDestinationIndex = 1;
-        
-        // One of our two channels will be delayed (determined below). We'll use this index to step
-        // through filling in our output with the historical samples for the delayed channel.  (item 4 above)
-        int delayedChannelHistoricalAudioOutputIndex;
-
-        // All samples will be attenuated by at least this much
-        float leftSideAttenuation = attenuationAndFade;
-        float rightSideAttenuation = attenuationAndFade;
-        
         // The weak/delayed channel will be attenuated by this additional amount
         float attenuationAndWeakChannelRatioAndFade = attenuationAndFade * weakChannelAmplitudeRatio;
         
-        // Now, based on the determination of which side is weak and delayed, set up our true starting point
-        // for our indexes, as well as the appropriate attenuation for each channel
-        if (rightSideWeakAndDelayed) {
-            delayedChannelHistoricalAudioOutputIndex = rightDestinationIndex; 
-            rightSideAttenuation = attenuationAndWeakChannelRatioAndFade;
-            rightDestinationIndex += (numSamplesDelay * OUTPUT_SAMPLES_PER_INPUT_SAMPLE);
-        } else {
-            delayedChannelHistoricalAudioOutputIndex = leftDestinationIndex;
-            leftSideAttenuation = attenuationAndWeakChannelRatioAndFade;
-            leftDestinationIndex += (numSamplesDelay * OUTPUT_SAMPLES_PER_INPUT_SAMPLE);
-        }
-
-        // If there was a sample delay for this stream, we need to pull samples prior to the official start of the input
-        // and stick those samples at the beginning of the output. We only need to loop through this for the weak/delayed
-        // side, since the normal side is fully handled below. (item 4 above)
-        if (numSamplesDelay > 0) {
-
-            // TODO: delayStreamSourceSamples may be inside the last frame written if the ringbuffer is completely full
-            // maybe make AudioRingBuffer have 1 extra frame in its buffer
-            AudioRingBuffer::ConstIterator delayStreamSourceSamples = streamPopOutput - numSamplesDelay;
-
-            for (int i = 0; i < numSamplesDelay; i++) {
-                int16_t originalHistoricalSample = *delayStreamSourceSamples;
-
-                _preMixSamples[delayedChannelHistoricalAudioOutputIndex] += originalHistoricalSample 
-                                                                                 * attenuationAndWeakChannelRatioAndFade;
-                ++delayStreamSourceSamples; // move our input pointer
-                delayedChannelHistoricalAudioOutputIndex += OUTPUT_SAMPLES_PER_INPUT_SAMPLE; // move our output sample
-            }
-        }
-
-        // Here's where we copy the MONO input to the STEREO output, and account for delay and weak side attenuation
-        for (int inputSample = 0; inputSample < inputSampleCount; inputSample++) {
-            int16_t originalSample = streamPopOutput[inputSample];
-            int16_t leftSideSample = originalSample * leftSideAttenuation;
-            int16_t rightSideSample = originalSample * rightSideAttenuation;
-
-            // since we might be delayed, don't write beyond our maxOutputIndex
-            if (leftDestinationIndex <= maxOutputIndex) {
-                _preMixSamples[leftDestinationIndex] += leftSideSample;
-            }
-            if (rightDestinationIndex <= maxOutputIndex) {
-                _preMixSamples[rightDestinationIndex] += rightSideSample;
-            }
-
-            leftDestinationIndex += OUTPUT_SAMPLES_PER_INPUT_SAMPLE;
-            rightDestinationIndex += OUTPUT_SAMPLES_PER_INPUT_SAMPLE;
-        }
+        // Pull the samples prior to the official start of the input along with the frame itself, so the
+        // delayed channel can read the historical samples and then the frame from one contiguous buffer.
+        // The normal side starts reading at the official start of the input. (item 4 above)
+        // TODO: the historical samples may be inside the last frame written if the ringbuffer is completely full
+        // maybe make AudioRingBuffer have 1 extra frame in its buffer
+        int16_t inputSamples[SAMPLE_PHASE_DELAY_AT_90 + AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL];
+        (streamPopOutput - numSamplesDelay).readSamples(inputSamples, numSamplesDelay + inputSampleCount);
+
+        // Now, based on the determination of which side is weak and delayed, set up the input and the
+        // appropriate attenuation for each channel, and copy the MONO input to the STEREO output
+        AudioSourceMix::addMonoSource(preMixSamples, inputSamples, numSamplesDelay, rightSideWeakAndDelayed,
+                                      attenuationAndFade, attenuationAndWeakChannelRatioAndFade);
         
     } else {
-        int stereoDivider = streamToAdd->isStereo() ? 1 : 2;
-
-       float attenuationAndFade = attenuationCoefficient * repeatedFrameFadeFactor;
+        float attenuationAndFade = attenuationCoefficient * repeatedFrameFadeFactor;
+        
+        int16_t inputSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO];
+        streamPopOutput.readSamples(inputSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO);
 
-        for (int s = 0; s < AudioConstants::NETWORK_FRAME_SAMPLES_STEREO; s++) {
-            _preMixSamples[s] = glm::clamp(_preMixSamples[s] + (int)(streamPopOutput[s / stereoDivider] * attenuationAndFade),
-                                            AudioConstants::MIN_SAMPLE_VALUE,
-                                           AudioConstants::MAX_SAMPLE_VALUE);
-        }
+        AudioMixKernels::addWithGain(preMixSamples, inputSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO,
+                                     attenuationAndFade);
     }
 
+    AudioFilterHSF1s* penumbraFilter = NULL;
+    float penumbraFilterGainL = 1.0f;
+    float penumbraFilterGainR = 1.0f;
+
     if (!sourceIsSelf && _enableFilter && !streamToAdd->ignorePenumbraFilter()) {
 
         const float TWO_OVER_PI = 2.0f / PI;
@@ -370,14 +404,6 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         const float FILTER_GAIN_AT_0 = ZERO_DB; // source is in front
         const float FILTER_GAIN_AT_90 = NEGATIVE_ONE_DB; // source is incident to left or right ear
         const float FILTER_GAIN_AT_180 = NEGATIVE_THREE_DB; // source is behind
-        
-        const float FILTER_CUTOFF_FREQUENCY_HZ = 1000.0f;
-        
-        const float penumbraFilterFrequency = FILTER_CUTOFF_FREQUENCY_HZ; // constant frequency
-        const float penumbraFilterSlope = NEGATIVE_THREE_DB; // constant slope
-        
-        float penumbraFilterGainL;
-        float penumbraFilterGainR;
 
         // variable gain calculation broken down by quadrant
         if (-bearingRelativeAngleToSource < -PI_OVER_TWO && -bearingRelativeAngleToSource > -PI) {
@@ -414,59 +440,222 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         }
         
         // Get our per listener/source data so we can get our filter
-        AudioFilterHSF1s& penumbraFilter = listenerNodeData->getListenerSourcePairData(streamUUID)->getPenumbraFilter();
- 
-        // set the gain on both filter channels
-        penumbraFilter.setParameters(0, 0, AudioConstants::SAMPLE_RATE, penumbraFilterFrequency, penumbraFilterGainL, penumbraFilterSlope);
-        penumbraFilter.setParameters(0, 1, AudioConstants::SAMPLE_RATE, penumbraFilterFrequency, penumbraFilterGainR, penumbraFilterSlope);
-        penumbraFilter.render(_preMixSamples, _preMixSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO / 2);
+        penumbraFilter = &listenerNodeData->getListenerSourcePairData(streamUUID)->getPenumbraFilter();
     }
     
-    // Actually mix the _preMixSamples into the _mixSamples here.
-    for (int s = 0; s < AudioConstants::NETWORK_FRAME_SAMPLES_STEREO; s++) {
-        _mixSamples[s] = glm::clamp(_mixSamples[s] + _preMixSamples[s], AudioConstants::MIN_SAMPLE_VALUE,
-                                    AudioConstants::MAX_SAMPLE_VALUE);
-    }
+    // Filter with the gain on both filter channels, and actually mix the preMixSamples into the mixSamples here.
+    AudioSourceMix::filterAndMix(mixSamples, preMixSamples, penumbraFilter, penumbraFilterGainL, penumbraFilterGainR);
 
     return 1;
 }
 
-int AudioMixer::prepareMixForListeningNode(Node* node) {
+int AudioMixer::prepareMixForListeningNode(Node* node, const ClusterBed* clusterBed,
+                                           int16_t* preMixSamples, int16_t* mixSamples) const {
     AvatarAudioStream* nodeAudioStream = static_cast<AudioMixerClientData*>(node->getLinkedData())->getAvatarAudioStream();
     AudioMixerClientData* listenerNodeData = static_cast<AudioMixerClientData*>(node->getLinkedData());
     
-    // zero out the client mix for this node
-    memset(_preMixSamples, 0, sizeof(_preMixSamples));
-    memset(_mixSamples, 0, sizeof(_mixSamples));
-
-    // loop through all other nodes that have sufficient audio to mix
+    // loop through all other streams that have sufficient audio to mix
     int streamsMixed = 0;
     
-    DependencyManager::get<NodeList>()->eachNode([&](const SharedNodePointer& otherNode){
-        if (otherNode->getLinkedData()) {
-            AudioMixerClientData* otherNodeClientData = (AudioMixerClientData*) otherNode->getLinkedData();
-            
-            // enumerate the ARBs attached to the otherNode and add all that should be added to mix
+    // zero out the client mix for this node, or start it from the distant sources its cluster already mixed
+    memset(preMixSamples, 0, MIX_BUFFER_SAMPLES * sizeof(int16_t));
+    if (clusterBed) {
+        memcpy(mixSamples, clusterBed->mixSamples, MIX_BUFFER_SAMPLES * sizeof(int16_t));
+        streamsMixed = clusterBed->streamsMixed;
+    } else {
+        memset(mixSamples, 0, MIX_BUFFER_SAMPLES * sizeof(int16_t));
+    }
+    
+    auto mixSource = [&](const AudioSourceGrid::Source& source) {
+        if (clusterBed && isDistantFromCluster(source.position, *clusterBed)) {
+            // this source is already in the cluster's bed
+            return;
+        }
+        
+        if (source.node.data() != node || source.stream->shouldLoopbackForNode()) {
+            streamsMixed += addStreamToMixForListeningNodeWithStream(listenerNodeData, source.streamUUID,
+                                                                     source.stream, nodeAudioStream,
+                                                                     preMixSamples, mixSamples);
+        }
+    };
+    
+    if (_enableSpatialCulling) {
+        _sourceGrid.eachSourceNear(nodeAudioStream->getPosition(), mixSource);
+    } else {
+        _sourceGrid.eachSource(mixSource);
+    }
+    
+    return streamsMixed;
+}
+
+int AudioMixer::addStreamToClusterBed(PositionalAudioStream* streamToAdd, const glm::vec3& clusterCenter,
+                                      int16_t* bedSamples) const {
+    float repeatedFrameFadeFactor = 1.0f;
+    
+    if (!shouldMixStreamFrame(streamToAdd, repeatedFrameFadeFactor)) {
+        return 0;
+    }
+    
+    float distanceBetween = glm::max(glm::distance(streamToAdd->getPosition(), clusterCenter), EPSILON);
+    
+    if (streamToAdd->getLastPopOutputTrailingLoudness() / distanceBetween <= _minAudibilityThreshold) {
+        return 0;
+    }
+    
+    float attenuationAndFade = attenuationCoefficientForStream(streamToAdd, clusterCenter, false, distanceBetween)
+        * repeatedFrameFadeFactor;
+    
+    AudioRingBuffer::ConstIterator streamPopOutput = streamToAdd->getLastPopOutput();
+    
+    if (!streamToAdd->isStereo()) {
+        // listeners in the cluster face every which way, so a distant mono source goes equally to both ears
+        int16_t inputSamples[AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL];
+        streamPopOutput.readSamples(inputSamples, AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL);
+        
+        AudioMixKernels::addMonoToStereo(bedSamples, inputSamples, inputSamples,
+                                         AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL,
+                                         attenuationAndFade, attenuationAndFade);
+    } else {
+        int16_t inputSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO];
+        streamPopOutput.readSamples(inputSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO);
+        
+        AudioMixKernels::addWithGain(bedSamples, inputSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO,
+                                     attenuationAndFade);
+    }
+    
+    return 1;
+}
+
+bool AudioMixer::isDistantFromCluster(const glm::vec3& position, const ClusterBed& clusterBed) const {
+    glm::vec3 offset = position - clusterBed.center;
+    return glm::dot(offset, offset) >= _clusterMixDistance * _clusterMixDistance;
+}
+
+float AudioMixer::audibleRadiusForStream(const PositionalAudioStream* stream) const {
+    // the stream is skipped once its trailing loudness over the distance drops to the audibility threshold
+    float audibleRadius = stream->getLastPopOutputTrailingLoudness() / _minAudibilityThreshold;
+    
+    // and is silent once the distance coefficient reaches zero, using the gentlest attenuation any listener could get
+    float attenuationPerDoublingInDistance = _attenuationPerDoublingInDistance;
+    for (int i = 0; i < _zonesSettings.length(); ++i) {
+        if (_audioZones[_zonesSettings[i].source].contains(stream->getPosition())) {
+            attenuationPerDoublingInDistance = glm::min(attenuationPerDoublingInDistance, _zonesSettings[i].coefficient);
+        }
+    }
+    
+    if (attenuationPerDoublingInDistance > 0.0f) {
+        float silentDistance = ATTENUATION_BEGINS_AT_DISTANCE * powf(2.0f, 1.0f / attenuationPerDoublingInDistance);
+        audibleRadius = glm::min(audibleRadius, silentDistance);
+    }
+    
+    return audibleRadius;
+}
+
+void AudioMixer::mixListenerRange(int begin, int end, int16_t* preMixSamples) {
+    for (int i = begin; i < end; i++) {
+        ListenerMix& listenerMix = _listenerMixes[i];
+        const ClusterBed* clusterBed = (listenerMix.clusterIndex >= 0) ? &_clusterBeds[listenerMix.clusterIndex] : NULL;
+        listenerMix.streamsMixed = prepareMixForListeningNode(listenerMix.node.data(), clusterBed,
+                                                              preMixSamples, listenerMix.mixSamples);
+    }
+}
+
+void AudioMixer::mixClusterRange(int begin, int end, int16_t* preMixSamples) {
+    for (int i = begin; i < end; i++) {
+        ClusterBed& clusterBed = _clusterBeds[i];
+        
+        memset(clusterBed.mixSamples, 0, sizeof(clusterBed.mixSamples));
+        clusterBed.streamsMixed = 0;
+        
+        auto mixSource = [&](const AudioSourceGrid::Source& source) {
+            if (isDistantFromCluster(source.position, clusterBed)) {
+                clusterBed.streamsMixed += addStreamToClusterBed(source.stream, clusterBed.center, clusterBed.mixSamples);
+            }
+        };
+        
+        if (_enableSpatialCulling) {
+            _sourceGrid.eachSourceNear(clusterBed.center, mixSource);
+        } else {
+            _sourceGrid.eachSource(mixSource);
+        }
+    }
+}
+
+void AudioMixer::assignListenersToClusters() {
+    _clusterBeds.clear();
+    _clusterIndexForCell.clear();
+    
+    if (!_enableClusterMix) {
+        for (size_t i = 0; i < _listenerMixes.size(); i++) {
+            _listenerMixes[i].clusterIndex = -1;
+        }
+        return;
+    }
+    
+    // with cells half the cluster distance across, every source within half that distance of a listener is
+    // guaranteed to be mixed for the listener itself instead of through the bed - including its own stream
+    float cellSize = _clusterMixDistance / 2.0f;
+    
+    for (size_t i = 0; i < _listenerMixes.size(); i++) {
+        ListenerMix& listenerMix = _listenerMixes[i];
+        AudioMixerClientData* nodeData = static_cast<AudioMixerClientData*>(listenerMix.node->getLinkedData());
+        
+        glm::ivec3 cell(glm::floor(nodeData->getAvatarAudioStream()->getPosition() / cellSize));
+        quint64 cellKey = AudioSourceGrid::keyForCell(cell);
+        
+        QHash<quint64, int>::const_iterator existingCluster = _clusterIndexForCell.constFind(cellKey);
+        if (existingCluster != _clusterIndexForCell.constEnd()) {
+            listenerMix.clusterIndex = existingCluster.value();
+        } else {
+            listenerMix.clusterIndex = (int)_clusterBeds.size();
+            _clusterIndexForCell.insert(cellKey, listenerMix.clusterIndex);
             
-            const QHash<QUuid, PositionalAudioStream*>& otherNodeAudioStreams = otherNodeClientData->getAudioStreams();
-            QHash<QUuid, PositionalAudioStream*>::ConstIterator i;
-            for (i = otherNodeAudioStreams.constBegin(); i != otherNodeAudioStreams.constEnd(); i++) {
-                PositionalAudioStream* otherNodeStream = i.value();
-                QUuid streamUUID = i.key();
-                
-                if (otherNodeStream->getType() == PositionalAudioStream::Microphone) {
-                    streamUUID = otherNode->getUUID();
-                }
-                
-                if (*otherNode != *node || otherNodeStream->shouldLoopbackForNode()) {
-                    streamsMixed += addStreamToMixForListeningNodeWithStream(listenerNodeData, streamUUID,
-                                                                             otherNodeStream, nodeAudioStream);
-                }
+            _clusterBeds.resize(_clusterBeds.size() + 1);
+            _clusterBeds.back().center = (glm::vec3(cell) + glm::vec3(0.5f)) * cellSize;
+            _clusterBeds.back().numListeners = 0;
+        }
+        
+        _clusterBeds[listenerMix.clusterIndex].numListeners++;
+    }
+    
+    // a listener alone in its cell gets a full mix of its own, and its cell is dropped from the beds to mix
+    int numClusters = 0;
+    std::vector<int> newIndexForCluster(_clusterBeds.size(), -1);
+    for (size_t i = 0; i < _clusterBeds.size(); i++) {
+        if (_clusterBeds[i].numListeners >= MIN_LISTENERS_PER_CLUSTER) {
+            newIndexForCluster[i] = numClusters;
+            if ((int)i != numClusters) {
+                _clusterBeds[numClusters].center = _clusterBeds[i].center;
+                _clusterBeds[numClusters].numListeners = _clusterBeds[i].numListeners;
             }
+            numClusters++;
         }
-    });
+    }
+    _clusterBeds.resize(numClusters);
     
-    return streamsMixed;
+    for (size_t i = 0; i < _listenerMixes.size(); i++) {
+        _listenerMixes[i].clusterIndex = newIndexForCluster[_listenerMixes[i].clusterIndex];
+    }
+}
+
+void AudioMixer::runMixJobs(int numItems, MixRangeFunction mixRange) {
+    // hand a contiguous slice to each pool job, the mixer thread takes the last slice itself
+    int numSlices = qMin(_numMixThreads, numItems);
+    int numJobs = numSlices - 1;
+    int begin = 0;
+    
+    for (int i = 0; i < numJobs; i++) {
+        int end = begin + (numItems - begin) / (numSlices - i);
+        _mixJobs[i]->setRange(mixRange, begin, end);
+        _mixThreadPool.start(_mixJobs[i]);
+        begin = end;
+    }
+    
+    (this->*mixRange)(begin, numItems, _preMixSamples);
+    
+    if (numJobs > 0) {
+        _mixJobsDone.acquire(numJobs);
+    }
 }
 
 void AudioMixer::sendAudioEnvironmentPacket(SharedNodePointer node) {
@@ -561,6 +750,9 @@ void AudioMixer::sendStatsPacket() {
     statsObject["useDynamicJitterBuffers"] = _streamSettings._dynamicJitterBuffers;
     statsObject["trailing_sleep_percentage"] = _trailingSleepRatio * 100.0f;
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
+    statsObject["mix_threads"] = _numMixThreads;
+    statsObject["source_grid_cell_size"] = _sourceGrid.getCellSize();
+    statsObject["average_cluster_beds_per_frame"] = (_numStatFrames > 0) ? (float) _sumClusterBeds / (float) _numStatFrames : 0.0f;
 
     statsObject["average_listeners_per_frame"] = (float) _sumListeners / (float) _numStatFrames;
     
@@ -573,6 +765,7 @@ void AudioMixer::sendStatsPacket() {
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     _sumListeners = 0;
     _sumMixes = 0;
+    _sumClusterBeds = 0;
     _numStatFrames = 0;
 
 
@@ -657,8 +850,8 @@ void AudioMixer::run() {
     nodeList->getNodeSocket().setParent(NULL);
     nodeList->getNodeSocket().moveToThread(_datagramProcessingThread);
     
-    // let the datagram processor handle readyRead from node socket
-    connect(&nodeList->getNodeSocket(), &QUdpSocket::readyRead,
+    // let the datagram processor read batches of datagrams whenever the node socket has them
+    connect(datagramProcessor->getDatagramReader(), &DatagramBatchReader::datagramsPending,
             datagramProcessor, &AudioMixerDatagramProcessor::readPendingDatagrams);
     
     // connect to the datagram processing thread signal that tells us we have to handle a packet
@@ -768,6 +961,9 @@ void AudioMixer::run() {
             _lastPerSecondCallbackTime = now;
         }
         
+        _sourceGrid.clear();
+        _listenerMixes.clear();
+        
         nodeList->eachNode([&](const SharedNodePointer& node) {
             
             if (node->getLinkedData()) {
@@ -785,59 +981,93 @@ void AudioMixer::run() {
                     nodeList->writeDatagram(packet, node);
                 }
                 
-                if (node->getType() == NodeType::Agent && node->getActiveSocket()
-                    && nodeData->getAvatarAudioStream()) {
-
-                    int streamsMixed = prepareMixForListeningNode(node.data());
-
-                    char* mixDataAt;
-                    if (streamsMixed > 0) {
-                        // pack header
-                        int numBytesMixPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeMixedAudio);
-                        mixDataAt = clientMixBuffer + numBytesMixPacketHeader;
-
-                        // pack sequence number
-                        quint16 sequence = nodeData->getOutgoingSequenceNumber();
-                        memcpy(mixDataAt, &sequence, sizeof(quint16));
-                        mixDataAt  += sizeof(quint16);
-                        
-                        // pack mixed audio samples
-                        memcpy(mixDataAt, _mixSamples, AudioConstants::NETWORK_FRAME_BYTES_STEREO);
-                        mixDataAt += AudioConstants::NETWORK_FRAME_BYTES_STEREO;
-                    } else {
-                        // pack header
-                        int numBytesPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeSilentAudioFrame);
-                        mixDataAt = clientMixBuffer + numBytesPacketHeader;
-
-                        // pack sequence number
-                        quint16 sequence = nodeData->getOutgoingSequenceNumber();
-                        memcpy(mixDataAt, &sequence, sizeof(quint16));
-                        mixDataAt += sizeof(quint16);
-
-                        // pack number of silent audio samples
-                        quint16 numSilentSamples = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO;
-                        memcpy(mixDataAt, &numSilentSamples, sizeof(quint16));
-                        mixDataAt += sizeof(quint16);
-                    }
+                // enumerate the ARBs attached to the node and add all that could be heard to this frame's sources
+                const QHash<QUuid, PositionalAudioStream*>& nodeAudioStreams = nodeData->getAudioStreams();
+                QHash<QUuid, PositionalAudioStream*>::ConstIterator i;
+                for (i = nodeAudioStreams.constBegin(); i != nodeAudioStreams.constEnd(); i++) {
+                    PositionalAudioStream* stream = i.value();
                     
-                    // Send audio environment
-                    sendAudioEnvironmentPacket(node);
-
-                    // send mixed audio packet
-                    nodeList->writeDatagram(clientMixBuffer, mixDataAt - clientMixBuffer, node);
-                    nodeData->incrementOutgoingMixedAudioSequenceNumber();
-
-                    // send an audio stream stats packet if it's time
-                    if (_sendAudioStreamStats) {
-                        nodeData->sendAudioStreamStatsPackets(node);
-                        _sendAudioStreamStats = false;
+                    // a stream with no trailing loudness is below the audibility threshold at any distance
+                    if (stream->getLastPopOutputTrailingLoudness() > 0.0f) {
+                        QUuid streamUUID = (stream->getType() == PositionalAudioStream::Microphone) ? node->getUUID() : i.key();
+                        _sourceGrid.addSource(node, streamUUID, stream, audibleRadiusForStream(stream));
                     }
-
-                    ++_sumListeners;
+                }
+                
+                if (node->getType() == NodeType::Agent && node->getActiveSocket()
+                    && nodeData->getAvatarAudioStream()) {
+                    _listenerMixes.resize(_listenerMixes.size() + 1);
+                    _listenerMixes.back().node = node;
                 }
             }
         });
         
+        // every stream has popped its frame for this one, so the listeners can now be mixed independently
+        _sourceGrid.rebuildCells();
+        
+        assignListenersToClusters();
+        runMixJobs((int)_clusterBeds.size(), &AudioMixer::mixClusterRange);
+        _sumClusterBeds += (int)_clusterBeds.size();
+        
+        runMixJobs((int)_listenerMixes.size(), &AudioMixer::mixListenerRange);
+        
+        // every listener's packets for this frame go out together when the batch ends
+        nodeList->beginDatagramBatch();
+        
+        for (size_t i = 0; i < _listenerMixes.size(); i++) {
+            const ListenerMix& listenerMix = _listenerMixes[i];
+            const SharedNodePointer& node = listenerMix.node;
+            AudioMixerClientData* nodeData = (AudioMixerClientData*)node->getLinkedData();
+
+            char* mixDataAt;
+            if (listenerMix.streamsMixed > 0) {
+                // pack header
+                int numBytesMixPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeMixedAudio);
+                mixDataAt = clientMixBuffer + numBytesMixPacketHeader;
+
+                // pack sequence number
+                quint16 sequence = nodeData->getOutgoingSequenceNumber();
+                memcpy(mixDataAt, &sequence, sizeof(quint16));
+                mixDataAt  += sizeof(quint16);
+                
+                // pack mixed audio samples
+                memcpy(mixDataAt, listenerMix.mixSamples, AudioConstants::NETWORK_FRAME_BYTES_STEREO);
+                mixDataAt += AudioConstants::NETWORK_FRAME_BYTES_STEREO;
+            } else {
+                // pack header
+                int numBytesPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeSilentAudioFrame);
+                mixDataAt = clientMixBuffer + numBytesPacketHeader;
+
+                // pack sequence number
+                quint16 sequence = nodeData->getOutgoingSequenceNumber();
+                memcpy(mixDataAt, &sequence, sizeof(quint16));
+                mixDataAt += sizeof(quint16);
+
+                // pack number of silent audio samples
+                quint16 numSilentSamples = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO;
+                memcpy(mixDataAt, &numSilentSamples, sizeof(quint16));
+                mixDataAt += sizeof(quint16);
+            }
+            
+            // Send audio environment
+            sendAudioEnvironmentPacket(node);
+
+            // send mixed audio packet
+            nodeList->writeDatagram(clientMixBuffer, mixDataAt - clientMixBuffer, node);
+            nodeData->incrementOutgoingMixedAudioSequenceNumber();
+
+            // send an audio stream stats packet if it's time
+            if (_sendAudioStreamStats) {
+                nodeData->sendAudioStreamStatsPackets(node);
+                _sendAudioStreamStats = false;
+            }
+
+            _sumMixes += listenerMix.streamsMixed;
+            ++_sumListeners;
+        }
+        
+        nodeList->endDatagramBatch();
+        
         ++_numStatFrames;
         
         QCoreApplication::processEvents();
@@ -1043,6 +1273,43 @@ void AudioMixer::parseSettingsObject(const QJsonObject &settingsObject) {
             qDebug() << "Filter enabled";
         }
         
+        const QString SPATIAL_CULLING_KEY = "enable_spatial_culling";
+        if (audioEnvGroupObject[SPATIAL_CULLING_KEY].isBool()) {
+            _enableSpatialCulling = audioEnvGroupObject[SPATIAL_CULLING_KEY].toBool();
+        }
+        if (_enableSpatialCulling) {
+            qDebug() << "Spatial culling of inaudible sources enabled";
+        }
+        
+        const QString CLUSTER_MIX_KEY = "enable_cluster_mix";
+        if (audioEnvGroupObject[CLUSTER_MIX_KEY].isBool()) {
+            _enableClusterMix = audioEnvGroupObject[CLUSTER_MIX_KEY].toBool();
+        }
+        
+        const QString CLUSTER_MIX_DISTANCE_KEY = "cluster_mix_distance";
+        if (audioEnvGroupObject[CLUSTER_MIX_DISTANCE_KEY].isString()) {
+            bool ok = false;
+            float clusterMixDistance = audioEnvGroupObject[CLUSTER_MIX_DISTANCE_KEY].toString().toFloat(&ok);
+            if (ok && clusterMixDistance > 0.0f) {
+                _clusterMixDistance = clusterMixDistance;
+            }
+        }
+        if (_enableClusterMix) {
+            qDebug() << "Cluster mix enabled, sources further than" << _clusterMixDistance
+                << "from a cluster are shared by its listeners";
+        }
+        
+        const QString MIX_THREADS = "mix_threads";
+        if (audioEnvGroupObject[MIX_THREADS].isString()) {
+            bool ok = false;
+            int numMixThreads = audioEnvGroupObject[MIX_THREADS].toString().toInt(&ok);
+            if (ok) {
+                // zero asks for one mixing thread per core
+                setNumMixThreads(numMixThreads > 0 ? numMixThreads : QThread::idealThreadCount());
+                qDebug() << "Mixing listeners on" << _numMixThreads << "threads";
+            }
+        }
+        
         const QString AUDIO_ZONES = "zones";
         if (audioEnvGroupObject[AUDIO_ZONES].isObject()) {
             const QJsonObject& zones = audioEnvGroupObject[AUDIO_ZONES].toObject();
@@ -12,16 +12,28 @@
 #ifndef hifi_AudioMixer_h
 #define hifi_AudioMixer_h
 
+#include <vector>
+
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+
 #include <AABox.h>
 #include <AudioRingBuffer.h>
 #include <ThreadedAssignment.h>
 
+#include "AudioSourceGrid.h"
+
 class PositionalAudioStream;
 class AvatarAudioStream;
 class AudioMixerClientData;
+class MixRangeJob;
 
 const int SAMPLE_PHASE_DELAY_AT_90 = 20;
 
+// used on a per stream basis to run the filter on before mixing, large enough to handle the historical
+// data from a phase delay as well as an entire network buffer
+const int MIX_BUFFER_SAMPLES = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2);
+
 const int READ_DATAGRAMS_STATS_WINDOW_SECONDS = 30;
 
 /// Handles assignments of type AudioMixer - mixing streams of audio and re-distributing to various clients.
@@ -29,6 +41,7 @@ class AudioMixer : public ThreadedAssignment {
     Q_OBJECT
 public:
     AudioMixer(const QByteArray& packet);
+    ~AudioMixer();
 public slots:
     /// threaded run of assignment
     void run();
@@ -41,25 +54,92 @@ public slots:
     static const InboundAudioStream::Settings& getStreamSettings() { return _streamSettings; }
     
 private:
+    friend class MixRangeJob;
+    
+    typedef void (AudioMixer::*MixRangeFunction)(int begin, int end, int16_t* preMixSamples);
+    
+    /// returns false if the stream has no frame worth mixing, otherwise sets the fade for a repeated frame
+    bool shouldMixStreamFrame(PositionalAudioStream* streamToAdd, float& repeatedFrameFadeFactor) const;
+    
+    /// injector, off-axis and distance attenuation of a stream heard from listenerPosition
+    float attenuationCoefficientForStream(PositionalAudioStream* streamToAdd, const glm::vec3& listenerPosition,
+                                          bool sourceIsSelf, float distanceBetween) const;
+    
     /// adds one stream to the mix for a listening node
+    /// preMixSamples and mixSamples are owned by the caller so that several listeners can be mixed at once
     int addStreamToMixForListeningNodeWithStream(AudioMixerClientData* listenerNodeData,
-                                                    const QUuid& streamUUID,
-                                                    PositionalAudioStream* streamToAdd,
-                                                    AvatarAudioStream* listeningNodeStream);
+                                                 const QUuid& streamUUID,
+                                                 PositionalAudioStream* streamToAdd,
+                                                 AvatarAudioStream* listeningNodeStream,
+                                                 int16_t* preMixSamples, int16_t* mixSamples) const;
+    
+    struct ClusterBed;
+    
+    /// prepares a mix for one Node from the sources gathered for this frame
+    /// if the node is part of a cluster it starts from the cluster's bed and only adds the sources near the cluster
+    int prepareMixForListeningNode(Node* node, const ClusterBed* clusterBed,
+                                   int16_t* preMixSamples, int16_t* mixSamples) const;
+    
+    /// adds one distant stream to a cluster's bed, attenuated as heard from the cluster center without panning or filtering
+    int addStreamToClusterBed(PositionalAudioStream* streamToAdd, const glm::vec3& clusterCenter, int16_t* bedSamples) const;
+    
+    bool isDistantFromCluster(const glm::vec3& position, const ClusterBed& clusterBed) const;
     
-    /// prepares and sends a mix to one Node
-    int prepareMixForListeningNode(Node* node);
+    /// distance beyond which addStreamToMixForListeningNodeWithStream would not mix the stream for any listener
+    float audibleRadiusForStream(const PositionalAudioStream* stream) const;
+    
+    /// mixes the listeners [begin, end) of this frame, safe to call from any mixing thread
+    void mixListenerRange(int begin, int end, int16_t* preMixSamples);
+    
+    /// mixes the beds of the clusters [begin, end) of this frame, safe to call from any mixing thread
+    void mixClusterRange(int begin, int end, int16_t* preMixSamples);
+    
+    /// groups this frame's listeners into clusters by the cell they are in
+    void assignListenersToClusters();
+    
+    /// runs mixRange over numItems, spread across the mixing threads if there is more than one
+    void runMixJobs(int numItems, MixRangeFunction mixRange);
     
     /// Send Audio Environment packet for a single node
     void sendAudioEnvironmentPacket(SharedNodePointer node);
+    
+    void setNumMixThreads(int numMixThreads);
 
-    // used on a per stream basis to run the filter on before mixing, large enough to handle the historical
-    // data from a phase delay as well as an entire network buffer
-    int16_t _preMixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    // the mix for one listener, filled by whichever thread mixed it and sent afterwards from the mixer thread
+    struct ListenerMix {
+        SharedNodePointer node;
+        int clusterIndex;
+        int streamsMixed;
+        
+        // client samples capacity is larger than what will be sent to optimize mixing
+        int16_t mixSamples[MIX_BUFFER_SAMPLES];
+    };
+    
+    // the distant sources of one cell mixed once for every listener in the cell, used by the cluster mix
+    struct ClusterBed {
+        glm::vec3 center;
+        int numListeners;
+        int streamsMixed;
+        int16_t mixSamples[MIX_BUFFER_SAMPLES];
+    };
+    
+    // every stream that could be heard this frame, gathered once so mixing threads don't walk the node list
+    AudioSourceGrid _sourceGrid;
+    bool _enableSpatialCulling;
+    std::vector<ListenerMix> _listenerMixes; // not a QVector so that its capacity survives clear() between frames
+    
+    bool _enableClusterMix;
+    float _clusterMixDistance;
+    std::vector<ClusterBed> _clusterBeds;
+    QHash<quint64, int> _clusterIndexForCell;
+    
+    // scratch buffer for the slice of listeners mixed on the mixer thread itself
+    int16_t _preMixSamples[MIX_BUFFER_SAMPLES];
     
-    // client samples capacity is larger than what will be sent to optimize mixing
-    // we are MMX adding 4 samples at a time so we need client samples to have an extra 4
-    int16_t _mixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    int _numMixThreads;
+    QThreadPool _mixThreadPool;
+    QVector<MixRangeJob*> _mixJobs;
+    QSemaphore _mixJobsDone;
 
     void perSecondActions();
     
@@ -80,6 +160,7 @@ private:
     int _numStatFrames;
     int _sumListeners;
     int _sumMixes;
+    int _sumClusterBeds;
     
     QHash<QString, AABox> _audioZones;
     struct ZonesSettings {
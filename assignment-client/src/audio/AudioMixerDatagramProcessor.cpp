@@ -18,6 +18,7 @@
 
 AudioMixerDatagramProcessor::AudioMixerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread) :
     _nodeSocket(nodeSocket),
+    _datagramReader(new DatagramBatchReader(nodeSocket, this)),
     _previousNodeSocketThread(previousNodeSocketThread)
 {
     
@@ -30,18 +31,14 @@ AudioMixerDatagramProcessor::~AudioMixerDatagramProcessor() {
 
 void AudioMixerDatagramProcessor::readPendingDatagrams() {
     
-    HifiSockAddr senderSockAddr;
-    static QByteArray incomingPacket;
-    
-    // read everything that is available
-    while (_nodeSocket.hasPendingDatagrams()) {
-        incomingPacket.resize(_nodeSocket.pendingDatagramSize());
-        
-        // just get this packet off the stack
-        _nodeSocket.readDatagram(incomingPacket.data(), incomingPacket.size(),
-                                  senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
-        
-        // emit the signal to tell AudioMixer it needs to process a packet
-        emit packetRequiresProcessing(incomingPacket, senderSockAddr);
+    // read everything that is available, a batch at a time
+    int numDatagrams;
+    while ((numDatagrams = _datagramReader->readBatch()) > 0) {
+        for (int i = 0; i < numDatagrams; i++) {
+            QByteArray incomingPacket(_datagramReader->getDatagram(i), _datagramReader->getDatagramSize(i));
+            
+            // emit the signal to tell AudioMixer it needs to process a packet
+            emit packetRequiresProcessing(incomingPacket, _datagramReader->getSenderSockAddr(i));
+        }
     }
 }
@@ -15,17 +15,22 @@
 #include <qobject.h>
 #include <qudpsocket.h>
 
+#include <DatagramBatchReader.h>
+
 class AudioMixerDatagramProcessor : public QObject {
     Q_OBJECT
 public:
     AudioMixerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread);
     ~AudioMixerDatagramProcessor();
+    
+    DatagramBatchReader* getDatagramReader() { return _datagramReader; }
 public slots:
     void readPendingDatagrams();
 signals:
     void packetRequiresProcessing(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr);
 private:
     QUdpSocket& _nodeSocket;
+    DatagramBatchReader* _datagramReader;
     QThread* _previousNodeSocketThread;
 };
 
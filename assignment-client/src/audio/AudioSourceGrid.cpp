@@ -0,0 +1,84 @@
+//
+//  AudioSourceGrid.cpp
+//  assignment-client/src/audio
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+
+#include "PositionalAudioStream.h"
+
+#include "AudioSourceGrid.h"
+
+const float AudioSourceGrid::MAX_CELL_SIZE = 1024.0f;
+
+// cells smaller than this only add hash lookups, nothing is audible from that close anyway
+const float MIN_CELL_SIZE = 1.0f;
+
+AudioSourceGrid::AudioSourceGrid() :
+    _cellSize(MIN_CELL_SIZE)
+{
+}
+
+void AudioSourceGrid::clear() {
+    _sources.clear();
+    _uncullableSources.clear();
+    
+    // keep the cell vectors around, most cells are re-used by the next frame
+    QHash<quint64, QVector<int> >::iterator cell = _cells.begin();
+    while (cell != _cells.end()) {
+        if (cell.value().isEmpty()) {
+            cell = _cells.erase(cell);
+        } else {
+            cell.value().clear();
+            ++cell;
+        }
+    }
+}
+
+void AudioSourceGrid::addSource(const SharedNodePointer& node, const QUuid& streamUUID, PositionalAudioStream* stream,
+                                float audibleRadius) {
+    Source source = { node, streamUUID, stream, stream->getPosition(), audibleRadius };
+    _sources.append(source);
+}
+
+void AudioSourceGrid::rebuildCells() {
+    float largestRadius = MIN_CELL_SIZE;
+    
+    for (int i = 0; i < _sources.size(); i++) {
+        if (_sources[i].audibleRadius >= MAX_CELL_SIZE) {
+            _uncullableSources.append(i);
+        } else {
+            largestRadius = glm::max(largestRadius, _sources[i].audibleRadius);
+        }
+    }
+    
+    // round up to a power of two so small changes in loudness don't change the cell size every frame
+    float cellSize = powf(2.0f, ceilf(log2f(largestRadius)));
+    
+    if (cellSize != _cellSize) {
+        // cell coordinates change with the cell size, so none of the existing cells can be re-used
+        _cells.clear();
+        _cellSize = cellSize;
+    }
+    
+    for (int i = 0; i < _sources.size(); i++) {
+        if (_sources[i].audibleRadius < MAX_CELL_SIZE) {
+            _cells[keyForCell(cellForPosition(_sources[i].position))].append(i);
+        }
+    }
+}
+
+glm::ivec3 AudioSourceGrid::cellForPosition(const glm::vec3& position) const {
+    return glm::ivec3(glm::floor(position / _cellSize));
+}
+
+quint64 AudioSourceGrid::keyForCell(const glm::ivec3& cell) {
+    // 21 bits per axis is plenty, the domain is at most a few thousand cells across
+    const quint64 AXIS_MASK = (1 << 21) - 1;
+    return ((quint64)(cell.x & AXIS_MASK) << 42) | ((quint64)(cell.y & AXIS_MASK) << 21) | (quint64)(cell.z & AXIS_MASK);
+}
@@ -0,0 +1,103 @@
+//
+//  AudioSourceGrid.h
+//  assignment-client/src/audio
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioSourceGrid_h
+#define hifi_AudioSourceGrid_h
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <LimitedNodeList.h>
+
+class PositionalAudioStream;
+
+/// Uniform grid of the audio sources mixed in one frame, so a listener only visits the sources that could be audible
+/// to it. Each source carries the radius beyond which the mixer would not hear it, and the grid cells are sized to the
+/// largest radius so a listener only ever has to look at its own cell and the 26 around it.
+class AudioSourceGrid {
+public:
+    struct Source {
+        SharedNodePointer node;
+        QUuid streamUUID;
+        PositionalAudioStream* stream;
+        glm::vec3 position;
+        float audibleRadius;
+    };
+    
+    AudioSourceGrid();
+    
+    void clear();
+    
+    /// sources with a radius larger than MAX_CELL_SIZE are never culled
+    void addSource(const SharedNodePointer& node, const QUuid& streamUUID, PositionalAudioStream* stream,
+                   float audibleRadius);
+    
+    /// sorts the sources added since clear() into cells, must be called before eachSourceNear
+    void rebuildCells();
+    
+    int getNumSources() const { return _sources.size(); }
+    int getNumCells() const { return _cells.size(); }
+    float getCellSize() const { return _cellSize; }
+    
+    template<typename SourceLambda>
+    void eachSource(SourceLambda functor) const {
+        for (int i = 0; i < _sources.size(); i++) {
+            functor(_sources[i]);
+        }
+    }
+    
+    /// calls functor for every source whose audible radius reaches position
+    template<typename SourceLambda>
+    void eachSourceNear(const glm::vec3& position, SourceLambda functor) const {
+        foreach (int index, _uncullableSources) {
+            functor(_sources[index]);
+        }
+        
+        if (_cells.isEmpty()) {
+            return;
+        }
+        
+        glm::ivec3 center = cellForPosition(position);
+        for (int x = center.x - 1; x <= center.x + 1; x++) {
+            for (int y = center.y - 1; y <= center.y + 1; y++) {
+                for (int z = center.z - 1; z <= center.z + 1; z++) {
+                    QHash<quint64, QVector<int> >::const_iterator cell = _cells.constFind(keyForCell(glm::ivec3(x, y, z)));
+                    if (cell == _cells.constEnd()) {
+                        continue;
+                    }
+                    
+                    foreach (int index, cell.value()) {
+                        const Source& source = _sources[index];
+                        glm::vec3 offset = source.position - position;
+                        if (glm::dot(offset, offset) < source.audibleRadius * source.audibleRadius) {
+                            functor(source);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    static const float MAX_CELL_SIZE;
+    
+    static quint64 keyForCell(const glm::ivec3& cell);
+    
+private:
+    glm::ivec3 cellForPosition(const glm::vec3& position) const;
+    
+    QVector<Source> _sources;
+    QVector<int> _uncullableSources;
+    QHash<quint64, QVector<int> > _cells;
+    float _cellSize;
+};
+
+#endif // hifi_AudioSourceGrid_h
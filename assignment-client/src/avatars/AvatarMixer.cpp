@@ -9,14 +9,18 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
+#include <QtCore/QEventLoop>
 #include <QtCore/QJsonObject>
 #include <QtCore/QTimer>
 #include <QtCore/QThread>
 
 #include <LogHandler.h>
 #include <NodeList.h>
+#include <OctreeConstants.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 #include <UUID.h>
@@ -29,24 +33,60 @@ const QString AVATAR_MIXER_LOGGING_NAME = "avatar-mixer";
 
 const unsigned int AVATAR_DATA_SEND_INTERVAL_MSECS = (1.0f / 60.0f) * 1000;
 
+const QString AVATAR_MIXER_SETTINGS_GROUP_KEY = "avatar_mixer";
+
+const int DEFAULT_MAX_KBPS_PER_RECEIVER = 5000;
+
+// builds the packets for one contiguous slice of the frame's receivers on a thread of the mixer's pool
+class BroadcastRangeJob : public QRunnable {
+public:
+    BroadcastRangeJob(AvatarMixer* mixer) : _mixer(mixer), _begin(0), _end(0) { setAutoDelete(false); }
+    
+    void setRange(int begin, int end) {
+        _begin = begin;
+        _end = end;
+    }
+    
+    virtual void run() {
+        _mixer->broadcastRange(_begin, _end);
+        _mixer->_broadcastJobsDone.release();
+    }
+    
+private:
+    AvatarMixer* _mixer;
+    int _begin;
+    int _end;
+};
+
 AvatarMixer::AvatarMixer(const QByteArray& packet) :
     ThreadedAssignment(packet),
+    _numBroadcastThreads(0),
     _broadcastThread(),
+    _frameNumber(0),
+    _maxKbpsPerReceiver(DEFAULT_MAX_KBPS_PER_RECEIVER),
+    _streamJointDeltas(true),
     _lastFrameTimestamp(QDateTime::currentMSecsSinceEpoch()),
     _trailingSleepRatio(1.0f),
     _performanceThrottlingRatio(0.0f),
     _sumListeners(0),
     _numStatFrames(0),
     _sumBillboardPackets(0),
-    _sumIdentityPackets(0)
+    _sumIdentityPackets(0),
+    _sumAvatarsDeferred(0),
+    _sumJointKeyframes(0)
 {
     // make sure we hear about node kills so we can tell the other nodes
     connect(DependencyManager::get<NodeList>().data(), &NodeList::nodeKilled, this, &AvatarMixer::nodeKilled);
+    
+    setNumBroadcastThreads(QThread::idealThreadCount());
 }
 
 AvatarMixer::~AvatarMixer() {
     _broadcastThread.quit();
     _broadcastThread.wait();
+    
+    _broadcastThreadPool.waitForDone();
+    qDeleteAll(_broadcastJobs);
 }
 
 void attachAvatarDataToNode(Node* newNode) {
@@ -55,7 +95,24 @@ void attachAvatarDataToNode(Node* newNode) {
     }
 }
 
-const float BILLBOARD_AND_IDENTITY_SEND_PROBABILITY = 1.0f / 300.0f;
+// billboards and identities are resent this often in case a receiver missed the packet after a change
+const quint64 BILLBOARD_AND_IDENTITY_RESEND_FRAMES = 300;
+
+//  The full rate distance is the distance within which an avatar is due to be sent every frame,
+//  at twice the full rate distance it is due every other frame
+const float FULL_RATE_DISTANCE = 2.0f;
+
+// avatars directly behind the receiver are due this much less often than those in front of it
+const float MIN_VIEW_PRIORITY = 0.25f;
+
+// the priority of an avatar the receiver has never been sent, ahead of every avatar it already knows about
+const float NEVER_SENT_PRIORITY = 1.0e6f;
+
+// how often a receiver gets a new joint keyframe to send deltas against, so the deltas don't keep growing
+const quint64 JOINT_KEYFRAME_INTERVAL_FRAMES = 300;
+
+// a keyframe that hasn't been acknowledged after this long is assumed lost and sent again
+const quint64 JOINT_KEYFRAME_ACK_TIMEOUT_FRAMES = 60;
 
 // NOTE: some additional optimizations to consider.
 //    1) use the view frustum to cull those avatars that are out of view. Since avatar data doesn't need to be present
@@ -113,105 +170,295 @@ void AvatarMixer::broadcastAvatarData() {
         ++framesSinceCutoffEvent;
     }
     
-    static QByteArray mixedAvatarByteArray;
-    
-    int numPacketHeaderBytes = populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
+    ++_frameNumber;
     
     auto nodeList = DependencyManager::get<NodeList>();
     
-    AvatarMixerClientData* nodeData = NULL;
-    AvatarMixerClientData* otherNodeData = NULL;
-    
+    // snapshot every avatar once for this frame, encoding it so every receiver can share the same bytes
+    // each avatar is locked only while it is copied, the packets are built afterwards without holding any lock
     nodeList->eachNode([&](const SharedNodePointer& node) {
-        if (node->getLinkedData() && node->getType() == NodeType::Agent && node->getActiveSocket()
-            && (nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData()))->getMutex().tryLock()) {
-            ++_sumListeners;
+        AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
+        int nodeIndex = node->getIndex();
+        if (nodeData && nodeIndex >= 0) {
+            QMutexLocker nodeDataLocker(&nodeData->getMutex());
             
-            // reset packet pointers for this node
-            mixedAvatarByteArray.resize(numPacketHeaderBytes);
+            // keyframes are numbered by the frame they were sent in, wrapping is fine since only the latest counts
+            quint16 keyframeSequence = (quint16)_frameNumber;
+            nodeData->encodeAvatarData(node->getUUID(), keyframeSequence);
+            nodeData->applyKeyframeAcks();
             
-            AvatarData& avatar = nodeData->getAvatar();
-            glm::vec3 myPosition = avatar.getPosition();
+            AvatarSnapshot snapshot;
+            snapshot.node = node;
+            snapshot.nodeIndex = nodeIndex;
+            snapshot.avatarData = nodeData->getEncodedAvatarData();
+            snapshot.fullJoints = nodeData->getEncodedFullJoints();
+            snapshot.keyframeJoints = nodeData->getEncodedKeyframeJoints();
+            snapshot.keyframeSequence = keyframeSequence;
+            snapshot.jointData = nodeData->getAvatar().getJointData();
+            snapshot.position = nodeData->getAvatar().getPosition();
+            snapshot.viewDirection = nodeData->getAvatar().getHeadOrientation() * IDENTITY_FRONT;
+            snapshot.billboardChangeTimestamp = nodeData->getBillboardChangeTimestamp();
+            snapshot.identityChangeTimestamp = nodeData->getIdentityChangeTimestamp();
             
-            // this is an AGENT we have received head data from
-            // send back a packet with other active node data to this node
-            nodeList->eachNode([&](const SharedNodePointer& otherNode) {
-                if (otherNode->getLinkedData() && otherNode->getUUID() != node->getUUID()
-                    && (otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData()))->getMutex().tryLock()) {
-                    
-                    AvatarMixerClientData* otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
-                    AvatarData& otherAvatar = otherNodeData->getAvatar();
-                    glm::vec3 otherPosition = otherAvatar.getPosition();
+            if (snapshot.billboardChangeTimestamp > 0) {
+                snapshot.billboardPacket = nodeData->getBillboardPacket(node->getUUID());
+            }
+            if (snapshot.identityChangeTimestamp > 0) {
+                snapshot.identityPacket = nodeData->getIdentityPacket(node->getUUID());
+            }
             
-                    float distanceToAvatar = glm::length(myPosition - otherPosition);
-                    //  The full rate distance is the distance at which EVERY update will be sent for this avatar
-                    //  at a distance of twice the full rate distance, there will be a 50% chance of sending this avatar's update
-                    const float FULL_RATE_DISTANCE = 2.0f;
-                    
-                    //  Decide whether to send this avatar's data based on it's distance from us
-                    if ((_performanceThrottlingRatio == 0 || randFloat() < (1.0f - _performanceThrottlingRatio))
-                        && (distanceToAvatar == 0.0f || randFloat() < FULL_RATE_DISTANCE / distanceToAvatar)) {
-                        QByteArray avatarByteArray;
-                        avatarByteArray.append(otherNode->getUUID().toRfc4122());
-                        avatarByteArray.append(otherAvatar.toByteArray());
-                        
-                        if (avatarByteArray.size() + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
-                            nodeList->writeDatagram(mixedAvatarByteArray, node);
-                            
-                            // reset the packet
-                            mixedAvatarByteArray.resize(numPacketHeaderBytes);
-                        }
-                        
-                        // copy the avatar into the mixedAvatarByteArray packet
-                        mixedAvatarByteArray.append(avatarByteArray);
-                        
-                        // if the receiving avatar has just connected make sure we send out the mesh and billboard
-                        // for this avatar (assuming they exist)
-                        bool forceSend = !nodeData->checkAndSetHasReceivedFirstPackets();
-                        
-                        // we will also force a send of billboard or identity packet
-                        // if either has changed in the last frame
-                        
-                        if (otherNodeData->getBillboardChangeTimestamp() > 0
-                            && (forceSend
-                                || otherNodeData->getBillboardChangeTimestamp() > _lastFrameTimestamp
-                                || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                            QByteArray billboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
-                            billboardPacket.append(otherNode->getUUID().toRfc4122());
-                            billboardPacket.append(otherNodeData->getAvatar().getBillboard());
-                            nodeList->writeDatagram(billboardPacket, node);
-                            
-                            ++_sumBillboardPackets;
-                        }
-                        
-                        if (otherNodeData->getIdentityChangeTimestamp() > 0
-                            && (forceSend
-                                || otherNodeData->getIdentityChangeTimestamp() > _lastFrameTimestamp
-                                || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                                
-                            QByteArray identityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
-                            
-                            QByteArray individualData = otherNodeData->getAvatar().identityByteArray();
-                            individualData.replace(0, NUM_BYTES_RFC4122_UUID, otherNode->getUUID().toRfc4122());
-                            identityPacket.append(individualData);
-                            
-                            nodeList->writeDatagram(identityPacket, node);
-                                
-                            ++_sumIdentityPackets;
-                        }
-                    }
+            // this is an AGENT we have received head data from, it gets a packet with the other avatars
+            if (node->getType() == NodeType::Agent && node->getActiveSocket()) {
+                ReceiverPackets receiver;
+                receiver.avatarIndex = (int)_avatarSnapshots.size();
+                _receiverPackets.push_back(receiver);
+            }
+            
+            _avatarSnapshots.push_back(snapshot);
+        }
+    });
+    
+    _sumListeners += (int)_receiverPackets.size();
+    
+    runBroadcastJobs((int)_receiverPackets.size());
+    
+    nodeList->beginDatagramBatch();
+    
+    for (size_t i = 0; i < _receiverPackets.size(); i++) {
+        const ReceiverPackets& receiver = _receiverPackets[i];
+        const SharedNodePointer& node = _avatarSnapshots[receiver.avatarIndex].node;
+        
+        for (size_t j = 0; j < receiver.packets.size(); j++) {
+            nodeList->writeDatagram(receiver.packets[j], node);
+        }
+        
+        _sumBillboardPackets += receiver.numBillboardPackets;
+        _sumIdentityPackets += receiver.numIdentityPackets;
+        _sumAvatarsDeferred += receiver.numAvatarsDeferred;
+        _sumJointKeyframes += receiver.numJointKeyframes;
+    }
+    
+    nodeList->endDatagramBatch();
+    
+    // release the snapshots so each avatar's encode buffer is no longer shared when it is re-encoded next frame
+    _avatarSnapshots.clear();
+    _receiverPackets.clear();
+    
+    _lastFrameTimestamp = QDateTime::currentMSecsSinceEpoch();
+}
+
+void AvatarMixer::broadcastRange(int begin, int end) {
+    // the byte budget of each receiver this frame, shrunk while the mixer is struggling to keep up
+    const float BYTES_PER_KILOBIT = 1000.0f / 8.0f;
+    int maxBytesThisFrame = _maxKbpsPerReceiver * BYTES_PER_KILOBIT * AVATAR_DATA_SEND_INTERVAL_MSECS / 1000.0f
+        * (1.0f - _performanceThrottlingRatio);
+    
+    // the avatars due to be sent to a receiver this frame, as (priority, index in _avatarSnapshots)
+    std::vector<std::pair<float, int> > dueAvatars;
+    dueAvatars.reserve(_avatarSnapshots.size());
+    
+    // the joints of one avatar packed as a delta for one receiver
+    const int MAX_JOINTS = 255;
+    QByteArray deltaJoints;
+    deltaJoints.resize(AvatarData::maxJointSectionBytes(MAX_JOINTS));
+    unsigned char* deltaJointsBuffer = reinterpret_cast<unsigned char*>(deltaJoints.data());
+    
+    for (int i = begin; i < end; i++) {
+        ReceiverPackets& receiver = _receiverPackets[i];
+        const AvatarSnapshot& receiverSnapshot = _avatarSnapshots[receiver.avatarIndex];
+        AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(receiverSnapshot.node->getLinkedData());
+        QVector<AvatarMixerClientData::SentAvatarState>& sentAvatarStates = nodeData->getSentAvatarStates();
+        
+        receiver.numBillboardPackets = 0;
+        receiver.numIdentityPackets = 0;
+        receiver.numAvatarsDeferred = 0;
+        receiver.numJointKeyframes = 0;
+        
+        dueAvatars.clear();
+        
+        for (int otherIndex = 0; otherIndex < (int)_avatarSnapshots.size(); otherIndex++) {
+            if (otherIndex == receiver.avatarIndex) {
+                continue;
+            }
+            
+            const AvatarSnapshot& other = _avatarSnapshots[otherIndex];
+            int otherNodeIndex = other.nodeIndex;
+            if (otherNodeIndex >= sentAvatarStates.size()) {
+                sentAvatarStates.resize(otherNodeIndex + 1);
+            }
+            AvatarMixerClientData::SentAvatarState& sentState = sentAvatarStates[otherNodeIndex];
+            if (sentState.avatarUUID != other.node->getUUID()) {
+                // the index was another avatar's before, this one has never been sent
+                sentState = AvatarMixerClientData::SentAvatarState();
+                sentState.avatarUUID = other.node->getUUID();
+            }
+            sentState.lastSeenFrame = _frameNumber;
+            
+            // an avatar is due once the frames since it was last sent make up for its distance and direction,
+            // the ones that don't fit in this frame's budget keep aging and come first next frame
+            float priority = NEVER_SENT_PRIORITY;
+            if (sentState.lastSentFrame > 0) {
+                glm::vec3 offset = other.position - receiverSnapshot.position;
+                float distance = glm::length(offset);
                 
-                    otherNodeData->getMutex().unlock();
+                float distancePriority = (distance > FULL_RATE_DISTANCE) ? FULL_RATE_DISTANCE / distance : 1.0f;
+                float viewPriority = 1.0f;
+                if (distance > 0.0f) {
+                    float facing = glm::dot(receiverSnapshot.viewDirection, offset / distance);
+                    viewPriority = MIN_VIEW_PRIORITY + (1.0f - MIN_VIEW_PRIORITY) * (0.5f + 0.5f * facing);
                 }
-            });
+                
+                priority = (_frameNumber - sentState.lastSentFrame) * distancePriority * viewPriority;
+            }
             
-            nodeList->writeDatagram(mixedAvatarByteArray, node);
+            if (priority >= 1.0f) {
+                dueAvatars.push_back(std::make_pair(priority, otherIndex));
+            }
+        }
+        
+        // highest priority first, ties go to the lower index so the order is the same every frame
+        std::sort(dueAvatars.begin(), dueAvatars.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        });
+        
+        QByteArray mixedAvatarByteArray;
+        mixedAvatarByteArray.reserve(MAX_PACKET_SIZE);
+        populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
+        
+        int bytesThisFrame = 0;
+        
+        for (size_t j = 0; j < dueAvatars.size(); j++) {
+            const AvatarSnapshot& other = _avatarSnapshots[dueAvatars[j].second];
+            AvatarMixerClientData::SentAvatarState& sentState = sentAvatarStates[other.nodeIndex];
             
-            nodeData->getMutex().unlock();
+            // billboard and identity go out after they change, and periodically in case a packet was lost
+            bool sendBillboard = other.billboardChangeTimestamp > 0
+                && (other.billboardChangeTimestamp != sentState.billboardChangeTimestamp
+                    || _frameNumber - sentState.billboardSentFrame >= BILLBOARD_AND_IDENTITY_RESEND_FRAMES);
+            bool sendIdentity = other.identityChangeTimestamp > 0
+                && (other.identityChangeTimestamp != sentState.identityChangeTimestamp
+                    || _frameNumber - sentState.identitySentFrame >= BILLBOARD_AND_IDENTITY_RESEND_FRAMES);
+            
+            // the joints go as a delta against the keyframe this receiver acknowledged, or in full while a keyframe is
+            // on its way, since the receiver drops its old keyframe when the new one arrives and the ack is a trip away
+            const char* jointBytes = other.fullJoints.constData();
+            int numJointBytes = other.fullJoints.size();
+            bool sendKeyframe = false;
+            
+            if (_streamJointDeltas) {
+                bool isKeyframeDue = !sentState.hasKeyframe
+                    || _frameNumber - sentState.keyframeFrame >= JOINT_KEYFRAME_INTERVAL_FRAMES;
+                bool isKeyframeInFlight = sentState.hasPendingKeyframe
+                    && _frameNumber - sentState.pendingKeyframeFrame < JOINT_KEYFRAME_ACK_TIMEOUT_FRAMES;
+                
+                if (isKeyframeDue && !isKeyframeInFlight) {
+                    jointBytes = other.keyframeJoints.constData();
+                    numJointBytes = other.keyframeJoints.size();
+                    sendKeyframe = true;
+                } else if (sentState.hasKeyframe && !sentState.hasPendingKeyframe) {
+                    jointBytes = deltaJoints.constData();
+                    numJointBytes = AvatarData::packDeltaJoints(deltaJointsBuffer, other.jointData,
+                                                                sentState.keyframeJointData, sentState.keyframeSequence);
+                }
+            }
+            
+            int avatarBytes = other.avatarData.size() + numJointBytes
+                + (sendBillboard ? other.billboardPacket.size() : 0)
+                + (sendIdentity ? other.identityPacket.size() : 0);
+            
+            // the first due avatar always goes, so a receiver isn't starved however hard the mixer is throttling
+            if (bytesThisFrame > 0 && bytesThisFrame + avatarBytes > maxBytesThisFrame) {
+                ++receiver.numAvatarsDeferred;
+                continue;
+            }
+            
+            bytesThisFrame += avatarBytes;
+            
+            if (other.avatarData.size() + numJointBytes + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
+                receiver.packets.push_back(mixedAvatarByteArray);
+                
+                // start a new packet, the sent one keeps the old buffer
+                mixedAvatarByteArray = QByteArray();
+                mixedAvatarByteArray.reserve(MAX_PACKET_SIZE);
+                populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
+            }
+            
+            // copy the avatar into the mixedAvatarByteArray packet
+            mixedAvatarByteArray.append(other.avatarData);
+            mixedAvatarByteArray.append(jointBytes, numJointBytes);
+            sentState.lastSentFrame = _frameNumber;
+            
+            if (sendKeyframe) {
+                sentState.pendingKeyframeJointData = other.jointData;
+                sentState.pendingKeyframeSequence = other.keyframeSequence;
+                sentState.pendingKeyframeFrame = _frameNumber;
+                sentState.hasPendingKeyframe = true;
+                ++receiver.numJointKeyframes;
+            }
+            
+            if (sendBillboard) {
+                receiver.packets.push_back(other.billboardPacket);
+                sentState.billboardChangeTimestamp = other.billboardChangeTimestamp;
+                sentState.billboardSentFrame = _frameNumber;
+                ++receiver.numBillboardPackets;
+            }
+            
+            if (sendIdentity) {
+                receiver.packets.push_back(other.identityPacket);
+                sentState.identityChangeTimestamp = other.identityChangeTimestamp;
+                sentState.identitySentFrame = _frameNumber;
+                ++receiver.numIdentityPackets;
+            }
         }
-    });
+        
+        receiver.packets.push_back(mixedAvatarByteArray);
+        
+        // forget the avatars that have left, so one that comes back is treated as never sent
+        for (int j = 0; j < sentAvatarStates.size(); j++) {
+            if (!sentAvatarStates[j].avatarUUID.isNull() && sentAvatarStates[j].lastSeenFrame != _frameNumber) {
+                sentAvatarStates[j] = AvatarMixerClientData::SentAvatarState();
+            }
+        }
+    }
+}
+
+void AvatarMixer::runBroadcastJobs(int numReceivers) {
+    // hand a contiguous slice to each pool job, the broadcast thread takes the last slice itself
+    int numSlices = qMin(_numBroadcastThreads, numReceivers);
+    int numJobs = numSlices - 1;
+    int begin = 0;
     
-    _lastFrameTimestamp = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < numJobs; i++) {
+        int end = begin + (numReceivers - begin) / (numSlices - i);
+        _broadcastJobs[i]->setRange(begin, end);
+        _broadcastThreadPool.start(_broadcastJobs[i]);
+        begin = end;
+    }
+    
+    broadcastRange(begin, numReceivers);
+    
+    if (numJobs > 0) {
+        _broadcastJobsDone.acquire(numJobs);
+    }
+}
+
+void AvatarMixer::setNumBroadcastThreads(int numBroadcastThreads) {
+    if (numBroadcastThreads < 1) {
+        numBroadcastThreads = 1;
+    }
+    
+    _numBroadcastThreads = numBroadcastThreads;
+    
+    // the broadcast thread builds one slice itself, so the pool only needs the remaining threads
+    _broadcastThreadPool.waitForDone();
+    _broadcastThreadPool.setMaxThreadCount(qMax(_numBroadcastThreads - 1, 1));
+    
+    qDeleteAll(_broadcastJobs);
+    _broadcastJobs.clear();
+    
+    for (int i = 0; i < _numBroadcastThreads - 1; i++) {
+        _broadcastJobs.append(new BroadcastRangeJob(this));
+    }
 }
 
 void AvatarMixer::nodeKilled(SharedNodePointer killedNode) {
@@ -275,6 +522,20 @@ void AvatarMixer::readPendingDatagrams() {
                     }
                     break;
                 }
+                case PacketTypeAvatarKeyframeAck: {
+                    
+                    // check if we have a matching node in our list
+                    SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                    
+                    if (avatarNode && avatarNode->getLinkedData()) {
+                        AvatarMixerClientData* nodeData = static_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
+                        
+                        // the acknowledgements are applied at the start of the next frame
+                        QMutexLocker nodeDataLocker(&nodeData->getMutex());
+                        nodeData->queueKeyframeAcks(receivedPacket);
+                    }
+                    break;
+                }
                 case PacketTypeKillAvatar: {
                     nodeList->processKillNode(receivedPacket);
                     break;
@@ -294,15 +555,20 @@ void AvatarMixer::sendStatsPacket() {
     
     statsObject["average_billboard_packets_per_frame"] = (float) _sumBillboardPackets / (float) _numStatFrames;
     statsObject["average_identity_packets_per_frame"] = (float) _sumIdentityPackets / (float) _numStatFrames;
+    statsObject["average_avatars_deferred_per_frame"] = (float) _sumAvatarsDeferred / (float) _numStatFrames;
+    statsObject["average_joint_keyframes_per_frame"] = (float) _sumJointKeyframes / (float) _numStatFrames;
     
     statsObject["trailing_sleep_percentage"] = _trailingSleepRatio * 100;
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
+    statsObject["broadcast_threads"] = _numBroadcastThreads;
     
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     
     _sumListeners = 0;
     _sumBillboardPackets = 0;
     _sumIdentityPackets = 0;
+    _sumAvatarsDeferred = 0;
+    _sumJointKeyframes = 0;
     _numStatFrames = 0;
 }
 
@@ -314,6 +580,24 @@ void AvatarMixer::run() {
     
     nodeList->linkedDataCreateCallback = attachAvatarDataToNode;
     
+    // wait for the domain-server settings, without them we keep our defaults
+    DomainHandler& domainHandler = nodeList->getDomainHandler();
+    
+    qDebug() << "Waiting for domain settings from domain-server.";
+    
+    // block until we get the settingsRequestComplete signal
+    QEventLoop loop;
+    connect(&domainHandler, &DomainHandler::settingsReceived, &loop, &QEventLoop::quit);
+    connect(&domainHandler, &DomainHandler::settingsReceiveFail, &loop, &QEventLoop::quit);
+    domainHandler.requestDomainSettings();
+    loop.exec();
+    
+    if (domainHandler.getSettingsObject().isEmpty()) {
+        qDebug() << "Failed to retreive settings object from domain-server. Using default avatar mixer settings.";
+    } else {
+        parseSettingsObject(domainHandler.getSettingsObject());
+    }
+    
     // setup the timer that will be fired on the broadcast thread
     QTimer* broadcastTimer = new QTimer();
     broadcastTimer->setInterval(AVATAR_DATA_SEND_INTERVAL_MSECS);
@@ -326,3 +610,39 @@ void AvatarMixer::run() {
     // start the broadcastThread
     _broadcastThread.start();
 }
+
+void AvatarMixer::parseSettingsObject(const QJsonObject& settingsObject) {
+    if (settingsObject.contains(AVATAR_MIXER_SETTINGS_GROUP_KEY)) {
+        QJsonObject avatarMixerGroupObject = settingsObject[AVATAR_MIXER_SETTINGS_GROUP_KEY].toObject();
+        
+        const QString BROADCAST_THREADS = "broadcast_threads";
+        if (avatarMixerGroupObject[BROADCAST_THREADS].isString()) {
+            bool ok = false;
+            int numBroadcastThreads = avatarMixerGroupObject[BROADCAST_THREADS].toString().toInt(&ok);
+            if (ok) {
+                // zero asks for one broadcast thread per core
+                setNumBroadcastThreads(numBroadcastThreads > 0 ? numBroadcastThreads : QThread::idealThreadCount());
+            }
+        }
+        
+        const QString STREAM_JOINT_DELTAS = "stream_joint_deltas";
+        if (avatarMixerGroupObject[STREAM_JOINT_DELTAS].isBool()) {
+            _streamJointDeltas = avatarMixerGroupObject[STREAM_JOINT_DELTAS].toBool();
+        }
+        if (_streamJointDeltas) {
+            qDebug() << "Streaming joint deltas against acknowledged keyframes";
+        }
+        
+        const QString MAX_KBPS_PER_RECEIVER = "max_kbps_per_receiver";
+        if (avatarMixerGroupObject[MAX_KBPS_PER_RECEIVER].isString()) {
+            bool ok = false;
+            int maxKbpsPerReceiver = avatarMixerGroupObject[MAX_KBPS_PER_RECEIVER].toString().toInt(&ok);
+            if (ok && maxKbpsPerReceiver > 0) {
+                _maxKbpsPerReceiver = maxKbpsPerReceiver;
+            }
+        }
+    }
+    
+    qDebug() << "Building avatar packets on" << _numBroadcastThreads << "threads, sending at most"
+        << _maxKbpsPerReceiver << "kbps to each receiver";
+}
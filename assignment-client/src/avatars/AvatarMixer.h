@@ -15,8 +15,18 @@
 #ifndef hifi_AvatarMixer_h
 #define hifi_AvatarMixer_h
 
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+
+#include <AvatarData.h>
 #include <ThreadedAssignment.h>
 
+class BroadcastRangeJob;
+
 /// Handles assignments of type AvatarMixer - distribution of avatar data to various clients
 class AvatarMixer : public ThreadedAssignment {
 public:
@@ -34,10 +44,62 @@ public slots:
     void sendStatsPacket();
     
 private:
+    friend class BroadcastRangeJob;
+    
     void broadcastAvatarData();
     
+    /// builds the packets for the receivers [begin, end) of this frame, safe to call from any broadcast thread
+    void broadcastRange(int begin, int end);
+    
+    /// runs broadcastRange over numReceivers, spread across the broadcast threads if there is more than one
+    void runBroadcastJobs(int numReceivers);
+    
+    void setNumBroadcastThreads(int numBroadcastThreads);
+    
+    void parseSettingsObject(const QJsonObject& settingsObject);
+    
+    // the state of one avatar copied at the start of a frame, so packets are built without holding its lock
+    struct AvatarSnapshot {
+        SharedNodePointer node;
+        int nodeIndex; // read once, the node's own is -1 if it is killed during the frame
+        QByteArray avatarData;
+        QByteArray fullJoints;
+        QByteArray keyframeJoints;
+        quint16 keyframeSequence;
+        QVector<JointData> jointData;
+        QByteArray billboardPacket;
+        QByteArray identityPacket;
+        glm::vec3 position;
+        glm::vec3 viewDirection;
+        quint64 billboardChangeTimestamp;
+        quint64 identityChangeTimestamp;
+    };
+    
+    // the packets for one receiver, filled by whichever thread built them and sent afterwards from the broadcast thread
+    struct ReceiverPackets {
+        int avatarIndex;
+        std::vector<QByteArray> packets;
+        int numBillboardPackets;
+        int numIdentityPackets;
+        int numAvatarsDeferred;
+        int numJointKeyframes;
+    };
+    
+    // not QVectors so that their capacity survives clear() between frames
+    std::vector<AvatarSnapshot> _avatarSnapshots;
+    std::vector<ReceiverPackets> _receiverPackets;
+    
+    int _numBroadcastThreads;
+    QThreadPool _broadcastThreadPool;
+    QVector<BroadcastRangeJob*> _broadcastJobs;
+    QSemaphore _broadcastJobsDone;
+    
     QThread _broadcastThread;
     
+    quint64 _frameNumber;
+    int _maxKbpsPerReceiver;
+    bool _streamJointDeltas;
+    
     quint64 _lastFrameTimestamp;
     
     float _trailingSleepRatio;
@@ -47,6 +109,8 @@ private:
     int _numStatFrames;
     int _sumBillboardPackets;
     int _sumIdentityPackets;
+    int _sumAvatarsDeferred;
+    int _sumJointKeyframes;
 };
 
 #endif // hifi_AvatarMixer_h
@@ -9,17 +9,28 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <LimitedNodeList.h>
 #include <PacketHeaders.h>
+#include <UUID.h>
 
 #include "AvatarMixerClientData.h"
 
 AvatarMixerClientData::AvatarMixerClientData() :
     NodeData(),
-    _hasReceivedFirstPackets(false),
     _billboardChangeTimestamp(0),
-    _identityChangeTimestamp(0)
+    _identityChangeTimestamp(0),
+    _encodedAvatarData(),
+    _encodedFullJoints(),
+    _encodedKeyframeJoints(),
+    _billboardPacket(),
+    _billboardPacketTimestamp(0),
+    _identityPacket(),
+    _identityPacketTimestamp(0)
 {
-    
+    // reserve up front so that resizing between frames keeps the allocation
+    _encodedAvatarData.reserve(NUM_BYTES_RFC4122_UUID + MAX_PACKET_SIZE);
+    _encodedFullJoints.reserve(MAX_PACKET_SIZE);
+    _encodedKeyframeJoints.reserve(MAX_PACKET_SIZE);
 }
 
 int AvatarMixerClientData::parseData(const QByteArray& packet) {
@@ -28,8 +39,81 @@ int AvatarMixerClientData::parseData(const QByteArray& packet) {
     return _avatar.parseDataAtOffset(packet, offset);
 }
 
-bool AvatarMixerClientData::checkAndSetHasReceivedFirstPackets() {
-    bool oldValue = _hasReceivedFirstPackets;
-    _hasReceivedFirstPackets = true;
-    return oldValue;
+void AvatarMixerClientData::encodeAvatarData(const QUuid& nodeUUID, quint16 keyframeSequence) {
+    _encodedAvatarData.resize(NUM_BYTES_RFC4122_UUID + MAX_PACKET_SIZE);
+    unsigned char* avatarBuffer = reinterpret_cast<unsigned char*>(_encodedAvatarData.data());
+    memcpy(avatarBuffer, nodeUUID.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+    _encodedAvatarData.resize(NUM_BYTES_RFC4122_UUID + _avatar.packBodyAndHead(avatarBuffer + NUM_BYTES_RFC4122_UUID));
+    
+    const QVector<JointData>& jointData = _avatar.getJointData();
+    int maxJointBytes = AvatarData::maxJointSectionBytes(jointData.size());
+    
+    _encodedFullJoints.resize(maxJointBytes);
+    _encodedFullJoints.resize(AvatarData::packFullJoints(reinterpret_cast<unsigned char*>(_encodedFullJoints.data()),
+                                                         jointData));
+    
+    _encodedKeyframeJoints.resize(maxJointBytes);
+    _encodedKeyframeJoints.resize(AvatarData::packKeyframeJoints(
+        reinterpret_cast<unsigned char*>(_encodedKeyframeJoints.data()), jointData, keyframeSequence));
+}
+
+const QByteArray& AvatarMixerClientData::getBillboardPacket(const QUuid& nodeUUID) {
+    if (_billboardPacketTimestamp != _billboardChangeTimestamp) {
+        _billboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
+        _billboardPacket.append(nodeUUID.toRfc4122());
+        _billboardPacket.append(_avatar.getBillboard());
+        
+        _billboardPacketTimestamp = _billboardChangeTimestamp;
+    }
+    return _billboardPacket;
+}
+
+const QByteArray& AvatarMixerClientData::getIdentityPacket(const QUuid& nodeUUID) {
+    if (_identityPacketTimestamp != _identityChangeTimestamp) {
+        _identityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
+        
+        QByteArray individualData = _avatar.identityByteArray();
+        individualData.replace(0, NUM_BYTES_RFC4122_UUID, nodeUUID.toRfc4122());
+        _identityPacket.append(individualData);
+        
+        _identityPacketTimestamp = _identityChangeTimestamp;
+    }
+    return _identityPacket;
+}
+
+void AvatarMixerClientData::queueKeyframeAcks(const QByteArray& packet) {
+    const int BYTES_PER_ACK = NUM_BYTES_RFC4122_UUID + sizeof(quint16);
+    
+    for (int offset = numBytesForPacketHeader(packet); offset + BYTES_PER_ACK <= packet.size(); offset += BYTES_PER_ACK) {
+        QUuid avatarUUID = QUuid::fromRfc4122(packet.mid(offset, NUM_BYTES_RFC4122_UUID));
+        
+        quint16 keyframeSequence;
+        memcpy(&keyframeSequence, packet.constData() + offset + NUM_BYTES_RFC4122_UUID, sizeof(keyframeSequence));
+        
+        _keyframeAcks.append(qMakePair(avatarUUID, keyframeSequence));
+    }
+}
+
+void AvatarMixerClientData::applyKeyframeAcks() {
+    for (int i = 0; i < _keyframeAcks.size(); i++) {
+        SharedNodePointer avatarNode = DependencyManager::get<LimitedNodeList>()->nodeWithUUID(_keyframeAcks[i].first);
+        int avatarIndex = avatarNode ? avatarNode->getIndex() : -1;
+        if (avatarIndex < 0 || avatarIndex >= _sentAvatarStates.size()) {
+            continue;
+        }
+        SentAvatarState& sentState = _sentAvatarStates[avatarIndex];
+        
+        // acknowledgements of keyframes that have since been replaced are ignored
+        if (sentState.avatarUUID == _keyframeAcks[i].first && sentState.hasPendingKeyframe
+            && sentState.pendingKeyframeSequence == _keyframeAcks[i].second) {
+            sentState.keyframeJointData = sentState.pendingKeyframeJointData;
+            sentState.keyframeSequence = sentState.pendingKeyframeSequence;
+            sentState.keyframeFrame = sentState.pendingKeyframeFrame;
+            sentState.hasKeyframe = true;
+            
+            sentState.pendingKeyframeJointData.clear();
+            sentState.hasPendingKeyframe = false;
+        }
+    }
+    _keyframeAcks.clear();
 }
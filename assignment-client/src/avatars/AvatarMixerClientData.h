@@ -13,6 +13,7 @@
 #define hifi_AvatarMixerClientData_h
 
 #include <QtCore/QUrl>
+#include <QtCore/QVector>
 
 #include <AvatarData.h>
 #include <NodeData.h>
@@ -25,19 +26,74 @@ public:
     int parseData(const QByteArray& packet);
     AvatarData& getAvatar() { return _avatar; }
     
-    bool checkAndSetHasReceivedFirstPackets();
-    
     quint64 getBillboardChangeTimestamp() const { return _billboardChangeTimestamp; }
     void setBillboardChangeTimestamp(quint64 billboardChangeTimestamp) { _billboardChangeTimestamp = billboardChangeTimestamp; }
     
     quint64 getIdentityChangeTimestamp() const { return _identityChangeTimestamp; }
     void setIdentityChangeTimestamp(quint64 identityChangeTimestamp) { _identityChangeTimestamp = identityChangeTimestamp; }
     
+    /// packs the node UUID and avatar data once for this frame so every receiver can share the same bytes
+    /// the joints are packed separately, in full and as a keyframe with the given sequence
+    void encodeAvatarData(const QUuid& nodeUUID, quint16 keyframeSequence);
+    const QByteArray& getEncodedAvatarData() const { return _encodedAvatarData; }
+    const QByteArray& getEncodedFullJoints() const { return _encodedFullJoints; }
+    const QByteArray& getEncodedKeyframeJoints() const { return _encodedKeyframeJoints; }
+    
+    /// the billboard and identity packets for this avatar, rebuilt only after the billboard or identity changes
+    const QByteArray& getBillboardPacket(const QUuid& nodeUUID);
+    const QByteArray& getIdentityPacket(const QUuid& nodeUUID);
+    
+    // what this node, as a receiver, has been sent of another avatar
+    struct SentAvatarState {
+        SentAvatarState() : lastSentFrame(0), lastSeenFrame(0), billboardChangeTimestamp(0),
+            billboardSentFrame(0), identityChangeTimestamp(0), identitySentFrame(0),
+            keyframeSequence(0), keyframeFrame(0), hasKeyframe(false),
+            pendingKeyframeSequence(0), pendingKeyframeFrame(0), hasPendingKeyframe(false) { }
+        
+        QUuid avatarUUID; // null while the slot is unused
+        quint64 lastSentFrame;
+        quint64 lastSeenFrame;
+        quint64 billboardChangeTimestamp;
+        quint64 billboardSentFrame;
+        quint64 identityChangeTimestamp;
+        quint64 identitySentFrame;
+        
+        // the joint keyframe the receiver acknowledged, deltas are made against it
+        QVector<JointData> keyframeJointData;
+        quint16 keyframeSequence;
+        quint64 keyframeFrame;
+        bool hasKeyframe;
+        
+        // the joint keyframe sent and not yet acknowledged
+        QVector<JointData> pendingKeyframeJointData;
+        quint16 pendingKeyframeSequence;
+        quint64 pendingKeyframeFrame;
+        bool hasPendingKeyframe;
+    };
+    
+    /// at the other avatar's Node::getIndex(), only touched by the thread building this receiver's packets
+    QVector<SentAvatarState>& getSentAvatarStates() { return _sentAvatarStates; }
+    
+    /// queues the keyframes this node's client acknowledged in a PacketTypeAvatarKeyframeAck
+    void queueKeyframeAcks(const QByteArray& packet);
+    
+    /// turns the queued acknowledgements into keyframes deltas can be made against,
+    /// must not be called while this node's packets are being built
+    void applyKeyframeAcks();
+    
 private:
     AvatarData _avatar;
-    bool _hasReceivedFirstPackets;
     quint64 _billboardChangeTimestamp;
     quint64 _identityChangeTimestamp;
+    QByteArray _encodedAvatarData;
+    QByteArray _encodedFullJoints;
+    QByteArray _encodedKeyframeJoints;
+    QByteArray _billboardPacket;
+    quint64 _billboardPacketTimestamp;
+    QByteArray _identityPacket;
+    quint64 _identityPacketTimestamp;
+    QVector<SentAvatarState> _sentAvatarStates;
+    QVector<QPair<QUuid, quint16> > _keyframeAcks;
 };
 
 #endif // hifi_AvatarMixerClientData_h
@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QThread>
 #include <QTimer>
 #include <EntityTree.h>
 #include <SimpleEntitySimulation.h>
@@ -47,6 +48,17 @@ Octree* EntityServer::createTree() {
     return tree;
 }
 
+void EntityServer::readAdditionalConfiguration(const QJsonObject& settingsSectionObject) {
+    // a single simulation thread unless asked for more, zero asks for one per core
+    int simulationThreads = 1;
+    readOptionInt(QString("simulationThreads"), settingsSectionObject, simulationThreads);
+    if (simulationThreads <= 0) {
+        simulationThreads = QThread::idealThreadCount();
+    }
+    _entitySimulation->setNumSimulationThreads(simulationThreads);
+    qDebug() << "simulationThreads=" << _entitySimulation->getNumSimulationThreads();
+}
+
 void EntityServer::beforeRun() {
     QTimer* pruneDeletedEntitiesTimer = new QTimer(this);
     connect(pruneDeletedEntitiesTimer, SIGNAL(timeout()), this, SLOT(pruneDeletedEntities()));
@@ -19,6 +19,8 @@
 #include "EntityTree.h"
 
 /// Handles assignments of type EntityServer - sending entities to various clients.
+class SimpleEntitySimulation;
+
 class EntityServer : public OctreeServer, public NewlyCreatedEntityHook {
     Q_OBJECT
 public:
@@ -47,9 +49,10 @@ public slots:
 
 protected:
     virtual Octree* createTree();
+    virtual void readAdditionalConfiguration(const QJsonObject& settingsSectionObject);
 
 private:
-    EntitySimulation* _entitySimulation;
+    SimpleEntitySimulation* _entitySimulation;
 };
 
 #endif // hifi_EntityServer_h
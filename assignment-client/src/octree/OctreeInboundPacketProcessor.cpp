@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
 #include <limits>
 #include <PacketHeaders.h>
 #include <PerfStat.h>
@@ -20,6 +21,30 @@
 static QUuid DEFAULT_NODE_ID_REF;
 const quint64 TOO_LONG_SINCE_LAST_NACK = 1 * USECS_PER_SECOND;
 
+// the most edits applied per acquisition of the tree's write lock, so the send threads get a turn between batches
+const int MAX_EDITS_PER_BATCH = 256;
+
+/// an edit packet taken off the queue in batched mode, with the stats that get tracked once its edits are applied
+class OctreeInboundPacketProcessor::InboundEditPacket {
+public:
+    QUuid nodeUUID;
+    unsigned short int sequence;
+    quint64 transitTime;
+    int editsInPacket;
+    quint64 processTime;
+    quint64 lockWaitTime;
+};
+
+/// an edit waiting for the write lock, either decoded already or the rest of a packet the tree wants to process itself
+class OctreeInboundPacketProcessor::QueuedEdit {
+public:
+    QSharedPointer<OctreeEditRecord> decodedEdit;
+    SharedNodePointer sendingNode;
+    int packetIndex;
+    QByteArray packet;
+    int atByte;
+};
+
 OctreeInboundPacketProcessor::OctreeInboundPacketProcessor(OctreeServer* myServer) :
     _myServer(myServer),
     _receivedPacketCount(0),
@@ -28,6 +53,10 @@ OctreeInboundPacketProcessor::OctreeInboundPacketProcessor(OctreeServer* myServe
     _totalLockWaitTime(0),
     _totalElementsInPacket(0),
     _totalPackets(0),
+    _totalEditBatches(0),
+    _totalBatchLockHoldTime(0),
+    _maxBatchLockHoldTime(0),
+    _editsPerBatch(),
     _lastNackTime(usecTimestampNow()),
     _shuttingDown(false)
 {
@@ -39,6 +68,10 @@ void OctreeInboundPacketProcessor::resetStats() {
     _totalLockWaitTime = 0;
     _totalElementsInPacket = 0;
     _totalPackets = 0;
+    _totalEditBatches = 0;
+    _totalBatchLockHoldTime = 0;
+    _maxBatchLockHoldTime = 0;
+    _editsPerBatch.reset();
     _lastNackTime = usecTimestampNow();
 
     _singleSenderStats.clear();
@@ -211,6 +244,182 @@ void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendin
     }
 }
 
+bool OctreeInboundPacketProcessor::process() {
+    if (!_myServer->wantsEditBatching()) {
+        return ReceivedPacketProcessor::process();
+    }
+
+    waitForPackets();
+    preProcess();
+
+    QVector<NetworkPacket> packets;
+    takeQueuedPackets(packets);
+    while (!packets.isEmpty()) {
+        processPacketBatch(packets);
+        midProcess();
+        takeQueuedPackets(packets);
+    }
+
+    postProcess();
+    return isStillRunning();  // keep running till they terminate us
+}
+
+void OctreeInboundPacketProcessor::processPacketBatch(const QVector<NetworkPacket>& packets) {
+    if (_shuttingDown) {
+        qDebug() << "OctreeInboundPacketProcessor::processPacketBatch() while shutting down... ignoring incoming packets";
+        return;
+    }
+
+    Octree* tree = _myServer->getOctree();
+    QVector<InboundEditPacket> editPackets;
+    QVector<QueuedEdit> edits;
+
+    // decode everything we can before taking the lock
+    foreach (const NetworkPacket& networkPacket, packets) {
+        const QByteArray& packet = networkPacket.getByteArray();
+        const SharedNodePointer& sendingNode = networkPacket.getNode();
+
+        PacketType packetType = packetTypeForPacket(packet);
+        if (!tree->handlesEditPacketType(packetType)) {
+            qDebug("unknown packet ignored... packetType=%d", packetType);
+            continue;
+        }
+        _receivedPacketCount++;
+
+        int numBytesPacketHeader = numBytesForPacketHeader(packet);
+        const unsigned char* packetData = reinterpret_cast<const unsigned char*>(packet.data());
+
+        InboundEditPacket editPacket;
+        editPacket.sequence = (*((unsigned short int*)(packetData + numBytesPacketHeader)));
+        quint64 sentAt = (*((quint64*)(packetData + numBytesPacketHeader + sizeof(editPacket.sequence))));
+        quint64 arrivedAt = usecTimestampNow();
+        if (sentAt > arrivedAt) {
+            sentAt = arrivedAt;
+        }
+        editPacket.transitTime = arrivedAt - sentAt;
+        editPacket.editsInPacket = 0;
+        editPacket.processTime = 0;
+        editPacket.lockWaitTime = 0;
+        editPacket.nodeUUID = DEFAULT_NODE_ID_REF;
+        if (sendingNode) {
+            sendingNode->setLastHeardMicrostamp(usecTimestampNow());
+            editPacket.nodeUUID = sendingNode->getUUID();
+        }
+        editPackets.append(editPacket);
+        int packetIndex = editPackets.size() - 1;
+
+        int atByte = numBytesPacketHeader + sizeof(editPacket.sequence) + sizeof(sentAt);
+        quint64 startDecode = usecTimestampNow();
+        while (atByte < packet.size()) {
+            OctreeEditRecord* decodedEdit = NULL;
+            int editDataBytesRead = tree->decodeEditPacketData(packetType, packetData + atByte,
+                                                               packet.size() - atByte, decodedEdit);
+
+            QueuedEdit edit;
+            edit.sendingNode = sendingNode;
+            edit.packetIndex = packetIndex;
+            edit.atByte = atByte;
+            if (editDataBytesRead == 0) {
+                // the tree wants the rest of this packet handed to processEditPacketData() under the lock
+                edit.packet = packet;
+                edits.append(edit);
+                break;
+            }
+
+            editPackets[packetIndex].editsInPacket++;
+            if (decodedEdit) {
+                edit.decodedEdit = QSharedPointer<OctreeEditRecord>(decodedEdit);
+                edits.append(edit);
+            }
+            atByte += editDataBytesRead;
+        }
+        editPackets[packetIndex].processTime += usecTimestampNow() - startDecode;
+    }
+
+    for (int begin = 0; begin < edits.size(); begin += MAX_EDITS_PER_BATCH) {
+        applyEditBatch(edits, begin, std::min(begin + MAX_EDITS_PER_BATCH, edits.size()), editPackets);
+    }
+
+    foreach (const InboundEditPacket& editPacket, editPackets) {
+        trackInboundPacket(editPacket.nodeUUID, editPacket.sequence, editPacket.transitTime,
+                           editPacket.editsInPacket, editPacket.processTime, editPacket.lockWaitTime);
+    }
+}
+
+void OctreeInboundPacketProcessor::applyEditBatch(QVector<QueuedEdit>& edits, int begin, int end,
+                                                  QVector<InboundEditPacket>& editPackets) {
+    Octree* tree = _myServer->getOctree();
+    int editsApplied = 0;
+    quint64 lockWaitTime = 0;
+    quint64 startBatch = usecTimestampNow();
+
+    // edits that stay inside one subtree are applied holding only the spine and its stripe, so encoding elsewhere in
+    // the tree carries on. The others take the tree for write. Either way the edits are applied in the order they came.
+    QVector<OctreeDecodedEdit> decodedEdits(end - begin);
+    for (int i = begin; i < end; i++) {
+        decodedEdits[i - begin].record = edits[i].decodedEdit.data();
+        decodedEdits[i - begin].sourceNode = edits[i].sendingNode;
+    }
+
+    int nextEdit = begin;
+    while (nextEdit < end) {
+        int editsInStripes = tree->applyDecodedEditsInStripes(decodedEdits, nextEdit - begin, lockWaitTime);
+        editsApplied += editsInStripes;
+        nextEdit += editsInStripes;
+        if (nextEdit == end) {
+            break;
+        }
+
+        quint64 startLock = usecTimestampNow();
+        tree->lockForWrite();
+        lockWaitTime += usecTimestampNow() - startLock;
+
+        // the edit that stopped the run above needs the whole tree, and so do any that follow it until one doesn't
+        do {
+            QueuedEdit& edit = edits[nextEdit++];
+            if (edit.decodedEdit) {
+                tree->applyDecodedEdit(*edit.decodedEdit, edit.sendingNode);
+                editsApplied++;
+                continue;
+            }
+
+            const QByteArray& packet = edit.packet;
+            PacketType packetType = packetTypeForPacket(packet);
+            const unsigned char* packetData = reinterpret_cast<const unsigned char*>(packet.data());
+            int atByte = edit.atByte;
+            while (atByte < packet.size()) {
+                int editDataBytesRead = tree->processEditPacketData(packetType, packetData, packet.size(),
+                                                                    packetData + atByte, packet.size() - atByte,
+                                                                    edit.sendingNode);
+                editPackets[edit.packetIndex].editsInPacket++;
+                editsApplied++;
+                if (editDataBytesRead <= 0) {
+                    break;
+                }
+                atByte += editDataBytesRead;
+            }
+        } while (nextEdit < end && (!edits[nextEdit].decodedEdit
+                                    || tree->stripeForDecodedEdit(*edits[nextEdit].decodedEdit) == ALL_STRIPES));
+
+        tree->unlock();
+    }
+    quint64 endProcess = usecTimestampNow();
+
+    // the batch's lock wait and hold time is shared out evenly over the packets its edits came from
+    quint64 lockHoldTime = endProcess - startBatch - lockWaitTime;
+    int editsInBatch = end - begin;
+    for (int i = begin; i < end; i++) {
+        InboundEditPacket& editPacket = editPackets[edits[i].packetIndex];
+        editPacket.processTime += lockHoldTime / editsInBatch;
+        editPacket.lockWaitTime += lockWaitTime / editsInBatch;
+    }
+
+    _totalEditBatches++;
+    _totalBatchLockHoldTime += lockHoldTime;
+    _maxBatchLockHoldTime = std::max(_maxBatchLockHoldTime, lockHoldTime);
+    _editsPerBatch.updateAverage(editsApplied);
+}
+
 void OctreeInboundPacketProcessor::trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 transitTime,
             int editsInPacket, quint64 processTime, quint64 lockWaitTime) {
 
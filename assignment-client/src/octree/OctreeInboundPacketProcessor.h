@@ -15,6 +15,7 @@
 #define hifi_OctreeInboundPacketProcessor_h
 
 #include <ReceivedPacketProcessor.h>
+#include <SimpleMovingAverage.h>
 
 #include "SequenceNumberStats.h"
 
@@ -70,6 +71,14 @@ public:
     quint64 getAverageLockWaitTimePerElement() const 
                 { return _totalElementsInPacket == 0 ? 0 : _totalLockWaitTime / _totalElementsInPacket; }
 
+    quint64 getTotalEditBatches() const { return _totalEditBatches; }
+    quint64 getAverageBatchLockHoldTime() const 
+                { return _totalEditBatches == 0 ? 0 : _totalBatchLockHoldTime / _totalEditBatches; }
+    quint64 getMaxBatchLockHoldTime() const { return _maxBatchLockHoldTime; }
+    float getAverageEditsPerBatch() const { return _editsPerBatch.getAverage(); }
+    float getEditsPerSecond() const 
+                { return _editsPerBatch.getSampleCount() == 0 ? 0.0f : _editsPerBatch.getAverageSampleValuePerSecond(); }
+
     void resetStats();
 
     NodeToSenderStatsMap& getSingleSenderStats() { return _singleSenderStats; }
@@ -80,6 +89,10 @@ protected:
 
     virtual void processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
 
+    /// In batched mode drains the whole queue each pass, decoding edits outside the tree lock and applying them in
+    /// bounded batches under a single lock, otherwise processes a packet at a time.
+    virtual bool process();
+
     virtual unsigned long getMaxWait() const;
     virtual void preProcess();
     virtual void midProcess();
@@ -88,6 +101,12 @@ private:
     int sendNackPackets();
 
 private:
+    class QueuedEdit;
+    class InboundEditPacket;
+
+    void processPacketBatch(const QVector<NetworkPacket>& packets);
+    void applyEditBatch(QVector<QueuedEdit>& edits, int begin, int end, QVector<InboundEditPacket>& editPackets);
+
     void trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 transitTime, 
             int elementsInPacket, quint64 processTime, quint64 lockWaitTime);
 
@@ -100,6 +119,11 @@ private:
     quint64 _totalElementsInPacket;
     quint64 _totalPackets;
     
+    quint64 _totalEditBatches;
+    quint64 _totalBatchLockHoldTime;
+    quint64 _maxBatchLockHoldTime;
+    SimpleMovingAverage _editsPerBatch;
+
     NodeToSenderStatsMap _singleSenderStats;
 
     quint64 _lastNackTime;
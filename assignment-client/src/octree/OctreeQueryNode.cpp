@@ -15,6 +15,7 @@
 #include <cstring>
 #include <cstdio>
 #include "OctreeSendThread.h"
+#include "OctreeServer.h"
 
 OctreeQueryNode::OctreeQueryNode() :
     _viewSent(false),
@@ -70,12 +71,11 @@ void OctreeQueryNode::forceNodeShutdown() {
     _isShuttingDown = true;
     elementBag.unhookNotifications(); // if our node is shutting down, then we no longer need octree element notifications
     if (_octreeSendThread) {
-        // we really need to force our thread to shutdown, this is synchronous, we will block while the thread actually 
-        // shuts down because we really need it to shutdown, and it's ok if we wait for it to complete
+        // we really need to force our thread to shutdown, this is synchronous, deleting it blocks until any send
+        // interval a scheduler worker has running for it completes, and it's ok if we wait for it to complete
         OctreeSendThread* sendThread = _octreeSendThread;
         _octreeSendThread = NULL;
         sendThread->setIsShuttingDown();
-        sendThread->terminate();
         delete sendThread;
     }
 }
@@ -96,7 +96,11 @@ void OctreeQueryNode::initializeOctreeSendThread(const SharedAssignmentPointer&
     
     // we want to be notified when the thread finishes
     connect(_octreeSendThread, &GenericThread::finished, this, &OctreeQueryNode::sendThreadFinished);
-    _octreeSendThread->initialize(true);
+    _octreeSendThread->initialize(false);
+
+    // the server's send scheduler runs our thread's intervals on its worker threads
+    OctreeServer* myServer = static_cast<OctreeServer*>(myAssignment.data());
+    myServer->getSendScheduler()->addSender(_octreeSendThread);
 }
 
 bool OctreeQueryNode::packetIsDuplicate() const {
@@ -0,0 +1,98 @@
+//
+//  OctreeSceneCache.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <SharedUtil.h>
+
+#include "OctreeSceneCache.h"
+
+// only a handful of distinct views are ever popular at once (spawn points), and each scene is a full set of sections
+const int MAX_CACHED_SCENES = 8;
+
+// simulated entities move without marking their elements changed, so scenes can't be trusted for long
+const quint64 MAX_CACHED_SCENE_AGE_USECS = USECS_PER_SECOND;
+
+OctreeSceneKey::OctreeSceneKey() :
+    rootLastChanged(0),
+    viewFrustum(),
+    octreeSizeScale(0.0f),
+    boundaryLevelAdjust(0),
+    wantColor(false),
+    wantCompression(false)
+{
+    
+}
+
+bool OctreeSceneKey::matches(const OctreeSceneKey& other) const {
+    return rootLastChanged == other.rootLastChanged
+        && octreeSizeScale == other.octreeSizeScale
+        && boundaryLevelAdjust == other.boundaryLevelAdjust
+        && wantColor == other.wantColor
+        && wantCompression == other.wantCompression
+        && viewFrustum.matches(other.viewFrustum);
+}
+
+OctreeSceneCache::OctreeSceneCache() :
+    _mutex(),
+    _scenes(),
+    _numHits(0),
+    _numMisses(0)
+{
+    
+}
+
+SharedOctreeSceneSections OctreeSceneCache::findScene(const OctreeSceneKey& key, quint64 currentRootLastChanged) {
+    QMutexLocker locker(&_mutex);
+    
+    removeStaleScenes(currentRootLastChanged, usecTimestampNow());
+    
+    for (int i = 0; i < _scenes.size(); i++) {
+        if (_scenes[i].key.matches(key)) {
+            ++_numHits;
+            return _scenes[i].sections;
+        }
+    }
+    
+    ++_numMisses;
+    return SharedOctreeSceneSections();
+}
+
+void OctreeSceneCache::addScene(const OctreeSceneKey& key, const SharedOctreeSceneSections& sections) {
+    QMutexLocker locker(&_mutex);
+    
+    quint64 now = usecTimestampNow();
+    removeStaleScenes(key.rootLastChanged, now);
+    
+    // a scene for the same key was added by another thread while this one was encoding, keep the newer one
+    for (int i = 0; i < _scenes.size(); i++) {
+        if (_scenes[i].key.matches(key)) {
+            _scenes.remove(i);
+            break;
+        }
+    }
+    
+    if (_scenes.size() == MAX_CACHED_SCENES) {
+        _scenes.remove(0); // scenes are appended, so the first is the oldest
+    }
+    
+    CachedScene scene;
+    scene.key = key;
+    scene.sections = sections;
+    scene.encodedTime = now;
+    _scenes.append(scene);
+}
+
+void OctreeSceneCache::removeStaleScenes(quint64 currentRootLastChanged, quint64 now) {
+    for (int i = _scenes.size() - 1; i >= 0; i--) {
+        if (_scenes[i].key.rootLastChanged != currentRootLastChanged
+            || now - _scenes[i].encodedTime > MAX_CACHED_SCENE_AGE_USECS) {
+            _scenes.remove(i);
+        }
+    }
+}
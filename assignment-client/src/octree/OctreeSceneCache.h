@@ -0,0 +1,69 @@
+//
+//  OctreeSceneCache.h
+//  assignment-client/src/octree
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSceneCache_h
+#define hifi_OctreeSceneCache_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+#include <ViewFrustum.h>
+
+/// everything the encoding of a full scene from the root depends on
+class OctreeSceneKey {
+public:
+    OctreeSceneKey();
+    
+    bool matches(const OctreeSceneKey& other) const;
+    
+    quint64 rootLastChanged;
+    ViewFrustum viewFrustum;
+    float octreeSizeScale;
+    int boundaryLevelAdjust;
+    bool wantColor;
+    bool wantCompression;
+};
+
+/// the finalized sections of a full scene, in the order they were written to packets
+typedef QVector<QByteArray> OctreeSceneSections;
+typedef QSharedPointer<const OctreeSceneSections> SharedOctreeSceneSections;
+
+/// Full scenes encoded by one send thread, kept so that send threads for clients with the same view can send the same
+/// sections instead of encoding the tree again. Scenes are dropped once the tree changes or they get too old.
+class OctreeSceneCache {
+public:
+    OctreeSceneCache();
+    
+    /// the sections of a scene encoded for a matching key, or null if there is none
+    SharedOctreeSceneSections findScene(const OctreeSceneKey& key, quint64 currentRootLastChanged);
+    
+    void addScene(const OctreeSceneKey& key, const SharedOctreeSceneSections& sections);
+    
+    quint64 getNumHits() const { return _numHits; }
+    quint64 getNumMisses() const { return _numMisses; }
+    
+private:
+    struct CachedScene {
+        OctreeSceneKey key;
+        SharedOctreeSceneSections sections;
+        quint64 encodedTime;
+    };
+    
+    void removeStaleScenes(quint64 currentRootLastChanged, quint64 now);
+    
+    QMutex _mutex;
+    QVector<CachedScene> _scenes;
+    quint64 _numHits;
+    quint64 _numMisses;
+};
+
+#endif // hifi_OctreeSceneCache_h
@@ -0,0 +1,186 @@
+//
+//  OctreeSendScheduler.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <functional>
+
+#include <QtCore/QRunnable>
+
+#include <SharedUtil.h>
+
+#include "OctreeSendScheduler.h"
+#include "OctreeSendThread.h"
+#include "OctreeServerConsts.h"
+
+class OctreeSendJob : public QRunnable {
+public:
+    OctreeSendJob(OctreeSendScheduler* scheduler, OctreeSendThread* sender, quint64 deadline) :
+        _scheduler(scheduler), _sender(sender), _deadline(deadline) { }
+
+    virtual void run() {
+        quint64 started = usecTimestampNow();
+        bool keepSending = _sender->process();
+        _scheduler->jobFinished(_sender, _deadline, started, keepSending);
+    }
+
+private:
+    OctreeSendScheduler* _scheduler;
+    OctreeSendThread* _sender;
+    quint64 _deadline;
+};
+
+OctreeSendScheduler::OctreeSendScheduler() :
+    _numWorkerThreads(0),
+    _maxJobLatency(0),
+    _queueDepth(0)
+{
+    setNumWorkerThreads(QThread::idealThreadCount());
+}
+
+OctreeSendScheduler::~OctreeSendScheduler() {
+    terminate();
+    _workerPool.waitForDone();
+}
+
+void OctreeSendScheduler::setNumWorkerThreads(int numWorkerThreads) {
+    QMutexLocker locker(&_schedulerMutex);
+    _numWorkerThreads = std::max(numWorkerThreads, 1);
+    _workerPool.setMaxThreadCount(_numWorkerThreads);
+    _dispatchCondition.wakeAll();
+}
+
+void OctreeSendScheduler::addSender(OctreeSendThread* sender) {
+    QMutexLocker locker(&_schedulerMutex);
+    _removedSenders.remove(sender);
+    schedule(sender, usecTimestampNow());
+}
+
+void OctreeSendScheduler::removeSender(OctreeSendThread* sender) {
+    QMutexLocker locker(&_schedulerMutex);
+    for (size_t i = 0; i < _queue.size(); i++) {
+        if (_queue[i].sender == sender) {
+            _queue.erase(_queue.begin() + i);
+            std::make_heap(_queue.begin(), _queue.end(), std::greater<ScheduledSender>());
+            break;
+        }
+    }
+    if (_runningSenders.contains(sender)) {
+        _removedSenders.insert(sender);
+        while (_runningSenders.contains(sender)) {
+            _senderIdleCondition.wait(&_schedulerMutex);
+        }
+    }
+}
+
+int OctreeSendScheduler::getNumSenders() {
+    QMutexLocker locker(&_schedulerMutex);
+    return (int)_queue.size() + _runningSenders.size() - _removedSenders.size();
+}
+
+void OctreeSendScheduler::resetStats() {
+    QMutexLocker locker(&_schedulerMutex);
+    _averageJobLatency.reset();
+    _averageJobTime.reset();
+    _averageQueueDepth.reset();
+    _maxJobLatency = 0;
+}
+
+bool OctreeSendScheduler::process() {
+    QMutexLocker locker(&_schedulerMutex);
+    if (!isStillRunning()) {
+        return false;
+    }
+
+    // only hand out a sender when a worker is free for it, so a sender waiting for a worker stays in deadline order
+    if (_queue.empty() || _runningSenders.size() >= _numWorkerThreads) {
+        _dispatchCondition.wait(&_schedulerMutex);
+        return isStillRunning();
+    }
+
+    quint64 now = usecTimestampNow();
+    quint64 nextDeadline = _queue.front().deadline;
+    if (nextDeadline > now) {
+        unsigned long msecsToWait = (unsigned long)((nextDeadline - now + USECS_PER_MSEC - 1) / USECS_PER_MSEC);
+        _dispatchCondition.wait(&_schedulerMutex, msecsToWait);
+        return isStillRunning();
+    }
+
+    _queueDepth = countDueSenders(now);
+    _averageQueueDepth.updateAverage(_queueDepth);
+
+    std::pop_heap(_queue.begin(), _queue.end(), std::greater<ScheduledSender>());
+    ScheduledSender next = _queue.back();
+    _queue.pop_back();
+
+    _runningSenders.insert(next.sender);
+    _workerPool.start(new OctreeSendJob(this, next.sender, next.deadline));
+
+    return isStillRunning();
+}
+
+void OctreeSendScheduler::terminating() {
+    QMutexLocker locker(&_schedulerMutex);
+    _dispatchCondition.wakeAll();
+}
+
+void OctreeSendScheduler::jobFinished(OctreeSendThread* sender, quint64 deadline, quint64 started, bool keepSending) {
+    if (!keepSending) {
+        // the sender stays in the running set until this is emitted, so it can't be deleted out from under us
+        emit sender->finished();
+    }
+
+    QMutexLocker locker(&_schedulerMutex);
+
+    quint64 latency = (started > deadline) ? started - deadline : 0;
+    _averageJobLatency.updateAverage(latency);
+    _maxJobLatency = std::max(_maxJobLatency, latency);
+    _averageJobTime.updateAverage(usecTimestampNow() - started);
+
+    _runningSenders.remove(sender);
+    if (_removedSenders.remove(sender)) {
+        _senderIdleCondition.wakeAll();
+    } else if (keepSending) {
+        // the next interval is due a full interval after this one started, a late sender doesn't try to catch up
+        schedule(sender, started + OCTREE_SEND_INTERVAL_USECS);
+    }
+
+    _dispatchCondition.wakeAll();
+}
+
+void OctreeSendScheduler::schedule(OctreeSendThread* sender, quint64 deadline) {
+    ScheduledSender scheduled = { deadline, sender };
+    _queue.push_back(scheduled);
+    std::push_heap(_queue.begin(), _queue.end(), std::greater<ScheduledSender>());
+    _dispatchCondition.wakeAll();
+}
+
+int OctreeSendScheduler::countDueSenders(quint64 now) const {
+    // walk down the heap only below entries that are due, so this costs as much as the senders that are due
+    int dueSenders = 0;
+    std::vector<size_t> toVisit;
+    if (!_queue.empty()) {
+        toVisit.push_back(0);
+    }
+    while (!toVisit.empty()) {
+        size_t index = toVisit.back();
+        toVisit.pop_back();
+        if (_queue[index].deadline <= now) {
+            dueSenders++;
+            size_t left = index * 2 + 1;
+            if (left < _queue.size()) {
+                toVisit.push_back(left);
+            }
+            if (left + 1 < _queue.size()) {
+                toVisit.push_back(left + 1);
+            }
+        }
+    }
+    return dueSenders;
+}
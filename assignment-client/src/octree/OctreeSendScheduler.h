@@ -0,0 +1,94 @@
+//
+//  OctreeSendScheduler.h
+//  assignment-client/src/octree
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSendScheduler_h
+#define hifi_OctreeSendScheduler_h
+
+#include <vector>
+
+#include <QtCore/QSet>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include <GenericThread.h>
+#include <SimpleMovingAverage.h>
+
+class OctreeSendThread;
+
+/// Runs the send processing for every client on a fixed pool of worker threads instead of a thread per client.
+/// Each sender has a deadline for its next interval and the dispatcher hands the earliest due sender to the next
+/// free worker. A sender is never run on two workers at once.
+class OctreeSendScheduler : public GenericThread {
+    Q_OBJECT
+public:
+    OctreeSendScheduler();
+    virtual ~OctreeSendScheduler();
+
+    void setNumWorkerThreads(int numWorkerThreads);
+    int getNumWorkerThreads() const { return _numWorkerThreads; }
+
+    /// schedules a sender, its first interval is due right away
+    void addSender(OctreeSendThread* sender);
+
+    /// stops scheduling a sender, blocking until an interval it has running on a worker completes
+    void removeSender(OctreeSendThread* sender);
+
+    int getNumSenders();
+
+    /// how late, in usecs, intervals started after their deadline
+    float getAverageJobLatency() const { return _averageJobLatency.getAverage(); }
+    int getJobLatencySampleCount() const { return _averageJobLatency.getSampleCount(); }
+    quint64 getMaxJobLatency() const { return _maxJobLatency; }
+
+    /// how long, in usecs, intervals took to run
+    float getAverageJobTime() const { return _averageJobTime.getAverage(); }
+
+    /// the number of senders that were past their deadline and waiting for a worker
+    int getQueueDepth() const { return _queueDepth; }
+    float getAverageQueueDepth() const { return _averageQueueDepth.getAverage(); }
+
+    void resetStats();
+
+    virtual bool process();
+    virtual void terminating();
+
+private:
+    friend class OctreeSendJob;
+
+    struct ScheduledSender {
+        quint64 deadline;
+        OctreeSendThread* sender;
+
+        bool operator>(const ScheduledSender& other) const { return deadline > other.deadline; }
+    };
+
+    void jobFinished(OctreeSendThread* sender, quint64 deadline, quint64 started, bool keepSending);
+    void schedule(OctreeSendThread* sender, quint64 deadline);
+    int countDueSenders(quint64 now) const;
+
+    QMutex _schedulerMutex;
+    QWaitCondition _dispatchCondition;
+    QWaitCondition _senderIdleCondition;
+
+    std::vector<ScheduledSender> _queue; // a min-heap on deadline
+    QSet<OctreeSendThread*> _runningSenders;
+    QSet<OctreeSendThread*> _removedSenders; // removed while running, not to be scheduled again
+
+    int _numWorkerThreads;
+    QThreadPool _workerPool;
+
+    SimpleMovingAverage _averageJobLatency;
+    SimpleMovingAverage _averageJobTime;
+    SimpleMovingAverage _averageQueueDepth;
+    quint64 _maxJobLatency;
+    int _queueDepth;
+};
+
+#endif // hifi_OctreeSendScheduler_h
@@ -10,6 +10,7 @@
 //
 
 #include <NodeList.h>
+#include <OutboundScheduler.h>
 #include <PacketHeaders.h>
 #include <PerfStat.h>
 #include <SharedUtil.h>
@@ -27,6 +28,10 @@ OctreeSendThread::OctreeSendThread(const SharedAssignmentPointer& myAssignment,
     _node(node),
     _nodeUUID(node->getUUID()),
     _packetData(),
+    _sceneKey(),
+    _recordedScene(),
+    _sharedScene(),
+    _nextSharedSection(0),
     _nodeMissingCount(0),
     _isShuttingDown(false)
 {
@@ -41,6 +46,11 @@ OctreeSendThread::OctreeSendThread(const SharedAssignmentPointer& myAssignment,
 }
 
 OctreeSendThread::~OctreeSendThread() {
+    // wait out any interval a worker still has running for us before anything is torn down
+    if (_myServer) {
+        _myServer->getSendScheduler()->removeSender(this);
+    }
+
     QString safeServerName("Octree");
     if (_myServer) {
         safeServerName = _myServer->getMyServerName();
@@ -73,8 +83,6 @@ bool OctreeSendThread::process() {
 
     OctreeServer::didProcess(this);
 
-    quint64  start = usecTimestampNow();
-
     // don't do any send processing until the initial load of the octree is complete...
     if (_myServer->isInitialLoadComplete()) {
         if (_node) {
@@ -89,31 +97,10 @@ bool OctreeSendThread::process() {
         }
     }
 
-    if (_isShuttingDown) {
-        return false; // exit early if we're shutting down
-    }
-
-    // Only sleep if we're still running and we got the lock last time we tried, otherwise try to get the lock asap
-    if (isStillRunning()) {
-        // dynamically sleep until we need to fire off the next set of octree elements
-        int elapsed = (usecTimestampNow() - start);
-        int usecToSleep =  OCTREE_SEND_INTERVAL_USECS - elapsed;
-
-        if (usecToSleep > 0) {
-            PerformanceWarning warn(false,"OctreeSendThread... usleep()",false,&_usleepTime,&_usleepCalls);
-            usleep(usecToSleep);
-        } else {
-            const int MIN_USEC_TO_SLEEP = 1;
-            usleep(MIN_USEC_TO_SLEEP);
-        }
-    }
-
-    return isStillRunning();  // keep running till they terminate us
+    // the send scheduler takes care of running us again once our next interval is due
+    return !_isShuttingDown;
 }
 
-quint64 OctreeSendThread::_usleepTime = 0;
-quint64 OctreeSendThread::_usleepCalls = 0;
-
 quint64 OctreeSendThread::_totalBytes = 0;
 quint64 OctreeSendThread::_totalWastedBytes = 0;
 quint64 OctreeSendThread::_totalPackets = 0;
@@ -292,6 +279,15 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
     // calculate max number of packets that can be sent during this interval
     int clientMaxPacketsPerInterval = std::max(1, (nodeData->getMaxOctreePacketsPerSecond() / INTERVALS_PER_SECOND));
     int maxPacketsPerInterval = std::min(clientMaxPacketsPerInterval, _myServer->getPacketsPerClientPerInterval());
+    
+    // when the outbound scheduler paces this client, pace it at the rate it asked for and only make up the packets
+    // it will get to send, the ones still queued from the last interval count against this one
+    OutboundScheduler* outboundScheduler = DependencyManager::get<NodeList>()->getOutboundScheduler();
+    if (outboundScheduler) {
+        outboundScheduler->setNodeBytesPerSecond(_node, maxPacketsPerInterval * INTERVALS_PER_SECOND * MAX_PACKET_SIZE);
+        int packetsQueued = outboundScheduler->getQueuedBytes(_node, TrafficClassEntity) / MAX_PACKET_SIZE;
+        maxPacketsPerInterval = std::max(0, maxPacketsPerInterval - packetsQueued);
+    }
 
     int truePacketsSent = 0;
     int trueBytesSent = 0;
@@ -314,6 +310,10 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
     // If we have a packet waiting, and our desired want color, doesn't match the current waiting packets color
     // then let's just send that waiting packet.
     if (!nodeData->getCurrentPacketFormatMatches()) {
+        // sections already written for the old format can't be mixed with the new one
+        _recordedScene.clear();
+        _sharedScene.clear();
+        
         if (nodeData->isPacketWaiting()) {
             packetsSentThisInterval += handlePacketSend(nodeData, trueBytesSent, truePacketsSent);
         } else {
@@ -330,7 +330,11 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
     // If the current view frustum has changed OR we have nothing to send, then search against
     // the current view frustum for things to send.
-    if (viewFrustumChanged || nodeData->elementBag.isEmpty()) {
+    if (viewFrustumChanged || (nodeData->elementBag.isEmpty() && !_sharedScene)) {
+        
+        // whatever scene we were in the middle of is abandoned
+        _recordedScene.clear();
+        _sharedScene.clear();
 
         // if our view has changed, we need to reset these things...
         if (viewFrustumChanged) {
@@ -351,12 +355,6 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
         nodeData->setLastRootTimestamp(_myServer->getOctree()->getRoot()->getLastChanged());
         _myServer->getOctree()->releaseSceneEncodeData(&nodeData->extraEncodeData);
 
-        // TODO: add these to stats page
-        //::endSceneSleepTime = _usleepTime;
-        //unsigned long sleepTime = ::endSceneSleepTime - ::startSceneSleepTime;
-        //unsigned long encodeTime = nodeData->stats.getTotalEncodeTime();
-        //unsigned long elapsedTime = nodeData->stats.getElapsedTime();
-
         int packetsJustSent = handlePacketSend(nodeData, trueBytesSent, truePacketsSent);
         packetsSentThisInterval += packetsJustSent;
 
@@ -365,9 +363,6 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             nodeData->elementBag.deleteAll();
         }
 
-        // TODO: add these to stats page
-        //::startSceneSleepTime = _usleepTime;
-        
         // start tracking our stats
         nodeData->stats.sceneStarted(isFullScene, viewFrustumChanged, _myServer->getOctree()->getRoot(), _myServer->getJurisdiction());
 
@@ -380,12 +375,37 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
         } else {
             nodeData->elementBag.insert(_myServer->getOctree()->getRoot());
         }
+        
+        // if another client with the same view had this scene encoded, send its sections instead of encoding again.
+        // Otherwise record the sections we encode so that the next client with this view can have them.
+        if (canShareScene(nodeData, viewFrustumChanged, isFullScene, wantDelta)) {
+            _sceneKey.rootLastChanged = _myServer->getOctree()->getRoot()->getLastChanged();
+            _sceneKey.viewFrustum = nodeData->getCurrentViewFrustum();
+            _sceneKey.octreeSizeScale = nodeData->getOctreeSizeScale();
+            _sceneKey.boundaryLevelAdjust = nodeData->getBoundaryLevelAdjust();
+            _sceneKey.wantColor = wantColor;
+            _sceneKey.wantCompression = wantCompression;
+            
+            _sharedScene = _myServer->getSceneCache().findScene(_sceneKey, _sceneKey.rootLastChanged);
+            
+            if (_sharedScene) {
+                nodeData->elementBag.deleteAll();
+                _nextSharedSection = 0;
+            } else {
+                _recordedScene = QSharedPointer<OctreeSceneSections>(new OctreeSceneSections());
+            }
+        }
     }
 
     // If we have something in our elementBag, then turn them into packets and send them out...
-    if (!nodeData->elementBag.isEmpty()) {
+    if (!nodeData->elementBag.isEmpty() || _sharedScene) {
         int bytesWritten = 0;
         quint64 start = usecTimestampNow();
+        
+        if (_sharedScene) {
+            packetsSentThisInterval += sendSharedSceneSections(nodeData, maxPacketsPerInterval - packetsSentThisInterval,
+                                                               trueBytesSent, truePacketsSent);
+        }
 
         // TODO: add these to stats page
         //quint64 startCompressTimeMsecs = OctreePacketData::getCompressContentTime() / 1000;
@@ -405,14 +425,18 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             bool lastNodeDidntFit = false; // assume each node fits
             if (!nodeData->elementBag.isEmpty()) {
                 
+                // the spine keeps the elements in the bag from being deleted, a subtree below the stripe depth is then
+                // encoded holding only its own stripe so edits elsewhere in the tree can go ahead
+                Octree* tree = _myServer->getOctree();
                 quint64 lockWaitStart = usecTimestampNow();
-                _myServer->getOctree()->lockForRead();
+                tree->lockSpineForRead();
+                OctreeElement* subTree = nodeData->elementBag.extract();
+                int stripe = tree->stripeOfElement(subTree);
+                tree->lockStripeForRead(stripe);
                 quint64 lockWaitEnd = usecTimestampNow();
                 lockWaitElapsedUsec = (float)(lockWaitEnd - lockWaitStart);
                 quint64 encodeStart = usecTimestampNow();
 
-                OctreeElement* subTree = nodeData->elementBag.extract();
-
                 /* TODO: Looking for a way to prevent locking and encoding a tree that is not
                 // going to result in any packets being sent...
                 //
@@ -482,7 +506,8 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                 }
 
                 nodeData->stats.encodeStopped();
-                _myServer->getOctree()->unlock();
+                tree->unlockStripe(stripe);
+                tree->unlockSpine();
             } else {
                 // If the bag was empty then we didn't even attempt to encode, and so we know the bytesWritten were 0
                 bytesWritten = 0;
@@ -513,6 +538,11 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
                     nodeData->writeToPacket(_packetData.getFinalizedData(), _packetData.getFinalizedSize());
                     extraPackingAttempts = 0;
+                    
+                    if (_recordedScene) {
+                        _recordedScene->append(QByteArray(reinterpret_cast<const char*>(_packetData.getFinalizedData()),
+                                                          _packetData.getFinalizedSize()));
+                    }
                     quint64 compressAndWriteEnd = usecTimestampNow();
                     compressAndWriteElapsedUsec = (float)(compressAndWriteEnd - compressAndWriteStart);
                 }
@@ -597,7 +627,16 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
         // if after sending packets we've emptied our bag, then we want to remember that we've sent all
         // the octree elements from the current view frustum
-        if (nodeData->elementBag.isEmpty()) {
+        if (nodeData->elementBag.isEmpty() && !_sharedScene) {
+            
+            // only a scene encoded entirely against one state of the tree can be shared
+            if (_recordedScene) {
+                if (_myServer->getOctree()->getRoot()->getLastChanged() == _sceneKey.rootLastChanged) {
+                    _myServer->getSceneCache().addScene(_sceneKey, _recordedScene);
+                }
+                _recordedScene.clear();
+            }
+            
             nodeData->updateLastKnownViewFrustum();
             nodeData->setViewSent(true);
             nodeData->map.erase(); // It would be nice if we could save this, and only reset it when the view frustum changes
@@ -607,3 +646,48 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
     return truePacketsSent;
 }
+
+bool OctreeSendThread::canShareScene(OctreeQueryNode* nodeData, bool viewFrustumChanged, bool isFullScene,
+                                     bool wantDelta) const {
+    // only a full scene from the root, encoded without anything the client has already been sent, comes out the same
+    // for every client with the same view. Leftover data in _packetData would end up in the first section.
+    return _myServer->wantsSceneCache()
+        && isFullScene
+        && !wantDelta
+        && !nodeData->getWantOcclusionCulling()
+        && !(viewFrustumChanged && nodeData->getWantLowResMoving())
+        && !_packetData.hasContent();
+}
+
+int OctreeSendThread::sendSharedSceneSections(OctreeQueryNode* nodeData, int maxPackets,
+                                              int& trueBytesSent, int& truePacketsSent) {
+    int packetsSent = 0;
+    
+    while (_nextSharedSection < _sharedScene->size() && packetsSent < maxPackets && !nodeData->isShuttingDown()) {
+        const QByteArray& section = _sharedScene->at(_nextSharedSection);
+        
+        // the same packing rules as for sections encoded here, so the client sees the same kind of packets
+        unsigned int writtenSize = section.size()
+            + (nodeData->getCurrentPacketIsCompressed() ? sizeof(OCTREE_PACKET_INTERNAL_SECTION_SIZE) : 0);
+        
+        if (writtenSize > nodeData->getAvailable()) {
+            packetsSent += handlePacketSend(nodeData, trueBytesSent, truePacketsSent);
+        }
+        
+        nodeData->writeToPacket(reinterpret_cast<const unsigned char*>(section.constData()), section.size());
+        ++_nextSharedSection;
+        
+        if (!nodeData->getCurrentPacketIsCompressed() || nodeData->getAvailable() < MINIMUM_ATTEMPT_MORE_PACKING) {
+            packetsSent += handlePacketSend(nodeData, trueBytesSent, truePacketsSent);
+        }
+    }
+    
+    if (_nextSharedSection == _sharedScene->size()) {
+        if (nodeData->isPacketWaiting()) {
+            packetsSent += handlePacketSend(nodeData, trueBytesSent, truePacketsSent);
+        }
+        _sharedScene.clear();
+    }
+    
+    return packetsSent;
+}
@@ -5,7 +5,7 @@
 //  Created by Brad Hefta-Gaub on 8/21/13.
 //  Copyright 2013 High Fidelity, Inc.
 //
-//  Threaded or non-threaded object for sending octree data packets to a client
+//  Non-threaded object for sending octree data packets to a client, run by the OctreeSendScheduler
 //
 //  Distributed under the Apache License, Version 2.0.
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
@@ -19,10 +19,12 @@
 #include <OctreeElementBag.h>
 
 #include "OctreeQueryNode.h"
+#include "OctreeSceneCache.h"
 
 class OctreeServer;
 
-/// Threaded processor for sending octree packets to a single client
+/// Processor for sending octree packets to a single client. It runs in non-threaded mode, the server's
+/// OctreeSendScheduler calls process() on a worker thread once per send interval.
 class OctreeSendThread : public GenericThread {
     Q_OBJECT
 public:
@@ -35,11 +37,7 @@ public:
     static quint64 _totalWastedBytes;
     static quint64 _totalPackets;
 
-    static quint64 _usleepTime;
-    static quint64 _usleepCalls;
-
-protected:
-    /// Implements generic processing behavior for this thread.
+    /// Sends one interval's worth of packets, returns false once the client is gone.
     virtual bool process();
 
 private:
@@ -50,9 +48,17 @@ private:
 
     int handlePacketSend(OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent);
     int packetDistributor(OctreeQueryNode* nodeData, bool viewFrustumChanged);
+    
+    bool canShareScene(OctreeQueryNode* nodeData, bool viewFrustumChanged, bool isFullScene, bool wantDelta) const;
+    int sendSharedSceneSections(OctreeQueryNode* nodeData, int maxPackets, int& trueBytesSent, int& truePacketsSent);
 
     OctreePacketData _packetData;
     
+    OctreeSceneKey _sceneKey;
+    QSharedPointer<OctreeSceneSections> _recordedScene; // the scene being encoded here, shared once it completes
+    SharedOctreeSceneSections _sharedScene; // a scene encoded by another thread that is being sent instead
+    int _nextSharedSection;
+    
     int _nodeMissingCount;
     bool _isShuttingDown;
 };
@@ -15,6 +15,7 @@
 #include <QTimer>
 #include <QUuid>
 
+#include <algorithm>
 #include <time.h>
 
 #include <AccountManager.h>
@@ -230,9 +231,15 @@ OctreeServer::OctreeServer(const QByteArray& packet) :
     _packetsTotalPerInterval(DEFAULT_PACKETS_PER_INTERVAL),
     _tree(NULL),
     _wantPersist(true),
+    _wantPersistJournal(true),
+    _snapshotInterval(OctreePersistThread::DEFAULT_SNAPSHOT_INTERVAL),
     _debugSending(false),
     _debugReceiving(false),
     _verboseDebug(false),
+    _wantSceneCache(true),
+    _wantEditBatching(true),
+    _sceneCache(),
+    _sendScheduler(new OctreeSendScheduler()),
     _jurisdiction(NULL),
     _jurisdictionSender(NULL),
     _octreeInboundPacketProcessor(NULL),
@@ -279,6 +286,13 @@ OctreeServer::~OctreeServer() {
         _persistThread->deleteLater();
     }
 
+    // every sender has been removed by now, this waits for the workers to go idle before the tree goes away
+    delete _sendScheduler;
+    _sendScheduler = NULL;
+
+    // the threads above were the other ones writing to nodes, with them stopped the scheduler can go
+    DependencyManager::get<NodeList>()->stopOutboundScheduler();
+
     delete _jurisdiction;
     _jurisdiction = NULL;
     
@@ -330,6 +344,8 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             showStats = true;
         } else if (url.path() == "/resetStats") {
             _octreeInboundPacketProcessor->resetStats();
+            _sendScheduler->resetStats();
+            _tree->resetLockStats();
             resetSendingStats();
             showStats = true;
         }
@@ -435,6 +451,57 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
         statsString += QString("      writeDatagram() last second: %1 clients\r\n\r\n")
             .arg(locale.toString((uint)howManyThreadsDidCallWriteDatagram(oneSecondAgo)).rightJustified(COLUMN_WIDTH, ' '));
 
+        statsString += QString("                     Send Threads: %1 threads\r\n")
+            .arg(locale.toString((uint)_sendScheduler->getNumWorkerThreads()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("                 Send Queue Depth: %1 clients\r\n")
+            .arg(locale.toString((uint)_sendScheduler->getQueueDepth()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString().sprintf("          Average send queue depth:    %9.2f clients\r\n",
+                                         _sendScheduler->getAverageQueueDepth());
+        statsString += QString().sprintf("          Average send job latency:    %9.2f usecs"
+                                         "                 samples: %12d \r\n",
+                                         _sendScheduler->getAverageJobLatency(),
+                                         _sendScheduler->getJobLatencySampleCount());
+        statsString += QString().sprintf("              Max send job latency:    %9llu usecs\r\n",
+                                         (unsigned long long)_sendScheduler->getMaxJobLatency());
+        statsString += QString().sprintf("             Average send job time:    %9.2f usecs\r\n\r\n",
+                                         _sendScheduler->getAverageJobTime());
+
+        // tree locks, the stripes that were waited on longest
+        const OctreeLock& treeLock = _tree->getLock();
+        OctreeLockStats spineStats = treeLock.getSpineStats();
+        statsString += QString("                Lock Stripe Depth: %1 levels\r\n")
+            .arg(locale.toString((uint)treeLock.getStripeDepth()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("                     Lock Stripes: %1 stripes\r\n")
+            .arg(locale.toString((uint)treeLock.getNumStripes()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString().sprintf("                  Spine lock waits:    %9llu of %12llu    total: %12llu usecs"
+                                         "    max: %9llu usecs\r\n",
+                                         (unsigned long long)spineStats.contended,
+                                         (unsigned long long)spineStats.acquisitions,
+                                         (unsigned long long)spineStats.totalWaitUsecs,
+                                         (unsigned long long)spineStats.maxWaitUsecs);
+
+        const int MAX_STRIPES_SHOWN = 8;
+        QVector<QPair<quint64, int> > stripeWaits;
+        for (int stripe = 0; stripe < treeLock.getNumStripes(); stripe++) {
+            OctreeLockStats stripeStats = treeLock.getStripeStats(stripe);
+            if (stripeStats.contended > 0) {
+                stripeWaits.append(qMakePair(stripeStats.totalWaitUsecs, stripe));
+            }
+        }
+        std::sort(stripeWaits.begin(), stripeWaits.end());
+        std::reverse(stripeWaits.begin(), stripeWaits.end());
+        for (int i = 0; i < stripeWaits.size() && i < MAX_STRIPES_SHOWN; i++) {
+            int stripe = stripeWaits[i].second;
+            OctreeLockStats stripeStats = treeLock.getStripeStats(stripe);
+            statsString += QString().sprintf("            Stripe %4d lock waits:    %9llu of %12llu"
+                                             "    total: %12llu usecs    max: %9llu usecs\r\n", stripe,
+                                             (unsigned long long)stripeStats.contended,
+                                             (unsigned long long)stripeStats.acquisitions,
+                                             (unsigned long long)stripeStats.totalWaitUsecs,
+                                             (unsigned long long)stripeStats.maxWaitUsecs);
+        }
+        statsString += "\r\n";
+
         float averageLoopTime = getAverageLoopTime();
         statsString += QString().sprintf("           Average packetLoop() time:      %7.2f msecs"
                                          "                 samples: %12d \r\n", 
@@ -652,6 +719,16 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             .arg(locale.toString((uint)averageProcessTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
         statsString += QString("  Average Wait Lock Time/Element: %1 usecs\r\n")
             .arg(locale.toString((uint)averageLockWaitTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("              Total Edit Batches: %1 batches\r\n")
+            .arg(locale.toString((uint)_octreeInboundPacketProcessor->getTotalEditBatches()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString().sprintf("             Average Edits/Batch: %9.2f edits\r\n",
+                                         _octreeInboundPacketProcessor->getAverageEditsPerBatch());
+        statsString += QString().sprintf("                Edits Per Second: %9.2f edits/sec\r\n",
+                                         _octreeInboundPacketProcessor->getEditsPerSecond());
+        statsString += QString("    Average Lock Hold Time/Batch: %1 usecs\r\n")
+            .arg(locale.toString((uint)_octreeInboundPacketProcessor->getAverageBatchLockHoldTime()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("        Max Lock Hold Time/Batch: %1 usecs\r\n")
+            .arg(locale.toString((uint)_octreeInboundPacketProcessor->getMaxBatchLockHoldTime()).rightJustified(COLUMN_WIDTH, ' '));
 
 
         int senderNumber = 0;
@@ -888,8 +965,8 @@ void OctreeServer::setupDatagramProcessingThread() {
     nodeList->getNodeSocket().setParent(NULL);
     nodeList->getNodeSocket().moveToThread(_datagramProcessingThread);
     
-    // let the datagram processor handle readyRead from node socket
-    connect(&nodeList->getNodeSocket(), &QUdpSocket::readyRead,
+    // let the datagram processor read batches of datagrams whenever the node socket has them
+    connect(datagramProcessor->getDatagramReader(), &DatagramBatchReader::datagramsPending,
             datagramProcessor, &OctreeServerDatagramProcessor::readPendingDatagrams);
     
     // connect to the datagram processing thread signal that tells us we have to handle a packet
@@ -1022,6 +1099,29 @@ void OctreeServer::readConfiguration() {
     readOptionBool(QString("debugTimestampNow"), settingsSectionObject, _debugTimestampNow);
     qDebug() << "debugTimestampNow=" << _debugTimestampNow;
 
+    bool noSceneCache;
+    readOptionBool(QString("NoSceneCache"), settingsSectionObject, noSceneCache);
+    _wantSceneCache = !noSceneCache;
+    qDebug() << "wantSceneCache=" << _wantSceneCache;
+
+    bool noEditBatching;
+    readOptionBool(QString("NoEditBatching"), settingsSectionObject, noEditBatching);
+    _wantEditBatching = !noEditBatching;
+    qDebug() << "wantEditBatching=" << _wantEditBatching;
+
+    // zero asks for one send thread per core
+    int sendThreads = 0;
+    if (readOptionInt(QString("sendThreads"), settingsSectionObject, sendThreads) && sendThreads > 0) {
+        _sendScheduler->setNumWorkerThreads(sendThreads);
+    }
+    qDebug() << "sendThreads=" << _sendScheduler->getNumWorkerThreads();
+
+    // the tree is locked a subtree at a time below this depth, 0 locks it as a whole
+    int lockStripeDepth = DEFAULT_LOCK_STRIPE_DEPTH;
+    readOptionInt(QString("lockStripeDepth"), settingsSectionObject, lockStripeDepth);
+    _tree->setLockStripeDepth(lockStripeDepth);
+    qDebug() << "lockStripeDepth=" << _tree->getLock().getStripeDepth();
+
     bool noPersist;
     readOptionBool(QString("NoPersist"), settingsSectionObject, noPersist);
     _wantPersist = !noPersist;
@@ -1044,6 +1144,15 @@ void OctreeServer::readConfiguration() {
         _wantBackup = !noBackup;
         qDebug() << "wantBackup=" << _wantBackup;
 
+        bool noPersistJournal;
+        readOptionBool(QString("NoPersistJournal"), settingsSectionObject, noPersistJournal);
+        _wantPersistJournal = !noPersistJournal;
+        qDebug() << "wantPersistJournal=" << _wantPersistJournal;
+
+        _snapshotInterval = OctreePersistThread::DEFAULT_SNAPSHOT_INTERVAL;
+        readOptionInt(QString("snapshotInterval"), settingsSectionObject, _snapshotInterval);
+        qDebug() << "snapshotInterval=" << _snapshotInterval;
+
         //qDebug() << "settingsSectionObject:" << settingsSectionObject;
         
     } else {
@@ -1107,6 +1216,10 @@ void OctreeServer::run() {
 
     // read the configuration from either the payload or the domain server configuration
     readConfiguration();
+    
+    // queue the packets to each client and send them paced at the client's rate, so that a scene going out to one
+    // doesn't sit in the socket buffer ahead of everyone else's packets
+    nodeList->startOutboundScheduler(getPacketsPerClientPerSecond() * MAX_PACKET_SIZE);
         
     beforeRun(); // after payload has been processed
 
@@ -1130,7 +1243,8 @@ void OctreeServer::run() {
 
         // now set up PersistThread
         _persistThread = new OctreePersistThread(_tree, _persistFilename, _persistInterval,
-                                    _wantBackup, _settings, _debugTimestampNow);
+                                    _wantBackup, _settings, _debugTimestampNow,
+                                    _wantPersistJournal, _snapshotInterval);
         if (_persistThread) {
             _persistThread->initialize(true);
         }
@@ -1149,6 +1263,9 @@ void OctreeServer::run() {
     _octreeInboundPacketProcessor = new OctreeInboundPacketProcessor(this);
     _octreeInboundPacketProcessor->initialize(true);
 
+    // start handing out the clients' send intervals to the worker threads
+    _sendScheduler->initialize(true);
+
     // Convert now to tm struct for local timezone
     tm* localtm = localtime(&_started);
     const int MAX_TIME_LENGTH = 128;
@@ -1220,7 +1337,7 @@ void OctreeServer::aboutToFinish() {
     if (_persistThread) {
         _persistThread->aboutToFinish();
     }
-
+    
     qDebug() << qPrintable(_safeServerName) << "server ENDING about to finish...";
 }
 
@@ -1369,6 +1486,9 @@ void OctreeServer::sendStatsPacket() {
         (double)OctreePacketData::getTotalBytesOfBitMasks();
     statsObject2[baseName + QString(".2.outbound.data.totalBytesBitMasks")] = (double)OctreePacketData::getTotalBytesOfColor();
 
+    statsObject2[baseName + QString(".2.outbound.data.sceneCacheHits")] = (double)_sceneCache.getNumHits();
+    statsObject2[baseName + QString(".2.outbound.data.sceneCacheMisses")] = (double)_sceneCache.getNumMisses();
+
     statsObject2[baseName + QString(".2.outbound.timing.1.avgLoopTime")] = getAverageLoopTime();
     statsObject2[baseName + QString(".2.outbound.timing.2.avgInsideTime")] = getAverageInsideTime();
     statsObject2[baseName + QString(".2.outbound.timing.3.avgTreeLockTime")] = getAverageTreeWaitTime();
@@ -1376,6 +1496,31 @@ void OctreeServer::sendStatsPacket() {
     statsObject2[baseName + QString(".2.outbound.timing.5.avgCompressAndWriteTime")] = getAverageCompressAndWriteTime();
     statsObject2[baseName + QString(".2.outbound.timing.5.avgSendTime")] = getAveragePacketSendingTime();
     statsObject2[baseName + QString(".2.outbound.timing.5.nodeWaitTime")] = getAverageNodeWaitTime();
+    statsObject2[baseName + QString(".2.outbound.timing.6.avgSendJobLatency")] = _sendScheduler->getAverageJobLatency();
+    statsObject2[baseName + QString(".2.outbound.timing.6.maxSendJobLatency")] = (double)_sendScheduler->getMaxJobLatency();
+    statsObject2[baseName + QString(".2.outbound.timing.6.avgSendJobTime")] = _sendScheduler->getAverageJobTime();
+    statsObject2[baseName + QString(".2.outbound.timing.6.sendQueueDepth")] = _sendScheduler->getQueueDepth();
+    statsObject2[baseName + QString(".2.outbound.timing.6.avgSendQueueDepth")] = _sendScheduler->getAverageQueueDepth();
+
+    // lock waits on the spine, and summed over the stripes along with the worst stripe's
+    const OctreeLock& treeLock = _tree->getLock();
+    OctreeLockStats spineStats = treeLock.getSpineStats();
+    quint64 stripeWaitUsecs = 0;
+    quint64 maxStripeWaitUsecs = 0;
+    int mostWaitedStripe = 0;
+    for (int stripe = 0; stripe < treeLock.getNumStripes(); stripe++) {
+        OctreeLockStats stripeStats = treeLock.getStripeStats(stripe);
+        stripeWaitUsecs += stripeStats.totalWaitUsecs;
+        if (stripeStats.totalWaitUsecs > maxStripeWaitUsecs) {
+            maxStripeWaitUsecs = stripeStats.totalWaitUsecs;
+            mostWaitedStripe = stripe;
+        }
+    }
+    statsObject2[baseName + QString(".2.outbound.timing.7.lockStripeDepth")] = treeLock.getStripeDepth();
+    statsObject2[baseName + QString(".2.outbound.timing.7.spineLockWaitTime")] = (double)spineStats.totalWaitUsecs;
+    statsObject2[baseName + QString(".2.outbound.timing.7.stripeLockWaitTime")] = (double)stripeWaitUsecs;
+    statsObject2[baseName + QString(".2.outbound.timing.7.mostWaitedStripe")] = mostWaitedStripe;
+    statsObject2[baseName + QString(".2.outbound.timing.7.mostWaitedStripeLockWaitTime")] = (double)maxStripeWaitUsecs;
 
     DependencyManager::get<NodeList>()->sendStatsToDomainServer(statsObject2);
 
@@ -1395,6 +1540,14 @@ void OctreeServer::sendStatsPacket() {
         (double)_octreeInboundPacketProcessor->getAverageProcessTimePerElement();
     statsObject3[baseName + QString(".3.inbound.timing.5.avgLockWaitTimePerElement")] = 
         (double)_octreeInboundPacketProcessor->getAverageLockWaitTimePerElement();
+    statsObject3[baseName + QString(".3.inbound.data.3.totalEditBatches")] = 
+        (double)_octreeInboundPacketProcessor->getTotalEditBatches();
+    statsObject3[baseName + QString(".3.inbound.data.4.editsPerSecond")] = 
+        (double)_octreeInboundPacketProcessor->getEditsPerSecond();
+    statsObject3[baseName + QString(".3.inbound.timing.6.avgLockHoldTimePerBatch")] = 
+        (double)_octreeInboundPacketProcessor->getAverageBatchLockHoldTime();
+    statsObject3[baseName + QString(".3.inbound.timing.7.maxLockHoldTimePerBatch")] = 
+        (double)_octreeInboundPacketProcessor->getMaxBatchLockHoldTime();
 
     DependencyManager::get<NodeList>()->sendStatsToDomainServer(statsObject3);
 }
@@ -22,6 +22,8 @@
 #include <EnvironmentData.h>
 
 #include "OctreePersistThread.h"
+#include "OctreeSceneCache.h"
+#include "OctreeSendScheduler.h"
 #include "OctreeSendThread.h"
 #include "OctreeServerConsts.h"
 #include "OctreeInboundPacketProcessor.h"
@@ -44,6 +46,12 @@ public:
 
     Octree* getOctree() { return _tree; }
     JurisdictionMap* getJurisdiction() { return _jurisdiction; }
+    
+    bool wantsEditBatching() const { return _wantEditBatching; }
+    bool wantsSceneCache() const { return _wantSceneCache; }
+    OctreeSceneCache& getSceneCache() { return _sceneCache; }
+
+    OctreeSendScheduler* getSendScheduler() { return _sendScheduler; }
 
     int getPacketsPerClientPerInterval() const { return std::min(_packetsPerClientPerInterval, 
                                 std::max(1, getPacketsTotalPerInterval() / std::max(1, getCurrentClientCount()))); }
@@ -161,10 +169,16 @@ protected:
     int _packetsTotalPerInterval;
     Octree* _tree; // this IS a reaveraging tree
     bool _wantPersist;
+    bool _wantPersistJournal;
+    int _snapshotInterval;
     bool _debugSending;
     bool _debugReceiving;
     bool _debugTimestampNow;
     bool _verboseDebug;
+    bool _wantSceneCache;
+    bool _wantEditBatching;
+    OctreeSceneCache _sceneCache;
+    OctreeSendScheduler* _sendScheduler;
     JurisdictionMap* _jurisdiction;
     JurisdictionSender* _jurisdictionSender;
     OctreeInboundPacketProcessor* _octreeInboundPacketProcessor;
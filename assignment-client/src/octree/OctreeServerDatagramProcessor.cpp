@@ -20,6 +20,7 @@
 
 OctreeServerDatagramProcessor::OctreeServerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread) :
     _nodeSocket(nodeSocket),
+    _datagramReader(new DatagramBatchReader(nodeSocket, this)),
     _previousNodeSocketThread(previousNodeSocketThread)
 {
     
@@ -32,24 +33,21 @@ OctreeServerDatagramProcessor::~OctreeServerDatagramProcessor() {
 
 void OctreeServerDatagramProcessor::readPendingDatagrams() {
     
-    HifiSockAddr senderSockAddr;
-    static QByteArray incomingPacket;
-    
-    // read everything that is available
-    while (_nodeSocket.hasPendingDatagrams()) {
-        incomingPacket.resize(_nodeSocket.pendingDatagramSize());
-        
-        // just get this packet off the stack
-        _nodeSocket.readDatagram(incomingPacket.data(), incomingPacket.size(),
-                                  senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
-                                  
-        PacketType packetType = packetTypeForPacket(incomingPacket);
-        if (packetType == PacketTypePing) {
-            DependencyManager::get<NodeList>()->processNodeData(senderSockAddr, incomingPacket);
-            return; // don't emit
+    // read everything that is available, a batch at a time
+    int numDatagrams;
+    while ((numDatagrams = _datagramReader->readBatch()) > 0) {
+        for (int i = 0; i < numDatagrams; i++) {
+            QByteArray incomingPacket(_datagramReader->getDatagram(i), _datagramReader->getDatagramSize(i));
+            const HifiSockAddr& senderSockAddr = _datagramReader->getSenderSockAddr(i);
+            
+            PacketType packetType = packetTypeForPacket(incomingPacket);
+            if (packetType == PacketTypePing) {
+                DependencyManager::get<NodeList>()->processNodeData(senderSockAddr, incomingPacket);
+                continue; // don't emit, but keep going since the rest of the batch has already been read
+            }
+            
+            // emit the signal to tell OctreeServer it needs to process a packet
+            emit packetRequiresProcessing(incomingPacket, senderSockAddr);
         }
-        
-        // emit the signal to tell AudioMixer it needs to process a packet
-        emit packetRequiresProcessing(incomingPacket, senderSockAddr);
     }
 }
@@ -15,17 +15,22 @@
 #include <qobject.h>
 #include <qudpsocket.h>
 
+#include <DatagramBatchReader.h>
+
 class OctreeServerDatagramProcessor : public QObject {
     Q_OBJECT
 public:
     OctreeServerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread);
     ~OctreeServerDatagramProcessor();
+    
+    DatagramBatchReader* getDatagramReader() { return _datagramReader; }
 public slots:
     void readPendingDatagrams();
 signals:
     void packetRequiresProcessing(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr);
 private:
     QUdpSocket& _nodeSocket;
+    DatagramBatchReader* _datagramReader;
     QThread* _previousNodeSocketThread;
 };
 
@@ -56,7 +56,11 @@ DomainServer::DomainServer(int argc, char* argv[]) :
     _cookieSessionHash(),
     _automaticNetworkingSetting(),
     _settingsManager(),
-    _iceServerSocket(ICE_SERVER_DEFAULT_HOSTNAME, ICE_SERVER_DEFAULT_PORT)
+    _iceServerSocket(ICE_SERVER_DEFAULT_HOSTNAME, ICE_SERVER_DEFAULT_PORT),
+    _domainListVersion(0),
+    _domainListChanges(),
+    _domainListRemovals(),
+    _oldestDomainListDeltaVersion(0)
 {
     LogUtils::init();
 
@@ -657,6 +661,8 @@ void DomainServer::handleConnectRequest(const QByteArray& packet, const HifiSock
         // if we have a username from an OAuth connect request, set it on the DomainServerNodeData
         nodeData->setUsername(username);
         nodeData->setSendingSockAddr(senderSockAddr);
+        
+        domainListNodeChanged(newNode);
 
         // reply back to the user with a PacketTypeDomainList
         sendDomainListToNode(newNode, senderSockAddr, nodeInterestList.toSet());
@@ -834,17 +840,19 @@ NodeSet DomainServer::nodeInterestListFromPacket(const QByteArray& packet, int n
     return nodeInterestSet;
 }
 
-void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
-                                        const NodeSet& nodeInterestList) {
-
-    QByteArray broadcastPacket = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+// nodes that check in with a domain list version get only what changed since, this often they get the whole list
+const qint64 FULL_DOMAIN_LIST_INTERVAL_MSECS = 30 * 1000;
 
-    // always send the node their own UUID back
-    QDataStream broadcastDataStream(&broadcastPacket, QIODevice::Append);
-    broadcastDataStream << node->getUUID();
+// how many removals are remembered for the nodes that haven't seen them yet
+const int MAX_DOMAIN_LIST_REMOVALS = 1000;
 
-    int numBroadcastPacketLeadBytes = broadcastDataStream.device()->pos();
+void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
+                                        const NodeSet& nodeInterestList, quint32 lastDomainListVersion) {
 
+    if (nodeInterestList.size() == 0) {
+        return;
+    }
+    
     DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
     
     auto nodeList = DependencyManager::get<LimitedNodeList>();
@@ -855,63 +863,122 @@ void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const Hif
     if (destinationSockAddr.isNull()) {
         destinationSockAddr = senderSockAddr;
     }
-
-    if (nodeInterestList.size() > 0) {
-
-//        DTLSServerSession* dtlsSession = _isUsingDTLS ? _dtlsSessions[senderSockAddr] : NULL;
-        int dataMTU = MAX_PACKET_SIZE;
-
-        if (nodeData->isAuthenticated()) {
-            // if this authenticated node has any interest types, send back those nodes as well
-            nodeList->eachNode([&](const SharedNodePointer& otherNode){
-                // reset our nodeByteArray and nodeDataStream
-                QByteArray nodeByteArray;
-                QDataStream nodeDataStream(&nodeByteArray, QIODevice::Append);
-                
-                if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())) {
-                    
-                    // don't send avatar nodes to other avatars, that will come from avatar mixer
-                    nodeDataStream << *otherNode.data();
-                    
-                    // pack the secret that these two nodes will use to communicate with each other
-                    QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
-                    if (secretUUID.isNull()) {
-                        // generate a new secret UUID these two nodes can use
-                        secretUUID = QUuid::createUuid();
-                        
-                        // set that on the current Node's sessionSecretHash
-                        nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
-                        
-                        // set it on the other Node's sessionSecretHash
-                        reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
-                        ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
-                        
-                    }
-                    
-                    nodeDataStream << secretUUID;
-                    
-                    if (broadcastPacket.size() +  nodeByteArray.size() > dataMTU) {
-                        // we need to break here and start a new packet
-                        // so send the current one
-                        
-                        nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
-                        
-                        // reset the broadcastPacket structure
-                        broadcastPacket.resize(numBroadcastPacketLeadBytes);
-                        broadcastDataStream.device()->seek(numBroadcastPacketLeadBytes);
-                    }
-                    
-                    // append the nodeByteArray to the current state of broadcastDataStream
-                    broadcastPacket.append(nodeByteArray);
+    
+    bool isDelta = lastDomainListVersion != 0 && lastDomainListVersion >= _oldestDomainListDeltaVersion
+        && lastDomainListVersion <= _domainListVersion
+        && nodeData->getFullDomainListTimer().isValid()
+        && nodeData->getFullDomainListTimer().elapsed() < FULL_DOMAIN_LIST_INTERVAL_MSECS;
+    
+    if (!isDelta) {
+        nodeData->getFullDomainListTimer().start();
+    }
+    
+    // gather the entries first, so every packet can say how many make up this version of the list
+    QList<QByteArray> packetPayloads;
+    QByteArray payload;
+    
+    // always send the node their own UUID back, then the list version and where this packet is in it
+    QByteArray leadBytes = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+    int numLeadBytes = leadBytes.size() + NUM_BYTES_RFC4122_UUID + sizeof(quint32) + sizeof(bool) + 2 * sizeof(quint16);
+    int dataMTU = MAX_PACKET_SIZE;
+    
+    auto appendEntry = [&](const QByteArray& entry) {
+        if (numLeadBytes + payload.size() + entry.size() > dataMTU && !payload.isEmpty()) {
+            packetPayloads << payload;
+            payload.clear();
+        }
+        payload.append(entry);
+    };
+    
+    auto appendNodeEntry = [&](const SharedNodePointer& otherNode) {
+        DomainServerNodeData* otherNodeData = reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData());
+        if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())
+            && otherNodeData && !otherNodeData->getDomainListEntry().isEmpty()) {
+            // the node's entry is serialized once each time it changes, only the secret is per pair
+            QByteArray entry = otherNodeData->getDomainListEntry();
+            QDataStream entryStream(&entry, QIODevice::Append);
+            entryStream << connectionSecretForNodes(node, otherNode);
+            appendEntry(entry);
+        }
+    };
+    
+    if (nodeData->isAuthenticated()) {
+        // if this authenticated node has any interest types, send back those nodes as well
+        if (isDelta) {
+            // removed nodes go out as their UUID with the unassigned type
+            QMap<quint32, QPair<QUuid, NodeType_t> >::const_iterator removal =
+                _domainListRemovals.upperBound(lastDomainListVersion);
+            for (; removal != _domainListRemovals.constEnd(); removal++) {
+                if (nodeInterestList.contains(removal.value().second)) {
+                    QByteArray entry;
+                    QDataStream entryStream(&entry, QIODevice::Append);
+                    entryStream << NodeType::Unassigned << removal.value().first;
+                    appendEntry(entry);
                 }
+            }
+            
+            QMap<quint32, QUuid>::const_iterator change = _domainListChanges.upperBound(lastDomainListVersion);
+            for (; change != _domainListChanges.constEnd(); change++) {
+                SharedNodePointer otherNode = nodeList->nodeWithUUID(change.value());
+                if (otherNode) {
+                    appendNodeEntry(otherNode);
+                }
+            }
+        } else {
+            nodeList->eachNode([&](const SharedNodePointer& otherNode){
+                appendNodeEntry(otherNode);
             });
         }
-
-        // always write the last broadcastPacket
+    }
+    
+    // always write the last packet, the node needs its own UUID even with nothing else in the list
+    packetPayloads << payload;
+    
+    quint16 numPackets = packetPayloads.size();
+    for (quint16 packetNumber = 0; packetNumber < numPackets; packetNumber++) {
+        QByteArray broadcastPacket = leadBytes;
+        QDataStream broadcastDataStream(&broadcastPacket, QIODevice::Append);
+        broadcastDataStream << node->getUUID() << _domainListVersion << !isDelta << packetNumber << numPackets;
+        broadcastPacket.append(packetPayloads[packetNumber]);
+        
         nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
     }
 }
 
+void DomainServer::domainListNodeChanged(const SharedNodePointer& node) {
+    DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
+    if (!nodeData) {
+        return;
+    }
+    
+    _domainListChanges.remove(nodeData->getDomainListVersion());
+    _domainListChanges.insert(++_domainListVersion, node->getUUID());
+    
+    QByteArray domainListEntry;
+    QDataStream entryStream(&domainListEntry, QIODevice::Append);
+    entryStream << *node.data();
+    nodeData->setDomainListEntry(domainListEntry, _domainListVersion);
+}
+
+QUuid DomainServer::connectionSecretForNodes(const SharedNodePointer& node, const SharedNodePointer& otherNode) {
+    DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
+    
+    // pack the secret that these two nodes will use to communicate with each other
+    QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
+    if (secretUUID.isNull()) {
+        // generate a new secret UUID these two nodes can use
+        secretUUID = QUuid::createUuid();
+        
+        // set that on the current Node's sessionSecretHash
+        nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
+        
+        // set it on the other Node's sessionSecretHash
+        reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
+            ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
+    }
+    return secretUUID;
+}
+
 void DomainServer::readAvailableDatagrams() {
     auto nodeList = DependencyManager::get<LimitedNodeList>();
 
@@ -1285,17 +1352,22 @@ void DomainServer::processDatagram(const QByteArray& receivedPacket, const HifiS
                                                senderSockAddr);
                     
                     SharedNodePointer checkInNode = nodeList->nodeWithUUID(nodeUUID);
-                    checkInNode->setPublicSocket(nodePublicAddress);
-                    checkInNode->setLocalSocket(nodeLocalAddress);
+                    if (checkInNode->getPublicSocket() != nodePublicAddress
+                        || checkInNode->getLocalSocket() != nodeLocalAddress) {
+                        checkInNode->setPublicSocket(nodePublicAddress);
+                        checkInNode->setLocalSocket(nodeLocalAddress);
+                        domainListNodeChanged(checkInNode);
+                    }
                     
                     // update last receive to now
                     quint64 timeNow = usecTimestampNow();
                     checkInNode->setLastHeardMicrostamp(timeNow);
                     
                     QList<NodeType_t> nodeInterestList;
-                    packetStream >> nodeInterestList;
+                    quint32 lastDomainListVersion = 0;
+                    packetStream >> nodeInterestList >> lastDomainListVersion;
                     
-                    sendDomainListToNode(checkInNode, senderSockAddr, nodeInterestList.toSet());
+                    sendDomainListToNode(checkInNode, senderSockAddr, nodeInterestList.toSet(), lastDomainListVersion);
                 }
                 
                 break;
@@ -1983,6 +2055,14 @@ void DomainServer::nodeKilled(SharedNodePointer node) {
     DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
 
     if (nodeData) {
+        // the nodes that know about this one hear it was removed with their next domain list
+        _domainListChanges.remove(nodeData->getDomainListVersion());
+        _domainListRemovals.insert(++_domainListVersion, qMakePair(node->getUUID(), node->getType()));
+        if (_domainListRemovals.size() > MAX_DOMAIN_LIST_REMOVALS) {
+            _oldestDomainListDeltaVersion = _domainListRemovals.begin().key();
+            _domainListRemovals.erase(_domainListRemovals.begin());
+        }
+        
         // if this node's UUID matches a static assignment we need to throw it back in the assignment queue
         if (!nodeData->getAssignmentUUID().isNull()) {
             SharedAssignmentPointer matchedAssignment = _allAssignments.take(nodeData->getAssignmentUUID());
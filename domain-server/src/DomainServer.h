@@ -15,6 +15,8 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QHash>
 #include <QtCore/QJsonObject>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
 #include <QtCore/QQueue>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QStringList>
@@ -96,7 +98,9 @@ private:
                                    const HifiSockAddr& senderSockAddr);
     NodeSet nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes);
     void sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr& senderSockAddr,
-                              const NodeSet& nodeInterestList);
+                              const NodeSet& nodeInterestList, quint32 lastDomainListVersion = 0);
+    void domainListNodeChanged(const SharedNodePointer& node);
+    QUuid connectionSecretForNodes(const SharedNodePointer& node, const SharedNodePointer& otherNode);
     
     void parseAssignmentConfigs(QSet<Assignment::Type>& excludedTypes);
     void addStaticAssignmentToAssignmentHash(Assignment* newAssignment);
@@ -153,6 +157,13 @@ private:
     DomainServerSettingsManager _settingsManager;
     
     HifiSockAddr _iceServerSocket;
+    
+    // every add, change or removal of a node bumps the domain list version, nodes check in with the version they have
+    // and are sent what changed since
+    quint32 _domainListVersion;
+    QMap<quint32, QUuid> _domainListChanges; // the version each node last changed at
+    QMap<quint32, QPair<QUuid, NodeType_t> > _domainListRemovals;
+    quint32 _oldestDomainListDeltaVersion; // removals before this were dropped, older versions get the full list
 };
 
 
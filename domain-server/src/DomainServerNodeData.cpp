@@ -25,7 +25,10 @@ DomainServerNodeData::DomainServerNodeData() :
     _paymentIntervalTimer(),
     _statsJSONObject(),
     _sendingSockAddr(),
-    _isAuthenticated(true)
+    _isAuthenticated(true),
+    _domainListEntry(),
+    _domainListVersion(0),
+    _fullDomainListTimer()
 {
     _paymentIntervalTimer.start();
 }
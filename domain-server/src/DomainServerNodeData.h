@@ -47,6 +47,14 @@ public:
     bool isAuthenticated() const { return _isAuthenticated; }
     
     QHash<QUuid, QUuid>& getSessionSecretHash() { return _sessionSecretHash; }
+    
+    /// this node's serialized entry for the domain list, and the domain list version it last changed at
+    void setDomainListEntry(const QByteArray& domainListEntry, quint32 version)
+        { _domainListEntry = domainListEntry; _domainListVersion = version; }
+    const QByteArray& getDomainListEntry() const { return _domainListEntry; }
+    quint32 getDomainListVersion() const { return _domainListVersion; }
+    
+    QElapsedTimer& getFullDomainListTimer() { return _fullDomainListTimer; }
 private:
     QJsonObject mergeJSONStatsFromNewObject(const QJsonObject& newObject, QJsonObject destinationObject);
     
@@ -58,6 +66,9 @@ private:
     QJsonObject _statsJSONObject;
     HifiSockAddr _sendingSockAddr;
     bool _isAuthenticated;
+    QByteArray _domainListEntry;
+    quint32 _domainListVersion;
+    QElapsedTimer _fullDomainListTimer;
 };
 
 #endif // hifi_DomainServerNodeData_h
@@ -0,0 +1,278 @@
+//
+//  AudioMixKernels.cpp
+//  libraries/audio/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "AudioMixKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HIFI_AUDIO_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is picked at runtime, so its kernels are compiled for it on their own instead of for the whole library
+#if defined(HIFI_AUDIO_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HIFI_AUDIO_AVX2
+#define HIFI_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+namespace AudioMixKernels {
+
+static inline int16_t saturate(int value) {
+    return (int16_t)(value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : value));
+}
+
+static inline int16_t applyGain(int16_t sample, float gain) {
+    // conversion back to int16 truncates and saturates, like cvttps2dq followed by packssdw
+    float scaled = (float)sample * gain;
+    return (scaled <= (float)INT16_MIN) ? INT16_MIN : ((scaled >= (float)INT16_MAX) ? INT16_MAX : (int16_t)scaled);
+}
+
+// the scalar kernels take a start index so the vector kernels can finish their tails with them
+
+static void addMonoToStereoScalar(int16_t* stereoOutput, const int16_t* leftInput, const int16_t* rightInput,
+                                  int start, int numFrames, float leftGain, float rightGain) {
+    for (int i = start; i < numFrames; i++) {
+        stereoOutput[2 * i] = saturate(stereoOutput[2 * i] + applyGain(leftInput[i], leftGain));
+        stereoOutput[2 * i + 1] = saturate(stereoOutput[2 * i + 1] + applyGain(rightInput[i], rightGain));
+    }
+}
+
+static void addWithGainScalar(int16_t* output, const int16_t* input, int start, int numSamples, float gain) {
+    for (int i = start; i < numSamples; i++) {
+        output[i] = saturate(output[i] + applyGain(input[i], gain));
+    }
+}
+
+static void addSaturatedScalar(int16_t* output, const int16_t* input, int start, int numSamples) {
+    for (int i = start; i < numSamples; i++) {
+        output[i] = saturate(output[i] + input[i]);
+    }
+}
+
+#ifdef HIFI_AUDIO_SSE2
+
+// scales 8 samples by gain, returning 8 saturated int16 samples
+static inline __m128i applyGainSSE2(__m128i samples, __m128 gain) {
+    // sign extend each half to 32 bits by unpacking into the high word and shifting back down
+    __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+    __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+    low = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), gain));
+    high = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), gain));
+
+    return _mm_packs_epi32(low, high);
+}
+
+static void addMonoToStereoSSE2(int16_t* stereoOutput, const int16_t* leftInput, const int16_t* rightInput,
+                                int numFrames, float leftGain, float rightGain) {
+    const int FRAMES_PER_STEP = 8;
+    __m128 left = _mm_set1_ps(leftGain);
+    __m128 right = _mm_set1_ps(rightGain);
+
+    int i = 0;
+    for (; i + FRAMES_PER_STEP <= numFrames; i += FRAMES_PER_STEP) {
+        __m128i leftSamples = applyGainSSE2(_mm_loadu_si128((const __m128i*)(leftInput + i)), left);
+        __m128i rightSamples = applyGainSSE2(_mm_loadu_si128((const __m128i*)(rightInput + i)), right);
+
+        __m128i* destination = (__m128i*)(stereoOutput + 2 * i);
+        _mm_storeu_si128(destination, _mm_adds_epi16(_mm_loadu_si128(destination),
+                                                     _mm_unpacklo_epi16(leftSamples, rightSamples)));
+        _mm_storeu_si128(destination + 1, _mm_adds_epi16(_mm_loadu_si128(destination + 1),
+                                                         _mm_unpackhi_epi16(leftSamples, rightSamples)));
+    }
+
+    addMonoToStereoScalar(stereoOutput, leftInput, rightInput, i, numFrames, leftGain, rightGain);
+}
+
+static void addWithGainSSE2(int16_t* output, const int16_t* input, int numSamples, float gain) {
+    const int SAMPLES_PER_STEP = 8;
+    __m128 gains = _mm_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        __m128i samples = applyGainSSE2(_mm_loadu_si128((const __m128i*)(input + i)), gains);
+        __m128i* destination = (__m128i*)(output + i);
+        _mm_storeu_si128(destination, _mm_adds_epi16(_mm_loadu_si128(destination), samples));
+    }
+
+    addWithGainScalar(output, input, i, numSamples, gain);
+}
+
+static void addSaturatedSSE2(int16_t* output, const int16_t* input, int numSamples) {
+    const int SAMPLES_PER_STEP = 8;
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        __m128i* destination = (__m128i*)(output + i);
+        _mm_storeu_si128(destination, _mm_adds_epi16(_mm_loadu_si128(destination),
+                                                     _mm_loadu_si128((const __m128i*)(input + i))));
+    }
+
+    addSaturatedScalar(output, input, i, numSamples);
+}
+
+#endif // HIFI_AUDIO_SSE2
+
+#ifdef HIFI_AUDIO_AVX2
+
+// scales 8 samples by gain with one 256-bit multiply, returning 8 saturated int16 samples
+HIFI_AVX2_TARGET static inline __m128i applyGainAVX2(__m128i samples, __m256 gain) {
+    __m256i scaled = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(samples)), gain));
+    return _mm_packs_epi32(_mm256_castsi256_si128(scaled), _mm256_extracti128_si256(scaled, 1));
+}
+
+HIFI_AVX2_TARGET static inline __m256i combineAVX2(__m128i low, __m128i high) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+HIFI_AVX2_TARGET static void addMonoToStereoAVX2(int16_t* stereoOutput, const int16_t* leftInput,
+                                                 const int16_t* rightInput, int numFrames,
+                                                 float leftGain, float rightGain) {
+    const int FRAMES_PER_STEP = 8;
+    __m256 left = _mm256_set1_ps(leftGain);
+    __m256 right = _mm256_set1_ps(rightGain);
+
+    int i = 0;
+    for (; i + FRAMES_PER_STEP <= numFrames; i += FRAMES_PER_STEP) {
+        __m128i leftSamples = applyGainAVX2(_mm_loadu_si128((const __m128i*)(leftInput + i)), left);
+        __m128i rightSamples = applyGainAVX2(_mm_loadu_si128((const __m128i*)(rightInput + i)), right);
+
+        __m256i interleaved = combineAVX2(_mm_unpacklo_epi16(leftSamples, rightSamples),
+                                          _mm_unpackhi_epi16(leftSamples, rightSamples));
+
+        __m256i* destination = (__m256i*)(stereoOutput + 2 * i);
+        _mm256_storeu_si256(destination, _mm256_adds_epi16(_mm256_loadu_si256(destination), interleaved));
+    }
+
+    // leave the upper halves clean before the SSE scalar tail and whatever runs after us
+    _mm256_zeroupper();
+    addMonoToStereoScalar(stereoOutput, leftInput, rightInput, i, numFrames, leftGain, rightGain);
+}
+
+HIFI_AVX2_TARGET static void addWithGainAVX2(int16_t* output, const int16_t* input, int numSamples, float gain) {
+    const int SAMPLES_PER_STEP = 16;
+    __m256 gains = _mm256_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        __m256i samples = combineAVX2(applyGainAVX2(_mm_loadu_si128((const __m128i*)(input + i)), gains),
+                                      applyGainAVX2(_mm_loadu_si128((const __m128i*)(input + i + 8)), gains));
+        __m256i* destination = (__m256i*)(output + i);
+        _mm256_storeu_si256(destination, _mm256_adds_epi16(_mm256_loadu_si256(destination), samples));
+    }
+
+    // leave the upper halves clean before the SSE scalar tail and whatever runs after us
+    _mm256_zeroupper();
+    addWithGainScalar(output, input, i, numSamples, gain);
+}
+
+HIFI_AVX2_TARGET static void addSaturatedAVX2(int16_t* output, const int16_t* input, int numSamples) {
+    const int SAMPLES_PER_STEP = 16;
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        __m256i* destination = (__m256i*)(output + i);
+        _mm256_storeu_si256(destination, _mm256_adds_epi16(_mm256_loadu_si256(destination),
+                                                           _mm256_loadu_si256((const __m256i*)(input + i))));
+    }
+
+    // leave the upper halves clean before the SSE scalar tail and whatever runs after us
+    _mm256_zeroupper();
+    addSaturatedScalar(output, input, i, numSamples);
+}
+
+#endif // HIFI_AUDIO_AVX2
+
+InstructionSet getBestInstructionSet() {
+#if defined(HIFI_AUDIO_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+#endif
+#if defined(HIFI_AUDIO_SSE2)
+    return SSE2;
+#else
+    return Scalar;
+#endif
+}
+
+static InstructionSet bestInstructionSet = getBestInstructionSet();
+static InstructionSet currentInstructionSet = bestInstructionSet;
+
+InstructionSet getInstructionSet() {
+    return currentInstructionSet;
+}
+
+void setInstructionSet(InstructionSet instructionSet) {
+    currentInstructionSet = (instructionSet > bestInstructionSet) ? bestInstructionSet : instructionSet;
+}
+
+const char* getInstructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case AVX2:
+            return "AVX2";
+        case SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
+
+void addMonoToStereo(int16_t* stereoOutput, const int16_t* leftInput, const int16_t* rightInput,
+                     int numFrames, float leftGain, float rightGain) {
+#ifdef HIFI_AUDIO_AVX2
+    if (currentInstructionSet == AVX2) {
+        addMonoToStereoAVX2(stereoOutput, leftInput, rightInput, numFrames, leftGain, rightGain);
+        return;
+    }
+#endif
+#ifdef HIFI_AUDIO_SSE2
+    if (currentInstructionSet == SSE2) {
+        addMonoToStereoSSE2(stereoOutput, leftInput, rightInput, numFrames, leftGain, rightGain);
+        return;
+    }
+#endif
+    addMonoToStereoScalar(stereoOutput, leftInput, rightInput, 0, numFrames, leftGain, rightGain);
+}
+
+void addWithGain(int16_t* output, const int16_t* input, int numSamples, float gain) {
+#ifdef HIFI_AUDIO_AVX2
+    if (currentInstructionSet == AVX2) {
+        addWithGainAVX2(output, input, numSamples, gain);
+        return;
+    }
+#endif
+#ifdef HIFI_AUDIO_SSE2
+    if (currentInstructionSet == SSE2) {
+        addWithGainSSE2(output, input, numSamples, gain);
+        return;
+    }
+#endif
+    addWithGainScalar(output, input, 0, numSamples, gain);
+}
+
+void addSaturated(int16_t* output, const int16_t* input, int numSamples) {
+#ifdef HIFI_AUDIO_AVX2
+    if (currentInstructionSet == AVX2) {
+        addSaturatedAVX2(output, input, numSamples);
+        return;
+    }
+#endif
+#ifdef HIFI_AUDIO_SSE2
+    if (currentInstructionSet == SSE2) {
+        addSaturatedSSE2(output, input, numSamples);
+        return;
+    }
+#endif
+    addSaturatedScalar(output, input, 0, numSamples);
+}
+
+}
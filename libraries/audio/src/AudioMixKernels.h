@@ -0,0 +1,48 @@
+//
+//  AudioMixKernels.h
+//  libraries/audio/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixKernels_h
+#define hifi_AudioMixKernels_h
+
+#include <stdint.h>
+
+// Sample loops used by the audio mixer. Every kernel converts samples to float, applies a gain, truncates back to
+// int16 with saturation and then saturating-adds into the destination, so all instruction sets give identical output.
+namespace AudioMixKernels {
+
+    enum InstructionSet {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    /// the best instruction set this CPU supports, used unless overridden with setInstructionSet
+    InstructionSet getBestInstructionSet();
+
+    InstructionSet getInstructionSet();
+
+    /// forces the kernels to a given instruction set (clamped to what the CPU supports), for tests and benchmarks
+    void setInstructionSet(InstructionSet instructionSet);
+
+    const char* getInstructionSetName(InstructionSet instructionSet);
+
+    /// adds numFrames of two mono inputs into interleaved stereo output, left and right each with their own gain.
+    /// Phase delay is done by the caller pointing the delayed channel's input numDelayFrames earlier in the source.
+    void addMonoToStereo(int16_t* stereoOutput, const int16_t* leftInput, const int16_t* rightInput,
+                         int numFrames, float leftGain, float rightGain);
+
+    /// adds numSamples of input scaled by gain into output
+    void addWithGain(int16_t* output, const int16_t* input, int numSamples, float gain);
+
+    /// saturating add of numSamples of input into output
+    void addSaturated(int16_t* output, const int16_t* input, int numSamples);
+};
+
+#endif // hifi_AudioMixKernels_h
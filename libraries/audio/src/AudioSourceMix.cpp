@@ -0,0 +1,39 @@
+//
+//  AudioSourceMix.cpp
+//  libraries/audio/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "AudioConstants.h"
+#include "AudioMixKernels.h"
+#include "AudioSourceMix.h"
+
+void AudioSourceMix::addMonoSource(int16_t* preMixSamples, const int16_t* input, int numDelayFrames,
+                                   bool rightSideWeak, float gain, float weakChannelGain) {
+    const int16_t* delayedChannelInput = input;
+    const int16_t* normalChannelInput = input + numDelayFrames;
+    if (rightSideWeak) {
+        AudioMixKernels::addMonoToStereo(preMixSamples, normalChannelInput, delayedChannelInput,
+                                         AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL, gain, weakChannelGain);
+    } else {
+        AudioMixKernels::addMonoToStereo(preMixSamples, delayedChannelInput, normalChannelInput,
+                                         AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL, weakChannelGain, gain);
+    }
+}
+
+void AudioSourceMix::filterAndMix(int16_t* mixSamples, int16_t* preMixSamples, AudioFilterHSF1s* penumbraFilter,
+                                  float penumbraFilterGainLeft, float penumbraFilterGainRight) {
+    if (penumbraFilter) {
+        penumbraFilter->setParameters(0, 0, AudioConstants::SAMPLE_RATE, PENUMBRA_FILTER_CUTOFF_FREQUENCY_HZ,
+                                      penumbraFilterGainLeft, PENUMBRA_FILTER_SLOPE);
+        penumbraFilter->setParameters(0, 1, AudioConstants::SAMPLE_RATE, PENUMBRA_FILTER_CUTOFF_FREQUENCY_HZ,
+                                      penumbraFilterGainRight, PENUMBRA_FILTER_SLOPE);
+        penumbraFilter->render(preMixSamples, preMixSamples, AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL);
+    }
+
+    AudioMixKernels::addSaturated(mixSamples, preMixSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO);
+}
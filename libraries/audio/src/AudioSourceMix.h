@@ -0,0 +1,43 @@
+//
+//  AudioSourceMix.h
+//  libraries/audio/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioSourceMix_h
+#define hifi_AudioSourceMix_h
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <SharedUtil.h>
+
+#include "AudioFormat.h" // For AudioFilterHSF1s
+#include "AudioBuffer.h" // For AudioFilterHSF1s
+#include "AudioFilter.h" // For AudioFilterHSF1s
+#include "AudioFilterBank.h"
+
+// The steps the audio mixer takes to mix one source's network frame into a listener's, shared with the benchmarks so
+// they time the mixer's own loop.
+namespace AudioSourceMix {
+
+    const float PENUMBRA_FILTER_CUTOFF_FREQUENCY_HZ = 1000.0f;
+    const float PENUMBRA_FILTER_SLOPE = 0.708f; // -3dB
+
+    /// adds a mono source's frame into the stereo pre-mix. The weak side gets weakChannelGain and is delayed by
+    /// numDelayFrames, input holds that many samples from before the frame followed by the frame itself.
+    void addMonoSource(int16_t* preMixSamples, const int16_t* input, int numDelayFrames, bool rightSideWeak,
+                       float gain, float weakChannelGain);
+
+    /// runs the penumbra filter over the pre-mix with these gains for the left and right ear, unless it is null, then
+    /// saturating-adds the pre-mix into the listener's mix
+    void filterAndMix(int16_t* mixSamples, int16_t* preMixSamples, AudioFilterHSF1s* penumbraFilter,
+                      float penumbraFilterGainLeft, float penumbraFilterGainRight);
+};
+
+#endif // hifi_AudioSourceMix_h
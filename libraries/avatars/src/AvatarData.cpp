@@ -42,6 +42,9 @@ AvatarData::AvatarData() :
     _bodyRoll(0.0f),
     _targetScale(1.0f),
     _handState(0),
+    _keyframeSequence(0),
+    _hasKeyframe(false),
+    _hasKeyframeToAcknowledge(false),
     _keyState(NO_KEY_DOWN),
     _isChatCirclingEnabled(false),
     _forceFaceshiftConnected(false),
@@ -128,6 +131,19 @@ void AvatarData::setHandPosition(const glm::vec3& handPosition) {
 }
 
 QByteArray AvatarData::toByteArray() {
+    QByteArray avatarDataByteArray;
+    avatarDataByteArray.resize(MAX_PACKET_SIZE);
+    
+    unsigned char* destinationBuffer = reinterpret_cast<unsigned char*>(avatarDataByteArray.data());
+    unsigned char* startPosition = destinationBuffer;
+    
+    destinationBuffer += packBodyAndHead(destinationBuffer);
+    destinationBuffer += packFullJoints(destinationBuffer, _jointData);
+    
+    return avatarDataByteArray.left(destinationBuffer - startPosition);
+}
+
+int AvatarData::packBodyAndHead(unsigned char* destinationBuffer) {
     // TODO: DRY this up to a shared method
     // that can pack any type given the number of bytes
     // and return the number of bytes to push the pointer
@@ -140,10 +156,6 @@ QByteArray AvatarData::toByteArray() {
         _headData->_isFaceshiftConnected = true;
     }
     
-    QByteArray avatarDataByteArray;
-    avatarDataByteArray.resize(MAX_PACKET_SIZE);
-    
-    unsigned char* destinationBuffer = reinterpret_cast<unsigned char*>(avatarDataByteArray.data());
     unsigned char* startPosition = destinationBuffer;
     
     memcpy(destinationBuffer, &_position, sizeof(_position));
@@ -229,12 +241,30 @@ QByteArray AvatarData::toByteArray() {
     
     // pupil dilation
     destinationBuffer += packFloatToByte(destinationBuffer, _headData->_pupilDilation, 1.0f);
+    
+    return destinationBuffer - startPosition;
+}
 
-    // joint data
-    *destinationBuffer++ = _jointData.size();
+// joints that moved less than this from their keyframe rotation are left out of a delta
+const float MIN_JOINT_ROTATION_CHANGE = glm::radians(0.5f);
+
+static bool hasJointRotationChanged(const glm::quat& rotation, const glm::quat& keyframeRotation) {
+    // the dot product of two unit quaternions is the cosine of half the angle between them
+    static const float MAX_UNCHANGED_DOT = cosf(MIN_JOINT_ROTATION_CHANGE / 2.0f);
+    return fabsf(glm::dot(glm::normalize(rotation), glm::normalize(keyframeRotation))) < MAX_UNCHANGED_DOT;
+}
+
+static bool isJointBitSet(const unsigned char* bits, int jointIndex) {
+    return bits[jointIndex / BITS_IN_BYTE] & (1 << (jointIndex % BITS_IN_BYTE));
+}
+
+static int packJointRotations(unsigned char* destinationBuffer, const QVector<JointData>& jointData) {
+    unsigned char* startPosition = destinationBuffer;
+    
+    *destinationBuffer++ = jointData.size();
     unsigned char validity = 0;
     int validityBit = 0;
-    foreach (const JointData& data, _jointData) {
+    foreach (const JointData& data, jointData) {
         if (data.valid) {
             validity |= (1 << validityBit);
         }
@@ -246,13 +276,79 @@ QByteArray AvatarData::toByteArray() {
     if (validityBit != 0) {
         *destinationBuffer++ = validity;
     }
-    foreach (const JointData& data, _jointData) {
+    foreach (const JointData& data, jointData) {
         if (data.valid) {
             destinationBuffer += packOrientationQuatToBytes(destinationBuffer, data.rotation);
         }
     }
-        
-    return avatarDataByteArray.left(destinationBuffer - startPosition);
+    
+    return destinationBuffer - startPosition;
+}
+
+int AvatarData::packFullJoints(unsigned char* destinationBuffer, const QVector<JointData>& jointData) {
+    *destinationBuffer = FullJoints;
+    return 1 + packJointRotations(destinationBuffer + 1, jointData);
+}
+
+int AvatarData::packKeyframeJoints(unsigned char* destinationBuffer, const QVector<JointData>& jointData,
+                                   quint16 keyframeSequence) {
+    unsigned char* startPosition = destinationBuffer;
+    
+    *destinationBuffer++ = KeyframeJoints;
+    memcpy(destinationBuffer, &keyframeSequence, sizeof(keyframeSequence));
+    destinationBuffer += sizeof(keyframeSequence);
+    destinationBuffer += packJointRotations(destinationBuffer, jointData);
+    
+    return destinationBuffer - startPosition;
+}
+
+int AvatarData::packDeltaJoints(unsigned char* destinationBuffer, const QVector<JointData>& jointData,
+                                const QVector<JointData>& keyframeJointData, quint16 keyframeSequence) {
+    unsigned char* startPosition = destinationBuffer;
+    
+    *destinationBuffer++ = DeltaJoints;
+    memcpy(destinationBuffer, &keyframeSequence, sizeof(keyframeSequence));
+    destinationBuffer += sizeof(keyframeSequence);
+    
+    int numJoints = jointData.size();
+    *destinationBuffer++ = numJoints;
+    
+    // the validity bits are followed by a bit per joint that is set if its rotation follows
+    int bytesOfBits = (numJoints + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+    unsigned char* validityBits = destinationBuffer;
+    unsigned char* changedBits = destinationBuffer + bytesOfBits;
+    memset(destinationBuffer, 0, 2 * bytesOfBits);
+    destinationBuffer += 2 * bytesOfBits;
+    
+    for (int i = 0; i < numJoints; i++) {
+        const JointData& data = jointData[i];
+        if (data.valid) {
+            validityBits[i / BITS_IN_BYTE] |= (1 << (i % BITS_IN_BYTE));
+            
+            if (i >= keyframeJointData.size() || !keyframeJointData[i].valid
+                || hasJointRotationChanged(data.rotation, keyframeJointData[i].rotation)) {
+                changedBits[i / BITS_IN_BYTE] |= (1 << (i % BITS_IN_BYTE));
+                destinationBuffer += packOrientationQuatToBytes(destinationBuffer, data.rotation);
+            }
+        }
+    }
+    
+    return destinationBuffer - startPosition;
+}
+
+int AvatarData::maxJointSectionBytes(int numJoints) {
+    const int COMPONENTS_PER_QUATERNION = 4;
+    int bytesOfBits = (numJoints + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+    return 1 + sizeof(quint16) + 1 + 2 * bytesOfBits + numJoints * COMPONENTS_PER_QUATERNION * sizeof(uint16_t);
+}
+
+bool AvatarData::takeKeyframeToAcknowledge(quint16& keyframeSequence) {
+    if (!_hasKeyframeToAcknowledge) {
+        return false;
+    }
+    keyframeSequence = _keyframeSequence;
+    _hasKeyframeToAcknowledge = false;
+    return true;
 }
 
 bool AvatarData::shouldLogError(const quint64& now) {
@@ -297,9 +393,10 @@ int AvatarData::parseDataAtOffset(const QByteArray& packet, int offset) {
     //     audioLoudness =  4
     // }
     // + 1 byte for pupilSize
+    // + 1 byte for jointStreamMode
     // + 1 byte for numJoints (0)
-    // = 45 bytes
-    int minPossibleSize = 45;
+    // = 46 bytes
+    int minPossibleSize = 46;
     
     int maxAvailableSize = packet.size() - offset;
     if (minPossibleSize > maxAvailableSize) {
@@ -499,10 +596,37 @@ int AvatarData::parseDataAtOffset(const QByteArray& packet, int offset) {
         sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_pupilDilation, 1.0f);
     } // 1 byte
     
+    // joint stream mode, keyframes and deltas also carry the sequence of the keyframe
+    JointStreamMode jointStreamMode = (JointStreamMode)*sourceBuffer++;
+    quint16 keyframeSequence = 0;
+    if (jointStreamMode == KeyframeJoints || jointStreamMode == DeltaJoints) {
+        minPossibleSize += sizeof(keyframeSequence);
+        if (minPossibleSize > maxAvailableSize) {
+            if (shouldLogError(now)) {
+                qDebug() << "Malformed AvatarData packet after JointStreamMode;"
+                    << " displayName = '" << _displayName << "'"
+                    << " minPossibleSize = " << minPossibleSize 
+                    << " maxAvailableSize = " << maxAvailableSize;
+            }
+            return maxAvailableSize;
+        }
+        memcpy(&keyframeSequence, sourceBuffer, sizeof(keyframeSequence));
+        sourceBuffer += sizeof(keyframeSequence);
+    } else if (jointStreamMode != FullJoints) {
+        if (shouldLogError(now)) {
+            qDebug() << "Discard AvatarData with unknown jointStreamMode" << jointStreamMode
+                << "; displayName = '" << _displayName << "'";
+        }
+        return maxAvailableSize;
+    }
+    
     // joint data
     int numJoints = *sourceBuffer++;
     int bytesOfValidity = (int)ceil((float)numJoints / (float)BITS_IN_BYTE);
-    minPossibleSize += bytesOfValidity;
+    
+    // a delta has a second set of bits for the joints whose rotation follows
+    int bytesOfChanged = (jointStreamMode == DeltaJoints) ? bytesOfValidity : 0;
+    minPossibleSize += bytesOfValidity + bytesOfChanged;
     if (minPossibleSize > maxAvailableSize) {
         if (shouldLogError(now)) {
             qDebug() << "Malformed AvatarData packet after JointValidityBits;"
@@ -512,28 +636,23 @@ int AvatarData::parseDataAtOffset(const QByteArray& packet, int offset) {
         }
         return maxAvailableSize;
     }
-    int numValidJoints = 0;
-    _jointData.resize(numJoints);
-    { // validity bits
-        unsigned char validity = 0;
-        int validityBit = 0;
-        for (int i = 0; i < numJoints; i++) {
-            if (validityBit == 0) {
-                validity = *sourceBuffer++;
-            }
-            bool valid = (bool)(validity & (1 << validityBit));
-            if (valid) {
-                ++numValidJoints;
-            }
-            _jointData[i].valid = valid;
-            validityBit = (validityBit + 1) % BITS_IN_BYTE; 
+    const unsigned char* validityBits = sourceBuffer;
+    sourceBuffer += bytesOfValidity;
+    const unsigned char* changedBits = sourceBuffer;
+    sourceBuffer += bytesOfChanged;
+    
+    int numRotations = 0;
+    for (int i = 0; i < numJoints; i++) {
+        if (isJointBitSet(validityBits, i) && (jointStreamMode != DeltaJoints || isJointBitSet(changedBits, i))) {
+            ++numRotations;
         }
     }
-    // 1 + bytesOfValidity bytes
+    // 1 + bytesOfValidity + bytesOfChanged bytes
 
     // each joint rotation component is stored in two bytes (sizeof(uint16_t))
     int COMPONENTS_PER_QUATERNION = 4;
-    minPossibleSize += numValidJoints * COMPONENTS_PER_QUATERNION * sizeof(uint16_t);
+    int bytesOfRotations = numRotations * COMPONENTS_PER_QUATERNION * sizeof(uint16_t);
+    minPossibleSize += bytesOfRotations;
     if (minPossibleSize > maxAvailableSize) {
         if (shouldLogError(now)) {
             qDebug() << "Malformed AvatarData packet after JointData;"
@@ -543,16 +662,35 @@ int AvatarData::parseDataAtOffset(const QByteArray& packet, int offset) {
         }
         return maxAvailableSize;
     }
+    
+    if (jointStreamMode == DeltaJoints && !(_hasKeyframe && keyframeSequence == _keyframeSequence)) {
+        // this delta was made against a keyframe we don't have, keep our joints until the next keyframe
+        sourceBuffer += bytesOfRotations;
+        return sourceBuffer - startPosition;
+    }
 
     { // joint data
+        _jointData.resize(numJoints);
         for (int i = 0; i < numJoints; i++) {
             JointData& data = _jointData[i];
+            data.valid = isJointBitSet(validityBits, i);
             if (data.valid) {
                 _hasNewJointRotations = true;
-                sourceBuffer += unpackOrientationQuatFromBytes(sourceBuffer, data.rotation);
+                if (jointStreamMode != DeltaJoints || isJointBitSet(changedBits, i)) {
+                    sourceBuffer += unpackOrientationQuatFromBytes(sourceBuffer, data.rotation);
+                } else if (i < _keyframeJointData.size()) {
+                    data.rotation = _keyframeJointData[i].rotation;
+                }
             }
         }
-    } // numJoints * 8 bytes
+    } // numRotations * 8 bytes
+    
+    if (jointStreamMode == KeyframeJoints) {
+        _keyframeJointData = _jointData;
+        _keyframeSequence = keyframeSequence;
+        _hasKeyframe = true;
+        _hasKeyframeToAcknowledge = true;
+    }
     
     return sourceBuffer - startPosition;
 }
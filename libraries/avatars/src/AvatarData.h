@@ -164,6 +164,31 @@ public:
     void setHandPosition(const glm::vec3& handPosition);
 
     virtual QByteArray toByteArray();
+    
+    /// how the joint rotations that end every avatar data payload are encoded
+    enum JointStreamMode {
+        FullJoints,     ///< every valid joint rotation
+        KeyframeJoints, ///< every valid joint rotation, kept by the receiver as the base for later deltas
+        DeltaJoints     ///< only the rotations that moved away from a keyframe the receiver acknowledged
+    };
+    
+    /// packs everything in the avatar data that comes before the joints
+    /// \return number of bytes packed
+    int packBodyAndHead(unsigned char* destinationBuffer);
+    
+    /// the pack*Joints functions write the joint section in one of the JointStreamModes
+    /// \return number of bytes packed
+    static int packFullJoints(unsigned char* destinationBuffer, const QVector<JointData>& jointData);
+    static int packKeyframeJoints(unsigned char* destinationBuffer, const QVector<JointData>& jointData,
+                                  quint16 keyframeSequence);
+    static int packDeltaJoints(unsigned char* destinationBuffer, const QVector<JointData>& jointData,
+                               const QVector<JointData>& keyframeJointData, quint16 keyframeSequence);
+    
+    /// \return the most bytes any of the pack*Joints functions write for numJoints joints
+    static int maxJointSectionBytes(int numJoints);
+    
+    /// \return true once for each keyframe parsed, with the sequence the sender expects to be acknowledged
+    bool takeKeyframeToAcknowledge(quint16& keyframeSequence);
 
     /// \return true if an error should be logged
     bool shouldLogError(const quint64& now);
@@ -346,6 +371,12 @@ protected:
     char _handState;
 
     QVector<JointData> _jointData; ///< the state of the skeleton joints
+    
+    // the last keyframe parsed, which deltas from the avatar mixer are applied on top of
+    QVector<JointData> _keyframeJointData;
+    quint16 _keyframeSequence;
+    bool _hasKeyframe;
+    bool _hasKeyframeToAcknowledge;
 
     // key state
     KeyState _keyState;
@@ -101,6 +101,9 @@ AvatarSharedPointer AvatarHashMap::matchingOrNewAvatar(const QUuid& sessionUUID,
 void AvatarHashMap::processAvatarDataPacket(const QByteArray &datagram, const QWeakPointer<Node> &mixerWeakPointer) {
     int bytesRead = numBytesForPacketHeader(datagram);
     
+    // the joint keyframes in this packet, acknowledged so the mixer can send deltas against them
+    QByteArray keyframeAckPacket;
+    
     // enumerate over all of the avatars in this packet
     // only add them if mixerWeakPointer points to something (meaning that mixer is still around)
     while (bytesRead < datagram.size() && mixerWeakPointer.data()) {
@@ -112,12 +115,26 @@ void AvatarHashMap::processAvatarDataPacket(const QByteArray &datagram, const QW
             
             // have the matching (or new) avatar parse the data from the packet
             bytesRead += matchingAvatarData->parseDataAtOffset(datagram, bytesRead);
+            
+            quint16 keyframeSequence;
+            if (matchingAvatarData->takeKeyframeToAcknowledge(keyframeSequence)) {
+                if (keyframeAckPacket.isEmpty()) {
+                    keyframeAckPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarKeyframeAck);
+                }
+                keyframeAckPacket.append(sessionUUID.toRfc4122());
+                keyframeAckPacket.append(reinterpret_cast<const char*>(&keyframeSequence), sizeof(keyframeSequence));
+            }
         } else {
             // create a dummy AvatarData class to throw this data on the ground
             AvatarData dummyData;
             bytesRead += dummyData.parseDataAtOffset(datagram, bytesRead);
         }
     }
+    
+    SharedNodePointer avatarMixer = mixerWeakPointer.toStrongRef();
+    if (!keyframeAckPacket.isEmpty() && avatarMixer) {
+        DependencyManager::get<NodeList>()->writeDatagram(keyframeAckPacket, avatarMixer);
+    }
 }
 
 void AvatarHashMap::processAvatarIdentityPacket(const QByteArray &packet, const QWeakPointer<Node>& mixerWeakPointer) {
@@ -10,6 +10,7 @@
 //
 
 #include <QtCore/QObject>
+#include <QtCore/QtEndian>
 
 #include <ByteCountCoding.h>
 #include <GLMHelpers.h>
@@ -17,6 +18,7 @@
 #include <PhysicsHelpers.h>
 #include <RegisteredMetaTypes.h>
 #include <SharedUtil.h> // usecTimestampNow()
+#include <UUID.h>
 
 #include "EntityScriptingInterface.h"
 #include "EntityItem.h"
@@ -136,23 +138,51 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
     
     OctreeElement::AppendState appendState = OctreeElement::COMPLETED; // assume the best
 
-    // encode our ID as a byte count coded byte stream
-    QByteArray encodedID = getID().toRfc4122();
+    // a pass that isn't finishing a partially encoded entity writes the whole entity, the same bytes as last time
+    // if nothing about it changed since
+    bool isContinuation = entityTreeElementExtraEncodeData
+                              && entityTreeElementExtraEncodeData->entities.contains(getEntityItemID());
+    if (!isContinuation) {
+        std::shared_ptr<const EncodedEntityData> encodedEntityData = std::atomic_load(&_encodedEntityData);
+        if (encodedEntityData && encodedEntityData->created == _created
+                && encodedEntityData->lastEdited == _lastEdited && encodedEntityData->lastUpdated == _lastUpdated
+                && encodedEntityData->lastSimulated == _lastSimulated
+                && encodedEntityData->changedOnServer == _changedOnServer) {
+            LevelDetails entityLevel = packetData->startLevel();
+            if (packetData->appendRawData((const unsigned char*)encodedEntityData->bytes.constData(),
+                                          encodedEntityData->bytes.size())
+                    && packetData->endLevel(entityLevel)) {
+                return appendState;
+            }
+            // it didn't fit whole, encode it the long way so as much of it as fits goes in this packet
+            packetData->discardLevel(entityLevel);
+        }
+    }
+
+    // encode our ID, in the big endian byte order of QUuid::toRfc4122()
+    unsigned char encodedID[NUM_BYTES_RFC4122_UUID];
+    QUuid id = getID();
+    qToBigEndian<quint32>(id.data1, encodedID);
+    qToBigEndian<quint16>(id.data2, encodedID + sizeof(quint32));
+    qToBigEndian<quint16>(id.data3, encodedID + sizeof(quint32) + sizeof(quint16));
+    memcpy(encodedID + sizeof(quint32) + 2 * sizeof(quint16), id.data4, sizeof(id.data4));
 
     // encode our type as a byte count coded byte stream
     ByteCountCoded<quint32> typeCoder = getType();
-    QByteArray encodedType = typeCoder;
+    unsigned char encodedType[ByteCountCoded<quint32>::MAX_ENCODED_BYTES];
+    int encodedTypeLength = typeCoder.encode(encodedType);
 
     // last updated (animations, non-physics changes)
     quint64 updateDelta = getLastUpdated() <= getLastEdited() ? 0 : getLastUpdated() - getLastEdited();
     ByteCountCoded<quint64> updateDeltaCoder = updateDelta;
-    QByteArray encodedUpdateDelta = updateDeltaCoder;
+    unsigned char encodedUpdateDelta[ByteCountCoded<quint64>::MAX_ENCODED_BYTES];
+    int encodedUpdateDeltaLength = updateDeltaCoder.encode(encodedUpdateDelta);
 
     // last simulated (velocity, angular velocity, physics changes)
     quint64 simulatedDelta = getLastSimulated() <= getLastEdited() ? 0 : getLastSimulated() - getLastEdited();
     ByteCountCoded<quint64> simulatedDeltaCoder = simulatedDelta;
-    QByteArray encodedSimulatedDelta = simulatedDeltaCoder;
-
+    unsigned char encodedSimulatedDelta[ByteCountCoded<quint64>::MAX_ENCODED_BYTES];
+    int encodedSimulatedDeltaLength = simulatedDeltaCoder.encode(encodedSimulatedDelta);
 
     EntityPropertyFlags propertyFlags(PROP_LAST_ITEM);
     EntityPropertyFlags requestedProperties = getEntityProperties(params);
@@ -184,12 +214,13 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
     bool successPropertyFlagsFits = false;
     int propertyFlagsOffset = 0;
     int oldPropertyFlagsLength = 0;
-    QByteArray encodedPropertyFlags;
+    unsigned char encodedPropertyFlags[PROP_LAST_ITEM / (BITS_PER_BYTE - 1) + 1];
     int propertyCount = 0;
 
-    successIDFits = packetData->appendValue(encodedID);
+    int startOfEntity = packetData->getUncompressedByteOffset();
+    successIDFits = packetData->appendRawData(encodedID, NUM_BYTES_RFC4122_UUID);
     if (successIDFits) {
-        successTypeFits = packetData->appendValue(encodedType);
+        successTypeFits = packetData->appendRawData(encodedType, encodedTypeLength);
     }
     if (successTypeFits) {
         successCreatedFits = packetData->appendValue(_created);
@@ -198,17 +229,16 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
         successLastEditedFits = packetData->appendValue(lastEdited);
     }
     if (successLastEditedFits) {
-        successLastUpdatedFits = packetData->appendValue(encodedUpdateDelta);
+        successLastUpdatedFits = packetData->appendRawData(encodedUpdateDelta, encodedUpdateDeltaLength);
     }
     if (successLastUpdatedFits) {
-        successLastSimulatedFits = packetData->appendValue(encodedSimulatedDelta);
+        successLastSimulatedFits = packetData->appendRawData(encodedSimulatedDelta, encodedSimulatedDeltaLength);
     }
     
     if (successLastSimulatedFits) {
         propertyFlagsOffset = packetData->getUncompressedByteOffset();
-        encodedPropertyFlags = propertyFlags;
-        oldPropertyFlagsLength = encodedPropertyFlags.length();
-        successPropertyFlagsFits = packetData->appendValue(encodedPropertyFlags);
+        oldPropertyFlagsLength = propertyFlags.encode(encodedPropertyFlags);
+        successPropertyFlagsFits = packetData->appendRawData(encodedPropertyFlags, oldPropertyFlagsLength);
     }
 
     bool headerFits = successIDFits && successTypeFits && successCreatedFits && successLastEditedFits 
@@ -253,10 +283,8 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
 
     if (propertyCount > 0) {
         int endOfEntityItemData = packetData->getUncompressedByteOffset();
-        encodedPropertyFlags = propertyFlags;
-        int newPropertyFlagsLength = encodedPropertyFlags.length();
-        packetData->updatePriorBytes(propertyFlagsOffset, 
-                (const unsigned char*)encodedPropertyFlags.constData(), encodedPropertyFlags.length());
+        int newPropertyFlagsLength = propertyFlags.encode(encodedPropertyFlags);
+        packetData->updatePriorBytes(propertyFlagsOffset, encodedPropertyFlags, newPropertyFlagsLength);
         
         // if the size of the PropertyFlags shrunk, we need to shift everything down to front of packet.
         if (newPropertyFlagsLength < oldPropertyFlagsLength) {
@@ -272,7 +300,20 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
             assert(newPropertyFlagsLength == oldPropertyFlagsLength); // should not have grown
         }
        
-        packetData->endLevel(entityLevel);
+        bool levelFits = packetData->endLevel(entityLevel);
+
+        // keep a whole entity's bytes for the next time it is sent unchanged
+        if (levelFits && !isContinuation && appendState == OctreeElement::COMPLETED) {
+            EncodedEntityData* encodedEntityData = new EncodedEntityData();
+            encodedEntityData->created = _created;
+            encodedEntityData->lastEdited = _lastEdited;
+            encodedEntityData->lastUpdated = _lastUpdated;
+            encodedEntityData->lastSimulated = _lastSimulated;
+            encodedEntityData->changedOnServer = _changedOnServer;
+            encodedEntityData->bytes = QByteArray((const char*)packetData->getUncompressedData(startOfEntity),
+                                                  packetData->getUncompressedByteOffset() - startOfEntity);
+            std::atomic_store(&_encodedEntityData, std::shared_ptr<const EncodedEntityData>(encodedEntityData));
+        }
     } else {
         packetData->discardLevel(entityLevel);
         appendState = OctreeElement::NONE; // if we got here, then we didn't include the item
@@ -702,8 +743,7 @@ void EntityItem::simulateKinematicMotion(float timeElapsed) {
         }
 
         float angularSpeed = glm::length(_angularVelocity);
-        
-        const float EPSILON_ANGULAR_VELOCITY_LENGTH = 0.1f; // 
+
         if (angularSpeed < EPSILON_ANGULAR_VELOCITY_LENGTH) {
             if (angularSpeed > 0.0f) {
                 _dirtyFlags |= EntityItem::DIRTY_MOTION_TYPE;
@@ -771,7 +811,6 @@ void EntityItem::simulateKinematicMotion(float timeElapsed) {
         }
 
         float speed = glm::length(velocity);
-        const float EPSILON_LINEAR_VELOCITY_LENGTH = 0.001f / (float)TREE_SCALE; // 1mm/sec
         if (speed < EPSILON_LINEAR_VELOCITY_LENGTH) {
             setVelocity(ENTITY_ITEM_ZERO_VEC3);
             if (speed > 0.0f) {
@@ -12,6 +12,7 @@
 #ifndef hifi_EntityItem_h
 #define hifi_EntityItem_h
 
+#include <memory>
 #include <stdint.h>
 
 #include <glm/glm.hpp>
@@ -33,6 +34,10 @@ class EntityTree;
 class EntityTreeElement;
 class EntityTreeElementExtraEncodeData;
 
+// the simulation brings an entity to a stop once it is spinning or moving slower than these
+const float EPSILON_ANGULAR_VELOCITY_LENGTH = 0.1f; // degrees/sec
+const float EPSILON_LINEAR_VELOCITY_LENGTH = 0.001f / (float)TREE_SCALE; // 1mm/sec
+
 #define DONT_ALLOW_INSTANTIATION virtual void pureVirtualFunctionPlaceHolder() = 0;
 #define ALLOW_INSTANTIATION virtual void pureVirtualFunctionPlaceHolder() { };
 
@@ -284,6 +289,9 @@ public:
 
     uint32_t getDirtyFlags() const { return _dirtyFlags; }
     void clearDirtyFlags(uint32_t mask = 0xffff) { _dirtyFlags &= ~mask; }
+
+    /// for a simulation that integrates the entity's motion itself, to flag what it changed the way simulate() would
+    void markDirtyFlags(uint32_t mask) { _dirtyFlags |= mask; }
     
     bool isMoving() const;
 
@@ -367,6 +375,20 @@ protected:
     uint32_t _dirtyFlags;   // things that have changed from EXTERNAL changes (via script or packet) but NOT from simulation
 
     EntityTreeElement* _element;    // back pointer to containing Element
+
+    /// the bytes appendEntityData() last wrote for the whole entity, and the times they were current as of. Every
+    /// edit, update and simulation bumps one of the times, so while they match the bytes can be copied as they are.
+    struct EncodedEntityData {
+        quint64 created;
+        quint64 lastEdited;
+        quint64 lastUpdated;
+        quint64 lastSimulated;
+        quint64 changedOnServer;
+        QByteArray bytes;
+    };
+
+    // swapped atomically rather than locked, the send threads of every client encode the same entities
+    mutable std::shared_ptr<const EncodedEntityData> _encodedEntityData;
 };
 
 
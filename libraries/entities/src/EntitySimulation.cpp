@@ -17,7 +17,6 @@
 void EntitySimulation::setEntityTree(EntityTree* tree) {
     if (_entityTree && _entityTree != tree) {
         _mortalEntities.clear();
-        _nextExpiry = quint64(-1);
         _updateableEntities.clear();
         _entitiesToBeSorted.clear();
     }
@@ -40,26 +39,18 @@ void EntitySimulation::updateEntities(QSet<EntityItem*>& entitiesToDelete) {
 
 // private
 void EntitySimulation::expireMortalEntities(const quint64& now) {
-    if (now > _nextExpiry) {
-        // only search for expired entities if we expect to find one
-        _nextExpiry = quint64(-1);
-        QSet<EntityItem*>::iterator itemItr = _mortalEntities.begin();
-        while (itemItr != _mortalEntities.end()) {
-            EntityItem* entity = *itemItr;
-            quint64 expiry = entity->getExpiry();
-            if (expiry < now) {
-                _entitiesToDelete.insert(entity);
-                itemItr = _mortalEntities.erase(itemItr);
-                _updateableEntities.remove(entity);
-                _entitiesToBeSorted.remove(entity);
-                removeEntityInternal(entity);
-            } else {
-                if (expiry < _nextExpiry) {
-                    // remeber the smallest _nextExpiry so we know when to start the next search
-                    _nextExpiry = expiry;
-                }
-                ++itemItr;
-            }
+    // only the entities that expired are visited, soonest first
+    while (!_mortalEntities.isEmpty() && _mortalEntities.topPriority() < now) {
+        EntityItem* entity = _mortalEntities.pop();
+        quint64 expiry = entity->getExpiry();
+        if (expiry < now) {
+            _entitiesToDelete.insert(entity);
+            _updateableEntities.remove(entity);
+            _entitiesToBeSorted.remove(entity);
+            removeEntityInternal(entity);
+        } else {
+            // its lifetime was extended without the change reaching us, wait for the new expiry
+            _mortalEntities.insertOrUpdate(entity, expiry);
         }
     }
 }
@@ -116,11 +107,7 @@ void EntitySimulation::sortEntitiesThatMoved() {
 void EntitySimulation::addEntity(EntityItem* entity) {
     assert(entity);
     if (entity->isMortal()) {
-        _mortalEntities.insert(entity);
-        quint64 expiry = entity->getExpiry();
-        if (expiry < _nextExpiry) {
-            _nextExpiry = expiry;
-        }
+        _mortalEntities.insertOrUpdate(entity, entity->getExpiry());
     }
     if (entity->needsToCallUpdate()) {
         _updateableEntities.insert(entity);
@@ -164,11 +151,7 @@ void EntitySimulation::entityChanged(EntityItem* entity) {
     if (!wasRemoved) {
         if (dirtyFlags & EntityItem::DIRTY_LIFETIME) {
             if (entity->isMortal()) {
-                _mortalEntities.insert(entity);
-                quint64 expiry = entity->getExpiry();
-                if (expiry < _nextExpiry) {
-                    _nextExpiry = expiry;
-                }
+                _mortalEntities.insertOrUpdate(entity, entity->getExpiry());
             } else {
                 _mortalEntities.remove(entity);
             }
@@ -185,7 +168,6 @@ void EntitySimulation::entityChanged(EntityItem* entity) {
 
 void EntitySimulation::clearEntities() {
     _mortalEntities.clear();
-    _nextExpiry = quint64(-1);
     _updateableEntities.clear();
     _entitiesToBeSorted.clear();
     clearEntitiesInternal();
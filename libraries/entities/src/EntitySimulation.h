@@ -15,6 +15,7 @@
 #include <QtCore/QObject>
 #include <QSet>
 
+#include <IndexedMinHeap.h>
 #include <PerfStat.h>
 
 #include "EntityItem.h"
@@ -95,8 +96,7 @@ protected:
 
     // We maintain multiple lists, each for its distinct purpose.
     // An entity may be in more than one list.
-    QSet<EntityItem*> _mortalEntities; // entities that have an expiry
-    quint64 _nextExpiry;
+    IndexedMinHeap<EntityItem*, quint64> _mortalEntities; // entities that have an expiry, soonest first
     QSet<EntityItem*> _updateableEntities; // entities that need update() called
     QSet<EntityItem*> _entitiesToBeSorted; // entities that were moved by THIS simulation and might need to be resorted in the tree
     QSet<EntityItem*> _entitiesToDelete;
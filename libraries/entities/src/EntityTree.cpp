@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <OctreeEditJournal.h>
 #include <PerfStat.h>
 
 #include "EntityTree.h"
@@ -139,20 +140,7 @@ bool EntityTree::updateEntityWithElement(EntityItem* entity, const EntityItemPro
         UpdateEntityOperator theOperator(this, containingElement, entity, properties);
         recurseTreeWithOperator(&theOperator);
         _isDirty = true;
-
-        uint32_t newFlags = entity->getDirtyFlags() & ~preFlags;
-        if (newFlags) {
-            if (_simulation) { 
-                if (newFlags & DIRTY_SIMULATION_FLAGS) {
-                    _simulation->lock();
-                    _simulation->entityChanged(entity);
-                    _simulation->unlock();
-                }
-            } else {
-                // normally the _simulation clears ALL updateFlags, but since there is none we do it explicitly
-                entity->clearDirtyFlags();
-            }
-        }
+        notifySimulationOfChange(entity, preFlags);
     }
     
     // TODO: this final containingElement check should eventually be removed (or wrapped in an #ifdef DEBUG).
@@ -166,6 +154,37 @@ bool EntityTree::updateEntityWithElement(EntityItem* entity, const EntityItemPro
     return true;
 }
 
+void EntityTree::notifySimulationOfChange(EntityItem* entity, uint32_t preFlags) {
+    uint32_t newFlags = entity->getDirtyFlags() & ~preFlags;
+    if (newFlags) {
+        if (_simulation) { 
+            if (newFlags & DIRTY_SIMULATION_FLAGS) {
+                _simulation->lock();
+                _simulation->entityChanged(entity);
+                _simulation->unlock();
+            }
+        } else {
+            // normally the _simulation clears ALL updateFlags, but since there is none we do it explicitly
+            entity->clearDirtyFlags();
+        }
+    }
+}
+
+void EntityTree::markPathChanged(EntityTreeElement* element) {
+    // the same elements UpdateEntityOperator marks on its way back up for an entity that stays put
+    glm::vec3 elementCenter = element->getAACube().calcCenter();
+    OctreeElement* pathElement = _rootElement;
+    while (pathElement && pathElement != element) {
+        pathElement->markWithChangedTime();
+        int childIndex = pathElement->getMyChildContainingPoint(elementCenter);
+        if (childIndex == OctreeElement::CHILD_UNKNOWN) {
+            return;
+        }
+        pathElement = pathElement->getChildAtIndex(childIndex);
+    }
+    element->markWithChangedTime();
+}
+
 EntityItem* EntityTree::addEntity(const EntityItemID& entityID, const EntityItemProperties& properties) {
     EntityItem* result = NULL;
 
@@ -575,31 +594,8 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
             bool validEditPacket = EntityItemProperties::decodeEntityEditPacket(editData, maxLength,
                                                     processedBytes, entityItemID, properties);
 
-            // If we got a valid edit packet, then it could be a new entity or it could be an update to
-            // an existing entity... handle appropriately
             if (validEditPacket) {
-            
-                // If this is a knownID, then it should exist in our tree
-                if (entityItemID.isKnownID) {
-                    // search for the entity by EntityItemID
-                    EntityItem* existingEntity = findEntityByEntityItemID(entityItemID);
-                    
-                    // if the EntityItem exists, then update it
-                    if (existingEntity) {
-                        updateEntity(entityItemID, properties);
-                        existingEntity->markAsChangedOnServer();
-                    } else {
-                        qDebug() << "User attempted to edit an unknown entity. ID:" << entityItemID;
-                    }
-                } else {
-                    // this is a new entity... assign a new entityID
-                    entityItemID = assignEntityID(entityItemID);
-                    EntityItem* newEntity = addEntity(entityItemID, properties);
-                    if (newEntity) {
-                        newEntity->markAsChangedOnServer();
-                        notifyNewlyCreatedEntity(*newEntity, senderNode);
-                    }
-                }
+                applyAddOrEdit(entityItemID, properties, senderNode);
             }
             break;
         }
@@ -611,6 +607,157 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
     return processedBytes;
 }
 
+int EntityTree::decodeEditPacketData(PacketType packetType, const unsigned char* editData, int maxLength,
+                    OctreeEditRecord*& decodedEdit) const {
+    decodedEdit = NULL;
+
+    // erase messages are left to processEditPacketData(), they run to the end of the packet anyway
+    if (packetType != PacketTypeEntityAddOrEdit) {
+        return 0;
+    }
+
+    int processedBytes = 0;
+    EntityEditRecord* record = new EntityEditRecord();
+    if (EntityItemProperties::decodeEntityEditPacket(editData, maxLength, processedBytes,
+                                                     record->entityItemID, record->properties)) {
+        decodedEdit = record;
+    } else {
+        delete record;
+    }
+    return processedBytes;
+}
+
+void EntityTree::applyDecodedEdit(const OctreeEditRecord& decodedEdit, const SharedNodePointer& senderNode) {
+    const EntityEditRecord& record = static_cast<const EntityEditRecord&>(decodedEdit);
+    applyAddOrEdit(record.entityItemID, record.properties, senderNode);
+}
+
+int EntityTree::stripeForDecodedEdit(const OctreeEditRecord& decodedEdit) {
+    const EntityEditRecord& record = static_cast<const EntityEditRecord&>(decodedEdit);
+
+    // adds and anything that may move the entity go through the whole tree, this only looks at what the spine
+    // protects, the entity itself is checked once its stripe is held
+    if (!record.entityItemID.isKnownID || record.properties.containsBoundsProperties()
+            || record.properties.registrationPointChanged()) {
+        return ALL_STRIPES;
+    }
+    EntityTreeElement* containingElement = getContainingElement(record.entityItemID);
+    if (!containingElement) {
+        return ALL_STRIPES;
+    }
+    return stripeOfElement(containingElement);
+}
+
+bool EntityTree::applyDecodedEditInStripe(const OctreeEditRecord& decodedEdit, int stripe,
+                                          const SharedNodePointer& senderNode) {
+    const EntityEditRecord& record = static_cast<const EntityEditRecord&>(decodedEdit);
+
+    // don't rely on the caller having asked stripeForDecodedEdit(), an edit that could move the entity needs the
+    // whole tree whatever stripe is held
+    if (!record.entityItemID.isKnownID || record.properties.containsBoundsProperties()
+            || record.properties.registrationPointChanged()) {
+        return false;
+    }
+    EntityTreeElement* containingElement = getContainingElement(record.entityItemID);
+    // an element in the spine has no stripe of its own, so it's never stripe local
+    if (stripe == ALL_STRIPES || !containingElement || stripeOfElement(containingElement) != stripe) {
+        return false;
+    }
+    EntityItem* existingEntity = containingElement->getEntityWithEntityItemID(record.entityItemID);
+
+    // locked entities, and the unusual ones that aren't in their best fit element, are left to UpdateEntityOperator
+    if (!existingEntity || existingEntity->getLocked()
+            || !containingElement->bestFitBounds(existingEntity->getMaximumAACube().clamp(0.0f, 1.0f))) {
+        return false;
+    }
+
+    // this is UpdateEntityOperator's typical no move case, without the recursion down to the element
+    EntityItemProperties properties = record.properties;
+    properties.setRegistrationPoint(existingEntity->getRegistrationPoint());
+    uint32_t preFlags = existingEntity->getDirtyFlags();
+    existingEntity->setProperties(properties);
+    markPathChanged(containingElement);
+    _isDirty = true;
+    notifySimulationOfChange(existingEntity, preFlags);
+
+    existingEntity->markAsChangedOnServer();
+    journalAddOrEdit(record.entityItemID, record.properties);
+    return true;
+}
+
+void EntityTree::applyAddOrEdit(EntityItemID entityItemID, const EntityItemProperties& properties,
+                                const SharedNodePointer& senderNode) {
+    // a valid edit could be for a new entity or it could be an update to an existing entity... handle appropriately
+    
+    // If this is a knownID, then it should exist in our tree
+    if (entityItemID.isKnownID) {
+        // search for the entity by EntityItemID
+        EntityItem* existingEntity = findEntityByEntityItemID(entityItemID);
+        
+        // if the EntityItem exists, then update it
+        if (existingEntity) {
+            updateEntity(entityItemID, properties);
+            existingEntity->markAsChangedOnServer();
+            journalAddOrEdit(entityItemID, properties);
+        } else {
+            qDebug() << "User attempted to edit an unknown entity. ID:" << entityItemID;
+        }
+    } else {
+        // this is a new entity... assign a new entityID
+        entityItemID = assignEntityID(entityItemID);
+        EntityItem* newEntity = addEntity(entityItemID, properties);
+        if (newEntity) {
+            newEntity->markAsChangedOnServer();
+            notifyNewlyCreatedEntity(*newEntity, senderNode);
+            journalAddOrEdit(entityItemID, properties);
+        }
+    }
+}
+
+void EntityTree::journalAddOrEdit(const EntityItemID& entityItemID, const EntityItemProperties& properties) {
+    if (!getEditJournal()) {
+        return;
+    }
+
+    // the journal keeps the edit as it was applied, with the entity's assigned ID in place of any creator token
+    unsigned char record[MAX_PACKET_SIZE];
+    int recordLength = 0;
+    if (EntityItemProperties::encodeEntityEditPacket(PacketTypeEntityAddOrEdit, entityItemID, properties,
+                                                     record, MAX_PACKET_SIZE, recordLength)) {
+        journalEdit(PacketTypeEntityAddOrEdit, record, recordLength);
+    } else {
+        qDebug() << "Edit to entity" << entityItemID << "didn't fit in a journal record, asking for a snapshot";
+        getEditJournal()->requestSnapshot();
+    }
+}
+
+bool EntityTree::replayJournalRecord(PacketType recordType, const unsigned char* data, int length) {
+    if (recordType == PacketTypeEntityErase) {
+        QByteArray dataByteArray((const char*)data, length);
+        processEraseMessageDetails(dataByteArray, SharedNodePointer());
+        return true;
+    }
+
+    if (recordType != PacketTypeEntityAddOrEdit) {
+        return false;
+    }
+
+    int processedBytes = 0;
+    EntityItemID entityItemID;
+    EntityItemProperties properties;
+    if (!EntityItemProperties::decodeEntityEditPacket(data, length, processedBytes, entityItemID, properties)) {
+        return false;
+    }
+
+    // journaled adds already carry the ID that was assigned, so an entity the snapshot doesn't have is added with it
+    if (findEntityByEntityItemID(entityItemID)) {
+        updateEntity(entityItemID, properties);
+    } else {
+        addEntity(entityItemID, properties);
+    }
+    return true;
+}
+
 
 void EntityTree::notifyNewlyCreatedEntity(const EntityItem& newEntity, const SharedNodePointer& senderNode) {
     _newlyCreatedHooksLock.lockForRead();
@@ -881,6 +1028,7 @@ int EntityTree::processEraseMessageDetails(const QByteArray& dataByteArray, cons
             entityItemIDsToDelete << entityItemID;
         }
         deleteEntities(entityItemIDsToDelete);
+        journalEdit(PacketTypeEntityErase, packetData, processedBytes);
     }
     return processedBytes;
 }
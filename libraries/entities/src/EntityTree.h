@@ -34,6 +34,13 @@ public:
 };
 
 
+/// an add or edit record decoded from an entity edit packet, waiting to be applied to the tree
+class EntityEditRecord : public OctreeEditRecord {
+public:
+    EntityItemID entityItemID;
+    EntityItemProperties properties;
+};
+
 class SendEntitiesOperationArgs {
 public:
     glm::vec3 root;
@@ -65,6 +72,14 @@ public:
     virtual bool handlesEditPacketType(PacketType packetType) const;
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& senderNode);
+    virtual int decodeEditPacketData(PacketType packetType, const unsigned char* editData, int maxLength,
+                    OctreeEditRecord*& decodedEdit) const;
+    virtual void applyDecodedEdit(const OctreeEditRecord& decodedEdit, const SharedNodePointer& senderNode);
+    virtual int stripeForDecodedEdit(const OctreeEditRecord& decodedEdit);
+    virtual bool applyDecodedEditInStripe(const OctreeEditRecord& decodedEdit, int stripe,
+                                          const SharedNodePointer& senderNode);
+    virtual bool wantsEditJournal() const { return getIsServer(); }
+    virtual bool replayJournalRecord(PacketType recordType, const unsigned char* data, int length);
 
     virtual bool rootElementHasData() const { return true; }
     
@@ -163,11 +178,16 @@ private:
     void processRemovedEntities(const DeleteEntityOperator& theOperator);
     bool updateEntityWithElement(EntityItem* entity, const EntityItemProperties& properties, 
             EntityTreeElement* containingElement);
+    void notifySimulationOfChange(EntityItem* entity, uint32_t preFlags);
+    void markPathChanged(EntityTreeElement* element);
     static bool findNearPointOperation(OctreeElement* element, void* extraData);
     static bool findInSphereOperation(OctreeElement* element, void* extraData);
     static bool findInCubeOperation(OctreeElement* element, void* extraData);
     static bool sendEntitiesOperation(OctreeElement* element, void* extraData);
 
+    void applyAddOrEdit(EntityItemID entityItemID, const EntityItemProperties& properties,
+            const SharedNodePointer& senderNode);
+    void journalAddOrEdit(const EntityItemID& entityItemID, const EntityItemProperties& properties);
     void notifyNewlyCreatedEntity(const EntityItem& newEntity, const SharedNodePointer& senderNode);
 
     QReadWriteLock _newlyCreatedHooksLock;
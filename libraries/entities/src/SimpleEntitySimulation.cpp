@@ -11,34 +11,475 @@
 
 //#include <PerfStat.h>
 
+#include <utility>
+
+#include <QtCore/QRunnable>
+
+#include <AABox.h>
+#include <PhysicsHelpers.h>
+
 #include "EntityItem.h"
+#include "EntityTree.h"
+#include "EntityTreeElement.h"
 #include "SimpleEntitySimulation.h"
 
+// the fields of a slot a step changed
+enum {
+    CHANGED_POSITION = 0x01,
+    CHANGED_ROTATION = 0x02,
+    CHANGED_VELOCITY = 0x04,
+    CHANGED_ANGULAR_VELOCITY = 0x08,
+    CHANGED_LAST_SIMULATED = 0x10
+};
+
+class SimulationRegionJob : public QRunnable {
+public:
+    SimulationRegionJob(SimpleEntitySimulation* simulation, int region) :
+        region(region), begin(0), end(0), now(0), _simulation(simulation) { setAutoDelete(false); }
+
+    void setRange(int begin, int end, quint64 now) {
+        this->begin = begin;
+        this->end = end;
+        this->now = now;
+        resortedEntities.clear();
+        unsortedEntities.clear();
+        crossingEntities.clear();
+    }
+
+    void runRegion() {
+        _simulation->simulateRange(begin, end, now);
+        _simulation->sortRegion(*this);
+    }
+
+    virtual void run() {
+        runRegion();
+        _simulation->_simulationJobsDone.release();
+    }
+
+    const int region;
+    int begin;
+    int end;
+    quint64 now;
+
+    // what the job leaves for the serial pass
+    std::vector<EntityItem*> resortedEntities; // moved to another element, which the tree's map doesn't know yet
+    std::vector<EntityItem*> unsortedEntities; // still in the region, but need the serial re-sort
+    std::vector<std::pair<EntityItem*, int> > crossingEntities; // left the region, with the one they are in now
+
+private:
+    SimpleEntitySimulation* _simulation;
+};
+
+SimpleEntitySimulation::SimpleEntitySimulation() :
+    EntitySimulation(),
+    _numSimulationThreads(0)
+{
+    for (int i = 0; i < NUM_REGIONS; i++) {
+        _regionEnds[i] = 0;
+        _regionJobs[i] = new SimulationRegionJob(this, i);
+    }
+    setNumSimulationThreads(1);
+}
+
+SimpleEntitySimulation::~SimpleEntitySimulation() {
+    _simulationThreadPool.waitForDone();
+    for (int i = 0; i < NUM_REGIONS; i++) {
+        delete _regionJobs[i];
+    }
+    clearEntitiesInternal();
+}
+
+void SimpleEntitySimulation::setNumSimulationThreads(int numSimulationThreads) {
+    if (numSimulationThreads < 1) {
+        numSimulationThreads = 1;
+    }
+
+    _numSimulationThreads = numSimulationThreads;
+
+    // the updating thread runs one region itself, so the pool only needs the remaining threads
+    _simulationThreadPool.waitForDone();
+    _simulationThreadPool.setMaxThreadCount(qMax(_numSimulationThreads - 1, 1));
+}
+
+
 void SimpleEntitySimulation::updateEntitiesInternal(const quint64& now) {
-    QSet<EntityItem*>::iterator itemItr = _movingEntities.begin();
-    while (itemItr != _movingEntities.end()) {
-        EntityItem* entity = *itemItr;
-        if (!entity->isMoving()) {
-            itemItr = _movingEntities.erase(itemItr);
-            _movableButStoppedEntities.insert(entity);
+    // entities an external change brought to a stop since the last update go before stepping the rest
+    int numSlots = (int)_movingEntities.size();
+    for (int i = 0; i < numSlots; i++) {
+        if (_velocities[i] == ENTITY_ITEM_ZERO_VEC3 && _angularVelocities[i] == ENTITY_ITEM_ZERO_VEC3) {
+            _stoppedEntities.push_back(_movingEntities[i]);
+        }
+    }
+    for (size_t i = 0; i < _stoppedEntities.size(); i++) {
+        removeKinematicState(_stoppedEntities[i]);
+        _movableButStoppedEntities.insert(_stoppedEntities[i]);
+    }
+    _stoppedEntities.clear();
+
+    runSimulationJobs(now);
+
+    // the element map is the whole tree's, so the jobs' moves are recorded in it here. Only the movers the jobs
+    // couldn't sort go on to the serial re-sort, and those that left their region join their new one's group.
+    bool hasResortedEntities = false;
+    for (int region = 0; region < NUM_REGIONS; region++) {
+        const SimulationRegionJob& job = *_regionJobs[region];
+        for (size_t i = 0; i < job.resortedEntities.size(); i++) {
+            EntityItem* entity = job.resortedEntities[i];
+            _entityTree->setContainingElement(entity->getEntityItemID(), entity->getElement());
+            hasResortedEntities = true;
+        }
+        for (size_t i = 0; i < job.unsortedEntities.size(); i++) {
+            _entitiesToBeSorted.insert(job.unsortedEntities[i]);
+        }
+        for (size_t i = 0; i < job.crossingEntities.size(); i++) {
+            _entitiesToBeSorted.insert(job.crossingEntities[i].first);
+        }
+    }
+    if (hasResortedEntities) {
+        // the root is above every region, so no job marks it
+        _entityTree->getRoot()->markWithChangedTime();
+    }
+    for (int region = 0; region < NUM_REGIONS; region++) {
+        const SimulationRegionJob& job = *_regionJobs[region];
+        for (size_t i = 0; i < job.crossingEntities.size(); i++) {
+            int slot = _movingEntitySlots.value(job.crossingEntities[i].first);
+            moveSlotToRegion(slot, regionOfSlot(slot), job.crossingEntities[i].second);
+        }
+    }
+}
+
+void SimpleEntitySimulation::runSimulationJobs(const quint64& now) {
+    int numSlots = (int)_movingEntities.size();
+    _timesElapsed.resize(numSlots);
+    _changedFields.resize(numSlots);
+
+    // a region is never split, since its job also sorts the region's part of the tree
+    int largestRegion = 0;
+    int begin = 0;
+    for (int region = 0; region < NUM_REGIONS; region++) {
+        int end = _regionEnds[region];
+        _regionJobs[region]->setRange(begin, end, now);
+        if (end - begin > _regionJobs[largestRegion]->end - _regionJobs[largestRegion]->begin) {
+            largestRegion = region;
+        }
+        begin = end;
+    }
+
+    // the updating thread runs the largest region itself, and every region when it is the only simulation thread
+    int numJobs = 0;
+    for (int region = 0; region < NUM_REGIONS; region++) {
+        SimulationRegionJob* job = _regionJobs[region];
+        if (region == largestRegion || job->begin == job->end) {
+            continue;
+        }
+        if (_numSimulationThreads > 1) {
+            _simulationThreadPool.start(job);
+            numJobs++;
         } else {
-            entity->simulate(now);
-            _entitiesToBeSorted.insert(entity);
-            ++itemItr;
+            job->runRegion();
         }
     }
+    _regionJobs[largestRegion]->runRegion();
+
+    if (numJobs > 0) {
+        _simulationJobsDone.acquire(numJobs);
+    }
+}
+
+void SimpleEntitySimulation::simulateRange(int begin, int end, const quint64& now) {
+    for (int i = begin; i < end; i++) {
+        if (_lastSimulated[i] == 0) {
+            _lastSimulated[i] = now;
+        }
+        _timesElapsed[i] = (float)(now - _lastSimulated[i]) / (float)(USECS_PER_SECOND);
+        _changedFields[i] = (_lastSimulated[i] != now) ? CHANGED_LAST_SIMULATED : 0;
+        _lastSimulated[i] = now;
+    }
+
+    // angular damping, stopping whatever spins too slowly to matter
+    for (int i = begin; i < end; i++) {
+        glm::vec3& angularVelocity = _angularVelocities[i];
+        if (angularVelocity == ENTITY_ITEM_ZERO_VEC3) {
+            continue;
+        }
+        if (_angularDampings[i] > 0.0f) {
+            angularVelocity *= powf(1.0f - _angularDampings[i], _timesElapsed[i]);
+            _changedFields[i] |= CHANGED_ANGULAR_VELOCITY;
+        }
+        float angularSpeed = glm::length(angularVelocity);
+        if (angularSpeed < EPSILON_ANGULAR_VELOCITY_LENGTH) {
+            if (angularSpeed > 0.0f) {
+                _movingEntities[i]->markDirtyFlags(EntityItem::DIRTY_MOTION_TYPE);
+            }
+            angularVelocity = ENTITY_ITEM_ZERO_VEC3;
+            _changedFields[i] |= CHANGED_ANGULAR_VELOCITY;
+        }
+    }
+
+    // rotation, in the same bullet-sized substeps as EntityItem::simulateKinematicMotion()
+    for (int i = begin; i < end; i++) {
+        if (_angularVelocities[i] == ENTITY_ITEM_ZERO_VEC3) {
+            continue;
+        }
+        // NOTE: angular velocity is currently in degrees/sec
+        glm::vec3 angularVelocity = glm::radians(_angularVelocities[i]);
+        glm::quat rotation = _rotations[i];
+        float dt = _timesElapsed[i];
+        while (dt > PHYSICS_ENGINE_FIXED_SUBSTEP) {
+            glm::quat dQ = computeBulletRotationStep(angularVelocity, PHYSICS_ENGINE_FIXED_SUBSTEP);
+            rotation = glm::normalize(dQ * rotation);
+            dt -= PHYSICS_ENGINE_FIXED_SUBSTEP;
+        }
+        glm::quat dQ = computeBulletRotationStep(angularVelocity, dt);
+        _rotations[i] = glm::normalize(dQ * rotation);
+        _changedFields[i] |= CHANGED_ROTATION;
+    }
+
+    // linear damping, position and gravity, the gravity of an entity without any is zero so it is added regardless
+    for (int i = begin; i < end; i++) {
+        glm::vec3 velocity = _velocities[i];
+        if (velocity == ENTITY_ITEM_ZERO_VEC3) {
+            continue;
+        }
+        float timeElapsed = _timesElapsed[i];
+        if (_dampings[i] > 0.0f) {
+            velocity *= powf(1.0f - _dampings[i], timeElapsed);
+        }
+        glm::vec3 position = _positions[i] + (velocity * timeElapsed);
+        velocity += _gravities[i] * timeElapsed;
+
+        float speed = glm::length(velocity);
+        if (speed < EPSILON_LINEAR_VELOCITY_LENGTH) {
+            _velocities[i] = ENTITY_ITEM_ZERO_VEC3;
+            if (speed > 0.0f) {
+                _movingEntities[i]->markDirtyFlags(EntityItem::DIRTY_MOTION_TYPE);
+            }
+            _changedFields[i] |= CHANGED_VELOCITY;
+        } else {
+            if (position != _positions[i]) {
+                _positions[i] = position;
+                _changedFields[i] |= CHANGED_POSITION;
+            }
+            if (velocity != _velocities[i]) {
+                _velocities[i] = velocity;
+                _changedFields[i] |= CHANGED_VELOCITY;
+            }
+        }
+    }
+
+    // write back only what changed, each entity is only touched by the thread simulating its slot
+    for (int i = begin; i < end; i++) {
+        uint8_t changedFields = _changedFields[i];
+        if (!changedFields) {
+            continue;
+        }
+        EntityItem* entity = _movingEntities[i];
+        if (changedFields & CHANGED_POSITION) {
+            entity->setPosition(_positions[i]);
+        }
+        if (changedFields & CHANGED_ROTATION) {
+            entity->setRotation(_rotations[i]);
+        }
+        if (changedFields & CHANGED_VELOCITY) {
+            entity->setVelocity(_velocities[i]);
+        }
+        if (changedFields & CHANGED_ANGULAR_VELOCITY) {
+            entity->setAngularVelocity(_angularVelocities[i]);
+        }
+        if (changedFields & CHANGED_LAST_SIMULATED) {
+            entity->setLastSimulated(_lastSimulated[i]);
+        }
+    }
+}
+
+// marks the elements from one element down to another below it as changed, as the tree's re-sort does
+static void markPathWithChangedTime(OctreeElement* element, const OctreeElement* lastElement) {
+    const AACube& lastCube = lastElement->getAACube();
+    while (element) {
+        element->markWithChangedTime();
+        if (element == lastElement) {
+            break;
+        }
+        OctreeElement* parent = element;
+        element = NULL;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            OctreeElement* child = parent->getChildAtIndex(i);
+            if (child && child->getAACube().contains(lastCube)) {
+                element = child;
+                break;
+            }
+        }
+    }
+}
+
+void SimpleEntitySimulation::sortRegion(SimulationRegionJob& job) {
+    EntityTreeElement* regionElement = NULL;
+    if (_entityTree && job.region != ROOT_REGION) {
+        regionElement = _entityTree->getRoot()->getChildAtIndex(job.region);
+    }
+
+    for (int i = job.begin; i < job.end; i++) {
+        if (!(_changedFields[i] & (CHANGED_POSITION | CHANGED_ROTATION))) {
+            continue;
+        }
+        EntityItem* entity = _movingEntities[i];
+        AACube newCube = entity->getMaximumAACube();
+        int newRegion = regionContaining(newCube);
+        if (newRegion != job.region) {
+            job.crossingEntities.push_back(std::make_pair(entity, newRegion));
+            continue;
+        }
+
+        EntityTreeElement* oldElement = entity->getElement();
+        AABox newBox = newCube.clamp(0.0f, 1.0f);
+        if (regionElement && oldElement && oldElement->bestFitBounds(newBox)) {
+            continue;
+        }
+        if (!regionElement || !oldElement || !regionElement->getAACube().contains(oldElement->getAACube())) {
+            job.unsortedEntities.push_back(entity);
+            continue;
+        }
+
+        // the element that fits it now, only whole tree writers may add elements so one that is missing leaves the
+        // mover to the serial re-sort. An element this empties is left for the tree's next pruning.
+        EntityTreeElement* newElement = regionElement;
+        while (newElement && !newElement->bestFitBounds(newBox)) {
+            int childIndex = newElement->getMyChildContaining(newBox);
+            newElement = (childIndex == OctreeElement::CHILD_UNKNOWN) ? NULL : newElement->getChildAtIndex(childIndex);
+        }
+        if (!newElement) {
+            job.unsortedEntities.push_back(entity);
+            continue;
+        }
+
+        markPathWithChangedTime(regionElement, oldElement);
+        markPathWithChangedTime(regionElement, newElement);
+        oldElement->removeEntityItem(entity);
+        newElement->addEntityItem(entity);
+        job.resortedEntities.push_back(entity);
+    }
+}
+
+int SimpleEntitySimulation::regionContaining(const AACube& cube) const {
+    // whatever is outside the domain goes to the serial re-sort, which removes it
+    AACube domainBounds(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f);
+    if (!_entityTree || !domainBounds.touches(cube)) {
+        return ROOT_REGION;
+    }
+    int childIndex = _entityTree->getRoot()->getMyChildContaining(cube.clamp(0.0f, 1.0f));
+    return (childIndex == OctreeElement::CHILD_UNKNOWN) ? ROOT_REGION : childIndex;
+}
+
+int SimpleEntitySimulation::regionOfSlot(int slot) const {
+    int region = 0;
+    while (slot >= _regionEnds[region]) {
+        region++;
+    }
+    return region;
+}
+
+void SimpleEntitySimulation::swapSlots(int a, int b) {
+    if (a == b) {
+        return;
+    }
+    std::swap(_movingEntities[a], _movingEntities[b]);
+    std::swap(_positions[a], _positions[b]);
+    std::swap(_rotations[a], _rotations[b]);
+    std::swap(_velocities[a], _velocities[b]);
+    std::swap(_gravities[a], _gravities[b]);
+    std::swap(_angularVelocities[a], _angularVelocities[b]);
+    std::swap(_dampings[a], _dampings[b]);
+    std::swap(_angularDampings[a], _angularDampings[b]);
+    std::swap(_lastSimulated[a], _lastSimulated[b]);
+    _movingEntitySlots[_movingEntities[a]] = a;
+    _movingEntitySlots[_movingEntities[b]] = b;
+}
+
+int SimpleEntitySimulation::moveSlotToRegion(int slot, int fromRegion, int toRegion) {
+    // each step swaps the slot with the edge of its group and moves that edge past it, a step per group crossed
+    while (fromRegion < toRegion) {
+        int last = _regionEnds[fromRegion] - 1;
+        swapSlots(slot, last);
+        slot = last;
+        _regionEnds[fromRegion]--;
+        fromRegion++;
+    }
+    while (fromRegion > toRegion) {
+        int first = _regionEnds[fromRegion - 1];
+        swapSlots(slot, first);
+        slot = first;
+        _regionEnds[fromRegion - 1]++;
+        fromRegion--;
+    }
+    return slot;
+}
+
+void SimpleEntitySimulation::loadKinematicState(EntityItem* entity) {
+    int slot;
+    QHash<EntityItem*, int>::const_iterator slotItr = _movingEntitySlots.constFind(entity);
+    if (slotItr != _movingEntitySlots.constEnd()) {
+        slot = slotItr.value();
+    } else {
+        // a new slot goes at the end, into the last region's group
+        slot = (int)_movingEntities.size();
+        _movingEntitySlots.insert(entity, slot);
+        _movingEntities.push_back(entity);
+        _positions.resize(slot + 1);
+        _rotations.resize(slot + 1);
+        _velocities.resize(slot + 1);
+        _gravities.resize(slot + 1);
+        _angularVelocities.resize(slot + 1);
+        _dampings.resize(slot + 1);
+        _angularDampings.resize(slot + 1);
+        _lastSimulated.resize(slot + 1);
+        _regionEnds[NUM_REGIONS - 1]++;
+    }
+    _positions[slot] = entity->getPosition();
+    _rotations[slot] = entity->getRotation();
+    _velocities[slot] = entity->getVelocity();
+    _gravities[slot] = entity->getGravity();
+    _angularVelocities[slot] = entity->getAngularVelocity();
+    _dampings[slot] = entity->getDamping();
+    _angularDampings[slot] = entity->getAngularDamping();
+    _lastSimulated[slot] = entity->getLastSimulated();
+
+    moveSlotToRegion(slot, regionOfSlot(slot), regionContaining(entity->getMaximumAACube()));
+}
+
+void SimpleEntitySimulation::removeKinematicState(EntityItem* entity) {
+    QHash<EntityItem*, int>::const_iterator slotItr = _movingEntitySlots.constFind(entity);
+    if (slotItr == _movingEntitySlots.constEnd()) {
+        return;
+    }
+
+    // move it into the last group and then to the very end, where it can be dropped
+    int slot = slotItr.value();
+    slot = moveSlotToRegion(slot, regionOfSlot(slot), NUM_REGIONS - 1);
+    swapSlots(slot, (int)_movingEntities.size() - 1);
+
+    _movingEntitySlots.remove(entity);
+    _movingEntities.pop_back();
+    _positions.pop_back();
+    _rotations.pop_back();
+    _velocities.pop_back();
+    _gravities.pop_back();
+    _angularVelocities.pop_back();
+    _dampings.pop_back();
+    _angularDampings.pop_back();
+    _lastSimulated.pop_back();
+    _regionEnds[NUM_REGIONS - 1]--;
 }
 
 void SimpleEntitySimulation::addEntityInternal(EntityItem* entity) {
     if (entity->isMoving()) {
-        _movingEntities.insert(entity);
+        loadKinematicState(entity);
     } else if (entity->getCollisionsWillMove()) {
         _movableButStoppedEntities.insert(entity);
     }
 }
 
 void SimpleEntitySimulation::removeEntityInternal(EntityItem* entity) {
-    _movingEntities.remove(entity);
+    removeKinematicState(entity);
     _movableButStoppedEntities.remove(entity);
 }
 
@@ -48,19 +489,34 @@ void SimpleEntitySimulation::entityChangedInternal(EntityItem* entity) {
     int dirtyFlags = entity->getDirtyFlags();
     if (dirtyFlags & SIMPLE_SIMULATION_DIRTY_FLAGS) {
         if (entity->isMoving()) {
-            _movingEntities.insert(entity);
+            loadKinematicState(entity);
         } else if (entity->getCollisionsWillMove()) {
             _movableButStoppedEntities.remove(entity);
         } else {
-            _movingEntities.remove(entity);
+            removeKinematicState(entity);
             _movableButStoppedEntities.remove(entity);
         }
     }
+    if (_movingEntitySlots.contains(entity)) {
+        // whatever changed, the slot's copy of the motion is stale now
+        loadKinematicState(entity);
+    }
     entity->clearDirtyFlags();
 }
 
 void SimpleEntitySimulation::clearEntitiesInternal() {
     _movingEntities.clear();
+    _movingEntitySlots.clear();
+    _positions.clear();
+    _rotations.clear();
+    _velocities.clear();
+    _gravities.clear();
+    _angularVelocities.clear();
+    _dampings.clear();
+    _angularDampings.clear();
+    _lastSimulated.clear();
+    for (int i = 0; i < NUM_REGIONS; i++) {
+        _regionEnds[i] = 0;
+    }
     _movableButStoppedEntities.clear();
 }
-
@@ -12,14 +12,41 @@
 #ifndef hifi_SimpleEntitySimulation_h
 #define hifi_SimpleEntitySimulation_h
 
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <QHash>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+
+#include <AACube.h>
+#include <OctreeConstants.h>
+
 #include "EntitySimulation.h"
 
+class SimulationRegionJob;
+
 /// provides simple velocity + gravity extrapolation of EntityItem's
+///
+/// The motion of the moving entities is kept in parallel arrays, one slot per entity, and integrated a field at a
+/// time rather than an entity at a time. The arrays are what the simulation steps, the entities get the results
+/// written back once per update and are loaded again whenever an external change flags their motion as dirty.
+///
+/// The slots are grouped by the child of the tree's root their entity's bounds fit in, so a group is a part of the
+/// domain and of the tree. Each update steps every group in a job of its own on a thread pool, and the job also
+/// re-sorts the movers that stayed in its part of the tree. Only the movers that crossed into another part, or that
+/// need tree elements that don't exist yet, are left for the serial re-sort of the whole tree.
 
 class SimpleEntitySimulation : public EntitySimulation {
 public:
-    SimpleEntitySimulation() : EntitySimulation() { }
-    virtual ~SimpleEntitySimulation() { clearEntitiesInternal(); }
+    SimpleEntitySimulation();
+    virtual ~SimpleEntitySimulation();
+
+    /// the threads an update is spread across, the thread calling updateEntities() is one of them
+    void setNumSimulationThreads(int numSimulationThreads);
+    int getNumSimulationThreads() const { return _numSimulationThreads; }
 
 protected:
     virtual void updateEntitiesInternal(const quint64& now);
@@ -28,7 +55,63 @@ protected:
     virtual void entityChangedInternal(EntityItem* entity);
     virtual void clearEntitiesInternal();
 
-    QSet<EntityItem*> _movingEntities;
+private:
+    friend class SimulationRegionJob;
+
+    // one region per child of the root, and one for whatever only fits in the root itself or is outside it
+    static const int NUM_REGIONS = NUMBER_OF_CHILDREN + 1;
+    static const int ROOT_REGION = NUMBER_OF_CHILDREN;
+
+    int regionContaining(const AACube& cube) const;
+    int regionOfSlot(int slot) const;
+
+    /// copies the entity's motion into its slot, giving it one if it has none
+    void loadKinematicState(EntityItem* entity);
+
+    /// frees the entity's slot
+    void removeKinematicState(EntityItem* entity);
+
+    /// moves a slot into another region's group by rotating it through the groups in between, returns its new slot
+    int moveSlotToRegion(int slot, int fromRegion, int toRegion);
+    void swapSlots(int a, int b);
+
+    /// steps the slots [begin, end) forward to now, the way EntityItem::simulate() steps a single entity, and writes
+    /// what changed back to their entities. Safe to run on different ranges at once.
+    void simulateRange(int begin, int end, const quint64& now);
+
+    /// moves the entities of a region's slots that left their tree element to the element that fits them now, as long
+    /// as it is in the region and already exists. The others are left in the job for the serial pass. Safe to run on
+    /// different regions at once, since a region's job is the only one touching that part of the tree.
+    void sortRegion(SimulationRegionJob& job);
+
+    /// steps and sorts every region, spread across the simulation threads if there is more than one
+    void runSimulationJobs(const quint64& now);
+
+    // slot i of every array belongs to _movingEntities[i]
+    std::vector<EntityItem*> _movingEntities;
+    QHash<EntityItem*, int> _movingEntitySlots;
+    std::vector<glm::vec3> _positions;
+    std::vector<glm::quat> _rotations;
+    std::vector<glm::vec3> _velocities;
+    std::vector<glm::vec3> _gravities;
+    std::vector<glm::vec3> _angularVelocities;
+    std::vector<float> _dampings;
+    std::vector<float> _angularDampings;
+    std::vector<quint64> _lastSimulated;
+    std::vector<float> _timesElapsed;
+    std::vector<uint8_t> _changedFields; // which of a slot's fields its entity needs written back this update
+
+    // region r holds the slots from the end of region r - 1 up to _regionEnds[r]
+    int _regionEnds[NUM_REGIONS];
+
+    // scratch for the serial pass of an update
+    std::vector<EntityItem*> _stoppedEntities;
+
+    int _numSimulationThreads;
+    QThreadPool _simulationThreadPool;
+    SimulationRegionJob* _regionJobs[NUM_REGIONS];
+    QSemaphore _simulationJobsDone;
+
     QSet<EntityItem*> _movableButStoppedEntities;
 };
 
@@ -0,0 +1,102 @@
+//
+//  DatagramBatchReader.cpp
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifdef __linux__
+#include <errno.h>
+#include <string.h>
+#endif
+
+#include <QtCore/QDebug>
+#include <QtCore/QSocketNotifier>
+
+#include "DatagramBatchReader.h"
+
+DatagramBatchReader::DatagramBatchReader(QUdpSocket& socket, QObject* parent) :
+    QObject(parent),
+    _socket(socket),
+    _buffers(MAX_DATAGRAMS_PER_BATCH * MAX_BATCHED_DATAGRAM_BYTES),
+    _datagramSizes(MAX_DATAGRAMS_PER_BATCH),
+    _senderSockAddrs(MAX_DATAGRAMS_PER_BATCH)
+{
+#ifdef __linux__
+    _messages.resize(MAX_DATAGRAMS_PER_BATCH);
+    _iovecs.resize(MAX_DATAGRAMS_PER_BATCH);
+    _senderAddresses.resize(MAX_DATAGRAMS_PER_BATCH);
+    
+    for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+        _iovecs[i].iov_base = &_buffers[i * MAX_BATCHED_DATAGRAM_BYTES];
+        _iovecs[i].iov_len = MAX_BATCHED_DATAGRAM_BYTES;
+    }
+    
+    // we read straight off the descriptor, so watch it ourselves rather than waiting on the socket's readyRead
+    QSocketNotifier* readNotifier = new QSocketNotifier(_socket.socketDescriptor(), QSocketNotifier::Read, this);
+    connect(readNotifier, &QSocketNotifier::activated, this, &DatagramBatchReader::datagramsPending);
+#else
+    connect(&_socket, &QUdpSocket::readyRead, this, &DatagramBatchReader::datagramsPending);
+#endif
+}
+
+int DatagramBatchReader::readBatch() {
+#ifdef __linux__
+    // recvmmsg overwrites the lengths in the headers, so they are reset for every batch
+    for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+        memset(&_messages[i], 0, sizeof(mmsghdr));
+        _messages[i].msg_hdr.msg_iov = &_iovecs[i];
+        _messages[i].msg_hdr.msg_iovlen = 1;
+        _messages[i].msg_hdr.msg_name = &_senderAddresses[i];
+        _messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+    }
+    
+    int numReceived = recvmmsg(_socket.socketDescriptor(), _messages.data(), MAX_DATAGRAMS_PER_BATCH, MSG_DONTWAIT, NULL);
+    
+    if (numReceived < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            qDebug() << "ERROR in recvmmsg:" << strerror(errno);
+        }
+        return 0;
+    }
+    
+    int numDatagrams = 0;
+    for (int i = 0; i < numReceived; i++) {
+        if (_messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            qDebug() << "Dropping a datagram larger than" << MAX_BATCHED_DATAGRAM_BYTES << "bytes";
+            continue;
+        }
+        
+        // keep the batch packed, a dropped datagram's slot is taken by the next one
+        if (numDatagrams != i) {
+            memcpy(&_buffers[numDatagrams * MAX_BATCHED_DATAGRAM_BYTES], &_buffers[i * MAX_BATCHED_DATAGRAM_BYTES], _messages[i].msg_len);
+        }
+        
+        _datagramSizes[numDatagrams] = _messages[i].msg_len;
+        _senderSockAddrs[numDatagrams] = HifiSockAddr(reinterpret_cast<const sockaddr*>(&_senderAddresses[i]));
+        ++numDatagrams;
+    }
+    
+    // a batch that was all dropped datagrams still has to look like progress to the caller
+    return (numDatagrams == 0 && numReceived > 0) ? readBatch() : numDatagrams;
+#else
+    int numDatagrams = 0;
+    
+    while (numDatagrams < MAX_DATAGRAMS_PER_BATCH && _socket.hasPendingDatagrams()) {
+        char* buffer = &_buffers[numDatagrams * MAX_BATCHED_DATAGRAM_BYTES];
+        HifiSockAddr& senderSockAddr = _senderSockAddrs[numDatagrams];
+        
+        qint64 datagramSize = _socket.readDatagram(buffer, MAX_BATCHED_DATAGRAM_BYTES,
+                                                   senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        if (datagramSize >= 0) {
+            _datagramSizes[numDatagrams] = (int)datagramSize;
+            ++numDatagrams;
+        }
+    }
+    
+    return numDatagrams;
+#endif
+}
@@ -0,0 +1,63 @@
+//
+//  DatagramBatchReader.h
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramBatchReader_h
+#define hifi_DatagramBatchReader_h
+
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+#include <QtCore/QObject>
+#include <QtNetwork/QUdpSocket>
+
+#include "HifiSockAddr.h"
+
+const int MAX_DATAGRAMS_PER_BATCH = 128;
+
+// the slot size for each batched datagram, large enough for anything we send. Larger datagrams are dropped on read
+// and sent on their own on write.
+const int MAX_BATCHED_DATAGRAM_BYTES = 8192;
+
+/// Reads pending datagrams off a socket into a pool of preallocated buffers. On Linux a whole batch is read with a
+/// single recvmmsg call straight off the socket descriptor, elsewhere it falls back to one readDatagram per datagram.
+class DatagramBatchReader : public QObject {
+    Q_OBJECT
+public:
+    DatagramBatchReader(QUdpSocket& socket, QObject* parent = 0);
+    
+    /// reads as many pending datagrams as fit in a batch, returns how many were read (0 once none are pending).
+    /// The datagrams from a previous batch are overwritten.
+    int readBatch();
+    
+    const char* getDatagram(int index) const { return &_buffers[index * MAX_BATCHED_DATAGRAM_BYTES]; }
+    int getDatagramSize(int index) const { return _datagramSizes[index]; }
+    const HifiSockAddr& getSenderSockAddr(int index) const { return _senderSockAddrs[index]; }
+    
+signals:
+    /// emitted when the socket has datagrams for readBatch
+    void datagramsPending();
+    
+private:
+    QUdpSocket& _socket;
+    std::vector<char> _buffers;
+    std::vector<int> _datagramSizes;
+    std::vector<HifiSockAddr> _senderSockAddrs;
+    
+#ifdef __linux__
+    std::vector<mmsghdr> _messages;
+    std::vector<iovec> _iovecs;
+    std::vector<sockaddr_storage> _senderAddresses;
+#endif
+};
+
+#endif // hifi_DatagramBatchReader_h
@@ -0,0 +1,125 @@
+//
+//  DatagramBatchWriter.cpp
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <string.h>
+
+#ifndef WIN32
+#include <errno.h>
+#include <sys/socket.h>
+#endif
+
+#include <QtCore/QDebug>
+
+#include "DatagramBatchWriter.h"
+
+// fills in the address for sendmmsg or sendto and returns its length, IPv6 destinations get a sockaddr_in6
+static socklen_t toSockAddr(const HifiSockAddr& sockAddr, sockaddr_storage& destinationAddress) {
+    memset(&destinationAddress, 0, sizeof(sockaddr_storage));
+    if (sockAddr.getAddress().protocol() == QAbstractSocket::IPv6Protocol) {
+        sockaddr_in6& address = reinterpret_cast<sockaddr_in6&>(destinationAddress);
+        Q_IPV6ADDR ipv6Address = sockAddr.getAddress().toIPv6Address();
+        address.sin6_family = AF_INET6;
+        memcpy(&address.sin6_addr, &ipv6Address, sizeof(address.sin6_addr));
+        address.sin6_port = htons(sockAddr.getPort());
+        return sizeof(sockaddr_in6);
+    }
+    sockaddr_in& address = reinterpret_cast<sockaddr_in&>(destinationAddress);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(sockAddr.getAddress().toIPv4Address());
+    address.sin_port = htons(sockAddr.getPort());
+    return sizeof(sockaddr_in);
+}
+
+DatagramBatchWriter::DatagramBatchWriter() :
+    _buffers(MAX_DATAGRAMS_PER_BATCH * MAX_BATCHED_DATAGRAM_BYTES),
+    _datagramSizes(MAX_DATAGRAMS_PER_BATCH),
+    _destinationSockAddrs(MAX_DATAGRAMS_PER_BATCH),
+    _numDatagrams(0)
+{
+#ifdef __linux__
+    _messages.resize(MAX_DATAGRAMS_PER_BATCH);
+    _iovecs.resize(MAX_DATAGRAMS_PER_BATCH);
+    _destinationAddresses.resize(MAX_DATAGRAMS_PER_BATCH);
+#endif
+}
+
+char* DatagramBatchWriter::queueDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
+    char* slot = &_buffers[_numDatagrams * MAX_BATCHED_DATAGRAM_BYTES];
+    memcpy(slot, datagram.constData(), datagram.size());
+    _datagramSizes[_numDatagrams] = datagram.size();
+    _destinationSockAddrs[_numDatagrams] = destinationSockAddr;
+    ++_numDatagrams;
+    
+    return slot;
+}
+
+void DatagramBatchWriter::flush(QUdpSocket& socket) {
+#ifdef __linux__
+    for (int i = 0; i < _numDatagrams; i++) {
+        socklen_t addressLength = toSockAddr(_destinationSockAddrs[i], _destinationAddresses[i]);
+        
+        _iovecs[i].iov_base = &_buffers[i * MAX_BATCHED_DATAGRAM_BYTES];
+        _iovecs[i].iov_len = _datagramSizes[i];
+        
+        memset(&_messages[i], 0, sizeof(mmsghdr));
+        _messages[i].msg_hdr.msg_iov = &_iovecs[i];
+        _messages[i].msg_hdr.msg_iovlen = 1;
+        _messages[i].msg_hdr.msg_name = &_destinationAddresses[i];
+        _messages[i].msg_hdr.msg_namelen = addressLength;
+    }
+    
+    // sendmmsg can stop short of the whole batch, so keep going from wherever it got to
+    int numSent = 0;
+    while (numSent < _numDatagrams) {
+        int result = sendmmsg(socket.socketDescriptor(), &_messages[numSent], _numDatagrams - numSent, 0);
+        
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            
+            // skip the datagram that failed, same as a failed writeDatagram would
+            qDebug() << "ERROR in sendmmsg:" << strerror(errno);
+            ++numSent;
+        } else {
+            numSent += result;
+        }
+    }
+#else
+    for (int i = 0; i < _numDatagrams; i++) {
+        sendDatagram(socket, &_buffers[i * MAX_BATCHED_DATAGRAM_BYTES], _datagramSizes[i], _destinationSockAddrs[i]);
+    }
+#endif
+    
+    _numDatagrams = 0;
+}
+
+qint64 DatagramBatchWriter::sendDatagram(QUdpSocket& socket, const char* data, int size,
+                                         const HifiSockAddr& destinationSockAddr) {
+    sockaddr_storage destinationAddress;
+    socklen_t addressLength = toSockAddr(destinationSockAddr, destinationAddress);
+    
+    while (true) {
+        qint64 bytesSent = sendto(socket.socketDescriptor(), data, size, 0,
+                                  reinterpret_cast<const sockaddr*>(&destinationAddress), addressLength);
+        if (bytesSent >= 0) {
+            return bytesSent;
+        }
+#ifdef WIN32
+        qDebug() << "ERROR in sendto:" << WSAGetLastError();
+#else
+        if (errno == EINTR) {
+            continue;
+        }
+        qDebug() << "ERROR in sendto:" << strerror(errno);
+#endif
+        return -1;
+    }
+}
@@ -0,0 +1,62 @@
+//
+//  DatagramBatchWriter.h
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramBatchWriter_h
+#define hifi_DatagramBatchWriter_h
+
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+#include <QtNetwork/QUdpSocket>
+
+#include "DatagramBatchReader.h"
+#include "HifiSockAddr.h"
+
+/// Queues outbound datagrams in preallocated buffers and sends them together. On Linux a flush is a single sendmmsg
+/// call per full batch, elsewhere it falls back to one sendto per datagram. Either way the datagrams go straight to
+/// the socket's descriptor, so a batch may be flushed from a thread other than the socket's.
+class DatagramBatchWriter {
+public:
+    DatagramBatchWriter();
+    
+    bool isEmpty() const { return _numDatagrams == 0; }
+    bool isFull() const { return _numDatagrams == MAX_DATAGRAMS_PER_BATCH; }
+    
+    /// whether a datagram of this size fits in a slot at all, larger ones have to be sent on their own
+    static bool canQueue(int datagramSize) { return datagramSize <= MAX_BATCHED_DATAGRAM_BYTES; }
+    
+    /// copies the datagram into the next free slot and returns it, so the copy can still be changed before the
+    /// flush. The batch must not be full.
+    char* queueDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr);
+    
+    /// sends every queued datagram and empties the batch
+    void flush(QUdpSocket& socket);
+    
+    /// sends one datagram with sendto on the socket's descriptor, which unlike QUdpSocket::writeDatagram is safe from
+    /// any thread. Returns the bytes sent, or -1 after logging the error.
+    static qint64 sendDatagram(QUdpSocket& socket, const char* data, int size, const HifiSockAddr& destinationSockAddr);
+    
+private:
+    std::vector<char> _buffers;
+    std::vector<int> _datagramSizes;
+    std::vector<HifiSockAddr> _destinationSockAddrs;
+    int _numDatagrams;
+    
+#ifdef __linux__
+    std::vector<mmsghdr> _messages;
+    std::vector<iovec> _iovecs;
+    std::vector<sockaddr_storage> _destinationAddresses;
+#endif
+};
+
+#endif // hifi_DatagramBatchWriter_h
@@ -16,17 +16,18 @@
 #include <QtCore/QDataStream>
 #include <QtCore/QDebug>
 #include <QtCore/QJsonDocument>
+#include <QtCore/QThread>
 #include <QtCore/QUrl>
 #include <QtNetwork/QHostInfo>
 
 #include <LogHandler.h>
 
-#include <tbb/parallel_for.h>
-
 #include "AccountManager.h"
 #include "Assignment.h"
 #include "HifiSockAddr.h"
 #include "LimitedNodeList.h"
+#include "OutboundScheduler.h"
+#include "PacketAuthenticator.h"
 #include "PacketHeaders.h"
 #include "SharedUtil.h"
 #include "UUID.h"
@@ -40,9 +41,13 @@ const QUrl DEFAULT_NODE_AUTH_URL = QUrl("https://data.highfidelity.io");
 
 LimitedNodeList::LimitedNodeList(unsigned short socketListenPort, unsigned short dtlsListenPort) :
     _sessionUUID(),
-    _nodeHash(),
-    _nodeMutex(QReadWriteLock::Recursive),
+    _nodeSnapshot(new NodeSnapshot()),
+    _nodeWriteMutex(),
+    _freeNodeIndices(),
     _nodeSocket(this),
+    _batchingThread(NULL),
+    _datagramBatch(),
+    _outboundScheduler(NULL),
     _dtlsSocket(NULL),
     _localSockAddr(),
     _publicSockAddr(),
@@ -156,9 +161,9 @@ void LimitedNodeList::changeSocketBufferSizes(int numBytes) {
 
 bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
     PacketType checkType = packetTypeForPacket(packet);
-    int numPacketTypeBytes = numBytesArithmeticCodingFromBuffer(packet.data());
+    PacketVersion packetVersion = versionFromPacketHeader(packet.constData());
     
-    if (packet[numPacketTypeBytes] != versionForPacketType(checkType)
+    if (packetVersion != versionForPacketType(checkType)
         && checkType != PacketTypeStunResponse) {
         PacketType mismatchType = packetTypeForPacket(packet);
         
@@ -167,7 +172,7 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         QUuid senderUUID = uuidFromPacketHeader(packet);
         if (!versionDebugSuppressMap.contains(senderUUID, checkType)) {
             qDebug() << "Packet version mismatch on" << packetTypeForPacket(packet) << "- Sender"
-            << uuidFromPacketHeader(packet) << "sent" << qPrintable(QString::number(packet[numPacketTypeBytes])) << "but"
+            << uuidFromPacketHeader(packet) << "sent" << qPrintable(QString::number(packetVersion)) << "but"
             << qPrintable(QString::number(versionForPacketType(mismatchType))) << "expected.";
             
             versionDebugSuppressMap.insert(senderUUID, checkType);
@@ -180,8 +185,11 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         // figure out which node this is from
         SharedNodePointer sendingNode = sendingNodeForPacket(packet);
         if (sendingNode) {
-            // check if the md5 hash in the header matches the hash we would expect
-            if (hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, sendingNode->getConnectionSecret())) {
+            // check if the tag in the header matches the one we would expect
+            if (PacketAuthenticator::isPacketAuthentic(packet.constData(), packet.size(),
+                                                       sendingNode->getAuthenticationKey())) {
+                // only an authentic packet gets to change how we authenticate what we send back
+                sendingNode->setAcceptsSipHash(PacketAuthenticator::senderAcceptsSipHash(packet.constData()));
                 return true;
             } else {
                 static QMultiMap<QUuid, PacketType> hashDebugSuppressMap;
@@ -208,19 +216,38 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
     return false;
 }
 
-qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
-                                      const QUuid& connectionSecret) {
-    QByteArray datagramCopy = datagram;
-    
-    if (!connectionSecret.isNull()) {
-        // setup the MD5 hash for source verification in the header
-        replaceHashInPacketGivenConnectionUUID(datagramCopy, connectionSecret);
+static void authenticateDatagram(char* datagram, int size, const SharedNodePointer& authenticatingNode) {
+    if (authenticatingNode && !authenticatingNode->getAuthenticationKey().isNull()) {
+        // write the tag for source verification into the header, in place
+        PacketAuthenticator::authenticatePacket(datagram, size, authenticatingNode->getAuthenticationKey(),
+                                                authenticatingNode->getAuthenticationMode());
     }
-    
+}
+
+qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
+                                      const SharedNodePointer& authenticatingNode) {
     // stat collection for packets
     ++_numCollectedPackets;
     _numCollectedBytes += datagram.size();
     
+    if (_batchingThread.load() == QThread::currentThread() && DatagramBatchWriter::canQueue(datagram.size())) {
+        if (_datagramBatch->isFull()) {
+            _datagramBatch->flush(_nodeSocket);
+        }
+        
+        // the batch's copy is the one that gets authenticated, so the datagram itself is never detached
+        char* queuedDatagram = _datagramBatch->queueDatagram(datagram, destinationSockAddr);
+        authenticateDatagram(queuedDatagram, datagram.size(), authenticatingNode);
+        
+        return datagram.size();
+    }
+    
+    QByteArray datagramCopy = datagram;
+    
+    if (authenticatingNode) {
+        authenticateDatagram(datagramCopy.data(), datagramCopy.size(), authenticatingNode);
+    }
+    
     qint64 bytesWritten = _nodeSocket.writeDatagram(datagramCopy,
                                                     destinationSockAddr.getAddress(), destinationSockAddr.getPort());
     
@@ -231,6 +258,64 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSock
     return bytesWritten;
 }
 
+bool LimitedNodeList::beginDatagramBatch() {
+    if (!_batchingThread.testAndSetOrdered(NULL, QThread::currentThread())) {
+        return _batchingThread.load() == QThread::currentThread();
+    }
+    
+    if (!_datagramBatch) {
+        _datagramBatch.reset(new DatagramBatchWriter());
+    }
+    
+    return true;
+}
+
+void LimitedNodeList::endDatagramBatch() {
+    if (_batchingThread.load() == QThread::currentThread()) {
+        _datagramBatch->flush(_nodeSocket);
+        _batchingThread.storeRelease(NULL);
+    }
+}
+
+void LimitedNodeList::startOutboundScheduler(int bytesPerNodePerSecond) {
+    OutboundScheduler* outboundScheduler = _outboundScheduler.load();
+    if (!outboundScheduler) {
+        outboundScheduler = new OutboundScheduler(*this);
+        outboundScheduler->setDefaultBytesPerSecond(bytesPerNodePerSecond);
+        outboundScheduler->initialize(true);
+        _outboundScheduler.storeRelease(outboundScheduler);
+        
+        qDebug() << "Scheduling outbound datagrams, paced at" << bytesPerNodePerSecond << "bytes per second per node";
+    } else {
+        outboundScheduler->setDefaultBytesPerSecond(bytesPerNodePerSecond);
+    }
+}
+
+void LimitedNodeList::stopOutboundScheduler() {
+    OutboundScheduler* outboundScheduler = _outboundScheduler.fetchAndStoreOrdered(NULL);
+    if (outboundScheduler) {
+        // its thread is done once terminate returns, nothing is left to run a deleteLater
+        outboundScheduler->terminate();
+        delete outboundScheduler;
+    }
+}
+
+qint64 LimitedNodeList::scheduleDatagram(OutboundScheduler& outboundScheduler, const QByteArray& datagram,
+                                         const HifiSockAddr& destinationSockAddr,
+                                         const SharedNodePointer& destinationNode,
+                                         const SharedNodePointer& authenticatingNode) {
+    ++_numCollectedPackets;
+    _numCollectedBytes += datagram.size();
+    
+    QByteArray datagramCopy = datagram;
+    if (authenticatingNode) {
+        authenticateDatagram(datagramCopy.data(), datagramCopy.size(), authenticatingNode);
+    }
+    
+    outboundScheduler.queueDatagram(destinationNode, destinationSockAddr, datagramCopy);
+    return datagram.size();
+}
+
 qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
                                const HifiSockAddr& overridenSockAddr) {
     if (destinationNode) {
@@ -246,7 +331,13 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const SharedNo
             }
         }
         
-        return writeDatagram(datagram, *destinationSockAddr, destinationNode->getConnectionSecret());
+        OutboundScheduler* outboundScheduler = _outboundScheduler.load();
+        if (outboundScheduler && destinationNode->getIndex() >= 0) {
+            return scheduleDatagram(*outboundScheduler, datagram, *destinationSockAddr, destinationNode,
+                                    destinationNode);
+        }
+        
+        return writeDatagram(datagram, *destinationSockAddr, destinationNode);
     }
     
     // didn't have a destinationNode to send to, return 0
@@ -269,7 +360,13 @@ qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, cons
         }
         
         // don't use the node secret!
-        return writeDatagram(datagram, *destinationSockAddr, QUuid());
+        OutboundScheduler* outboundScheduler = _outboundScheduler.load();
+        if (outboundScheduler && destinationNode->getIndex() >= 0) {
+            return scheduleDatagram(*outboundScheduler, datagram, *destinationSockAddr, destinationNode,
+                                    SharedNodePointer());
+        }
+        
+        return writeDatagram(datagram, *destinationSockAddr, SharedNodePointer());
     }
     
     // didn't have a destinationNode to send to, return 0
@@ -277,7 +374,7 @@ qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, cons
 }
 
 qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
-    return writeDatagram(datagram, destinationSockAddr, QUuid());
+    return writeDatagram(datagram, destinationSockAddr, SharedNodePointer());
 }
 
 qint64 LimitedNodeList::writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
@@ -326,11 +423,17 @@ int LimitedNodeList::findNodeAndUpdateWithDataFromPacket(const QByteArray& packe
 }
 
 SharedNodePointer LimitedNodeList::nodeWithUUID(const QUuid& nodeUUID) {
-    QReadLocker readLocker(&_nodeMutex);
+    NodeSnapshotPointer snapshot = getNodeSnapshot();
     
-    NodeHash::const_iterator it = _nodeHash.find(nodeUUID);
-    return it == _nodeHash.cend() ? SharedNodePointer() : it->second;
- }
+    NodeHash::const_iterator it = snapshot->nodesByUUID.find(nodeUUID);
+    return it == snapshot->nodesByUUID.cend() ? SharedNodePointer() : it->second;
+}
+
+SharedNodePointer LimitedNodeList::nodeWithIndex(int index) {
+    NodeSnapshotPointer snapshot = getNodeSnapshot();
+    
+    return (index >= 0 && index < snapshot->nodesByIndex.size()) ? snapshot->nodesByIndex[index] : SharedNodePointer();
+}
 
 SharedNodePointer LimitedNodeList::sendingNodeForPacket(const QByteArray& packet) {
     QUuid nodeUUID = uuidFromPacketHeader(packet);
@@ -342,17 +445,19 @@ SharedNodePointer LimitedNodeList::sendingNodeForPacket(const QByteArray& packet
 void LimitedNodeList::eraseAllNodes() {
     qDebug() << "Clearing the NodeList. Deleting all nodes in list.";
     
-    QSet<SharedNodePointer> killedNodes;
-    eachNode([&killedNodes](const SharedNodePointer& node){
-        killedNodes.insert(node);
-    });
+    _nodeWriteMutex.lock();
+    NodeSnapshotPointer killedSnapshot = getNodeSnapshot();
     
-    // iterate the current nodes, emit that they are dying and remove them from the hash
-    _nodeMutex.lockForWrite();
-    _nodeHash.clear();
-    _nodeMutex.unlock();
+    // with every node gone all the indices are free again
+    std::atomic_store(&_nodeSnapshot, NodeSnapshotPointer(new NodeSnapshot()));
+    _freeNodeIndices = std::priority_queue<int, std::vector<int>, std::greater<int> >();
+    foreach(const SharedNodePointer& killedNode, killedSnapshot->nodes) {
+        killedNode->setIndex(-1);
+    }
+    _nodeWriteMutex.unlock();
     
-    foreach(const SharedNodePointer& killedNode, killedNodes) {
+    // emit that the nodes of the last snapshot are dying
+    foreach(const SharedNodePointer& killedNode, killedSnapshot->nodes) {
         handleNodeKill(killedNode);
     }
 }
@@ -362,20 +467,22 @@ void LimitedNodeList::reset() {
 }
 
 void LimitedNodeList::killNodeWithUUID(const QUuid& nodeUUID) {
-    _nodeMutex.lockForRead();
+    _nodeWriteMutex.lock();
     
-    NodeHash::iterator it = _nodeHash.find(nodeUUID);
-    if (it != _nodeHash.end()) {
+    NodeSnapshotPointer snapshot = getNodeSnapshot();
+    NodeHash::const_iterator it = snapshot->nodesByUUID.find(nodeUUID);
+    if (it != snapshot->nodesByUUID.cend()) {
         SharedNodePointer matchingNode = it->second;
         
-        _nodeMutex.unlock();
+        QSet<SharedNodePointer> killedNodes;
+        killedNodes.insert(matchingNode);
+        removeNodesFromSnapshot(killedNodes);
         
-        QWriteLocker writeLocker(&_nodeMutex);
-        _nodeHash.unsafe_erase(it);
+        _nodeWriteMutex.unlock();
         
         handleNodeKill(matchingNode);
     } else {
-        _nodeMutex.unlock();
+        _nodeWriteMutex.unlock();
     }
 }
 
@@ -389,31 +496,87 @@ void LimitedNodeList::processKillNode(const QByteArray& dataByteArray) {
 
 void LimitedNodeList::handleNodeKill(const SharedNodePointer& node) {
     qDebug() << "Killed" << *node;
+    
+    OutboundScheduler* outboundScheduler = _outboundScheduler.load();
+    if (outboundScheduler) {
+        outboundScheduler->forgetNode(node);
+    }
     emit nodeKilled(node);
 }
 
+void LimitedNodeList::removeNodesFromSnapshot(const QSet<SharedNodePointer>& removedNodes) {
+    NodeSnapshotPointer currentSnapshot = getNodeSnapshot();
+    NodeSnapshot* newSnapshot = new NodeSnapshot();
+    
+    newSnapshot->nodes.reserve(currentSnapshot->nodes.size());
+    foreach(const SharedNodePointer& node, currentSnapshot->nodes) {
+        if (!removedNodes.contains(node)) {
+            newSnapshot->nodes.append(node);
+        }
+    }
+    newSnapshot->nodesByIndex = currentSnapshot->nodesByIndex;
+    newSnapshot->nodesByUUID = currentSnapshot->nodesByUUID;
+    
+    foreach(const SharedNodePointer& node, removedNodes) {
+        newSnapshot->nodesByIndex[node->getIndex()].clear();
+        newSnapshot->nodesByUUID.erase(node->getUUID());
+        _freeNodeIndices.push(node->getIndex());
+    }
+    
+    std::atomic_store(&_nodeSnapshot, NodeSnapshotPointer(newSnapshot));
+    
+    // the indices may go to the next nodes added, the killed ones must not keep using them
+    foreach(const SharedNodePointer& node, removedNodes) {
+        node->setIndex(-1);
+    }
+}
+
 SharedNodePointer LimitedNodeList::addOrUpdateNode(const QUuid& uuid, NodeType_t nodeType,
                                                    const HifiSockAddr& publicSocket, const HifiSockAddr& localSocket) {
-    try {
-        SharedNodePointer matchingNode = _nodeHash.at(uuid);
-        
-        matchingNode->setPublicSocket(publicSocket);
-        matchingNode->setLocalSocket(localSocket);
-        
-        return matchingNode;
-    } catch (std::out_of_range) {
-        // we didn't have this node, so add them
-        Node* newNode = new Node(uuid, nodeType, publicSocket, localSocket);
-        SharedNodePointer newNodeSharedPointer(newNode, &QObject::deleteLater);
-        
-        _nodeHash.insert(UUIDNodePair(newNode->getUUID(), newNodeSharedPointer));
+    SharedNodePointer matchingNode = nodeWithUUID(uuid);
+    if (!matchingNode) {
+        QMutexLocker writeLocker(&_nodeWriteMutex);
         
-        qDebug() << "Added" << *newNode;
-        
-        emit nodeAdded(newNodeSharedPointer);
-        
-        return newNodeSharedPointer;
+        // look again now that we're the only writer, another thread may have just added this node
+        NodeSnapshotPointer currentSnapshot = getNodeSnapshot();
+        NodeHash::const_iterator it = currentSnapshot->nodesByUUID.find(uuid);
+        if (it == currentSnapshot->nodesByUUID.cend()) {
+            // we didn't have this node, so add them at the lowest free index
+            Node* newNode = new Node(uuid, nodeType, publicSocket, localSocket);
+            SharedNodePointer newNodeSharedPointer(newNode, &QObject::deleteLater);
+            
+            if (_freeNodeIndices.empty()) {
+                newNode->setIndex(currentSnapshot->nodesByIndex.size());
+            } else {
+                newNode->setIndex(_freeNodeIndices.top());
+                _freeNodeIndices.pop();
+            }
+            
+            NodeSnapshot* newSnapshot = new NodeSnapshot(*currentSnapshot);
+            newSnapshot->nodes.append(newNodeSharedPointer);
+            if (newNode->getIndex() == newSnapshot->nodesByIndex.size()) {
+                newSnapshot->nodesByIndex.append(newNodeSharedPointer);
+            } else {
+                newSnapshot->nodesByIndex[newNode->getIndex()] = newNodeSharedPointer;
+            }
+            newSnapshot->nodesByUUID.insert(UUIDNodePair(newNode->getUUID(), newNodeSharedPointer));
+            
+            std::atomic_store(&_nodeSnapshot, NodeSnapshotPointer(newSnapshot));
+            writeLocker.unlock();
+            
+            qDebug() << "Added" << *newNode;
+            
+            emit nodeAdded(newNodeSharedPointer);
+            
+            return newNodeSharedPointer;
+        }
+        matchingNode = it->second;
     }
+    
+    matchingNode->setPublicSocket(publicSocket);
+    matchingNode->setLocalSocket(localSocket);
+    
+    return matchingNode;
 }
 
 unsigned LimitedNodeList::broadcastToNodes(const QByteArray& packet, const NodeSet& destinationNodeTypes) {
@@ -482,23 +645,25 @@ void LimitedNodeList::resetPacketStats() {
 void LimitedNodeList::removeSilentNodes() {
     QSet<SharedNodePointer> killedNodes;
     
-    eachNodeHashIterator([&](NodeHash::iterator& it){
-        SharedNodePointer node = it->second;
+    // only the other writers wait on this, the readers keep iterating the snapshot they have
+    _nodeWriteMutex.lock();
+    
+    eachNode([&](const SharedNodePointer& node){
         node->getMutex().lock();
         
         if ((usecTimestampNow() - node->getLastHeardMicrostamp()) > (NODE_SILENCE_THRESHOLD_MSECS * USECS_PER_MSEC)) {
-            // call the NodeHash erase to get rid of this node
-            it = _nodeHash.unsafe_erase(it);
-            
             killedNodes.insert(node);
-        } else {
-            // we didn't erase this node, push the iterator forwards
-            ++it;
         }
         
         node->getMutex().unlock();
     });
     
+    if (!killedNodes.isEmpty()) {
+        removeNodesFromSnapshot(killedNodes);
+    }
+    
+    _nodeWriteMutex.unlock();
+    
     foreach(const SharedNodePointer& killedNode, killedNodes) {
         handleNodeKill(killedNode);
     }
@@ -13,24 +13,30 @@
 #define hifi_LimitedNodeList_h
 
 #include <stdint.h>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
 
 #ifndef _WIN32
 #include <unistd.h> // not on windows, not needed for mac or windows
 #endif
 
+#include <qatomic.h>
 #include <qelapsedtimer.h>
+#include <qmutex.h>
 #include <qreadwritelock.h>
 #include <qset.h>
 #include <qsharedpointer.h>
+#include <qvector.h>
 #include <QtNetwork/qudpsocket.h>
 #include <QtNetwork/qhostaddress.h>
 
-#include <tbb/concurrent_unordered_map.h>
-
 #include <DependencyManager.h>
 
+#include "DatagramBatchWriter.h"
 #include "DomainHandler.h"
 #include "Node.h"
 #include "UUIDHasher.h"
@@ -51,15 +57,32 @@ const unsigned short STUN_SERVER_PORT = 3478;
 const QString DOMAIN_SERVER_LOCAL_PORT_SMEM_KEY = "domain-server.local-port";
 
 class HifiSockAddr;
+class OutboundScheduler;
+class QThread;
 
 typedef QSet<NodeType_t> NodeSet;
 
 typedef QSharedPointer<Node> SharedNodePointer;
 Q_DECLARE_METATYPE(SharedNodePointer)
 
-using namespace tbb;
 typedef std::pair<QUuid, SharedNodePointer> UUIDNodePair;
-typedef concurrent_unordered_map<QUuid, SharedNodePointer, UUIDHasher> NodeHash;
+typedef std::unordered_map<QUuid, SharedNodePointer, UUIDHasher> NodeHash;
+
+/// The node list as of one change to it. Snapshots are never modified once published: a change copies the current
+/// snapshot and publishes the copy, so a reader iterates the snapshot it loaded without a lock and it, and the nodes
+/// in it, stay alive for as long as the reader holds it.
+class NodeSnapshot {
+public:
+    /// every node, densely packed for iteration
+    QVector<SharedNodePointer> nodes;
+    
+    /// the nodes at their Node::getIndex(), null where an index is free
+    QVector<SharedNodePointer> nodesByIndex;
+    
+    NodeHash nodesByUUID;
+};
+
+typedef std::shared_ptr<const NodeSnapshot> NodeSnapshotPointer;
 
 typedef quint8 PingType_t;
 namespace PingType {
@@ -95,12 +118,34 @@ public:
 
     qint64 writeUnverifiedDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
                          const HifiSockAddr& overridenSockAddr = HifiSockAddr());
+    
+    /// queues the datagrams written from the calling thread until endDatagramBatch, which sends them in as few system
+    /// calls as the platform allows. Only one thread batches at a time, returns false if another already is.
+    bool beginDatagramBatch();
+    void endDatagramBatch();
+    
+    /// from now on the datagrams written to nodes are queued and sent by the scheduler's thread, in priority order and
+    /// paced at this rate per node, 0 for no pacing. The ones written to plain addresses still go out right away.
+    void startOutboundScheduler(int bytesPerNodePerSecond);
+    
+    /// goes back to writing straight to the socket, whatever is still queued is dropped. The scheduler is deleted
+    /// before this returns, so it may only be called once every other thread that writes to nodes has stopped.
+    void stopOutboundScheduler();
+    
+    /// null unless startOutboundScheduler was called
+    OutboundScheduler* getOutboundScheduler() const { return _outboundScheduler.load(); }
 
     void(*linkedDataCreateCallback)(Node *);
     
-    int size() const { return _nodeHash.size(); }
+    int size() const { return getNodeSnapshot()->nodes.size(); }
+    
+    /// the current nodes, the snapshot is never modified so it can be read without a lock
+    NodeSnapshotPointer getNodeSnapshot() const { return std::atomic_load(&_nodeSnapshot); }
 
     SharedNodePointer nodeWithUUID(const QUuid& nodeUUID);
+    
+    /// the node with this Node::getIndex(), or null if no current node has it
+    SharedNodePointer nodeWithIndex(int index);
     SharedNodePointer sendingNodeForPacket(const QByteArray& packet);
     
     SharedNodePointer addOrUpdateNode(const QUuid& uuid, NodeType_t nodeType,
@@ -133,19 +178,19 @@ public:
     
     template<typename NodeLambda>
     void eachNode(NodeLambda functor) {
-        QReadLocker readLock(&_nodeMutex);
+        NodeSnapshotPointer snapshot = getNodeSnapshot();
         
-        for (NodeHash::const_iterator it = _nodeHash.cbegin(); it != _nodeHash.cend(); ++it) {
-            functor(it->second);
+        for (int i = 0; i < snapshot->nodes.size(); i++) {
+            functor(snapshot->nodes[i]);
         }
     }
     
     template<typename BreakableNodeLambda>
     void eachNodeBreakable(BreakableNodeLambda functor) {
-        QReadLocker readLock(&_nodeMutex);
+        NodeSnapshotPointer snapshot = getNodeSnapshot();
         
-        for (NodeHash::const_iterator it = _nodeHash.cbegin(); it != _nodeHash.cend(); ++it) {
-            if (!functor(it->second)) {
+        for (int i = 0; i < snapshot->nodes.size(); i++) {
+            if (!functor(snapshot->nodes[i])) {
                 break;
             }
         }
@@ -153,11 +198,11 @@ public:
     
     template<typename PredLambda>
     SharedNodePointer nodeMatchingPredicate(const PredLambda predicate) {
-        QReadLocker readLock(&_nodeMutex);
+        NodeSnapshotPointer snapshot = getNodeSnapshot();
         
-        for (NodeHash::const_iterator it = _nodeHash.cbegin(); it != _nodeHash.cend(); ++it) {
-            if (predicate(it->second)) {
-                return it->second;
+        for (int i = 0; i < snapshot->nodes.size(); i++) {
+            if (predicate(snapshot->nodes[i])) {
+                return snapshot->nodes[i];
             }
         }
         
@@ -187,16 +232,28 @@ protected:
     void operator=(LimitedNodeList const&); // Don't implement, needed to avoid copies of singleton
     
     qint64 writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
-                         const QUuid& connectionSecret);
+                         const SharedNodePointer& authenticatingNode);
+    
+    /// hands a datagram for a node to the outbound scheduler, authenticating it first if the node is given
+    qint64 scheduleDatagram(OutboundScheduler& outboundScheduler, const QByteArray& datagram,
+                            const HifiSockAddr& destinationSockAddr, const SharedNodePointer& destinationNode,
+                            const SharedNodePointer& authenticatingNode);
     
     void changeSocketBufferSizes(int numBytes);
     
     void handleNodeKill(const SharedNodePointer& node);
+    
+    /// publishes a copy of the current snapshot without these nodes and frees their indices, needs _nodeWriteMutex
+    void removeNodesFromSnapshot(const QSet<SharedNodePointer>& removedNodes);
 
     QUuid _sessionUUID;
-    NodeHash _nodeHash;
-    QReadWriteLock _nodeMutex;
+    NodeSnapshotPointer _nodeSnapshot;
+    QMutex _nodeWriteMutex; // serializes the changes to the node list, readers never take it
+    std::priority_queue<int, std::vector<int>, std::greater<int> > _freeNodeIndices;
     QUdpSocket _nodeSocket;
+    QAtomicPointer<QThread> _batchingThread;
+    std::unique_ptr<DatagramBatchWriter> _datagramBatch;
+    QAtomicPointer<OutboundScheduler> _outboundScheduler;
     QUdpSocket* _dtlsSocket;
     HifiSockAddr _localSockAddr;
     HifiSockAddr _publicSockAddr;
@@ -204,17 +261,6 @@ protected:
     int _numCollectedPackets;
     int _numCollectedBytes;
     QElapsedTimer _packetStatTimer;
-    
-    template<typename IteratorLambda>
-    void eachNodeHashIterator(IteratorLambda functor) {
-        QWriteLocker writeLock(&_nodeMutex);
-        NodeHash::iterator it = _nodeHash.begin();
-        
-        while (it != _nodeHash.end()) {
-            functor(it);
-        }
-    }
-    
 };
 
 #endif // hifi_LimitedNodeList_h
@@ -44,9 +44,12 @@ const QString& NodeType::getNodeTypeName(NodeType_t nodeType) {
 Node::Node(const QUuid& uuid, NodeType_t type, const HifiSockAddr& publicSocket, const HifiSockAddr& localSocket) :
 	NetworkPeer(uuid, publicSocket, localSocket),
     _type(type),
+    _index(-1),
     _activeSocket(NULL),
     _symmetricSocket(),
     _connectionSecret(),
+    _authenticationKey(),
+    _acceptsSipHash(false),
     _bytesReceivedMovingAverage(NULL),
     _linkedData(NULL),
     _isAlive(true),
@@ -63,6 +66,21 @@ Node::~Node() {
     delete _bytesReceivedMovingAverage;
 }
 
+void Node::setConnectionSecret(const QUuid& connectionSecret) {
+    if (connectionSecret != _connectionSecret) {
+        _connectionSecret = connectionSecret;
+        _authenticationKey = PacketAuthenticationKey(connectionSecret);
+        
+        // a new connection has to tell us again what it accepts
+        _acceptsSipHash = false;
+    }
+}
+
+PacketAuthenticator::Mode Node::getAuthenticationMode() const {
+    return (_acceptsSipHash && PacketAuthenticator::getPreferredMode() == PacketAuthenticator::SipHash)
+        ? PacketAuthenticator::SipHash : PacketAuthenticator::MD5Hash;
+}
+
 void Node::recordBytesReceived(int bytesReceived) {
     if (!_bytesReceivedMovingAverage) {
         _bytesReceivedMovingAverage = new SimpleMovingAverage(100);
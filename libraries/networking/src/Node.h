@@ -12,6 +12,7 @@
 #ifndef hifi_Node_h
 #define hifi_Node_h
 
+#include <atomic>
 #include <ostream>
 #include <stdint.h>
 
@@ -23,6 +24,7 @@
 #include "HifiSockAddr.h"
 #include "NetworkPeer.h"
 #include "NodeData.h"
+#include "PacketAuthenticator.h"
 #include "SimpleMovingAverage.h"
 #include "MovingPercentile.h"
 
@@ -54,8 +56,20 @@ public:
     char getType() const { return _type; }
     void setType(char type) { _type = type; }
     
+    /// small and unique among the current nodes, for keeping per-node state in arrays instead of hashing UUIDs.
+    /// The index of a killed node goes to the next node added, so state kept by index must check whose it is.
+    /// -1 once the node has been killed.
+    int getIndex() const { return _index; }
+    void setIndex(int index) { _index = index; }
+    
     const QUuid& getConnectionSecret() const { return _connectionSecret; }
-    void setConnectionSecret(const QUuid& connectionSecret) { _connectionSecret = connectionSecret; }
+    void setConnectionSecret(const QUuid& connectionSecret);
+    
+    const PacketAuthenticationKey& getAuthenticationKey() const { return _authenticationKey; }
+    
+    /// the mode packets to this node are authenticated with, SipHash once the node has said it accepts it
+    PacketAuthenticator::Mode getAuthenticationMode() const;
+    void setAcceptsSipHash(bool acceptsSipHash) { _acceptsSipHash = acceptsSipHash; }
 
     NodeData* getLinkedData() const { return _linkedData; }
     void setLinkedData(NodeData* linkedData) { _linkedData = linkedData; }
@@ -94,11 +108,14 @@ private:
     Node& operator=(Node otherNode);
 
     NodeType_t _type;
+    std::atomic<int> _index;
     
     HifiSockAddr* _activeSocket;
     HifiSockAddr _symmetricSocket;
     
     QUuid _connectionSecret;
+    PacketAuthenticationKey _authenticationKey;
+    std::atomic<bool> _acceptsSipHash; // set on the datagram-processing thread, read by the send paths
     SimpleMovingAverage* _bytesReceivedMovingAverage;
     NodeData* _linkedData;
     bool _isAlive;
@@ -34,7 +34,11 @@ NodeList::NodeList(char newOwnerType, unsigned short socketListenPort, unsigned
     _numNoReplyDomainCheckIns(0),
     _assignmentServerSocket(),
     _hasCompletedInitialSTUNFailure(false),
-    _stunRequestsSinceSuccess(0)
+    _stunRequestsSinceSuccess(0),
+    _domainListVersion(0),
+    _pendingDomainListVersion(0),
+    _pendingDomainListIsFull(false),
+    _numPendingDomainListPackets(0)
 {
     static bool firstCall = true;
     if (firstCall) {
@@ -192,6 +196,10 @@ void NodeList::reset() {
     LimitedNodeList::reset();
     
     _numNoReplyDomainCheckIns = 0;
+    
+    // the next domain list we get is a full one
+    _domainListVersion = 0;
+    _numPendingDomainListPackets = 0;
 
     // refresh the owner UUID to the NULL UUID
     setSessionUUID(QUuid());
@@ -209,10 +217,14 @@ void NodeList::reset() {
 
 void NodeList::addNodeTypeToInterestSet(NodeType_t nodeTypeToAdd) {
     _nodeTypesOfInterest << nodeTypeToAdd;
+    
+    // changes we've seen didn't include nodes of the new type, ask for the full list
+    _domainListVersion = 0;
 }
 
 void NodeList::addSetOfNodeTypesToNodeInterestSet(const NodeSet& setOfNodeTypes) {
     _nodeTypesOfInterest.unite(setOfNodeTypes);
+    _domainListVersion = 0;
 }
 
 
@@ -297,6 +309,11 @@ void NodeList::sendDomainServerCheckIn() {
         // pack our data to send to the domain-server
         packetStream << _ownerType << _publicSockAddr << _localSockAddr << _nodeTypesOfInterest.toList();
         
+        // once connected, tell the domain-server which version of the list we have so it only sends what changed
+        if (domainPacketType == PacketTypeDomainListRequest) {
+            packetStream << _domainListVersion;
+        }
+        
         
         // if this is a connect request, and we can present a username signature, send it along
         if (!_domainHandler.isConnected()) {
@@ -312,7 +329,7 @@ void NodeList::sendDomainServerCheckIn() {
         }
         
         if (!isUsingDTLS) {
-            writeDatagram(domainServerPacket, _domainHandler.getSockAddr(), QUuid());
+            writeDatagram(domainServerPacket, _domainHandler.getSockAddr(), SharedNodePointer());
         }
         
         const int NUM_DOMAIN_SERVER_CHECKINS_PER_STUN_REQUEST = 5;
@@ -386,9 +403,23 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
     packetStream >> newUUID;
     setSessionUUID(newUUID);
     
+    // then the version of the list this is part of, and which of its packets this is
+    quint32 listVersion;
+    bool isFullList;
+    quint16 packetNumber, numPackets;
+    packetStream >> listVersion >> isFullList >> packetNumber >> numPackets;
+    
     // pull each node in the packet
     while(packetStream.device()->pos() < packet.size()) {
-        packetStream >> nodeType >> nodeUUID >> nodePublicSocket >> nodeLocalSocket;
+        packetStream >> nodeType >> nodeUUID;
+        
+        // nodes removed since the version we had come with the unassigned type
+        if (nodeType == NodeType::Unassigned) {
+            killNodeWithUUID(nodeUUID);
+            continue;
+        }
+        
+        packetStream >> nodePublicSocket >> nodeLocalSocket;
 
         // if the public socket address is 0 then it's reachable at the same IP
         // as the domain server
@@ -402,6 +433,17 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
         node->setConnectionSecret(connectionUUID);
     }
     
+    // we only have a version of the list once every packet of it is in, until then we keep asking from the last one
+    if (listVersion != _pendingDomainListVersion || isFullList != _pendingDomainListIsFull) {
+        _pendingDomainListVersion = listVersion;
+        _pendingDomainListIsFull = isFullList;
+        _numPendingDomainListPackets = 0;
+    }
+    if (++_numPendingDomainListPackets >= numPackets) {
+        _domainListVersion = listVersion;
+        _numPendingDomainListPackets = 0;
+    }
+    
     // ping inactive nodes in conjunction with receipt of list from domain-server
     // this makes it happen every second and also pings any newly added nodes
     pingInactiveNodes();
@@ -56,6 +56,9 @@ public:
     void addNodeTypeToInterestSet(NodeType_t nodeTypeToAdd);
     void addSetOfNodeTypesToNodeInterestSet(const NodeSet& setOfNodeTypes);
     void resetNodeInterestSet() { _nodeTypesOfInterest.clear(); }
+    
+    /// the version of the domain list we have all of, the domain-server sends what changed since with each check in
+    quint32 getDomainListVersion() const { return _domainListVersion; }
 
     void processNodeData(const HifiSockAddr& senderSockAddr, const QByteArray& packet);
     
@@ -94,6 +97,10 @@ private:
     HifiSockAddr _assignmentServerSocket;
     bool _hasCompletedInitialSTUNFailure;
     unsigned int _stunRequestsSinceSuccess;
+    quint32 _domainListVersion;
+    quint32 _pendingDomainListVersion;
+    bool _pendingDomainListIsFull;
+    quint16 _numPendingDomainListPackets;
 };
 
 #endif // hifi_NodeList_h
@@ -0,0 +1,306 @@
+//
+//  OutboundScheduler.cpp
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <SharedUtil.h>
+
+#include "LimitedNodeList.h"
+#include "OutboundScheduler.h"
+
+// the most each class queues for a node before dropping its oldest, audio keeps about a tenth of a second
+const int MAX_QUEUED_BYTES[NUM_TRAFFIC_CLASSES] = {
+    64 * 1024,      // control
+    16 * 1024,      // audio
+    64 * 1024,      // avatar
+    1024 * 1024,    // entity
+    64 * 1024       // stats
+};
+
+// a bucket holds this much of its rate, enough for a frame's burst without letting a node that went quiet
+// come back with a flood
+const quint64 BUCKET_DEPTH_USECS = 20 * USECS_PER_MSEC;
+const int MIN_BUCKET_DEPTH_BYTES = 2 * MAX_PACKET_SIZE;
+
+TrafficClass trafficClassForPacketType(PacketType type) {
+    switch (type) {
+        case PacketTypeStunResponse:
+        case PacketTypeDomainList:
+        case PacketTypeDomainListRequest:
+        case PacketTypeDomainConnectRequest:
+        case PacketTypeDomainConnectionDenied:
+        case PacketTypeDomainServerRequireDTLS:
+        case PacketTypeRequestAssignment:
+        case PacketTypeCreateAssignment:
+        case PacketTypeDataServerConfirm:
+        case PacketTypePing:
+        case PacketTypePingReply:
+        case PacketTypeUnverifiedPing:
+        case PacketTypeUnverifiedPingReply:
+        case PacketTypeKillAvatar:
+        case PacketTypeIceServerHeartbeat:
+        case PacketTypeIceServerHeartbeatResponse:
+            return TrafficClassControl;
+        case PacketTypeInjectAudio:
+        case PacketTypeMixedAudio:
+        case PacketTypeMicrophoneAudioNoEcho:
+        case PacketTypeMicrophoneAudioWithEcho:
+        case PacketTypeSilentAudioFrame:
+        case PacketTypeMuteEnvironment:
+        case PacketTypeNoisyMute:
+        case PacketTypeAudioEnvironment:
+            return TrafficClassAudio;
+        case PacketTypeAvatarData:
+        case PacketTypeBulkAvatarData:
+        case PacketTypeAvatarIdentity:
+        case PacketTypeAvatarBillboard:
+        case PacketTypeAvatarKeyframeAck:
+            return TrafficClassAvatar;
+        case PacketTypeEntityQuery:
+        case PacketTypeEntityData:
+        case PacketTypeEntityAddOrEdit:
+        case PacketTypeEntityErase:
+        case PacketTypeEntityAddResponse:
+        case PacketTypeEntityEditNack:
+        case PacketTypeOctreeDataNack:
+        case PacketTypeJurisdiction:
+        case PacketTypeJurisdictionRequest:
+        case PacketTypeMetavoxelData:
+            return TrafficClassEntity;
+        default:
+            return TrafficClassStats;
+    }
+}
+
+const char* nameForTrafficClass(TrafficClass trafficClass) {
+    switch (trafficClass) {
+        case TrafficClassControl:
+            return "control";
+        case TrafficClassAudio:
+            return "audio";
+        case TrafficClassAvatar:
+            return "avatar";
+        case TrafficClassEntity:
+            return "entity";
+        default:
+            return "stats";
+    }
+}
+
+OutboundScheduler::OutboundScheduler(LimitedNodeList& nodeList) :
+    _nodeList(nodeList),
+    _socket(nodeList.getNodeSocket()),
+    _batch(),
+    _queueMutex(),
+    _hasDatagrams(),
+    _nodeQueues(),
+    _numQueuedDatagrams(0),
+    _nextNode(0),
+    _defaultBytesPerSecond(0)
+{
+    for (int i = 0; i < NUM_TRAFFIC_CLASSES; i++) {
+        _datagramsSent[i] = 0;
+        _datagramsDropped[i] = 0;
+    }
+}
+
+OutboundScheduler::NodeQueues* OutboundScheduler::queuesForNode(const SharedNodePointer& node) {
+    int index = node->getIndex();
+    if (index < 0 || _nodeList.nodeWithIndex(index) != node) {
+        return NULL;
+    }
+    if (index >= _nodeQueues.size()) {
+        _nodeQueues.resize(index + 1);
+    }
+    NodeQueues& queues = _nodeQueues[index];
+    if (queues.nodeUUID != node->getUUID()) {
+        // the index was a killed node's, whatever it still had queued goes with it
+        for (int i = 0; i < NUM_TRAFFIC_CLASSES; i++) {
+            _numQueuedDatagrams -= queues.queues[i].size();
+        }
+        queues = NodeQueues();
+        queues.nodeUUID = node->getUUID();
+    }
+    return &queues;
+}
+
+void OutboundScheduler::setNodeBytesPerSecond(const SharedNodePointer& node, int bytesPerSecond) {
+    QMutexLocker locker(&_queueMutex);
+    NodeQueues* queues = queuesForNode(node);
+    if (queues) {
+        queues->bytesPerSecond = bytesPerSecond;
+    }
+}
+
+void OutboundScheduler::queueDatagram(const SharedNodePointer& node, const HifiSockAddr& destinationSockAddr,
+                                      const QByteArray& datagram) {
+    TrafficClass trafficClass = trafficClassForPacketType(packetTypeForPacket(datagram));
+
+    QMutexLocker locker(&_queueMutex);
+    NodeQueues* nodeQueues = queuesForNode(node);
+    if (!nodeQueues) {
+        // the node was killed after the datagram was written to it
+        ++_datagramsDropped[trafficClass];
+        return;
+    }
+    NodeQueues& queues = *nodeQueues;
+    std::deque<QueuedDatagram>& queue = queues.queues[trafficClass];
+
+    QueuedDatagram queuedDatagram;
+    queuedDatagram.datagram = datagram;
+    queuedDatagram.destinationSockAddr = destinationSockAddr;
+    queue.push_back(queuedDatagram);
+    queues.queuedBytes[trafficClass] += datagram.size();
+    ++_numQueuedDatagrams;
+
+    while (queues.queuedBytes[trafficClass] > MAX_QUEUED_BYTES[trafficClass] && queue.size() > 1) {
+        queues.queuedBytes[trafficClass] -= queue.front().datagram.size();
+        queue.pop_front();
+        --_numQueuedDatagrams;
+        ++_datagramsDropped[trafficClass];
+    }
+
+    locker.unlock();
+    _hasDatagrams.wakeOne();
+}
+
+int OutboundScheduler::getQueuedBytes(const SharedNodePointer& node, TrafficClass trafficClass) {
+    QMutexLocker locker(&_queueMutex);
+    int index = node->getIndex();
+    if (index < 0 || index >= _nodeQueues.size() || _nodeQueues[index].nodeUUID != node->getUUID()) {
+        return 0;
+    }
+    return _nodeQueues[index].queuedBytes[trafficClass];
+}
+
+void OutboundScheduler::forgetNode(const SharedNodePointer& node) {
+    // found by UUID, a killed node no longer has its index
+    QMutexLocker locker(&_queueMutex);
+    for (int index = 0; index < _nodeQueues.size(); index++) {
+        if (_nodeQueues[index].nodeUUID == node->getUUID()) {
+            for (int i = 0; i < NUM_TRAFFIC_CLASSES; i++) {
+                _numQueuedDatagrams -= _nodeQueues[index].queues[i].size();
+            }
+            _nodeQueues[index] = NodeQueues();
+            return;
+        }
+    }
+}
+
+quint64 OutboundScheduler::takeDueDatagrams(std::vector<QueuedDatagram>& dueDatagrams) {
+    quint64 now = usecTimestampNow();
+    int numNodes = _nodeQueues.size();
+
+    for (int i = 0; i < numNodes; i++) {
+        NodeQueues& queues = _nodeQueues[i];
+        int bytesPerSecond = queues.bytesPerSecond > 0 ? queues.bytesPerSecond : _defaultBytesPerSecond;
+        if (!queues.nodeUUID.isNull() && bytesPerSecond > 0) {
+            float depth = std::max((float)bytesPerSecond * BUCKET_DEPTH_USECS / USECS_PER_SECOND,
+                                   (float)MIN_BUCKET_DEPTH_BYTES);
+            float refill = (float)bytesPerSecond * (now - queues.lastRefillUsecs) / USECS_PER_SECOND;
+            queues.tokens = std::min(depth, queues.tokens + refill);
+        }
+        queues.lastRefillUsecs = now;
+    }
+
+    // a node may go as long as it has tokens left, even if the datagram takes it below zero
+    for (int trafficClass = 0; trafficClass < NUM_TRAFFIC_CLASSES; trafficClass++) {
+        bool tookDatagram = true;
+        while (tookDatagram && (int)dueDatagrams.size() < MAX_DATAGRAMS_PER_BATCH) {
+            tookDatagram = false;
+
+            for (int i = 0; i < numNodes && (int)dueDatagrams.size() < MAX_DATAGRAMS_PER_BATCH; i++) {
+                NodeQueues& queues = _nodeQueues[(_nextNode + i) % numNodes];
+                std::deque<QueuedDatagram>& queue = queues.queues[trafficClass];
+                bool isPaced = queues.bytesPerSecond > 0 || _defaultBytesPerSecond > 0;
+                if (queue.empty() || (isPaced && queues.tokens <= 0.0f)) {
+                    continue;
+                }
+
+                int datagramSize = queue.front().datagram.size();
+                dueDatagrams.push_back(queue.front());
+                queue.pop_front();
+                queues.queuedBytes[trafficClass] -= datagramSize;
+                if (isPaced) {
+                    queues.tokens -= datagramSize;
+                }
+                --_numQueuedDatagrams;
+                ++_datagramsSent[trafficClass];
+                tookDatagram = true;
+            }
+        }
+    }
+    _nextNode = (numNodes > 0) ? (_nextNode + 1) % numNodes : 0;
+
+    if (!dueDatagrams.empty() || _numQueuedDatagrams == 0) {
+        return 0;
+    }
+
+    // everything left is waiting on a bucket, find the first to have a token again
+    quint64 usecsUntilTokens = 0;
+    for (int i = 0; i < numNodes; i++) {
+        const NodeQueues& queues = _nodeQueues[i];
+        int bytesPerSecond = queues.bytesPerSecond > 0 ? queues.bytesPerSecond : _defaultBytesPerSecond;
+        bool hasDatagrams = false;
+        for (int trafficClass = 0; trafficClass < NUM_TRAFFIC_CLASSES; trafficClass++) {
+            hasDatagrams = hasDatagrams || !queues.queues[trafficClass].empty();
+        }
+        if (hasDatagrams && bytesPerSecond > 0) {
+            quint64 usecs = (quint64)((1.0f - queues.tokens) * USECS_PER_SECOND / bytesPerSecond);
+            usecsUntilTokens = (usecsUntilTokens == 0) ? usecs : std::min(usecsUntilTokens, usecs);
+        }
+    }
+    return usecsUntilTokens;
+}
+
+bool OutboundScheduler::process() {
+    std::vector<QueuedDatagram> dueDatagrams;
+    dueDatagrams.reserve(MAX_DATAGRAMS_PER_BATCH);
+
+    _queueMutex.lock();
+    while (isStillRunning()) {
+        quint64 usecsUntilTokens = takeDueDatagrams(dueDatagrams);
+        if (!dueDatagrams.empty()) {
+            break;
+        }
+
+        if (_numQueuedDatagrams == 0) {
+            _hasDatagrams.wait(&_queueMutex);
+        } else {
+            // the wait has millisecond resolution, the buckets are deep enough to cover for it
+            _hasDatagrams.wait(&_queueMutex, std::max((quint64)1, usecsUntilTokens / USECS_PER_MSEC));
+        }
+    }
+    _queueMutex.unlock();
+
+    for (size_t i = 0; i < dueDatagrams.size(); i++) {
+        const QueuedDatagram& dueDatagram = dueDatagrams[i];
+        if (DatagramBatchWriter::canQueue(dueDatagram.datagram.size())) {
+            if (_batch.isFull()) {
+                _batch.flush(_socket);
+            }
+            _batch.queueDatagram(dueDatagram.datagram, dueDatagram.destinationSockAddr);
+        } else {
+            // QUdpSocket isn't safe to write from this thread, the too large ones go to the descriptor as well
+            DatagramBatchWriter::sendDatagram(_socket, dueDatagram.datagram.constData(), dueDatagram.datagram.size(),
+                                              dueDatagram.destinationSockAddr);
+        }
+    }
+    _batch.flush(_socket);
+
+    return isStillRunning();
+}
+
+void OutboundScheduler::terminating() {
+    // the send thread checks whether it is still running with the lock held, so this can't come between the check and
+    // the wait
+    QMutexLocker locker(&_queueMutex);
+    _hasDatagrams.wakeAll();
+}
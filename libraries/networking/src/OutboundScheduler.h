@@ -0,0 +1,123 @@
+//
+//  OutboundScheduler.h
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OutboundScheduler_h
+#define hifi_OutboundScheduler_h
+
+#include <atomic>
+#include <deque>
+
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+#include <QtNetwork/QUdpSocket>
+
+#include <GenericThread.h>
+
+#include "DatagramBatchWriter.h"
+#include "HifiSockAddr.h"
+#include "Node.h"
+#include "PacketHeaders.h"
+
+class LimitedNodeList;
+
+typedef QSharedPointer<Node> SharedNodePointer;
+
+/// the order datagrams leave in, a class is only sent once every node's higher classes are empty or out of tokens
+enum TrafficClass {
+    TrafficClassControl, // pings and the domain and kill packets, tiny and what keeps the nodes connected
+    TrafficClassAudio,
+    TrafficClassAvatar,
+    TrafficClassEntity,
+    TrafficClassStats,
+    NUM_TRAFFIC_CLASSES
+};
+
+TrafficClass trafficClassForPacketType(PacketType type);
+const char* nameForTrafficClass(TrafficClass trafficClass);
+
+/// Sends the datagrams written to nodes from its own thread, out of a queue per node and traffic class. Each node
+/// has a token bucket so a burst to one node is spread out at its rate instead of filling the socket buffer ahead of
+/// everyone else's audio, and within what the buckets allow the higher classes always go first.
+class OutboundScheduler : public GenericThread {
+    Q_OBJECT
+public:
+    OutboundScheduler(LimitedNodeList& nodeList);
+
+    /// the rate of the nodes without one of their own, 0 sends as fast as the priorities allow
+    void setDefaultBytesPerSecond(int bytesPerSecond) { _defaultBytesPerSecond = bytesPerSecond; }
+    int getDefaultBytesPerSecond() const { return _defaultBytesPerSecond; }
+
+    /// the rate this node is paced at, 0 goes back to the default. Like the calls below it does nothing for a node
+    /// that has been killed, whose index may already be another node's.
+    void setNodeBytesPerSecond(const SharedNodePointer& node, int bytesPerSecond);
+
+    /// queues a datagram that is ready to go, already authenticated. When the node's queue for its class is over
+    /// that class's limit the oldest datagrams are dropped, a late audio frame is worse than a missing one.
+    void queueDatagram(const SharedNodePointer& node, const HifiSockAddr& destinationSockAddr,
+                       const QByteArray& datagram);
+
+    /// the bytes of this class waiting for the node, for senders that should hold off rather than queue more
+    int getQueuedBytes(const SharedNodePointer& node, TrafficClass trafficClass);
+
+    /// drops whatever is still queued for a node that was killed
+    void forgetNode(const SharedNodePointer& node);
+
+    quint64 getDatagramsSent(TrafficClass trafficClass) const { return _datagramsSent[trafficClass].load(); }
+    quint64 getDatagramsDropped(TrafficClass trafficClass) const { return _datagramsDropped[trafficClass].load(); }
+
+    virtual bool process();
+    virtual void terminating();
+
+private:
+    struct QueuedDatagram {
+        QByteArray datagram;
+        HifiSockAddr destinationSockAddr;
+    };
+
+    struct NodeQueues {
+        NodeQueues() : bytesPerSecond(0), tokens(0.0f), lastRefillUsecs(0) {
+            for (int i = 0; i < NUM_TRAFFIC_CLASSES; i++) {
+                queuedBytes[i] = 0;
+            }
+        }
+
+        QUuid nodeUUID; // null while the slot is unused
+        std::deque<QueuedDatagram> queues[NUM_TRAFFIC_CLASSES];
+        int queuedBytes[NUM_TRAFFIC_CLASSES];
+        int bytesPerSecond;
+        float tokens;
+        quint64 lastRefillUsecs;
+    };
+
+    /// the queues of this node at its index, claimed for it if they were a killed node's. Null if this node is the
+    /// one that was killed, it must not touch the queues of whoever has its index now. Needs _queueMutex.
+    NodeQueues* queuesForNode(const SharedNodePointer& node);
+
+    /// moves the datagrams that may go now into the batch, in class order and taking turns between the nodes.
+    /// Returns the usecs until a node blocked on its bucket may send again, 0 when none is. Needs _queueMutex.
+    quint64 takeDueDatagrams(std::vector<QueuedDatagram>& dueDatagrams);
+
+    LimitedNodeList& _nodeList;
+    QUdpSocket& _socket;
+    DatagramBatchWriter _batch;
+
+    QMutex _queueMutex;
+    QWaitCondition _hasDatagrams;
+    QVector<NodeQueues> _nodeQueues;
+    int _numQueuedDatagrams;
+    int _nextNode; // the node the next pass starts at, so the first node doesn't always go first
+
+    int _defaultBytesPerSecond;
+    std::atomic<quint64> _datagramsSent[NUM_TRAFFIC_CLASSES];
+    std::atomic<quint64> _datagramsDropped[NUM_TRAFFIC_CLASSES];
+};
+
+#endif // hifi_OutboundScheduler_h
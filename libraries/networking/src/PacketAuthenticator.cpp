@@ -0,0 +1,188 @@
+//
+//  PacketAuthenticator.cpp
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <assert.h>
+#include <string.h>
+
+#include <QtCore/QCryptographicHash>
+
+#include "PacketAuthenticator.h"
+
+const int NUM_BYTES_PACKET_TAG = NUM_BYTES_MD5_HASH;
+
+static PacketAuthenticator::Mode preferredMode = PacketAuthenticator::SipHash;
+
+static quint64 readLittleEndian64(const unsigned char* bytes) {
+    quint64 value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static void writeLittleEndian64(quint64 value, char* bytes) {
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (char)(value >> (8 * i));
+    }
+}
+
+PacketAuthenticationKey::PacketAuthenticationKey(const QUuid& connectionSecret) :
+    _isNull(connectionSecret.isNull()),
+    _k0(0),
+    _k1(0)
+{
+    QByteArray rfcSecret = connectionSecret.toRfc4122();
+    memcpy(_secretBytes, rfcSecret.constData(), NUM_BYTES_RFC4122_UUID);
+
+    const unsigned char* secretBytes = reinterpret_cast<const unsigned char*>(_secretBytes);
+    _k0 = readLittleEndian64(secretBytes);
+    _k1 = readLittleEndian64(secretBytes + 8);
+}
+
+PacketAuthenticator::Mode PacketAuthenticator::getPreferredMode() {
+    return preferredMode;
+}
+
+void PacketAuthenticator::setPreferredMode(Mode mode) {
+    preferredMode = mode;
+}
+
+PacketAuthenticator::Mode PacketAuthenticator::modeForPacket(const char* packet) {
+    unsigned char versionByte = packet[numBytesArithmeticCodingFromBuffer(packet)];
+    return (versionByte & PACKET_SIP_HASH_AUTHENTICATED_FLAG) ? SipHash : MD5Hash;
+}
+
+bool PacketAuthenticator::senderAcceptsSipHash(const char* packet) {
+    unsigned char versionByte = packet[numBytesArithmeticCodingFromBuffer(packet)];
+    return versionByte & PACKET_ACCEPTS_SIP_HASH_FLAG;
+}
+
+static void computeTag(const char* packet, int packetSize, const PacketAuthenticationKey& key,
+                       PacketAuthenticator::Mode mode, char* tag) {
+    int numHeaderBytes = numBytesForPacketHeader(packet);
+    const char* payload = packet + numHeaderBytes;
+    int payloadSize = packetSize - numHeaderBytes;
+
+    // the flag bits of the version byte follow the payload, a packet without any keeps the original md5 tag
+    char flags = (char)((unsigned char)packet[numBytesArithmeticCodingFromBuffer(packet)] & ~PACKET_VERSION_MASK);
+    int numFlagBytes = (flags != 0) ? 1 : 0;
+
+    if (mode == PacketAuthenticator::SipHash) {
+        PacketAuthenticator::sipHash128(payload, payloadSize, &flags, numFlagBytes, key.getK0(), key.getK1(), tag);
+    } else {
+        // the original scheme, md5 of the payload followed by the connection secret
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        hash.addData(payload, payloadSize);
+        hash.addData(&flags, numFlagBytes);
+        hash.addData(key.getSecretBytes(), NUM_BYTES_RFC4122_UUID);
+        memcpy(tag, hash.result().constData(), NUM_BYTES_PACKET_TAG);
+    }
+}
+
+void PacketAuthenticator::authenticatePacket(char* packet, int packetSize, const PacketAuthenticationKey& key, Mode mode) {
+    if (numHashBytesInPacketHeaderGivenPacketType(packetTypeForPacket(packet)) == 0) {
+        return;
+    }
+
+    char* versionByte = packet + numBytesArithmeticCodingFromBuffer(packet);
+    unsigned char flaggedVersion = (unsigned char)*versionByte & PACKET_VERSION_MASK;
+    if (preferredMode == SipHash) {
+        flaggedVersion |= PACKET_ACCEPTS_SIP_HASH_FLAG;
+    }
+    if (mode == SipHash) {
+        flaggedVersion |= PACKET_SIP_HASH_AUTHENTICATED_FLAG;
+    }
+    *versionByte = (char)flaggedVersion;
+
+    computeTag(packet, packetSize, key, mode, packet + numBytesForPacketHeader(packet) - NUM_BYTES_PACKET_TAG);
+}
+
+bool PacketAuthenticator::isPacketAuthentic(const char* packet, int packetSize, const PacketAuthenticationKey& key) {
+    if (packetSize < numBytesForPacketHeader(packet)) {
+        return false;
+    }
+
+    char expectedTag[NUM_BYTES_PACKET_TAG];
+    computeTag(packet, packetSize, key, modeForPacket(packet), expectedTag);
+
+    // compare every byte so the time taken doesn't say how much of a forged tag was right
+    const char* packetTag = packet + numBytesForPacketHeader(packet) - NUM_BYTES_PACKET_TAG;
+    unsigned char difference = 0;
+    for (int i = 0; i < NUM_BYTES_PACKET_TAG; i++) {
+        difference |= packetTag[i] ^ expectedTag[i];
+    }
+    return difference == 0;
+}
+
+#define SIP_ROTATE_LEFT(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIP_ROUND \
+    v0 += v1; v1 = SIP_ROTATE_LEFT(v1, 13); v1 ^= v0; v0 = SIP_ROTATE_LEFT(v0, 32); \
+    v2 += v3; v3 = SIP_ROTATE_LEFT(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = SIP_ROTATE_LEFT(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = SIP_ROTATE_LEFT(v1, 17); v1 ^= v2; v2 = SIP_ROTATE_LEFT(v2, 32);
+
+void PacketAuthenticator::sipHash128(const char* data, int size, quint64 k0, quint64 k1, char* tag) {
+    sipHash128(data, size, NULL, 0, k0, k1, tag);
+}
+
+void PacketAuthenticator::sipHash128(const char* data, int size, const char* suffix, int suffixSize,
+                                     quint64 k0, quint64 k1, char* tag) {
+    quint64 v0 = k0 ^ 0x736f6d6570736575ULL;
+    quint64 v1 = k1 ^ 0x646f72616e646f6dULL ^ 0xee;
+    quint64 v2 = k0 ^ 0x6c7967656e657261ULL;
+    quint64 v3 = k1 ^ 0x7465646279746573ULL;
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* blocksEnd = bytes + (size - (size % 8));
+
+    for (; bytes != blocksEnd; bytes += 8) {
+        quint64 m = readLittleEndian64(bytes);
+        v3 ^= m;
+        SIP_ROUND SIP_ROUND
+        v0 ^= m;
+    }
+
+    // what is left of the data and the suffix make at most two more blocks
+    assert(suffixSize >= 0 && suffixSize <= 8);
+    unsigned char tail[16];
+    int tailSize = size % 8;
+    memcpy(tail, bytes, tailSize);
+    if (suffixSize > 0) {
+        memcpy(tail + tailSize, suffix, suffixSize);
+        tailSize += suffixSize;
+    }
+    bytes = tail;
+    if (tailSize >= 8) {
+        quint64 m = readLittleEndian64(bytes);
+        v3 ^= m;
+        SIP_ROUND SIP_ROUND
+        v0 ^= m;
+        bytes += 8;
+        tailSize -= 8;
+    }
+
+    // the last block holds the remaining bytes with the low byte of the length on top
+    quint64 m = ((quint64)(size + suffixSize)) << 56;
+    for (int i = tailSize - 1; i >= 0; i--) {
+        m |= ((quint64)bytes[i]) << (8 * i);
+    }
+    v3 ^= m;
+    SIP_ROUND SIP_ROUND
+    v0 ^= m;
+
+    v2 ^= 0xee;
+    SIP_ROUND SIP_ROUND SIP_ROUND SIP_ROUND
+    writeLittleEndian64(v0 ^ v1 ^ v2 ^ v3, tag);
+
+    v1 ^= 0xdd;
+    SIP_ROUND SIP_ROUND SIP_ROUND SIP_ROUND
+    writeLittleEndian64(v0 ^ v1 ^ v2 ^ v3, tag + 8);
+}
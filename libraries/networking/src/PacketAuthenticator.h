@@ -0,0 +1,74 @@
+//
+//  PacketAuthenticator.h
+//  libraries/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketAuthenticator_h
+#define hifi_PacketAuthenticator_h
+
+#include <QtCore/QUuid>
+
+#include "PacketHeaders.h"
+
+/// the connection secret for a node, with the forms the authenticators need computed once up front
+class PacketAuthenticationKey {
+public:
+    PacketAuthenticationKey(const QUuid& connectionSecret = QUuid());
+
+    bool isNull() const { return _isNull; }
+
+    const char* getSecretBytes() const { return _secretBytes; }
+    quint64 getK0() const { return _k0; }
+    quint64 getK1() const { return _k1; }
+
+private:
+    bool _isNull;
+    char _secretBytes[NUM_BYTES_RFC4122_UUID];
+    quint64 _k0;
+    quint64 _k1;
+};
+
+// Computes and checks the tag in the hash field of verified packets. The tag is written straight into the packet and
+// checked against the bytes in place, so no temporary buffers are made for the payload.
+//
+// The mode a packet was authenticated with travels in the high bits of its version byte. A sender only switches to
+// SipHash once the receiving node has advertised that it accepts it, so a peer preferring MD5 keeps getting MD5.
+// Whenever any of those flag bits are set they are part of what the tag covers, so they can't be flipped on the way
+// to downgrade a packet or a peer.
+namespace PacketAuthenticator {
+
+    enum Mode {
+        MD5Hash,
+        SipHash
+    };
+
+    /// the mode advertised to and used with nodes that accept it, SipHash unless overridden
+    Mode getPreferredMode();
+    void setPreferredMode(Mode mode);
+
+    /// the mode a packet's tag was computed with, from its version byte
+    Mode modeForPacket(const char* packet);
+
+    /// whether the sender of a packet has advertised it accepts SipHash tags
+    bool senderAcceptsSipHash(const char* packet);
+
+    /// writes the tag for the packet's payload into its header and marks the mode in its version byte.
+    /// Does nothing for packet types that are not verified.
+    void authenticatePacket(char* packet, int packetSize, const PacketAuthenticationKey& key, Mode mode);
+
+    /// checks the tag in the packet's header using the mode the packet declares
+    bool isPacketAuthentic(const char* packet, int packetSize, const PacketAuthenticationKey& key);
+
+    /// SipHash-2-4 with a 128 bit output, written little-endian into tag
+    void sipHash128(const char* data, int size, quint64 k0, quint64 k1, char* tag);
+
+    /// the same over data followed by up to 8 suffix bytes, without copying the data to put them together
+    void sipHash128(const char* data, int size, const char* suffix, int suffixSize, quint64 k0, quint64 k1, char* tag);
+};
+
+#endif // hifi_PacketAuthenticator_h
@@ -57,14 +57,16 @@ PacketVersion versionForPacketType(PacketType type) {
         case PacketTypeInjectAudio:
             return 1;
         case PacketTypeAvatarData:
-            return 5;
+            return 6;
+        case PacketTypeBulkAvatarData:
+            return 1;
         case PacketTypeAvatarIdentity:
             return 1;
         case PacketTypeEnvironmentData:
             return 2;
         case PacketTypeDomainList:
         case PacketTypeDomainListRequest:
-            return 3;
+            return 4;
         case PacketTypeCreateAssignment:
         case PacketTypeRequestAssignment:
             return 2;
@@ -109,6 +111,7 @@ QString nameForPacketType(PacketType type) {
         PACKET_TYPE_NAME_LOOKUP(PacketTypeMuteEnvironment);
         PACKET_TYPE_NAME_LOOKUP(PacketTypeAudioStreamStats);
         PACKET_TYPE_NAME_LOOKUP(PacketTypeDataServerConfirm);
+        PACKET_TYPE_NAME_LOOKUP(PacketTypeAvatarKeyframeAck);
         PACKET_TYPE_NAME_LOOKUP(PacketTypeOctreeStats);
         PACKET_TYPE_NAME_LOOKUP(PacketTypeJurisdiction);
         PACKET_TYPE_NAME_LOOKUP(PacketTypeJurisdictionRequest);
@@ -204,18 +207,8 @@ QUuid uuidFromPacketHeader(const QByteArray& packet) {
                                          NUM_BYTES_RFC4122_UUID));
 }
 
-QByteArray hashFromPacketHeader(const QByteArray& packet) {
-    return packet.mid(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH);
-}
-
-QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID) {
-    return QCryptographicHash::hash(packet.mid(numBytesForPacketHeader(packet)) + connectionUUID.toRfc4122(),
-                                    QCryptographicHash::Md5);
-}
-
-void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID) {
-    packet.replace(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH,
-                   hashForPacketAndConnectionUUID(packet, connectionUUID));
+PacketVersion versionFromPacketHeader(const char* packet) {
+    return packet[numBytesArithmeticCodingFromBuffer(packet)] & PACKET_VERSION_MASK;
 }
 
 PacketType packetTypeForPacket(const QByteArray& packet) {
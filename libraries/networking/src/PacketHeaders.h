@@ -42,7 +42,7 @@ enum PacketType {
     PacketTypeMuteEnvironment,
     PacketTypeAudioStreamStats,
     PacketTypeDataServerConfirm, // 20
-    UNUSED_5,
+    PacketTypeAvatarKeyframeAck,
     UNUSED_6,
     UNUSED_7,
     UNUSED_8,
@@ -92,6 +92,11 @@ const int NUM_BYTES_MD5_HASH = 16;
 const int NUM_STATIC_HEADER_BYTES = sizeof(PacketVersion) + NUM_BYTES_RFC4122_UUID;
 const int MAX_PACKET_HEADER_BYTES = sizeof(PacketType) + NUM_BYTES_MD5_HASH + NUM_STATIC_HEADER_BYTES;
 
+// the low bits of the version byte carry the version, the high bits are flags set by the PacketAuthenticator
+const unsigned char PACKET_VERSION_MASK = 0x3F;
+const unsigned char PACKET_ACCEPTS_SIP_HASH_FLAG = 0x40;
+const unsigned char PACKET_SIP_HASH_AUTHENTICATED_FLAG = 0x80;
+
 PacketVersion versionForPacketType(PacketType type);
 QString nameForPacketType(PacketType type);
 
@@ -109,9 +114,7 @@ int numBytesForPacketHeaderGivenPacketType(PacketType type);
 
 QUuid uuidFromPacketHeader(const QByteArray& packet);
 
-QByteArray hashFromPacketHeader(const QByteArray& packet);
-QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID);
-void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID);
+PacketVersion versionFromPacketHeader(const char* packet);
 
 PacketType packetTypeForPacket(const QByteArray& packet);
 PacketType packetTypeForPacket(const char* packet);
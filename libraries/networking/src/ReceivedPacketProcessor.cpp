@@ -31,13 +31,28 @@ void ReceivedPacketProcessor::queueReceivedPacket(const SharedNodePointer& sendi
     _hasPackets.wakeAll();
 }
 
-bool ReceivedPacketProcessor::process() {
-
+void ReceivedPacketProcessor::waitForPackets() {
     if (_packets.size() == 0) {
         _waitingOnPacketsMutex.lock();
         _hasPackets.wait(&_waitingOnPacketsMutex, getMaxWait());
         _waitingOnPacketsMutex.unlock();
     }
+}
+
+void ReceivedPacketProcessor::takeQueuedPackets(QVector<NetworkPacket>& packets) {
+    lock();
+    packets.clear();
+    packets.swap(_packets);
+    foreach (const NetworkPacket& packet, packets) {
+        if (!packet.getNode().isNull()) {
+            _nodePacketCounts[packet.getNode()->getUUID()]--;
+        }
+    }
+    unlock();
+}
+
+bool ReceivedPacketProcessor::process() {
+    waitForPackets();
     preProcess();
     while (_packets.size() > 0) {
         lock(); // lock to make sure nothing changes on us
@@ -71,6 +71,13 @@ protected:
     /// Override to do work after the packets processing loop.  Default does nothing.
     virtual void postProcess() { }
 
+    /// Waits for packets to arrive if there are none, up to getMaxWait()
+    void waitForPackets();
+
+    /// Moves every queued packet into packets, for subclasses that handle the queue as a batch instead of a packet at
+    /// a time.
+    void takeQueuedPackets(QVector<NetworkPacket>& packets);
+
     virtual void terminating();
 
 protected:
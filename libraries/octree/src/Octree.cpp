@@ -13,6 +13,7 @@
 #define _USE_MATH_DEFINES
 #endif
 
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
 #include <cmath>
@@ -31,7 +32,9 @@
 
 #include "CoverageMap.h"
 #include "OctreeConstants.h"
+#include "OctreeEditJournal.h"
 #include "OctreeElementBag.h"
+#include "OctreeIndexedSVOFile.h"
 #include "Octree.h"
 #include "ViewFrustum.h"
 
@@ -44,9 +47,10 @@ Octree::Octree(bool shouldReaverage) :
     _isDirty(true),
     _shouldReaverage(shouldReaverage),
     _stopImport(false),
-    _lock(QReadWriteLock::Recursive),
+    _lock(),
     _isViewing(false),
-    _isServer(false)
+    _isServer(false),
+    _editJournal(NULL)
 {
 }
 
@@ -55,6 +59,48 @@ Octree::~Octree() {
     eraseAllOctreeElements(false);
 }
 
+void Octree::journalEdit(PacketType recordType, const unsigned char* data, int length) {
+    if (_editJournal) {
+        _editJournal->appendRecord(recordType, data, length);
+    }
+}
+
+int Octree::applyDecodedEditsInStripes(const QVector<OctreeDecodedEdit>& edits, int first, quint64& lockWaitUsecs) {
+    quint64 startLock = usecTimestampNow();
+    lockSpineForRead();
+    lockWaitUsecs += usecTimestampNow() - startLock;
+
+    // consecutive edits in the same stripe are applied under one lock of it
+    int nextEdit = first;
+    int lockedStripe = ALL_STRIPES;
+    while (nextEdit < edits.size() && edits[nextEdit].record) {
+        const OctreeDecodedEdit& edit = edits[nextEdit];
+        int stripe = stripeForDecodedEdit(*edit.record);
+        if (stripe == ALL_STRIPES) {
+            break;
+        }
+        if (stripe != lockedStripe) {
+            if (lockedStripe != ALL_STRIPES) {
+                unlockStripe(lockedStripe);
+            }
+            startLock = usecTimestampNow();
+            lockStripeForWrite(stripe);
+            lockWaitUsecs += usecTimestampNow() - startLock;
+            lockedStripe = stripe;
+        }
+        if (!applyDecodedEditInStripe(*edit.record, stripe, edit.sourceNode)) {
+            break;
+        }
+        nextEdit++;
+    }
+    if (lockedStripe != ALL_STRIPES) {
+        unlockStripe(lockedStripe);
+    }
+    unlockSpine();
+
+    return nextEdit - first;
+}
+
 // Recurses voxel tree calling the RecurseOctreeOperation function for each element.
 // stops recursion if operation function returns false.
 void Octree::recurseTreeWithOperation(RecurseOctreeOperation operation, void* extraData) {
@@ -1902,6 +1948,10 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
 }
 
 bool Octree::readFromSVOFile(const char* fileName) {
+    if (OctreeIndexedSVOFile::isIndexedSVOFile(fileName)) {
+        return readFromIndexedSVOFile(fileName);
+    }
+
     bool fileOk = false;
 
     PacketVersion gotVersion = 0;
@@ -2043,7 +2093,36 @@ bool Octree::readFromSVOFile(const char* fileName) {
     return fileOk;
 }
 
-void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
+bool Octree::readFromIndexedSVOFile(const char* fileName) {
+    OctreeIndexedSVOFile indexedFile(fileName);
+
+    qDebug("Loading indexed file %s...", fileName);
+    if (!indexedFile.open(this)) {
+        return false;
+    }
+
+    emit importSize(1.0f, 1.0f, 1.0f);
+    emit importProgress(0);
+    while (indexedFile.hasMoreChunks()) {
+        indexedFile.readNextChunk();
+        emit importProgress((100 * indexedFile.getNumChunksRead()) / indexedFile.getNumChunks());
+    }
+    emit importProgress(100);
+    return true;
+}
+
+// the smallest element cube, in tree units, that encloses both cubes
+static AACube enclosingElementCube(const AACube& first, const AACube& second) {
+    for (float scale = std::max(first.getScale(), second.getScale()); scale < 1.0f; scale *= 2.0f) {
+        glm::vec3 firstCorner = glm::floor(first.getCorner() / scale) * scale;
+        if (firstCorner == glm::floor(second.getCorner() / scale) * scale) {
+            return AACube(firstCorner, scale);
+        }
+    }
+    return AACube(glm::vec3(0.0f), 1.0f);
+}
+
+void Octree::writeToSVOFile(const char* fileName, OctreeElement* element, bool wantChunkIndex) {
     std::ofstream file(fileName, std::ios::out|std::ios::binary);
 
     if(file.is_open()) {
@@ -2053,6 +2132,14 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
         PacketVersion expectedVersion = versionForPacketType(expectedType);
         bool hasBufferBreaks = versionHasSVOfileBreaks(expectedVersion);
 
+        // the index locates the chunks, it takes the place of the buffer breaks
+        wantChunkIndex = wantChunkIndex && getWantSVOfileVersions();
+        if (wantChunkIndex) {
+            quint8 formatVersion = OctreeIndexedSVOFile::INDEXED_SVO_FORMAT_VERSION;
+            file.write(OctreeIndexedSVOFile::INDEXED_SVO_MAGIC, sizeof(OctreeIndexedSVOFile::INDEXED_SVO_MAGIC));
+            file.write(reinterpret_cast<char*>(&formatVersion), sizeof(formatVersion));
+        }
+
         // before reading the file, check to see if this version of the Octree supports file versions
         if (getWantSVOfileVersions()) {
             // if so, read the first byte of the file and see if it matches the expected version code
@@ -2060,9 +2147,11 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
             file.write(&expectedVersion, sizeof(expectedVersion));
             qDebug() << "SVO file type: " << nameForPacketType(expectedType) << " version: " << (int)expectedVersion;
 
-            hasBufferBreaks = versionHasSVOfileBreaks(expectedVersion);
+            hasBufferBreaks = !wantChunkIndex && versionHasSVOfileBreaks(expectedVersion);
         }
-        if (hasBufferBreaks) {
+        if (wantChunkIndex) {
+            qDebug() << "    this version includes a chunk index";
+        } else if (hasBufferBreaks) {
             qDebug() << "    this version includes buffer breaks";
         } else {
             qDebug() << "    this version does not include buffer breaks";
@@ -2082,14 +2171,24 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
         int bytesWritten = 0;
         bool lastPacketWritten = false;
 
+        // for the index, each chunk's offset and length and the element enclosing the subtrees encoded into it
+        QByteArray chunkIndex;
+        quint32 numChunks = 0;
+        AACube chunkCube;
+        bool chunkHasSubTrees = false;
+
         while (!elementBag.isEmpty()) {
+            // do tree locking down here so that we have shorter slices and less thread contention, a subtree below the
+            // stripe depth only needs its own stripe
+            lockSpineForRead();
             OctreeElement* subTree = elementBag.extract();
-            
-            lockForRead(); // do tree locking down here so that we have shorter slices and less thread contention
+            int stripe = stripeOfElement(subTree);
+            lockStripeForRead(stripe);
             EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS);
             params.extraEncodeData = &extraEncodeData;
             bytesWritten = encodeTreeBitstream(subTree, &packetData, elementBag, params);
-            unlock();
+            unlockStripe(stripe);
+            unlockSpine();
 
             // if the subTree couldn't fit, and so we should reset the packet and reinsert the element in our bag and try again
             if (bytesWritten == 0 && (params.stopReason == EncodeBitstreamParams::DIDNT_FIT)) {
@@ -2100,6 +2199,11 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
                         quint16 bufferSize = packetData.getFinalizedSize();
                         file.write((const char*)&bufferSize, sizeof(bufferSize));
                     }
+                    if (wantChunkIndex) {
+                        appendChunkIndexEntry(chunkIndex, file.tellp(), packetData.getFinalizedSize(), chunkCube);
+                        numChunks++;
+                        chunkHasSubTrees = false;
+                    }
                     file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
                     lastPacketWritten = true;
                 }
@@ -2107,6 +2211,11 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
                 elementBag.insert(subTree);
             } else {
                 lastPacketWritten = false;
+                if (bytesWritten > 0) {
+                    chunkCube = chunkHasSubTrees ? enclosingElementCube(chunkCube, subTree->getAACube())
+                                                 : subTree->getAACube();
+                    chunkHasSubTrees = true;
+                }
             }
         }
 
@@ -2117,14 +2226,37 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
                 quint16 bufferSize = packetData.getFinalizedSize();
                 file.write((const char*)&bufferSize, sizeof(bufferSize));
             }
+            if (wantChunkIndex && packetData.hasContent()) {
+                appendChunkIndexEntry(chunkIndex, file.tellp(), packetData.getFinalizedSize(), chunkCube);
+                numChunks++;
+            }
             file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
         }
+
+        if (wantChunkIndex) {
+            quint64 indexOffset = file.tellp();
+            file.write(chunkIndex.constData(), chunkIndex.size());
+            file.write(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
+            file.write(reinterpret_cast<char*>(&numChunks), sizeof(numChunks));
+            qDebug() << "    wrote" << numChunks << "indexed chunks";
+        }
         
         releaseSceneEncodeData(&extraEncodeData);
     }
     file.close();
 }
 
+void Octree::appendChunkIndexEntry(QByteArray& chunkIndex, quint64 offset, quint32 length, const AACube& enclosingCube) {
+    chunkIndex.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    chunkIndex.append(reinterpret_cast<const char*>(&length), sizeof(length));
+
+    const glm::vec3& corner = enclosingCube.getCorner();
+    unsigned char* octalCode = pointToOctalCode(corner.x, corner.y, corner.z, enclosingCube.getScale());
+    chunkIndex.append(reinterpret_cast<const char*>(octalCode),
+                      bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode)));
+    delete[] octalCode;
+}
+
 unsigned long Octree::getOctreeElementsCount() {
     unsigned long nodeCount = 0;
     recurseTreeWithOperation(countOctreeElementsOperation, &nodeCount);
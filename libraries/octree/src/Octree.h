@@ -12,6 +12,7 @@
 #ifndef hifi_Octree_h
 #define hifi_Octree_h
 
+#include <atomic>
 #include <set>
 #include <SimpleMovingAverage.h>
 
@@ -19,6 +20,7 @@ class CoverageMap;
 class ReadBitstreamToTreeParams;
 class Octree;
 class OctreeElement;
+class OctreeEditJournal;
 class OctreeElementBag;
 class OctreePacketData;
 class Shape;
@@ -28,12 +30,13 @@ class Shape;
 #include "ViewFrustum.h"
 #include "OctreeElement.h"
 #include "OctreeElementBag.h"
+#include "OctreeLock.h"
 #include "OctreePacketData.h"
 #include "OctreeSceneStats.h"
 
 #include <QHash>
 #include <QObject>
-#include <QReadWriteLock>
+#include <QVector>
 
 /// derive from this class to use the Octree::recurseTreeWithOperator() method
 class RecurseOctreeOperator {
@@ -211,6 +214,22 @@ public:
     {}
 };
 
+/// An inbound edit record decoded without touching the tree. Trees that implement decodeEditPacketData() hand these
+/// back so the server can decode edits outside the tree lock and apply a batch of them under a single lock.
+class OctreeEditRecord {
+public:
+    virtual ~OctreeEditRecord() { }
+};
+
+/// A decoded edit in a batch with the node it came from. The record is NULL for an edit that wasn't decoded, which has
+/// to go through processEditPacketData().
+struct OctreeDecodedEdit {
+    OctreeDecodedEdit() : record(NULL) { }
+
+    const OctreeEditRecord* record;
+    SharedNodePointer sourceNode;
+};
+
 class Octree : public QObject {
     Q_OBJECT
 public:
@@ -230,6 +249,35 @@ public:
     virtual bool handlesEditPacketType(PacketType packetType) const { return false; }
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& sourceNode) { return 0; }
+
+    // Optional two step form of processEditPacketData(). decodeEditPacketData() doesn't need the tree lock, it returns
+    // the bytes read and sets decodedEdit (NULL for an invalid record), or returns 0 if the rest of the packet has to go
+    // through processEditPacketData() instead. applyDecodedEdit() is called with the tree locked for write.
+    virtual int decodeEditPacketData(PacketType packetType, const unsigned char* editData, int maxLength,
+                    OctreeEditRecord*& decodedEdit) const { return 0; }
+    virtual void applyDecodedEdit(const OctreeEditRecord& decodedEdit, const SharedNodePointer& sourceNode) { }
+
+    // Decoded edits that only change one subtree may be applied holding just its stripe. stripeForDecodedEdit() is
+    // called with the spine locked and returns the stripe an edit stays within, or ALL_STRIPES if it needs the tree
+    // locked for write. applyDecodedEditInStripe() is then called with that stripe locked for write too, it returns
+    // false without changing anything if the edit turns out to need the whole tree or another stripe after all.
+    virtual int stripeForDecodedEdit(const OctreeEditRecord& decodedEdit) { return ALL_STRIPES; }
+    virtual bool applyDecodedEditInStripe(const OctreeEditRecord& decodedEdit, int stripe,
+                                          const SharedNodePointer& sourceNode) {
+        return false;
+    }
+
+    /// Applies the edits from first on that each stay inside one stripe, holding the spine and one stripe at a time,
+    /// and returns how many it applied. Stops at the first edit that needs the tree locked for write, which the caller
+    /// applies next. Adds the time spent waiting on the locks to lockWaitUsecs.
+    int applyDecodedEditsInStripes(const QVector<OctreeDecodedEdit>& edits, int first, quint64& lockWaitUsecs);
+
+    // Trees that journal the edits they apply return true from wantsEditJournal(), record their edits with
+    // journalEdit() and rebuild them in replayJournalRecord(), which is called with the tree locked for write.
+    virtual bool wantsEditJournal() const { return false; }
+    virtual bool replayJournalRecord(PacketType recordType, const unsigned char* data, int length) { return false; }
+    void setEditJournal(OctreeEditJournal* editJournal) { _editJournal = editJournal; }
+    OctreeEditJournal* getEditJournal() const { return _editJournal; }
                     
     virtual bool recurseChildrenWithData() const { return true; }
     virtual bool rootElementHasData() const { return false; }
@@ -288,6 +336,18 @@ public:
     void lockForWrite() { _lock.lockForWrite(); }
     bool tryLockForWrite() { return _lock.tryLockForWrite(); }
     void unlock() { _lock.unlock(); }
+
+    // Locking of single subtrees, see OctreeLock. The stripe depth may only be changed before the tree is shared.
+    void setLockStripeDepth(int stripeDepth) { _lock.setStripeDepth(stripeDepth); }
+    const OctreeLock& getLock() const { return _lock; }
+    void resetLockStats() { _lock.resetStats(); }
+    int stripeOfElement(const OctreeElement* element) const { return _lock.stripeContaining(element->getAACube()); }
+    void lockSpineForRead() { _lock.lockSpineForRead(); }
+    void unlockSpine() { _lock.unlockSpine(); }
+    void lockStripeForRead(int stripe) { _lock.lockStripeForRead(stripe); }
+    void lockStripeForWrite(int stripe) { _lock.lockStripeForWrite(stripe); }
+    void unlockStripe(int stripe) { _lock.unlockStripe(stripe); }
+
     // output hints from the encode process
     typedef enum {
         Lock,
@@ -320,8 +380,10 @@ public:
     void loadOctreeFile(const char* fileName, bool wantColorRandomizer);
 
     // these will read/write files that match the wireformat, excluding the 'V' leading
-    void writeToSVOFile(const char* filename, OctreeElement* element = NULL);
+    // wantChunkIndex writes an OctreeIndexedSVOFile instead, readFromSVOFile() reads either kind
+    void writeToSVOFile(const char* filename, OctreeElement* element = NULL, bool wantChunkIndex = false);
     bool readFromSVOFile(const char* filename);
+    bool readFromIndexedSVOFile(const char* filename);
     
 
     unsigned long getOctreeElementsCount();
@@ -373,6 +435,11 @@ protected:
                                      const ViewFrustum::location& parentLocationThisView) const;
 
     static bool countOctreeElementsOperation(OctreeElement* element, void* extraData);
+    static void appendChunkIndexEntry(QByteArray& chunkIndex, quint64 offset, quint32 length,
+                                      const AACube& enclosingCube);
+
+    /// appends a record to the edit journal, if there is one
+    void journalEdit(PacketType recordType, const unsigned char* data, int length);
 
     OctreeElement* nodeForOctalCode(OctreeElement* ancestorElement, const unsigned char* needleCode, OctreeElement** parentOfFoundElement) const;
     OctreeElement* createMissingElement(OctreeElement* lastParentElement, const unsigned char* codeToReach, int recursionCount = 0);
@@ -381,14 +448,16 @@ protected:
 
     OctreeElement* _rootElement;
 
-    bool _isDirty;
+    std::atomic<bool> _isDirty; // also set by edits that only hold a stripe
     bool _shouldReaverage;
     bool _stopImport;
 
-    QReadWriteLock _lock;
+    OctreeLock _lock;
     
     bool _isViewing; 
     bool _isServer;
+
+    OctreeEditJournal* _editJournal;
 };
 
 float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeScale);
@@ -0,0 +1,197 @@
+//
+//  OctreeEditJournal.cpp
+//  libraries/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstdio>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <QtCore/QDebug>
+
+#include "Octree.h"
+#include "OctreeEditJournal.h"
+
+// each record is its payload length, a checksum of the payload, then the payload: the record type and its data
+const int NUM_BYTES_JOURNAL_RECORD_HEADER = sizeof(quint32) + sizeof(quint16);
+
+OctreeEditJournal::OctreeEditJournal(const QString& filename) :
+    _filename(filename),
+    _pendingRecords(0),
+    _snapshotRequested(false)
+{
+}
+
+OctreeEditJournal::~OctreeEditJournal() {
+    close();
+}
+
+bool OctreeEditJournal::open(qint64 validLength) {
+    _file.setFileName(_filename);
+    if (!_file.open(QIODevice::ReadWrite)) {
+        qDebug() << "ERROR opening edit journal" << _filename << "-" << _file.errorString();
+        return false;
+    }
+    if (_file.size() > validLength) {
+        qDebug() << "Dropping" << (_file.size() - validLength) << "bytes of torn records from edit journal" << _filename;
+        _file.resize(validLength);
+    }
+    _file.seek(_file.size());
+    return true;
+}
+
+void OctreeEditJournal::close() {
+    if (_file.isOpen()) {
+        flush();
+        _file.close();
+    }
+}
+
+void OctreeEditJournal::appendRecord(PacketType recordType, const unsigned char* data, int length) {
+    quint32 payloadLength = sizeof(char) + length;
+    QByteArray payload;
+    payload.reserve(payloadLength);
+    payload.append((char)recordType);
+    payload.append(reinterpret_cast<const char*>(data), length);
+    quint16 checksum = qChecksum(payload.constData(), payloadLength);
+
+    QMutexLocker locker(&_mutex);
+    _pending.append(reinterpret_cast<const char*>(&payloadLength), sizeof(payloadLength));
+    _pending.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    _pending.append(payload);
+    _pendingRecords++;
+}
+
+int OctreeEditJournal::flush() {
+    QByteArray records;
+    int numRecords = 0;
+    {
+        QMutexLocker locker(&_mutex);
+        records.swap(_pending);
+        numRecords = _pendingRecords;
+        _pendingRecords = 0;
+    }
+
+    if (numRecords == 0 || !_file.isOpen()) {
+        return 0;
+    }
+
+    // the write and sync happen without the mutex, so edits being journaled never wait on the disk
+    if (_file.write(records) != records.size() || !_file.flush() || !syncFile(_file)) {
+        qDebug() << "ERROR writing edit journal" << _filename << "-" << _file.errorString();
+        requestSnapshot();
+        return 0;
+    }
+    return numRecords;
+}
+
+qint64 OctreeEditJournal::getSize() {
+    QMutexLocker locker(&_mutex);
+    return _file.size() + _pending.size();
+}
+
+void OctreeEditJournal::requestSnapshot() {
+    QMutexLocker locker(&_mutex);
+    _snapshotRequested = true;
+}
+
+bool OctreeEditJournal::isSnapshotRequested() {
+    QMutexLocker locker(&_mutex);
+    return _snapshotRequested;
+}
+
+bool OctreeEditJournal::rotate(const QString& rotatedFilename) {
+    flush();
+    _file.close();
+
+    bool rotated = false;
+    if (QFile::exists(rotatedFilename)) {
+        // the last snapshot never replaced the persist file, so the records set aside for it are still needed
+        QFile rotatedFile(rotatedFilename);
+        QFile journalFile(_filename);
+        if (rotatedFile.open(QIODevice::Append) && journalFile.open(QIODevice::ReadOnly)) {
+            rotated = rotatedFile.write(journalFile.readAll()) >= 0 && rotatedFile.flush() && syncFile(rotatedFile);
+        }
+    } else {
+        rotated = QFile::rename(_filename, rotatedFilename);
+    }
+    if (!rotated) {
+        qDebug() << "ERROR moving edit journal" << _filename << "to" << rotatedFilename;
+    }
+
+    {
+        QMutexLocker locker(&_mutex);
+        _snapshotRequested = false;
+    }
+
+    // records queued since the flush above stay pending and go into the new journal
+    _file.setFileName(_filename);
+    if (!_file.open(rotated ? (QIODevice::ReadWrite | QIODevice::Truncate) : QIODevice::ReadWrite)) {
+        qDebug() << "ERROR opening edit journal" << _filename << "-" << _file.errorString();
+        return false;
+    }
+    _file.seek(_file.size());
+    return rotated;
+}
+
+int OctreeEditJournal::replay(const QString& filename, Octree* tree, qint64& validLength) {
+    validLength = 0;
+
+    QFile file(filename);
+    if (!file.exists()) {
+        return 0;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "ERROR reading edit journal" << filename << "-" << file.errorString();
+        return 0;
+    }
+
+    QByteArray journal = file.readAll();
+    const char* dataAt = journal.constData();
+    qint64 bytesLeft = journal.size();
+    int numRecords = 0;
+
+    while (bytesLeft >= NUM_BYTES_JOURNAL_RECORD_HEADER) {
+        quint32 payloadLength;
+        quint16 checksum;
+        memcpy(&payloadLength, dataAt, sizeof(payloadLength));
+        memcpy(&checksum, dataAt + sizeof(payloadLength), sizeof(checksum));
+
+        const char* payload = dataAt + NUM_BYTES_JOURNAL_RECORD_HEADER;
+        if (payloadLength < sizeof(char) || payloadLength > bytesLeft - NUM_BYTES_JOURNAL_RECORD_HEADER
+            || qChecksum(payload, payloadLength) != checksum) {
+            qDebug() << "Edit journal" << filename << "ends with a torn record after" << numRecords << "records";
+            break;
+        }
+
+        PacketType recordType = (PacketType)payload[0];
+        if (!tree->replayJournalRecord(recordType, reinterpret_cast<const unsigned char*>(payload + 1),
+                                       payloadLength - 1)) {
+            qDebug() << "Edit journal" << filename << "has a record the tree couldn't replay, type:" << recordType;
+        }
+
+        numRecords++;
+        dataAt += NUM_BYTES_JOURNAL_RECORD_HEADER + payloadLength;
+        bytesLeft -= NUM_BYTES_JOURNAL_RECORD_HEADER + payloadLength;
+        validLength += NUM_BYTES_JOURNAL_RECORD_HEADER + payloadLength;
+    }
+    return numRecords;
+}
+
+bool OctreeEditJournal::syncFile(QFile& file) {
+#ifdef _WIN32
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
@@ -0,0 +1,70 @@
+//
+//  OctreeEditJournal.h
+//  libraries/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEditJournal_h
+#define hifi_OctreeEditJournal_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include <PacketHeaders.h>
+
+class Octree;
+
+/// Append-only log of the edits applied to a tree since its last snapshot. Trees append records as they apply edits,
+/// the persist thread writes them out and syncs them to disk in batches with flush(). Every record carries its
+/// length and a checksum, so a record torn by a crash mid-write is found and dropped when the journal is replayed.
+class OctreeEditJournal {
+public:
+    OctreeEditJournal(const QString& filename);
+    ~OctreeEditJournal();
+
+    const QString& getFilename() const { return _filename; }
+
+    /// opens the journal for appending, cutting it back to validLength first to drop a torn last record
+    bool open(qint64 validLength);
+    void close();
+
+    /// queues a record, it is written with the next flush(). Safe to call from any thread.
+    void appendRecord(PacketType recordType, const unsigned char* data, int length);
+
+    /// writes the queued records and syncs them to disk, returns the number of records written
+    int flush();
+
+    /// the size of the journal on disk, plus what is queued
+    qint64 getSize();
+
+    /// called when an edit couldn't be journaled, the tree needs a snapshot before the journal is complete again
+    void requestSnapshot();
+    bool isSnapshotRequested();
+
+    /// flushes, then moves the journal to rotatedFilename and starts an empty one. Records appended after this belong
+    /// to the snapshot about to be written.
+    bool rotate(const QString& rotatedFilename);
+
+    /// replays the records in a journal file into the tree, which must be locked for write. Stops at the first torn
+    /// record. Returns the number of records replayed, validLength is set to the bytes holding complete records.
+    static int replay(const QString& filename, Octree* tree, qint64& validLength);
+
+    /// syncs a file's contents to disk
+    static bool syncFile(QFile& file);
+
+private:
+    QString _filename;
+    QFile _file;
+    QMutex _mutex;
+    QByteArray _pending;
+    int _pendingRecords;
+    bool _snapshotRequested;
+};
+
+#endif // hifi_OctreeEditJournal_h
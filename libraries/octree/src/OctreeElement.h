@@ -16,6 +16,8 @@
 //#define SIMPLE_CHILD_ARRAY
 #define SIMPLE_EXTERNAL_CHILDREN
 
+#include <atomic>
+
 #include <QReadWriteLock>
 
 #include <OctalCode.h>
@@ -280,7 +282,9 @@ protected:
       unsigned char* pointer;
     } _octalCode;  
 
-    quint64 _lastChanged; /// Client and server, timestamp this node was last changed, 8 bytes
+    /// Client and server, timestamp this node was last changed, 8 bytes. Edits holding different stripes of the tree
+    /// mark the spine elements above them changed at the same time.
+    std::atomic<quint64> _lastChanged;
 
     /// Client and server, pointers to child nodes, various encodings
 #ifdef SIMPLE_CHILD_ARRAY
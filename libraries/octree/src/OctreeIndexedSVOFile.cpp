@@ -0,0 +1,181 @@
+//
+//  OctreeIndexedSVOFile.cpp
+//  libraries/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <string.h>
+
+#include <QtCore/QDebug>
+
+#include <OctalCode.h>
+
+#include "Octree.h"
+#include "OctreeConstants.h"
+#include "OctreeIndexedSVOFile.h"
+
+// the magic starts with a byte no PacketType has in a plain SVO file header
+const char OctreeIndexedSVOFile::INDEXED_SVO_MAGIC[4] = { 'H', 'S', 'V', 'O' };
+const quint8 OctreeIndexedSVOFile::INDEXED_SVO_FORMAT_VERSION = 1;
+
+const qint64 INDEXED_SVO_HEADER_LENGTH = sizeof(OctreeIndexedSVOFile::INDEXED_SVO_MAGIC) + sizeof(quint8)
+                                            + sizeof(PacketType) + sizeof(PacketVersion);
+const qint64 INDEXED_SVO_TRAILER_LENGTH = sizeof(quint64) + sizeof(quint32);
+
+bool OctreeIndexedSVOFile::isIndexedSVOFile(const QString& filename) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray magic = file.read(sizeof(INDEXED_SVO_MAGIC));
+    return magic.size() == sizeof(INDEXED_SVO_MAGIC)
+        && memcmp(magic.constData(), INDEXED_SVO_MAGIC, sizeof(INDEXED_SVO_MAGIC)) == 0;
+}
+
+OctreeIndexedSVOFile::OctreeIndexedSVOFile(const QString& filename) :
+    _filename(filename),
+    _tree(NULL),
+    _mapped(NULL),
+    _mappedSize(0),
+    _version(0),
+    _nextChunk(0)
+{
+}
+
+OctreeIndexedSVOFile::~OctreeIndexedSVOFile() {
+    close();
+}
+
+bool OctreeIndexedSVOFile::open(Octree* tree) {
+    _tree = tree;
+    _file.setFileName(_filename);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        qDebug() << "ERROR opening indexed SVO file" << _filename << "-" << _file.errorString();
+        return false;
+    }
+
+    _mappedSize = _file.size();
+    if (_mappedSize < INDEXED_SVO_HEADER_LENGTH + INDEXED_SVO_TRAILER_LENGTH) {
+        qDebug() << "Indexed SVO file" << _filename << "is too short to hold its index";
+        close();
+        return false;
+    }
+
+    _mapped = _file.map(0, _mappedSize);
+    if (!_mapped) {
+        qDebug() << "ERROR mapping indexed SVO file" << _filename << "-" << _file.errorString();
+        close();
+        return false;
+    }
+
+    const unsigned char* dataAt = _mapped + sizeof(INDEXED_SVO_MAGIC);
+    quint8 formatVersion = *dataAt++;
+    PacketType gotType = (PacketType)*dataAt++;
+    _version = *dataAt++;
+
+    PacketType expectedType = tree->expectedDataPacketType();
+    if (formatVersion != INDEXED_SVO_FORMAT_VERSION) {
+        qDebug() << "Indexed SVO file format mismatch. Expected:" << INDEXED_SVO_FORMAT_VERSION << "Got:" << formatVersion;
+    } else if (gotType != expectedType) {
+        qDebug() << "SVO file type mismatch. Expected: " << nameForPacketType(expectedType)
+                    << " Got: " << nameForPacketType(gotType);
+    } else if (!tree->canProcessVersion(_version)) {
+        qDebug("SVO file version mismatch. Expected: %d Got: %d", versionForPacketType(expectedType), _version);
+    } else if (readIndex()) {
+        qDebug() << "Indexed SVO file" << _filename << "has" << _chunks.size() << "chunks";
+        return true;
+    }
+
+    close();
+    return false;
+}
+
+void OctreeIndexedSVOFile::close() {
+    if (_mapped) {
+        _file.unmap(const_cast<unsigned char*>(_mapped));
+        _mapped = NULL;
+    }
+    _file.close();
+    _chunks.clear();
+    _nextChunk = 0;
+}
+
+bool OctreeIndexedSVOFile::readIndex() {
+    quint64 indexOffset;
+    quint32 numChunks;
+    const unsigned char* trailer = _mapped + _mappedSize - INDEXED_SVO_TRAILER_LENGTH;
+    memcpy(&indexOffset, trailer, sizeof(indexOffset));
+    memcpy(&numChunks, trailer + sizeof(indexOffset), sizeof(numChunks));
+
+    quint64 indexEnd = _mappedSize - INDEXED_SVO_TRAILER_LENGTH;
+    if (indexOffset < (quint64)INDEXED_SVO_HEADER_LENGTH || indexOffset > indexEnd) {
+        qDebug() << "Indexed SVO file" << _filename << "has a bad index offset:" << indexOffset;
+        return false;
+    }
+
+    const unsigned char* dataAt = _mapped + indexOffset;
+    quint64 bytesLeft = indexEnd - indexOffset;
+    const quint64 NUM_BYTES_CHUNK_LOCATION = sizeof(quint64) + sizeof(quint32);
+
+    _chunks.reserve(numChunks);
+    for (quint32 i = 0; i < numChunks; i++) {
+        if (bytesLeft <= NUM_BYTES_CHUNK_LOCATION) {
+            qDebug() << "Indexed SVO file" << _filename << "index ends after" << i << "of" << numChunks << "chunks";
+            return false;
+        }
+
+        Chunk chunk;
+        memcpy(&chunk.offset, dataAt, sizeof(chunk.offset));
+        memcpy(&chunk.length, dataAt + sizeof(chunk.offset), sizeof(chunk.length));
+        dataAt += NUM_BYTES_CHUNK_LOCATION;
+        bytesLeft -= NUM_BYTES_CHUNK_LOCATION;
+
+        int codeLength = numberOfThreeBitSectionsInCode(dataAt, (int)bytesLeft);
+        size_t codeBytes = bytesRequiredForCodeLength(codeLength);
+        if (codeLength == OVERFLOWED_OCTCODE_BUFFER || codeBytes > bytesLeft) {
+            qDebug() << "Indexed SVO file" << _filename << "has a bad octal code for chunk" << i;
+            return false;
+        }
+        if (chunk.offset < (quint64)INDEXED_SVO_HEADER_LENGTH || chunk.offset + chunk.length > indexOffset) {
+            qDebug() << "Indexed SVO file" << _filename << "has chunk" << i << "outside its data";
+            return false;
+        }
+
+        VoxelPositionSize enclosing;
+        voxelDetailsForCode(dataAt, enclosing);
+        chunk.corner = glm::vec3(enclosing.x, enclosing.y, enclosing.z);
+        chunk.scale = enclosing.s;
+        chunk.distance = 0.0f;
+        _chunks.push_back(chunk);
+
+        dataAt += codeBytes;
+        bytesLeft -= codeBytes;
+    }
+    return true;
+}
+
+void OctreeIndexedSVOFile::orderChunksByDistance(const glm::vec3& point) {
+    glm::vec3 treePoint = point / (float)TREE_SCALE;
+    for (int i = _nextChunk; i < _chunks.size(); i++) {
+        Chunk& chunk = _chunks[i];
+        glm::vec3 nearest = glm::clamp(treePoint, chunk.corner, chunk.corner + glm::vec3(chunk.scale));
+        chunk.distance = glm::distance(treePoint, nearest) * (float)TREE_SCALE;
+    }
+    std::stable_sort(_chunks.begin() + _nextChunk, _chunks.end());
+}
+
+void OctreeIndexedSVOFile::readNextChunk() {
+    if (!hasMoreChunks()) {
+        return;
+    }
+    const Chunk& chunk = _chunks[_nextChunk++];
+
+    // the chunk is decoded straight out of the mapped file, pages are only read in as the decode touches them
+    ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false, _version);
+    _tree->readBitstreamToTree(_mapped + chunk.offset, chunk.length, args);
+}
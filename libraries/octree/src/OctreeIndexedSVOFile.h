@@ -0,0 +1,85 @@
+//
+//  OctreeIndexedSVOFile.h
+//  libraries/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeIndexedSVOFile_h
+#define hifi_OctreeIndexedSVOFile_h
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <glm/glm.hpp>
+
+#include <PacketHeaders.h>
+
+class Octree;
+
+/// An SVO file with an index of its chunks. The chunks are the same buffers a plain SVO file holds, the index gives
+/// the file offset and length of each one along with the octal code of the element that encloses everything in it.
+/// Chunks only hold octal coded subtrees, so they can be decoded in any order. The file is read through a memory map,
+/// chunks are decoded straight out of it.
+///
+/// The layout is the header, the chunks, the index, then a trailer locating the index:
+///     header:  INDEXED_SVO_MAGIC, index format version, PacketType, PacketVersion
+///     index:   per chunk, quint64 offset, quint32 length, octal code
+///     trailer: quint64 index offset, quint32 chunk count
+class OctreeIndexedSVOFile {
+public:
+    static const char INDEXED_SVO_MAGIC[4];
+    static const quint8 INDEXED_SVO_FORMAT_VERSION;
+
+    /// true if the file starts like an indexed SVO file, plain SVO files start with their PacketType
+    static bool isIndexedSVOFile(const QString& filename);
+
+    OctreeIndexedSVOFile(const QString& filename);
+    ~OctreeIndexedSVOFile();
+
+    /// maps the file and reads its index, fails if the file isn't one the tree can read
+    bool open(Octree* tree);
+    void close();
+
+    /// orders the chunks left to read nearest first to a point, in meters
+    void orderChunksByDistance(const glm::vec3& point);
+
+    int getNumChunks() const { return _chunks.size(); }
+    int getNumChunksRead() const { return _nextChunk; }
+    bool hasMoreChunks() const { return _nextChunk < _chunks.size(); }
+
+    /// how far, in meters, the next chunk is from the point the chunks were ordered by
+    float getNextChunkDistance() const { return hasMoreChunks() ? _chunks[_nextChunk].distance : 0.0f; }
+
+    /// decodes the next chunk into the tree, which must be locked for write
+    void readNextChunk();
+
+private:
+    class Chunk {
+    public:
+        quint64 offset;
+        quint32 length;
+        glm::vec3 corner; // the enclosing element's cube, in tree units
+        float scale;
+        float distance;
+
+        bool operator<(const Chunk& other) const { return distance < other.distance; }
+    };
+
+    bool readIndex();
+
+    QString _filename;
+    QFile _file;
+    Octree* _tree;
+    const unsigned char* _mapped;
+    qint64 _mappedSize;
+    PacketVersion _version;
+    QVector<Chunk> _chunks;
+    int _nextChunk;
+};
+
+#endif // hifi_OctreeIndexedSVOFile_h
@@ -0,0 +1,210 @@
+//
+//  OctreeLock.cpp
+//  libraries/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#include <QtCore/QThread>
+
+#include <SharedUtil.h>
+
+#include "OctreeLock.h"
+
+void OctreeLock::WaitStats::recordWait(quint64 waitUsecs) {
+    acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (waitUsecs == 0) {
+        return;
+    }
+    contended.fetch_add(1, std::memory_order_relaxed);
+    totalWaitUsecs.fetch_add(waitUsecs, std::memory_order_relaxed);
+    quint64 maxWait = maxWaitUsecs.load(std::memory_order_relaxed);
+    while (waitUsecs > maxWait && !maxWaitUsecs.compare_exchange_weak(maxWait, waitUsecs, std::memory_order_relaxed)) {
+    }
+}
+
+OctreeLockStats OctreeLock::WaitStats::get() const {
+    OctreeLockStats stats;
+    stats.acquisitions = acquisitions.load(std::memory_order_relaxed);
+    stats.contended = contended.load(std::memory_order_relaxed);
+    stats.totalWaitUsecs = totalWaitUsecs.load(std::memory_order_relaxed);
+    stats.maxWaitUsecs = maxWaitUsecs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void OctreeLock::WaitStats::reset() {
+    acquisitions = 0;
+    contended = 0;
+    totalWaitUsecs = 0;
+    maxWaitUsecs = 0;
+}
+
+OctreeLock::OctreeLock() :
+    _spine(QReadWriteLock::Recursive),
+    _spineStats(),
+    _stripeDepth(0),
+    _numStripes(1),
+    _stripes(new Stripe[1]),
+    _writer(NULL),
+    _writeDepth(0)
+{
+}
+
+void OctreeLock::setStripeDepth(int stripeDepth) {
+    _stripeDepth = std::max(0, std::min(stripeDepth, MAX_LOCK_STRIPE_DEPTH));
+    _numStripes = 1 << (3 * _stripeDepth);
+    _stripes.reset(new Stripe[_numStripes]);
+    _spineStats.reset();
+}
+
+int OctreeLock::stripeContaining(const AACube& cube) const {
+    int cellsPerSide = 1 << _stripeDepth;
+    glm::vec3 minimum = cube.getCorner() * (float)cellsPerSide;
+    glm::vec3 maximum = (cube.getCorner() + glm::vec3(cube.getScale())) * (float)cellsPerSide;
+
+    // the cells are powers of two, so for an element's cube these are exact
+    int stripe = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        int cell = (int)std::floor(minimum[axis]);
+        if (minimum[axis] < 0.0f || cell >= cellsPerSide || maximum[axis] > (float)(cell + 1)) {
+            return ALL_STRIPES;
+        }
+        stripe = stripe * cellsPerSide + cell;
+    }
+    return stripe;
+}
+
+void OctreeLock::lockTimed(QReadWriteLock& lock, bool forWrite, WaitStats& stats) {
+    // only pay for the clock when the lock is taken
+    if (forWrite ? lock.tryLockForWrite() : lock.tryLockForRead()) {
+        stats.recordWait(0);
+        return;
+    }
+    quint64 waitStart = usecTimestampNow();
+    if (forWrite) {
+        lock.lockForWrite();
+    } else {
+        lock.lockForRead();
+    }
+    stats.recordWait(std::max(usecTimestampNow() - waitStart, (quint64)1));
+}
+
+void OctreeLock::lockForRead() {
+    // QReadWriteLock won't let its writer read, so a writer reading takes the write again
+    if (_writer == QThread::currentThreadId()) {
+        _spine.lockForWrite();
+        _writeDepth++;
+        return;
+    }
+    lockTimed(_spine, false, _spineStats);
+    lockStripeForRead(ALL_STRIPES);
+}
+
+bool OctreeLock::tryLockForRead() {
+    if (_writer == QThread::currentThreadId()) {
+        _spine.lockForWrite();
+        _writeDepth++;
+        return true;
+    }
+    if (!_spine.tryLockForRead()) {
+        return false;
+    }
+    for (int i = 0; i < _numStripes; i++) {
+        if (!_stripes[i].lock.tryLockForRead()) {
+            while (--i >= 0) {
+                _stripes[i].lock.unlock();
+            }
+            _spine.unlock();
+            return false;
+        }
+    }
+    return true;
+}
+
+void OctreeLock::lockForWrite() {
+    lockTimed(_spine, true, _spineStats);
+    _writer = QThread::currentThreadId();
+    _writeDepth++;
+}
+
+bool OctreeLock::tryLockForWrite() {
+    if (!_spine.tryLockForWrite()) {
+        return false;
+    }
+    _writer = QThread::currentThreadId();
+    _writeDepth++;
+    return true;
+}
+
+void OctreeLock::unlock() {
+    if (_writer == QThread::currentThreadId()) {
+        if (--_writeDepth == 0) {
+            _writer = NULL;
+        }
+        _spine.unlock();
+        return;
+    }
+    unlockStripe(ALL_STRIPES);
+    _spine.unlock();
+}
+
+void OctreeLock::lockSpineForRead() {
+    if (_writer == QThread::currentThreadId()) {
+        _spine.lockForWrite();
+        return;
+    }
+    lockTimed(_spine, false, _spineStats);
+}
+
+void OctreeLock::unlockSpine() {
+    _spine.unlock();
+}
+
+void OctreeLock::lockStripeForRead(int stripe) {
+    if (stripe == ALL_STRIPES) {
+        // always in the same order, so two whole tree readers can't each be waiting on a stripe the other holds
+        for (int i = 0; i < _numStripes; i++) {
+            lockTimed(_stripes[i].lock, false, _stripes[i].stats);
+        }
+        return;
+    }
+    assert(stripe >= 0 && stripe < _numStripes);
+    lockTimed(_stripes[stripe].lock, false, _stripes[stripe].stats);
+}
+
+void OctreeLock::lockStripeForWrite(int stripe) {
+    assert(stripe >= 0 && stripe < _numStripes);
+    lockTimed(_stripes[stripe].lock, true, _stripes[stripe].stats);
+}
+
+void OctreeLock::unlockStripe(int stripe) {
+    if (stripe == ALL_STRIPES) {
+        for (int i = _numStripes - 1; i >= 0; i--) {
+            _stripes[i].lock.unlock();
+        }
+        return;
+    }
+    _stripes[stripe].lock.unlock();
+}
+
+OctreeLockStats OctreeLock::getSpineStats() const {
+    return _spineStats.get();
+}
+
+OctreeLockStats OctreeLock::getStripeStats(int stripe) const {
+    return _stripes[stripe].stats.get();
+}
+
+void OctreeLock::resetStats() {
+    _spineStats.reset();
+    for (int i = 0; i < _numStripes; i++) {
+        _stripes[i].stats.reset();
+    }
+}
@@ -0,0 +1,107 @@
+//
+//  OctreeLock.h
+//  libraries/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeLock_h
+#define hifi_OctreeLock_h
+
+#include <atomic>
+#include <memory>
+
+#include <QtCore/QReadWriteLock>
+
+#include <AACube.h>
+
+const int ALL_STRIPES = -1;
+const int MAX_LOCK_STRIPE_DEPTH = 3;
+
+/// What waiting on one of the octree's locks has cost, since the last reset.
+struct OctreeLockStats {
+    quint64 acquisitions;
+    quint64 contended; // acquisitions that had to wait
+    quint64 totalWaitUsecs;
+    quint64 maxWaitUsecs;
+};
+
+/// The octree's lock, striped by subtree. The elements at the stripe depth each root a stripe with a lock of its own,
+/// the elements above them are the spine, which has the tree lock. Code that only touches one subtree holds the spine
+/// for read and then that stripe, so edits in one part of the tree don't hold up encoding another. Code that may
+/// touch anything uses the whole tree lock, a whole tree reader holds the spine and every stripe for read and a whole
+/// tree writer holds the spine for write, which shuts out the stripe holders too. Only whole tree writers may add or
+/// delete elements, or change the spine. With a stripe depth of 0 there is a single stripe, the root's.
+///
+/// All of the locks are recursive. A whole tree writer may take any of them again, and a thread holding the spine may
+/// take it again along with stripes. A thread may hold at most one stripe for write and must not hold another stripe
+/// while it waits for it, so a stripe holder can't go on to lock the whole tree.
+class OctreeLock {
+public:
+    OctreeLock();
+
+    /// may only be called while the lock isn't held, clears the stats
+    void setStripeDepth(int stripeDepth);
+    int getStripeDepth() const { return _stripeDepth; }
+    int getNumStripes() const { return _numStripes; }
+
+    /// the stripe a cube in tree units lies in, ALL_STRIPES if it reaches into more than one or is outside the tree
+    int stripeContaining(const AACube& cube) const;
+
+    void lockForRead();
+    bool tryLockForRead();
+    void lockForWrite();
+    bool tryLockForWrite();
+    void unlock();
+
+    void lockSpineForRead();
+    void unlockSpine();
+
+    /// the spine must be held, ALL_STRIPES reads every stripe
+    void lockStripeForRead(int stripe);
+    void lockStripeForWrite(int stripe);
+    void unlockStripe(int stripe);
+
+    OctreeLockStats getSpineStats() const;
+    OctreeLockStats getStripeStats(int stripe) const;
+    void resetStats();
+
+private:
+    struct WaitStats {
+        WaitStats() : acquisitions(0), contended(0), totalWaitUsecs(0), maxWaitUsecs(0) { }
+
+        void recordWait(quint64 waitUsecs);
+        OctreeLockStats get() const;
+        void reset();
+
+        std::atomic<quint64> acquisitions;
+        std::atomic<quint64> contended;
+        std::atomic<quint64> totalWaitUsecs;
+        std::atomic<quint64> maxWaitUsecs;
+    };
+
+    struct Stripe {
+        Stripe() : lock(QReadWriteLock::Recursive) { }
+
+        QReadWriteLock lock;
+        WaitStats stats;
+    };
+
+    static void lockTimed(QReadWriteLock& lock, bool forWrite, WaitStats& stats);
+
+    QReadWriteLock _spine;
+    WaitStats _spineStats;
+
+    int _stripeDepth;
+    int _numStripes;
+    std::unique_ptr<Stripe[]> _stripes;
+
+    // set while a whole tree writer holds the lock, so unlock() can tell it from a reader
+    std::atomic<Qt::HANDLE> _writer;
+    int _writeDepth;
+};
+
+#endif // hifi_OctreeLock_h
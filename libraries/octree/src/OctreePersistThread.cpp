@@ -18,31 +18,58 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonObject>
 
 #include <PerfStat.h>
 #include <SharedUtil.h>
 
+#include "OctreeIndexedSVOFile.h"
 #include "OctreePersistThread.h"
 
 const int OctreePersistThread::DEFAULT_PERSIST_INTERVAL = 1000 * 30; // every 30 seconds
+const int OctreePersistThread::DEFAULT_SNAPSHOT_INTERVAL = 1000 * 60 * 10; // every 10 minutes
+
+// journaled edits are synced to disk together, at most this long after they were applied
+const quint64 JOURNAL_FLUSH_INTERVAL_USECS = 100 * USECS_PER_MSEC;
+
+// a journal this large is folded into a snapshot without waiting for the snapshot interval
+const qint64 MAX_JOURNAL_BYTES = 64 * 1024 * 1024;
+
+// with an indexed persist file, clients are served once the chunks within this many meters of the origin are loaded,
+// the rest are read in afterwards in slices short enough not to hold up edits and sending
+const float NEAR_CHUNK_DISTANCE = 256.0f;
+const quint64 CHUNK_LOADING_SLICE_USECS = 20 * USECS_PER_MSEC;
 
 OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename, int persistInterval, 
-                                                bool wantBackup, const QJsonObject& settings, bool debugTimestampNow) :
+                                                bool wantBackup, const QJsonObject& settings, bool debugTimestampNow,
+                                                bool wantEditJournal, int snapshotInterval) :
     _tree(tree),
     _filename(filename),
     _persistInterval(persistInterval),
     _initialLoadComplete(false),
     _loadTimeUSecs(0),
+    _loadStarted(0),
     _lastCheck(0),
     _wantBackup(wantBackup),
     _debugTimestampNow(debugTimestampNow),
-    _lastTimeDebug(0)
+    _lastTimeDebug(0),
+    _wantEditJournal(wantEditJournal),
+    _snapshotInterval(snapshotInterval),
+    _editJournal(NULL),
+    _lastJournalFlush(0),
+    _lastSnapshot(0),
+    _loadingFile(NULL)
 {
     parseSettings(settings);
 }
 
+OctreePersistThread::~OctreePersistThread() {
+    delete _loadingFile;
+    delete _editJournal;
+}
+
 void OctreePersistThread::parseSettings(const QJsonObject& settings) {
     if (settings["backups"].isArray()) {
         const QJsonArray& backupRules = settings["backups"].toArray();
@@ -95,7 +122,7 @@ quint64 OctreePersistThread::getMostRecentBackupTimeInUsecs(const QString& forma
 bool OctreePersistThread::process() {
 
     if (!_initialLoadComplete) {
-        quint64 loadStarted = usecTimestampNow();
+        _loadStarted = usecTimestampNow();
         qDebug() << "loading Octrees from file: " << _filename << "...";
 
         bool persistantFileRead;
@@ -122,13 +149,25 @@ bool OctreePersistThread::process() {
                 qDebug() << "Loading Octree... lock file removed:" << lockFileName;
             }
 
-            persistantFileRead = _tree->readFromSVOFile(_filename.toLocal8Bit().constData());
+            // journaled edits may be to entities anywhere in the tree, so with a journal to replay the whole file
+            // has to be loaded first
+            bool wantEditJournal = _wantEditJournal && _tree->wantsEditJournal();
+            if (OctreeIndexedSVOFile::isIndexedSVOFile(_filename) && !(wantEditJournal && hasEditJournalToReplay())) {
+                persistantFileRead = loadNearChunks();
+            } else {
+                persistantFileRead = _tree->readFromSVOFile(_filename.toLocal8Bit().constData());
+            }
+
+            if (wantEditJournal) {
+                replayEditJournal();
+            }
+
             _tree->pruneTree();
         }
         _tree->unlock();
 
         quint64 loadDone = usecTimestampNow();
-        _loadTimeUSecs = loadDone - loadStarted;
+        _loadTimeUSecs = loadDone - _loadStarted;
 
         _tree->clearDirtyBit(); // the tree is clean since we just loaded it
         qDebug("DONE loading Octrees from file... fileRead=%s", debug::valueOf(persistantFileRead));
@@ -160,6 +199,7 @@ bool OctreePersistThread::process() {
         // used in formatting the backup filename in cases of non-rolling backup names. However, we don't
         // want an uninitialized value for this, so we set it to the current time (startup of the server)
         time(&_lastPersistTime);
+        _lastSnapshot = _lastJournalFlush = _lastCheck;
 
         emit loadCompleted();
     }
@@ -169,6 +209,10 @@ bool OctreePersistThread::process() {
         quint64 USECS_TO_SLEEP = 10 * MSECS_TO_USECS; // every 10ms
         usleep(USECS_TO_SLEEP);
 
+        if (!isFullyLoaded()) {
+            loadMoreChunks(CHUNK_LOADING_SLICE_USECS);
+        }
+
         // do our updates then check to save...
         _tree->update();
 
@@ -176,7 +220,21 @@ bool OctreePersistThread::process() {
         quint64 sinceLastSave = now - _lastCheck;
         quint64 intervalToCheck = _persistInterval * MSECS_TO_USECS;
 
-        if (sinceLastSave > intervalToCheck) {
+        if (_editJournal) {
+            // with a journal the cost of persisting follows the rate of edits, the whole tree is only written
+            // out when a snapshot is due
+            if (now - _lastJournalFlush > JOURNAL_FLUSH_INTERVAL_USECS) {
+                _lastJournalFlush = now;
+                flushEditJournal();
+            }
+
+            bool snapshotDue = _tree->isDirty() && (now - _lastSnapshot > _snapshotInterval * MSECS_TO_USECS);
+            bool snapshotWanted = snapshotDue || _editJournal->getSize() > MAX_JOURNAL_BYTES
+                                    || _editJournal->isSnapshotRequested();
+            if (snapshotWanted && isFullyLoaded()) {
+                snapshot();
+            }
+        } else if (sinceLastSave > intervalToCheck && isFullyLoaded()) {
             _lastCheck = now;
             persist();
         }
@@ -199,10 +257,169 @@ bool OctreePersistThread::process() {
 
 void OctreePersistThread::aboutToFinish() {
     qDebug() << "Persist thread about to finish...";
-    persist();
+
+    // the tree is only written out whole
+    if (!isFullyLoaded()) {
+        loadMoreChunks(0);
+    }
+
+    if (_editJournal) {
+        snapshot();
+
+        // no more edits are coming, anything after the snapshot is in the journal and replayed at the next start
+        QMutexLocker locker(&_editJournalMutex);
+        _tree->setEditJournal(NULL);
+        _editJournal->close();
+    } else {
+        persist();
+    }
     qDebug() << "Persist thread done with about to finish...";
 }
 
+bool OctreePersistThread::isFullyLoaded() {
+    QMutexLocker locker(&_loadingMutex);
+    return _loadingFile == NULL;
+}
+
+bool OctreePersistThread::loadNearChunks() {
+    // NOTE: the tree is locked for write while the near chunks are loaded
+    QMutexLocker locker(&_loadingMutex);
+    _loadingFile = new OctreeIndexedSVOFile(_filename);
+    if (!_loadingFile->open(_tree)) {
+        delete _loadingFile;
+        _loadingFile = NULL;
+        return false;
+    }
+
+    _loadingFile->orderChunksByDistance(glm::vec3(0.0f));
+    while (_loadingFile->hasMoreChunks() && _loadingFile->getNextChunkDistance() <= NEAR_CHUNK_DISTANCE) {
+        _loadingFile->readNextChunk();
+    }
+    qDebug() << "Loaded" << _loadingFile->getNumChunksRead() << "of" << _loadingFile->getNumChunks()
+                << "chunks near the origin, the rest are loaded while clients are served";
+
+    if (!_loadingFile->hasMoreChunks()) {
+        delete _loadingFile;
+        _loadingFile = NULL;
+    }
+    return true;
+}
+
+void OctreePersistThread::loadMoreChunks(quint64 maxUsecs) {
+    QMutexLocker locker(&_loadingMutex);
+    if (!_loadingFile) {
+        return;
+    }
+
+    quint64 sliceStarted = usecTimestampNow();
+    _tree->lockForWrite();
+    while (_loadingFile->hasMoreChunks() && (maxUsecs == 0 || usecTimestampNow() - sliceStarted < maxUsecs)) {
+        _loadingFile->readNextChunk();
+    }
+    bool doneLoading = !_loadingFile->hasMoreChunks();
+    if (doneLoading) {
+        _tree->pruneTree();
+    }
+    _tree->unlock();
+
+    if (doneLoading) {
+        // the chunks read in leave the tree dirty, so the next persist or snapshot writes it out along with any edits
+        // made while it was loading
+        qDebug() << "DONE loading all" << _loadingFile->getNumChunks() << "chunks of" << _filename << "in"
+                    << qPrintable(formatUsecTime(usecTimestampNow() - _loadStarted));
+        delete _loadingFile;
+        _loadingFile = NULL;
+    }
+}
+
+bool OctreePersistThread::hasEditJournalToReplay() const {
+    QString journalFilename = _filename + ".journal";
+    return QFile::exists(journalFilename + ".compacting") || QFileInfo(journalFilename).size() > 0;
+}
+
+void OctreePersistThread::replayEditJournal() {
+    // NOTE: the tree is locked for write while the journal is replayed
+    QString journalFilename = _filename + ".journal";
+    QString compactingFilename = journalFilename + ".compacting";
+
+    // a journal still set aside for compaction means we stopped before its snapshot was in place, its edits
+    // come before the ones in the current journal
+    bool snapshotInterrupted = QFile::exists(compactingFilename);
+
+    qint64 validLength = 0;
+    int recordsReplayed = OctreeEditJournal::replay(compactingFilename, _tree, validLength);
+    recordsReplayed += OctreeEditJournal::replay(journalFilename, _tree, validLength);
+    qDebug() << "Replayed" << recordsReplayed << "edits from the edit journal" << journalFilename;
+
+    _editJournal = new OctreeEditJournal(journalFilename);
+    if (!_editJournal->open(validLength)) {
+        qDebug() << "Falling back to persisting the whole tree every persist interval";
+        delete _editJournal;
+        _editJournal = NULL;
+        return;
+    }
+    if (snapshotInterrupted) {
+        _editJournal->requestSnapshot();
+    }
+    _tree->setEditJournal(_editJournal);
+}
+
+void OctreePersistThread::flushEditJournal() {
+    QMutexLocker locker(&_editJournalMutex);
+    _editJournal->flush();
+}
+
+void OctreePersistThread::snapshot() {
+    QMutexLocker locker(&_editJournalMutex);
+    _lastSnapshot = usecTimestampNow();
+
+    if (!_tree->isDirty() && !_editJournal->isSnapshotRequested()) {
+        _editJournal->flush();
+        return;
+    }
+
+    _tree->lockForWrite();
+    {
+        qDebug() << "pruning Octree before snapshot...";
+        _tree->pruneTree();
+        qDebug() << "DONE pruning Octree before snapshot...";
+    }
+    _tree->unlock();
+
+    backup(); // handle backup if requested
+
+    // Set the journal aside first. Edits applied while the snapshot is written land in the new journal, whether or
+    // not the snapshot caught them, replaying them again on top of it leaves the same entities.
+    QString compactingFilename = _editJournal->getFilename() + ".compacting";
+    _editJournal->rotate(compactingFilename);
+    _tree->clearDirtyBit(); // anything changed from here on dirties the tree again
+
+    // the snapshot is written beside the persist file and moved over it once it is on disk, so the persist file is
+    // always a complete snapshot and no lock file is needed
+    QString snapshotFilename = _filename + ".snapshot";
+    qDebug() << "saving Octree snapshot to file " << snapshotFilename << "...";
+    _tree->writeToSVOFile(qPrintable(snapshotFilename), NULL, true);
+
+    QFile snapshotFile(snapshotFilename);
+    if (snapshotFile.open(QIODevice::ReadOnly)) {
+        OctreeEditJournal::syncFile(snapshotFile);
+        snapshotFile.close();
+    }
+
+#ifdef _WIN32
+    remove(qPrintable(_filename)); // rename won't replace an existing file here
+#endif
+    if (rename(qPrintable(snapshotFilename), qPrintable(_filename)) == 0) {
+        remove(qPrintable(compactingFilename));
+        time(&_lastPersistTime);
+        qDebug() << "DONE saving Octree snapshot to file " << _filename << "...";
+    } else {
+        // the set aside journal stays, the next rotate adds to it and startup replays it
+        qDebug() << "ERROR moving Octree snapshot " << snapshotFilename << "to" << _filename << "...";
+        _tree->setDirtyBit(); // try again at the next snapshot interval
+    }
+}
+
 void OctreePersistThread::persist() {
     if (_tree->isDirty()) {
         _tree->lockForWrite();
@@ -224,7 +441,7 @@ void OctreePersistThread::persist() {
 
             qDebug() << "saving Octree to file " << _filename << "...";
             
-            _tree->writeToSVOFile(qPrintable(_filename));
+            _tree->writeToSVOFile(qPrintable(_filename), NULL, true);
             time(&_lastPersistTime);
             _tree->clearDirtyBit(); // tree is clean after saving
             qDebug() << "DONE saving Octree to file...";
@@ -14,9 +14,13 @@
 #ifndef hifi_OctreePersistThread_h
 #define hifi_OctreePersistThread_h
 
+#include <QMutex>
 #include <QString>
 #include <GenericThread.h>
 #include "Octree.h"
+#include "OctreeEditJournal.h"
+
+class OctreeIndexedSVOFile;
 
 /// Generalized threaded processor for handling received inbound packets.
 class OctreePersistThread : public GenericThread {
@@ -32,12 +36,20 @@ public:
     };
 
     static const int DEFAULT_PERSIST_INTERVAL;
+    static const int DEFAULT_SNAPSHOT_INTERVAL;
 
+    /// With wantEditJournal, and a tree that supports it, edits are appended to a journal next to the persist file and
+    /// the whole tree is only written out as a snapshot every snapshotInterval msecs, or once the journal gets large.
     OctreePersistThread(Octree* tree, const QString& filename, int persistInterval = DEFAULT_PERSIST_INTERVAL, 
                                 bool wantBackup = false, const QJsonObject& settings = QJsonObject(), 
-                                bool debugTimestampNow = false);
+                                bool debugTimestampNow = false, bool wantEditJournal = false,
+                                int snapshotInterval = DEFAULT_SNAPSHOT_INTERVAL);
+    virtual ~OctreePersistThread();
 
+    /// with an indexed persist file the initial load completes once the chunks near the origin are in, the rest of the
+    /// tree keeps loading after
     bool isInitialLoadComplete() const { return _initialLoadComplete; }
+    bool isFullyLoaded();
     quint64 getLoadElapsedTime() const { return _loadTimeUSecs; }
 
     void aboutToFinish(); /// call this to inform the persist thread that the owner is about to finish to support final persist
@@ -50,6 +62,12 @@ protected:
     virtual bool process();
     
     void persist();
+    bool loadNearChunks();
+    void loadMoreChunks(quint64 maxUsecs);
+    bool hasEditJournalToReplay() const;
+    void replayEditJournal();
+    void flushEditJournal();
+    void snapshot();
     void backup();
     void rollOldBackupVersions(const BackupRule& rule);
     void restoreFromMostRecentBackup();
@@ -64,6 +82,7 @@ private:
     bool _initialLoadComplete;
 
     quint64 _loadTimeUSecs;
+    quint64 _loadStarted;
 
     time_t _lastPersistTime;
     quint64 _lastCheck;
@@ -72,6 +91,16 @@ private:
     
     bool _debugTimestampNow;
     quint64 _lastTimeDebug;
+
+    bool _wantEditJournal;
+    int _snapshotInterval;
+    OctreeEditJournal* _editJournal;
+    QMutex _editJournalMutex;
+    quint64 _lastJournalFlush;
+    quint64 _lastSnapshot;
+
+    OctreeIndexedSVOFile* _loadingFile; // while the chunks far from the origin are still loading
+    QMutex _loadingMutex;
 };
 
 #endif // hifi_OctreePersistThread_h
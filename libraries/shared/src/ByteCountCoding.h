@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cstring>
 #include <limits>
 
 #include <QBitArray>
@@ -36,7 +37,14 @@ public:
 
     ByteCountCoded(const QByteArray& fromEncoded) : data(0) { decode(fromEncoded); }
 
+    /// the most bytes a value of this type encodes to
+    static const int MAX_ENCODED_BYTES = (sizeof(T) * BITS_IN_BYTE) / (BITS_IN_BYTE - 1) + 1;
+
     QByteArray encode() const;
+    
+    /// encodes into a buffer of at least MAX_ENCODED_BYTES without allocating, returns the number of bytes written
+    int encode(unsigned char* output) const;
+    
     void decode(const QByteArray& fromEncoded);
 
     bool operator==(const ByteCountCoded& other) const { return data == other.data; }
@@ -57,8 +65,12 @@ template<typename T> inline QByteArray& operator>>(QByteArray& in, ByteCountCode
 }
 
 template<typename T> inline QByteArray ByteCountCoded<T>::encode() const {
-    QByteArray output;
+    unsigned char output[MAX_ENCODED_BYTES];
+    int numberOfBytes = encode(output);
+    return QByteArray((const char*)output, numberOfBytes);
+}
 
+template<typename T> inline int ByteCountCoded<T>::encode(unsigned char* output) const {
     int totalBits = sizeof(data) * BITS_IN_BYTE;
     int valueBits = totalBits;
     bool firstValueFound = false;
@@ -83,16 +95,14 @@ template<typename T> inline QByteArray ByteCountCoded<T>::encode() const {
     // + 1 because we always take at least 1 byte, even if number of bits is less than a bytes worth
     int numberOfBytes = (valueBits / (BITS_IN_BYTE - 1)) + 1; 
 
-    output.fill(0, numberOfBytes);
+    memset(output, 0, numberOfBytes);
 
     // next pack the number of header bits in, the first N-1 to be set to 1, the last to be set to 0
     for(int i = 0; i < numberOfBytes; i++) {
         int outputIndex = i;
         T bitValue = (i < (numberOfBytes - 1)  ? 1 : 0);
-        char original = output.at(outputIndex / BITS_IN_BYTE);
         int shiftBy = BITS_IN_BYTE - ((outputIndex % BITS_IN_BYTE) + 1);
-        char thisBit = ( bitValue << shiftBy);
-        output[i / BITS_IN_BYTE] = (original | thisBit);
+        output[outputIndex / BITS_IN_BYTE] |= (unsigned char)(bitValue << shiftBy);
     }
 
     // finally pack the the actual bits from the bit array
@@ -100,14 +110,12 @@ template<typename T> inline QByteArray ByteCountCoded<T>::encode() const {
     for(int i = numberOfBytes; i < (numberOfBytes + valueBits); i++) {
         int outputIndex = i;
         T bitValue = (temp & 1);
-        char original = output.at(outputIndex / BITS_IN_BYTE);
         int shiftBy = BITS_IN_BYTE - ((outputIndex % BITS_IN_BYTE) + 1);
-        char thisBit = ( bitValue << shiftBy);
-        output[i / BITS_IN_BYTE] = (original | thisBit);
+        output[outputIndex / BITS_IN_BYTE] |= (unsigned char)(bitValue << shiftBy);
 
         temp = temp >> 1;
     }
-    return output;
+    return numberOfBytes;
 }
 
 template<typename T> inline void ByteCountCoded<T>::decode(const QByteArray& fromEncodedBytes) {
@@ -0,0 +1,146 @@
+//
+//  IndexedMinHeap.h
+//  libraries/shared/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_IndexedMinHeap_h
+#define hifi_IndexedMinHeap_h
+
+#include <assert.h>
+#include <utility>
+#include <vector>
+
+#include <qhash.h>
+
+/// A binary min-heap of items that also knows where each item is in it, so an item's priority can be changed or the
+/// item removed in O(log n) without searching for it. Each item is in the heap at most once.
+template <typename T, typename Priority>
+class IndexedMinHeap {
+
+public:
+    bool isEmpty() const { return _heap.empty(); }
+    int size() const { return (int)_heap.size(); }
+    bool contains(const T& item) const { return _indices.contains(item); }
+
+    /// the item with the lowest priority, the heap must not be empty
+    const T& top() const { assert(!isEmpty()); return _heap[0].item; }
+    Priority topPriority() const { assert(!isEmpty()); return _heap[0].priority; }
+
+    /// adds the item, or moves it to the new priority if it is already in the heap
+    void insertOrUpdate(const T& item, Priority priority) {
+        typename QHash<T, int>::const_iterator indexItr = _indices.constFind(item);
+        if (indexItr == _indices.constEnd()) {
+            int index = size();
+            _heap.push_back(Entry(item, priority));
+            _indices.insert(item, index);
+            siftUp(index);
+        } else {
+            int index = indexItr.value();
+            Priority oldPriority = _heap[index].priority;
+            _heap[index].priority = priority;
+            if (priority < oldPriority) {
+                siftUp(index);
+            } else {
+                siftDown(index);
+            }
+        }
+    }
+
+    /// returns false if the item wasn't in the heap
+    bool remove(const T& item) {
+        typename QHash<T, int>::iterator indexItr = _indices.find(item);
+        if (indexItr == _indices.end()) {
+            return false;
+        }
+        int index = indexItr.value();
+        _indices.erase(indexItr);
+        removeAt(index);
+        return true;
+    }
+
+    /// removes and returns the item with the lowest priority, the heap must not be empty
+    T pop() {
+        assert(!isEmpty());
+        T item = _heap[0].item;
+        _indices.remove(item);
+        removeAt(0);
+        return item;
+    }
+
+    void clear() {
+        _heap.clear();
+        _indices.clear();
+    }
+
+private:
+    struct Entry {
+        Entry(const T& item, Priority priority) : item(item), priority(priority) { }
+        T item;
+        Priority priority;
+    };
+
+    // the item at index has already been taken out of _indices
+    void removeAt(int index) {
+        int lastIndex = size() - 1;
+        if (index != lastIndex) {
+            _heap[index] = _heap[lastIndex];
+            _indices[_heap[index].item] = index;
+            _heap.pop_back();
+            // the entry moved from the end may belong above or below where it landed
+            if (index > 0 && _heap[index].priority < _heap[(index - 1) / 2].priority) {
+                siftUp(index);
+            } else {
+                siftDown(index);
+            }
+        } else {
+            _heap.pop_back();
+        }
+    }
+
+    void siftUp(int index) {
+        while (index > 0) {
+            int parent = (index - 1) / 2;
+            if (!(_heap[index].priority < _heap[parent].priority)) {
+                break;
+            }
+            swapEntries(index, parent);
+            index = parent;
+        }
+    }
+
+    void siftDown(int index) {
+        int heapSize = size();
+        while (true) {
+            int smallest = index;
+            int left = 2 * index + 1;
+            int right = left + 1;
+            if (left < heapSize && _heap[left].priority < _heap[smallest].priority) {
+                smallest = left;
+            }
+            if (right < heapSize && _heap[right].priority < _heap[smallest].priority) {
+                smallest = right;
+            }
+            if (smallest == index) {
+                break;
+            }
+            swapEntries(index, smallest);
+            index = smallest;
+        }
+    }
+
+    void swapEntries(int a, int b) {
+        std::swap(_heap[a], _heap[b]);
+        _indices[_heap[a].item] = a;
+        _indices[_heap[b].item] = b;
+    }
+
+    std::vector<Entry> _heap;
+    QHash<T, int> _indices;
+};
+
+#endif // hifi_IndexedMinHeap_h
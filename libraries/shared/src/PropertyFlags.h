@@ -21,12 +21,15 @@
 
 #include <algorithm>
 #include <climits>
+#include <cstring>
 
 #include <QBitArray>
 #include <QByteArray>
 
 #include <SharedUtil.h>
 
+const int BITS_PER_BYTE = 8;
+
 template<typename Enum>class PropertyFlags {
 public:
     typedef Enum enum_type;
@@ -51,6 +54,13 @@ public:
     void setHasProperty(Enum flag, bool value = true);
     bool getHasProperty(Enum flag) const;
     QByteArray encode();
+    
+    /// the number of bytes encode() writes
+    int getEncodedSize() const { return (_maxFlag < _minFlag) ? 1 : (_maxFlag / (BITS_PER_BYTE - 1)) + 1; }
+    
+    /// encodes into a buffer of at least getEncodedSize() bytes without allocating, returns the number of bytes written
+    int encode(unsigned char* output);
+    
     void decode(const QByteArray& fromEncoded);
 
     operator QByteArray() { return encode(); };
@@ -153,29 +163,27 @@ template<typename Enum> inline bool PropertyFlags<Enum>::getHasProperty(Enum fla
     return _flags.testBit(flag);
 }
 
-const int BITS_PER_BYTE = 8;
-
 template<typename Enum> inline QByteArray PropertyFlags<Enum>::encode() {
-    QByteArray output;
-    
+    QByteArray output(getEncodedSize(), 0);
+    encode((unsigned char*)output.data());
+    return output;
+}
+
+template<typename Enum> inline int PropertyFlags<Enum>::encode(unsigned char* output) {
     if (_maxFlag < _minFlag) {
-        output.fill(0, 1);
-        return output; // no flags... nothing to encode
+        output[0] = 0;
+        return 1; // no flags... nothing to encode
     }
 
-    // we should size the array to the correct size.
-    int lengthInBytes = (_maxFlag / (BITS_PER_BYTE - 1)) + 1;
-
-    output.fill(0, lengthInBytes);
+    int lengthInBytes = getEncodedSize();
+    memset(output, 0, lengthInBytes);
 
     // next pack the number of header bits in, the first N-1 to be set to 1, the last to be set to 0
     for(int i = 0; i < lengthInBytes; i++) {
         int outputIndex = i;
         int bitValue = (i < (lengthInBytes - 1)  ? 1 : 0);
-        char original = output.at(outputIndex / BITS_PER_BYTE);
         int shiftBy = BITS_PER_BYTE - ((outputIndex % BITS_PER_BYTE) + 1);
-        char thisBit = ( bitValue << shiftBy);
-        output[i / BITS_PER_BYTE] = (original | thisBit);
+        output[outputIndex / BITS_PER_BYTE] |= (unsigned char)(bitValue << shiftBy);
     }
 
     // finally pack the the actual bits from the bit array
@@ -183,14 +191,12 @@ template<typename Enum> inline QByteArray PropertyFlags<Enum>::encode() {
         int flagIndex = i - lengthInBytes;
         int outputIndex = i;
         int bitValue = ( _flags[flagIndex]  ? 1 : 0);
-        char original = output.at(outputIndex / BITS_PER_BYTE);
         int shiftBy = BITS_PER_BYTE - ((outputIndex % BITS_PER_BYTE) + 1);
-        char thisBit = ( bitValue << shiftBy);
-        output[i / BITS_PER_BYTE] = (original | thisBit);
+        output[outputIndex / BITS_PER_BYTE] |= (unsigned char)(bitValue << shiftBy);
     }
     
     _encodedLength = lengthInBytes;
-    return output;
+    return lengthInBytes;
 }
 
 template<typename Enum> inline void PropertyFlags<Enum>::decode(const QByteArray& fromEncodedBytes) {
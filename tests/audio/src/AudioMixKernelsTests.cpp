@@ -0,0 +1,120 @@
+//
+//  AudioMixKernelsTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <AudioConstants.h>
+#include <AudioMixKernels.h>
+
+#include "AudioMixKernelsTests.h"
+
+using namespace AudioMixKernels;
+
+const int FRAME_SAMPLES = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO;
+const int FRAME_FRAMES = AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL;
+const int MAX_DELAY = 20;
+const int NUM_BENCHMARK_FRAMES = 200000;
+
+static void fillRandom(int16_t* samples, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+        samples[i] = (int16_t)(rand() - (RAND_MAX / 2));
+    }
+}
+
+void AudioMixKernelsTests::runAllTests() {
+    compareInstructionSets();
+    benchmarkInstructionSets();
+}
+
+void AudioMixKernelsTests::compareInstructionSets() {
+    int16_t input[FRAME_SAMPLES + MAX_DELAY];
+    int16_t startingOutput[FRAME_SAMPLES];
+    fillRandom(input, FRAME_SAMPLES + MAX_DELAY);
+    fillRandom(startingOutput, FRAME_SAMPLES);
+    
+    // odd sizes and offsets so the scalar tails and unaligned loads are covered too
+    const int NUM_SAMPLES = FRAME_SAMPLES - 3;
+    const int NUM_FRAMES = FRAME_FRAMES - 5;
+    const float LEFT_GAIN = 0.71f;
+    const float RIGHT_GAIN = 1.37f;
+    
+    int16_t expected[3][FRAME_SAMPLES];
+    int16_t actual[3][FRAME_SAMPLES];
+    
+    InstructionSet bestInstructionSet = getBestInstructionSet();
+    
+    for (int set = Scalar; set <= bestInstructionSet; set++) {
+        setInstructionSet((InstructionSet)set);
+        int16_t (*output)[FRAME_SAMPLES] = (set == Scalar) ? expected : actual;
+        
+        memcpy(output[0], startingOutput, sizeof(startingOutput));
+        addMonoToStereo(output[0], input + 1, input + 1 + MAX_DELAY, NUM_FRAMES, LEFT_GAIN, RIGHT_GAIN);
+        
+        memcpy(output[1], startingOutput, sizeof(startingOutput));
+        addWithGain(output[1], input + 3, NUM_SAMPLES, RIGHT_GAIN);
+        
+        memcpy(output[2], startingOutput, sizeof(startingOutput));
+        addSaturated(output[2], input + 5, NUM_SAMPLES);
+        
+        if (set != Scalar) {
+            for (int kernel = 0; kernel < 3; kernel++) {
+                if (memcmp(expected[kernel], actual[kernel], sizeof(startingOutput)) != 0) {
+                    qDebug() << "FAILED - kernel" << kernel << "differs between scalar and"
+                        << getInstructionSetName((InstructionSet)set);
+                }
+            }
+        }
+    }
+    
+    setInstructionSet(bestInstructionSet);
+}
+
+void AudioMixKernelsTests::benchmarkInstructionSets() {
+    int16_t input[FRAME_SAMPLES + MAX_DELAY];
+    int16_t output[FRAME_SAMPLES];
+    fillRandom(input, FRAME_SAMPLES + MAX_DELAY);
+    
+    InstructionSet bestInstructionSet = getBestInstructionSet();
+    
+    for (int set = Scalar; set <= bestInstructionSet; set++) {
+        setInstructionSet((InstructionSet)set);
+        memset(output, 0, sizeof(output));
+        
+        QElapsedTimer timer;
+        
+        timer.start();
+        for (int i = 0; i < NUM_BENCHMARK_FRAMES; i++) {
+            addMonoToStereo(output, input, input + (i % MAX_DELAY), FRAME_FRAMES, 0.5f, 0.25f);
+        }
+        double monoToStereoNsecs = (double)timer.nsecsElapsed() / NUM_BENCHMARK_FRAMES;
+        
+        timer.restart();
+        for (int i = 0; i < NUM_BENCHMARK_FRAMES; i++) {
+            addWithGain(output, input, FRAME_SAMPLES, 0.5f);
+        }
+        double withGainNsecs = (double)timer.nsecsElapsed() / NUM_BENCHMARK_FRAMES;
+        
+        timer.restart();
+        for (int i = 0; i < NUM_BENCHMARK_FRAMES; i++) {
+            addSaturated(output, input, FRAME_SAMPLES);
+        }
+        double saturatedNsecs = (double)timer.nsecsElapsed() / NUM_BENCHMARK_FRAMES;
+        
+        // print one output sample so the loops can't be optimized away
+        qDebug("%-6s nsecs per frame | mono to stereo: %8.1f  stereo with gain: %8.1f  saturated add: %8.1f  (%d)",
+               getInstructionSetName((InstructionSet)set), monoToStereoNsecs, withGainNsecs, saturatedNsecs, output[7]);
+    }
+    
+    setInstructionSet(bestInstructionSet);
+}
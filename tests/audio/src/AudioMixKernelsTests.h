@@ -0,0 +1,25 @@
+//
+//  AudioMixKernelsTests.h
+//  tests/audio/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixKernelsTests_h
+#define hifi_AudioMixKernelsTests_h
+
+namespace AudioMixKernelsTests {
+
+    void runAllTests();
+    
+    // checks that every supported instruction set mixes exactly like the scalar kernels
+    void compareInstructionSets();
+    
+    // times each kernel per 512 sample network frame for every supported instruction set
+    void benchmarkInstructionSets();
+};
+
+#endif // hifi_AudioMixKernelsTests_h
@@ -0,0 +1,91 @@
+//
+//  AudioBenchmarks.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <QtCore/QVector>
+
+#include <AudioConstants.h>
+#include <AudioSourceMix.h>
+#include <SharedUtil.h>
+
+#include "AudioBenchmarks.h"
+#include "BenchmarkRunner.h"
+
+// the audio-mixer's limit on how far the weak channel is delayed for phase panning
+const int MAX_PHASE_DELAY_SAMPLES = 20;
+
+const int INPUT_SAMPLES = MAX_PHASE_DELAY_SAMPLES + AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL;
+
+class MixSource {
+public:
+    int16_t samples[INPUT_SAMPLES];
+    int delaySamples;
+    float gain;
+    float weakChannelGain;
+    bool rightSideWeak;
+    float filterGainLeft;
+    float filterGainRight;
+    AudioFilterHSF1s penumbraFilter;
+};
+
+void AudioBenchmarks::runAll(BenchmarkRunner& runner) {
+    benchmarkListenerMix(runner);
+}
+
+void AudioBenchmarks::benchmarkListenerMix(BenchmarkRunner& runner) {
+    const int SOURCE_COUNTS[] = { 8, 32 };
+
+    for (unsigned int count = 0; count < sizeof(SOURCE_COUNTS) / sizeof(SOURCE_COUNTS[0]); count++) {
+        int numSources = SOURCE_COUNTS[count];
+        QString name = QString("audio/listener_mix/%1_sources").arg(numSources);
+        if (!runner.wants(name)) {
+            continue;
+        }
+
+        QVector<MixSource*> sources;
+        for (int i = 0; i < numSources; i++) {
+            MixSource* source = new MixSource();
+            for (int j = 0; j < INPUT_SAMPLES; j++) {
+                source->samples[j] = (int16_t)(rand() - (RAND_MAX / 2));
+            }
+            source->delaySamples = randIntInRange(0, MAX_PHASE_DELAY_SAMPLES);
+            source->gain = randFloatInRange(0.05f, 1.0f);
+            source->weakChannelGain = source->gain * randFloatInRange(0.5f, 1.0f);
+            source->rightSideWeak = randomBoolean();
+            source->filterGainLeft = randFloatInRange(0.708f, 1.0f);
+            source->filterGainRight = randFloatInRange(0.708f, 1.0f);
+            source->penumbraFilter.initialize(AudioConstants::SAMPLE_RATE,
+                                              AudioConstants::NETWORK_FRAME_SAMPLES_STEREO / 2);
+            sources.append(source);
+        }
+
+        int16_t preMixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO];
+        int16_t mixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO];
+
+        runner.run(name, [&]() {
+            memset(preMixSamples, 0, sizeof(preMixSamples));
+            memset(mixSamples, 0, sizeof(mixSamples));
+
+            // the mixer's own steps for each source, so this times what the mixer runs
+            foreach (MixSource* source, sources) {
+                AudioSourceMix::addMonoSource(preMixSamples,
+                                              source->samples + MAX_PHASE_DELAY_SAMPLES - source->delaySamples,
+                                              source->delaySamples, source->rightSideWeak, source->gain,
+                                              source->weakChannelGain);
+                AudioSourceMix::filterAndMix(mixSamples, preMixSamples, &source->penumbraFilter,
+                                             source->filterGainLeft, source->filterGainRight);
+            }
+        });
+
+        qDeleteAll(sources);
+    }
+}
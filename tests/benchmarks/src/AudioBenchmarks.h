@@ -0,0 +1,24 @@
+//
+//  AudioBenchmarks.h
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioBenchmarks_h
+#define hifi_AudioBenchmarks_h
+
+class BenchmarkRunner;
+
+namespace AudioBenchmarks {
+
+    void runAll(BenchmarkRunner& runner);
+
+    // one listener's mix of a frame from many mono sources, the per source work the audio-mixer does
+    void benchmarkListenerMix(BenchmarkRunner& runner);
+};
+
+#endif // hifi_AudioBenchmarks_h
@@ -0,0 +1,61 @@
+//
+//  AvatarBenchmarks.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <AvatarData.h>
+#include <SharedUtil.h>
+
+#include "AvatarBenchmarks.h"
+#include "BenchmarkRunner.h"
+
+const int NUM_SKELETON_JOINTS = 64;
+
+static glm::quat randomRotation() {
+    return glm::normalize(glm::quat(randFloatInRange(-1.0f, 1.0f), randFloatInRange(-1.0f, 1.0f),
+                                    randFloatInRange(-1.0f, 1.0f), randFloatInRange(-1.0f, 1.0f)));
+}
+
+void AvatarBenchmarks::runAll(BenchmarkRunner& runner) {
+    benchmarkAvatarData(runner);
+}
+
+void AvatarBenchmarks::benchmarkAvatarData(BenchmarkRunner& runner) {
+    const QString PACK_NAME = "avatar/to_byte_array";
+    const QString PARSE_NAME = "avatar/parse_data_at_offset";
+    if (!runner.wants(PACK_NAME) && !runner.wants(PARSE_NAME)) {
+        return;
+    }
+
+    AvatarData sender;
+    sender.setPosition(glm::vec3(randFloatInRange(0.0f, 100.0f), 1.0f, randFloatInRange(0.0f, 100.0f)));
+    sender.setOrientation(randomRotation());
+
+    QVector<JointData> joints(NUM_SKELETON_JOINTS);
+    for (int i = 0; i < NUM_SKELETON_JOINTS; i++) {
+        joints[i].valid = true;
+        joints[i].rotation = randomRotation();
+    }
+    sender.setJointData(joints);
+
+    // packing allocates the head, so pack once before touching it
+    QByteArray packed = sender.toByteArray();
+    sender.setHeadOrientation(randomRotation());
+    packed = sender.toByteArray();
+
+    runner.run(PACK_NAME, [&]() {
+        packed = sender.toByteArray();
+    });
+
+    AvatarData receiver;
+    runner.run(PARSE_NAME, [&]() {
+        receiver.parseDataAtOffset(packed, 0);
+    });
+}
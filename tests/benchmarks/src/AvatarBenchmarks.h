@@ -0,0 +1,24 @@
+//
+//  AvatarBenchmarks.h
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AvatarBenchmarks_h
+#define hifi_AvatarBenchmarks_h
+
+class BenchmarkRunner;
+
+namespace AvatarBenchmarks {
+
+    void runAll(BenchmarkRunner& runner);
+
+    // packing and unpacking an avatar with a full skeleton, what the avatar-mixer does for every avatar it relays
+    void benchmarkAvatarData(BenchmarkRunner& runner);
+};
+
+#endif // hifi_AvatarBenchmarks_h
@@ -0,0 +1,117 @@
+//
+//  BenchmarkRunner.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <stdlib.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QVector>
+
+#include "BenchmarkRunner.h"
+
+const unsigned int BenchmarkRunner::BENCHMARK_SEED = 0x4869f1;
+
+const int BENCHMARK_FORMAT_VERSION = 1;
+
+// a batch should take at least this long so the timer's resolution and overhead don't show in the samples
+const qint64 TARGET_BATCH_NSECS = 20 * 1000;
+const int MAX_BATCH_SIZE = 1 << 20;
+const qint64 WARMUP_NSECS = 100 * 1000 * 1000;
+const int MIN_SAMPLES = 50;
+
+static double percentile(const QVector<double>& sortedSamples, double fraction) {
+    int index = std::min((int)(fraction * sortedSamples.size()), sortedSamples.size() - 1);
+    return sortedSamples[index];
+}
+
+BenchmarkRunner::BenchmarkRunner(const QString& filter, float secondsPerBenchmark) :
+    _filter(filter),
+    _secondsPerBenchmark(secondsPerBenchmark)
+{
+}
+
+bool BenchmarkRunner::wants(const QString& name) {
+    if (!_filter.isEmpty() && !name.contains(_filter)) {
+        return false;
+    }
+    srand(BENCHMARK_SEED);
+    return true;
+}
+
+void BenchmarkRunner::run(const QString& name, std::function<void()> operation) {
+    if (!wants(name)) {
+        return;
+    }
+
+    // warm the caches and find a batch size, doubling it until a batch takes long enough to time
+    QElapsedTimer timer;
+    int batchSize = 1;
+    qint64 warmupStarted = 0;
+    timer.start();
+    while (true) {
+        qint64 batchStarted = timer.nsecsElapsed();
+        for (int i = 0; i < batchSize; i++) {
+            operation();
+        }
+        qint64 batchNsecs = timer.nsecsElapsed() - batchStarted;
+        if (batchNsecs < TARGET_BATCH_NSECS && batchSize < MAX_BATCH_SIZE) {
+            batchSize *= 2;
+        } else if (timer.nsecsElapsed() - warmupStarted >= WARMUP_NSECS) {
+            break;
+        }
+    }
+
+    QVector<double> samples;
+    qint64 timedNsecs = 0;
+    qint64 benchmarkNsecs = (qint64)(_secondsPerBenchmark * 1000 * 1000 * 1000);
+    while (timedNsecs < benchmarkNsecs || samples.size() < MIN_SAMPLES) {
+        qint64 batchStarted = timer.nsecsElapsed();
+        for (int i = 0; i < batchSize; i++) {
+            operation();
+        }
+        qint64 batchNsecs = timer.nsecsElapsed() - batchStarted;
+        timedNsecs += batchNsecs;
+        samples.append((double)batchNsecs / batchSize);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    quint64 numOperations = (quint64)samples.size() * batchSize;
+    double opsPerSecond = numOperations / (timedNsecs / 1.0e9);
+
+    QJsonObject latency;
+    latency["p50"] = percentile(samples, 0.5);
+    latency["p90"] = percentile(samples, 0.9);
+    latency["p99"] = percentile(samples, 0.99);
+    latency["max"] = samples.last();
+
+    QJsonObject result;
+    result["name"] = name;
+    result["operations"] = (double)numOperations;
+    result["batch_size"] = batchSize;
+    result["seconds"] = timedNsecs / 1.0e9;
+    result["ops_per_second"] = opsPerSecond;
+    result["latency_nsecs"] = latency;
+    _results.append(result);
+
+    qDebug("%-48s %14.1f ops/s  p50 %12.1f ns  p99 %12.1f ns", qPrintable(name), opsPerSecond,
+           latency["p50"].toDouble(), latency["p99"].toDouble());
+}
+
+QJsonDocument BenchmarkRunner::toJson() const {
+    QJsonObject document;
+    document["format_version"] = BENCHMARK_FORMAT_VERSION;
+    document["seed"] = (double)BENCHMARK_SEED;
+    document["qt_version"] = QString(qVersion());
+    document["seconds_per_benchmark"] = _secondsPerBenchmark;
+    document["benchmarks"] = _results;
+    return QJsonDocument(document);
+}
@@ -0,0 +1,44 @@
+//
+//  BenchmarkRunner.h
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_BenchmarkRunner_h
+#define hifi_BenchmarkRunner_h
+
+#include <functional>
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QString>
+
+/// Times benchmarks and collects their results as JSON. An operation is timed in batches sized so a batch takes long
+/// enough to time reliably, the latencies reported are per operation averaged over each batch. Operations slower
+/// than the batch target are timed one at a time. The random seed is reset before each benchmark sets up, so every
+/// run generates the same scenes.
+class BenchmarkRunner {
+public:
+    static const unsigned int BENCHMARK_SEED;
+
+    BenchmarkRunner(const QString& filter, float secondsPerBenchmark);
+
+    /// whether a benchmark runs with this filter, for skipping expensive setup. Also reseeds the random generator.
+    bool wants(const QString& name);
+
+    /// warms up, then times the operation for the configured number of seconds
+    void run(const QString& name, std::function<void()> operation);
+
+    QJsonDocument toJson() const;
+
+private:
+    QString _filter;
+    float _secondsPerBenchmark;
+    QJsonArray _results;
+};
+
+#endif // hifi_BenchmarkRunner_h
@@ -0,0 +1,121 @@
+//
+//  EntityBenchmarks.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <EntityItemProperties.h>
+#include <EntityTree.h>
+#include <LimitedNodeList.h>
+#include <OctreeElementBag.h>
+#include <OctreePacketData.h>
+#include <SharedUtil.h>
+
+#include "BenchmarkRunner.h"
+#include "EntityBenchmarks.h"
+
+// scenes are generated in a region this many meters on a side
+const float SCENE_SIZE = 256.0f;
+
+// QUuid::createUuid doesn't use the seeded generator, so the scenes make their own
+static QUuid randomUuid() {
+    return QUuid(rand(), rand(), rand(), rand(), rand(), rand(), rand(), rand(), rand(), rand(), rand());
+}
+
+static EntityItemProperties randomBoxProperties() {
+    EntityItemProperties properties;
+    properties.setType(EntityTypes::Box);
+    properties.setPosition(glm::vec3(randFloatInRange(0.0f, SCENE_SIZE), randFloatInRange(0.0f, SCENE_SIZE / 8.0f),
+                                     randFloatInRange(0.0f, SCENE_SIZE)));
+    float size = randFloatInRange(0.25f, 4.0f);
+    properties.setDimensions(glm::vec3(size, size, size));
+    properties.setRotation(glm::angleAxis(randFloatInRange(0.0f, TWO_PI), glm::vec3(0.0f, 1.0f, 0.0f)));
+    xColor color = { (unsigned char)randIntInRange(0, 255), (unsigned char)randIntInRange(0, 255),
+                     (unsigned char)randIntInRange(0, 255) };
+    properties.setColor(color);
+    return properties;
+}
+
+void EntityBenchmarks::runAll(BenchmarkRunner& runner) {
+    benchmarkEncodeTreeBitstream(runner);
+    benchmarkEditProperties(runner);
+}
+
+void EntityBenchmarks::benchmarkEncodeTreeBitstream(BenchmarkRunner& runner) {
+    const int ENTITY_COUNTS[] = { 1000, 10000 };
+
+    for (unsigned int count = 0; count < sizeof(ENTITY_COUNTS) / sizeof(ENTITY_COUNTS[0]); count++) {
+        int numEntities = ENTITY_COUNTS[count];
+        QString name = QString("octree/encode_tree_bitstream/%1_entities").arg(numEntities);
+        if (!runner.wants(name)) {
+            continue;
+        }
+
+        EntityTree tree;
+        for (int i = 0; i < numEntities; i++) {
+            EntityItemID entityID(randomUuid());
+            entityID.isKnownID = false; // as the entity tests do, so a local tree takes an entity with a known ID
+            tree.addEntity(entityID, randomBoxProperties());
+        }
+
+        runner.run(name, [&]() {
+            OctreeElementBag elementBag;
+            OctreeElementExtraEncodeData extraEncodeData;
+            OctreePacketData packetData;
+            elementBag.insert(tree.getRoot());
+
+            // the same packet by packet loop the persist thread's writer uses
+            while (!elementBag.isEmpty()) {
+                OctreeElement* subTree = elementBag.extract();
+                EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS);
+                params.extraEncodeData = &extraEncodeData;
+                int bytesWritten = tree.encodeTreeBitstream(subTree, &packetData, elementBag, params);
+                if (bytesWritten == 0 && params.stopReason == EncodeBitstreamParams::DIDNT_FIT) {
+                    packetData.reset();
+                    elementBag.insert(subTree);
+                }
+            }
+            tree.releaseSceneEncodeData(&extraEncodeData);
+        });
+    }
+}
+
+void EntityBenchmarks::benchmarkEditProperties(BenchmarkRunner& runner) {
+    const QString ENCODE_NAME = "entities/encode_edit_properties";
+    const QString DECODE_NAME = "entities/decode_edit_properties";
+    if (!runner.wants(ENCODE_NAME) && !runner.wants(DECODE_NAME)) {
+        return;
+    }
+
+    EntityItemID entityID(randomUuid());
+    EntityItemProperties properties = randomBoxProperties();
+    properties.setVelocity(glm::vec3(randFloatInRange(-1.0f, 1.0f), 0.0f, randFloatInRange(-1.0f, 1.0f)));
+    properties.setGravity(glm::vec3(0.0f, -9.8f, 0.0f));
+    properties.setLifetime(60.0f);
+    properties.setScript("http://example.com/scripts/benchmark.js");
+
+    unsigned char editBuffer[MAX_PACKET_SIZE];
+    int editLength = 0;
+    runner.run(ENCODE_NAME, [&]() {
+        EntityItemProperties::encodeEntityEditPacket(PacketTypeEntityAddOrEdit, entityID, properties,
+                                                     editBuffer, MAX_PACKET_SIZE, editLength);
+    });
+
+    EntityItemProperties::encodeEntityEditPacket(PacketTypeEntityAddOrEdit, entityID, properties,
+                                                 editBuffer, MAX_PACKET_SIZE, editLength);
+    runner.run(DECODE_NAME, [&]() {
+        int processedBytes = 0;
+        EntityItemID decodedID;
+        EntityItemProperties decodedProperties;
+        EntityItemProperties::decodeEntityEditPacket(editBuffer, editLength, processedBytes,
+                                                     decodedID, decodedProperties);
+    });
+}
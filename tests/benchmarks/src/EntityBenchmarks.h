@@ -0,0 +1,27 @@
+//
+//  EntityBenchmarks.h
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityBenchmarks_h
+#define hifi_EntityBenchmarks_h
+
+class BenchmarkRunner;
+
+namespace EntityBenchmarks {
+
+    void runAll(BenchmarkRunner& runner);
+
+    // encoding a whole generated entity scene into packets, as the entity-server does for a client seeing all of it
+    void benchmarkEncodeTreeBitstream(BenchmarkRunner& runner);
+
+    // encoding and decoding the edit message for an entity with the commonly edited properties set
+    void benchmarkEditProperties(BenchmarkRunner& runner);
+};
+
+#endif // hifi_EntityBenchmarks_h
@@ -0,0 +1,95 @@
+//
+//  MetavoxelBenchmarks.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <limits.h>
+
+#include <QtCore/QDataStream>
+
+#include <AttributeRegistry.h>
+#include <Bitstream.h>
+#include <MetavoxelData.h>
+#include <SharedUtil.h>
+
+#include "BenchmarkRunner.h"
+#include "MetavoxelBenchmarks.h"
+
+const float MAXIMUM_LEAF_SIZE = 0.5f;
+const float MINIMUM_LEAF_SIZE = 0.125f;
+const int NUM_MUTATIONS = 4;
+
+/// fills the tree with leaves of random sizes and values, like the metavoxel tests' server
+class RandomLeafVisitor : public MetavoxelVisitor {
+public:
+    RandomLeafVisitor(const AttributePointer& attribute, int maxLeaves);
+
+    virtual int visit(MetavoxelInfo& info);
+
+private:
+    int _leavesRemaining;
+};
+
+RandomLeafVisitor::RandomLeafVisitor(const AttributePointer& attribute, int maxLeaves) :
+    MetavoxelVisitor(QVector<AttributePointer>(), QVector<AttributePointer>() << attribute),
+    _leavesRemaining(maxLeaves) {
+}
+
+int RandomLeafVisitor::visit(MetavoxelInfo& info) {
+    if (_leavesRemaining <= 0) {
+        return STOP_RECURSION;
+    }
+    if (info.size > MAXIMUM_LEAF_SIZE || (info.size > MINIMUM_LEAF_SIZE && randomBoolean())) {
+        return encodeRandomOrder();
+    }
+    info.outputValues[0] = OwnedAttributeValue(_outputs.at(0), encodeInline<float>(randFloat()));
+    _leavesRemaining--;
+    return STOP_RECURSION;
+}
+
+void MetavoxelBenchmarks::runAll(BenchmarkRunner& runner) {
+    benchmarkDeltas(runner);
+}
+
+void MetavoxelBenchmarks::benchmarkDeltas(BenchmarkRunner& runner) {
+    const QString WRITE_NAME = "metavoxels/write_delta";
+    const QString READ_NAME = "metavoxels/read_delta";
+    if (!runner.wants(WRITE_NAME) && !runner.wants(READ_NAME)) {
+        return;
+    }
+
+    AttributePointer attribute = AttributeRegistry::getInstance()->registerAttribute(
+        new FloatAttribute("benchmarkAttribute"));
+    MetavoxelLOD lod(glm::vec3(), 0.01f);
+
+    MetavoxelData reference;
+    reference.expand();
+    reference.expand();
+    RandomLeafVisitor fillVisitor(attribute, INT_MAX);
+    reference.guide(fillVisitor);
+
+    MetavoxelData mutated = reference;
+    RandomLeafVisitor mutateVisitor(attribute, NUM_MUTATIONS);
+    mutated.guide(mutateVisitor);
+
+    QByteArray delta;
+    runner.run(WRITE_NAME, [&]() {
+        delta.clear();
+        QDataStream outStream(&delta, QIODevice::WriteOnly);
+        Bitstream out(outStream);
+        mutated.writeDelta(reference, lod, out, lod);
+        out.flush();
+    });
+
+    runner.run(READ_NAME, [&]() {
+        QDataStream inStream(delta);
+        Bitstream in(inStream);
+        MetavoxelData received;
+        received.readDelta(reference, lod, in, lod);
+    });
+}
@@ -0,0 +1,25 @@
+//
+//  MetavoxelBenchmarks.h
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_MetavoxelBenchmarks_h
+#define hifi_MetavoxelBenchmarks_h
+
+class BenchmarkRunner;
+
+namespace MetavoxelBenchmarks {
+
+    void runAll(BenchmarkRunner& runner);
+
+    // writing and reading the Bitstream delta between two versions of a metavoxel tree a few leaves apart, as the
+    // metavoxel server sends each frame
+    void benchmarkDeltas(BenchmarkRunner& runner);
+};
+
+#endif // hifi_MetavoxelBenchmarks_h
@@ -0,0 +1,47 @@
+//
+//  NetworkingBenchmarks.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+
+#include <LimitedNodeList.h>
+#include <PacketAuthenticator.h>
+#include <PacketHeaders.h>
+
+#include "BenchmarkRunner.h"
+#include "NetworkingBenchmarks.h"
+
+using namespace PacketAuthenticator;
+
+void NetworkingBenchmarks::runAll(BenchmarkRunner& runner) {
+    benchmarkPacketAuthentication(runner);
+}
+
+void NetworkingBenchmarks::benchmarkPacketAuthentication(BenchmarkRunner& runner) {
+    PacketAuthenticationKey key(QUuid(rand(), rand(), rand(), rand(), rand(), rand(), rand(), rand(), rand(), rand(),
+                                      rand()));
+
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeAvatarData, QUuid(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11));
+    while (packet.size() < MAX_PACKET_SIZE) {
+        packet.append((char)rand());
+    }
+
+    for (int mode = MD5Hash; mode <= SipHash; mode++) {
+        QString modeName = (mode == SipHash) ? "siphash" : "md5";
+
+        runner.run(QString("networking/authenticate_packet/%1").arg(modeName), [&]() {
+            authenticatePacket(packet.data(), packet.size(), key, (Mode)mode);
+        });
+
+        authenticatePacket(packet.data(), packet.size(), key, (Mode)mode);
+        runner.run(QString("networking/is_packet_authentic/%1").arg(modeName), [&]() {
+            isPacketAuthentic(packet.constData(), packet.size(), key);
+        });
+    }
+}
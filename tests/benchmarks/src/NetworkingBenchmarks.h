@@ -0,0 +1,24 @@
+//
+//  NetworkingBenchmarks.h
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_NetworkingBenchmarks_h
+#define hifi_NetworkingBenchmarks_h
+
+class BenchmarkRunner;
+
+namespace NetworkingBenchmarks {
+
+    void runAll(BenchmarkRunner& runner);
+
+    // tagging and checking a full size verified packet in each authentication mode
+    void benchmarkPacketAuthentication(BenchmarkRunner& runner);
+};
+
+#endif // hifi_NetworkingBenchmarks_h
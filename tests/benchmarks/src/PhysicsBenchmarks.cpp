@@ -0,0 +1,94 @@
+//
+//  PhysicsBenchmarks.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <AACubeShape.h>
+#include <CapsuleShape.h>
+#include <CollisionInfo.h>
+#include <PlaneShape.h>
+#include <ShapeCollider.h>
+#include <SharedUtil.h>
+#include <SphereShape.h>
+
+#include "BenchmarkRunner.h"
+#include "PhysicsBenchmarks.h"
+
+const int NUM_SHAPE_PAIRS = 256;
+
+// shapes are placed within this distance of each other, so roughly half of the pairs touch
+const float PAIR_SPREAD = 3.0f;
+
+enum BenchmarkShapeType {
+    BENCHMARK_SPHERE,
+    BENCHMARK_CAPSULE,
+    BENCHMARK_PLANE,
+    BENCHMARK_AACUBE,
+    NUM_BENCHMARK_SHAPE_TYPES
+};
+
+static const char* BENCHMARK_SHAPE_NAMES[NUM_BENCHMARK_SHAPE_TYPES] = { "sphere", "capsule", "plane", "aacube" };
+
+static Shape* randomShape(int type) {
+    glm::vec3 position(randFloatInRange(-PAIR_SPREAD, PAIR_SPREAD), randFloatInRange(-PAIR_SPREAD, PAIR_SPREAD),
+                       randFloatInRange(-PAIR_SPREAD, PAIR_SPREAD));
+    switch (type) {
+        case BENCHMARK_SPHERE:
+            return new SphereShape(randFloatInRange(0.5f, 1.5f), position);
+        case BENCHMARK_CAPSULE:
+            return new CapsuleShape(randFloatInRange(0.25f, 1.0f), randFloatInRange(0.5f, 1.5f), position,
+                                    glm::angleAxis(randFloatInRange(0.0f, TWO_PI),
+                                                   glm::normalize(glm::vec3(randFloatInRange(-1.0f, 1.0f), 1.0f,
+                                                                            randFloatInRange(-1.0f, 1.0f)))));
+        case BENCHMARK_PLANE:
+            return new PlaneShape(glm::vec4(0.0f, 1.0f, 0.0f, randFloatInRange(-PAIR_SPREAD, PAIR_SPREAD)));
+        default:
+            return new AACubeShape(randFloatInRange(1.0f, 3.0f), position);
+    }
+}
+
+void PhysicsBenchmarks::runAll(BenchmarkRunner& runner) {
+    benchmarkShapeColliderPairs(runner);
+}
+
+void PhysicsBenchmarks::benchmarkShapeColliderPairs(BenchmarkRunner& runner) {
+    ShapeCollider::initDispatchTable();
+    CollisionList collisions(16);
+
+    for (int typeA = BENCHMARK_SPHERE; typeA < NUM_BENCHMARK_SHAPE_TYPES; typeA++) {
+        for (int typeB = typeA; typeB < NUM_BENCHMARK_SHAPE_TYPES; typeB++) {
+            if (typeA == BENCHMARK_PLANE && typeB == BENCHMARK_PLANE) {
+                continue;
+            }
+            QString name = QString("physics/shape_collider/%1_vs_%2").arg(BENCHMARK_SHAPE_NAMES[typeA],
+                                                                          BENCHMARK_SHAPE_NAMES[typeB]);
+            if (!runner.wants(name)) {
+                continue;
+            }
+
+            QVector<Shape*> shapesA;
+            QVector<Shape*> shapesB;
+            for (int i = 0; i < NUM_SHAPE_PAIRS; i++) {
+                shapesA.append(randomShape(typeA));
+                shapesB.append(randomShape(typeB));
+            }
+
+            int pair = 0;
+            runner.run(name, [&]() {
+                collisions.clear();
+                ShapeCollider::collideShapes(shapesA[pair], shapesB[pair], collisions);
+                pair = (pair + 1) % NUM_SHAPE_PAIRS;
+            });
+
+            qDeleteAll(shapesA);
+            qDeleteAll(shapesB);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+//
+//  PhysicsBenchmarks.h
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PhysicsBenchmarks_h
+#define hifi_PhysicsBenchmarks_h
+
+class BenchmarkRunner;
+
+namespace PhysicsBenchmarks {
+
+    void runAll(BenchmarkRunner& runner);
+
+    // ShapeCollider::collideShapes on random pairs of each shape type, about half of them touching
+    void benchmarkShapeColliderPairs(BenchmarkRunner& runner);
+};
+
+#endif // hifi_PhysicsBenchmarks_h
@@ -0,0 +1,64 @@
+//
+//  main.cpp
+//  tests/benchmarks/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+
+#include <SharedUtil.h>
+
+#include "AudioBenchmarks.h"
+#include "AvatarBenchmarks.h"
+#include "BenchmarkRunner.h"
+#include "EntityBenchmarks.h"
+#include "MetavoxelBenchmarks.h"
+#include "NetworkingBenchmarks.h"
+#include "PhysicsBenchmarks.h"
+
+const float DEFAULT_SECONDS_PER_BENCHMARK = 1.0f;
+
+int main(int argc, const char* argv[]) {
+    // the metavoxel attribute registry needs an application
+    QCoreApplication app(argc, const_cast<char**>(argv));
+
+    if (cmdOptionExists(argc, argv, "--help")) {
+        printf("Usage: benchmarks [--filter substring] [--seconds per-benchmark] [--output file.json]\n");
+        return 0;
+    }
+
+    const char* filter = getCmdOption(argc, argv, "--filter");
+    const char* seconds = getCmdOption(argc, argv, "--seconds");
+    const char* output = getCmdOption(argc, argv, "--output");
+
+    BenchmarkRunner runner(filter ? QString(filter) : QString(),
+                           seconds ? (float)atof(seconds) : DEFAULT_SECONDS_PER_BENCHMARK);
+
+    AudioBenchmarks::runAll(runner);
+    AvatarBenchmarks::runAll(runner);
+    EntityBenchmarks::runAll(runner);
+    MetavoxelBenchmarks::runAll(runner);
+    NetworkingBenchmarks::runAll(runner);
+    PhysicsBenchmarks::runAll(runner);
+
+    QByteArray json = runner.toJson().toJson();
+    if (!output) {
+        fwrite(json.constData(), 1, json.size(), stdout);
+        return 0;
+    }
+
+    QFile outputFile(output);
+    if (!outputFile.open(QIODevice::WriteOnly) || outputFile.write(json) != json.size()) {
+        fprintf(stderr, "Failed to write %s: %s\n", output, qPrintable(outputFile.errorString()));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+//
+//  PacketAuthenticatorTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cassert>
+#include <string.h>
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <PacketAuthenticator.h>
+
+#include "PacketAuthenticatorTests.h"
+
+using namespace PacketAuthenticator;
+
+const int NUM_BENCHMARK_PACKETS = 100000;
+const int BENCHMARK_PAYLOAD_BYTES = 1400;
+
+void PacketAuthenticatorTests::runAllTests() {
+    sipHashVectorsTest();
+    roundTripTest();
+    benchmarkModes();
+}
+
+void PacketAuthenticatorTests::sipHashVectorsTest() {
+    // reference SipHash-2-4 128 bit outputs for key 00..0f and messages 00..(length - 1)
+    const int NUM_VECTORS = 4;
+    const int lengths[NUM_VECTORS] = { 0, 1, 15, 16 };
+    const char* expected[NUM_VECTORS] = {
+        "a3817f04ba25a8e66df67214c7550293",
+        "da87c1d86b99af44347659119b22fc45",
+        "5493e99933b0a8117e08ec0f97cfc3d9",
+        "6ee2a4ca67b054bbfd3315bf85230577"
+    };
+
+    char key[16];
+    char message[16];
+    for (int i = 0; i < 16; i++) {
+        key[i] = i;
+        message[i] = i;
+    }
+    PacketAuthenticationKey authenticationKey(QUuid::fromRfc4122(QByteArray(key, sizeof(key))));
+
+    for (int i = 0; i < NUM_VECTORS; i++) {
+        char tag[16];
+        sipHash128(message, lengths[i], authenticationKey.getK0(), authenticationKey.getK1(), tag);
+        if (QByteArray(tag, sizeof(tag)).toHex() != expected[i]) {
+            qDebug() << "FAILED - SipHash of" << lengths[i] << "bytes was" << QByteArray(tag, sizeof(tag)).toHex();
+        }
+
+        // the same bytes with the last few passed as a suffix
+        for (int suffixSize = 1; suffixSize <= std::min(lengths[i], 8); suffixSize++) {
+            int size = lengths[i] - suffixSize;
+            sipHash128(message, size, message + size, suffixSize,
+                       authenticationKey.getK0(), authenticationKey.getK1(), tag);
+            if (QByteArray(tag, sizeof(tag)).toHex() != expected[i]) {
+                qDebug() << "FAILED - SipHash of" << lengths[i] << "bytes with a" << suffixSize << "byte suffix was"
+                    << QByteArray(tag, sizeof(tag)).toHex();
+            }
+        }
+    }
+}
+
+void PacketAuthenticatorTests::roundTripTest() {
+    QUuid sessionUUID = QUuid::createUuid();
+    PacketAuthenticationKey key(QUuid::createUuid());
+    PacketAuthenticationKey wrongKey(QUuid::createUuid());
+
+    for (int mode = MD5Hash; mode <= SipHash; mode++) {
+        QByteArray packet = byteArrayWithPopulatedHeader(PacketTypePing, sessionUUID);
+        packet.append("some payload to authenticate");
+
+        authenticatePacket(packet.data(), packet.size(), key, (Mode)mode);
+
+        assert(modeForPacket(packet.constData()) == mode);
+        assert(versionFromPacketHeader(packet.constData()) == versionForPacketType(PacketTypePing));
+        assert(isPacketAuthentic(packet.constData(), packet.size(), key));
+        assert(!isPacketAuthentic(packet.constData(), packet.size(), wrongKey));
+
+        // flip either flag bit of the version byte, which would downgrade the packet or what its sender accepts
+        int versionIndex = numBytesArithmeticCodingFromBuffer(packet.constData());
+        const char flagBits[] = { (char)PACKET_ACCEPTS_SIP_HASH_FLAG, (char)PACKET_SIP_HASH_AUTHENTICATED_FLAG };
+        for (int i = 0; i < (int)sizeof(flagBits); i++) {
+            packet[versionIndex] = packet[versionIndex] ^ flagBits[i];
+            assert(!isPacketAuthentic(packet.constData(), packet.size(), key));
+            packet[versionIndex] = packet[versionIndex] ^ flagBits[i];
+        }
+        assert(isPacketAuthentic(packet.constData(), packet.size(), key));
+
+        // flip one payload bit
+        packet[packet.size() - 1] = packet[packet.size() - 1] ^ 1;
+        assert(!isPacketAuthentic(packet.constData(), packet.size(), key));
+    }
+}
+
+void PacketAuthenticatorTests::benchmarkModes() {
+    PacketAuthenticationKey key(QUuid::createUuid());
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypePing, QUuid::createUuid());
+    packet.append(QByteArray(BENCHMARK_PAYLOAD_BYTES, 'x'));
+
+    for (int mode = MD5Hash; mode <= SipHash; mode++) {
+        QElapsedTimer timer;
+        timer.start();
+
+        int numAuthentic = 0;
+        for (int i = 0; i < NUM_BENCHMARK_PACKETS; i++) {
+            authenticatePacket(packet.data(), packet.size(), key, (Mode)mode);
+            numAuthentic += isPacketAuthentic(packet.constData(), packet.size(), key);
+        }
+
+        double nsecsPerPacket = (double)timer.nsecsElapsed() / NUM_BENCHMARK_PACKETS;
+        qDebug("%-7s nsecs to authenticate and verify a %d byte payload: %8.1f  (%d)",
+               mode == SipHash ? "SipHash" : "MD5", BENCHMARK_PAYLOAD_BYTES, nsecsPerPacket, numAuthentic);
+    }
+}
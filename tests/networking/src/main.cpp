@@ -8,11 +8,13 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include "PacketAuthenticatorTests.h"
 #include "SequenceNumberStatsTests.h"
 #include <stdio.h>
 
 int main(int argc, char** argv) {
     SequenceNumberStatsTests::runAllTests();
+    PacketAuthenticatorTests::runAllTests();
     printf("tests passed! press enter to exit");
     getchar();
     return 0;
@@ -517,8 +517,83 @@ void EntityTests::entityTreeTests(bool verbose) {
     }
 }
 
+void EntityTests::stripeEditTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "EntityTests::stripeEditTests()";
+
+    EntityTree tree;
+    tree.setLockStripeDepth(1);
+    EntityItemID entityID(QUuid::createUuid());
+    entityID.isKnownID = false; // added as a local tree entity, then edited by its known ID
+    glm::vec3 positionNearOriginInMeters(1.0f, 1.0f, 1.0f);
+    EntityItemProperties properties;
+    properties.setPosition(positionNearOriginInMeters);
+    tree.addEntity(entityID, properties);
+    entityID.isKnownID = true;
+
+    EntityItem* entity = tree.findEntityByEntityItemID(entityID);
+    glm::vec3 positionBefore = entity ? entity->getPosition() : glm::vec3();
+    int stripe = tree.stripeOfElement(tree.getContainingElement(entityID));
+
+    EntityEditRecord moveEdit;
+    moveEdit.entityItemID = entityID;
+    moveEdit.properties.setPosition(glm::vec3((float)TREE_SCALE * 0.75f));
+
+    EntityEditRecord gravityEdit;
+    gravityEdit.entityItemID = entityID;
+    gravityEdit.properties.setGravity(glm::vec3(0.0f, -9.8f, 0.0f));
+
+    QVector<OctreeDecodedEdit> edits(2);
+    edits[0].record = &moveEdit;
+    edits[1].record = &gravityEdit;
+
+    {
+        testsTaken++;
+        QString testName = "move edit at the head of a batch isn't applied in a stripe";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        quint64 lockWaitUsecs = 0;
+        int applied = tree.applyDecodedEditsInStripes(edits, 0, lockWaitUsecs);
+        bool passed = entity && stripe != ALL_STRIPES && applied == 0 && entity->getPosition() == positionBefore
+            && !tree.applyDecodedEditInStripe(moveEdit, stripe, SharedNodePointer());
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName) << "applied=" << applied;
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "edit in one subtree is applied in its stripe, and only its own";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        bool otherStripeRefused = !tree.applyDecodedEditInStripe(gravityEdit, (stripe + 1) % 8, SharedNodePointer());
+        quint64 lockWaitUsecs = 0;
+        int applied = tree.applyDecodedEditsInStripes(edits, 1, lockWaitUsecs);
+        bool passed = entity && otherStripeRefused && applied == 1 && entity->getGravity() != glm::vec3()
+            && entity->getPosition() == positionBefore;
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName) << "applied=" << applied;
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+}
 
 void EntityTests::runAllTests(bool verbose) {
     entityTreeTests(verbose);
+    stripeEditTests(verbose);
 }
 
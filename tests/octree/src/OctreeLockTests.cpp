@@ -0,0 +1,172 @@
+//
+//  OctreeLockTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <functional>
+
+#include <QDebug>
+#include <QThread>
+
+#include <OctreeLock.h>
+
+#include "OctreeLockTests.h"
+
+// runs a function on a thread of its own and waits for it, the lock's owners are threads
+class OtherThread : public QThread {
+public:
+    OtherThread(std::function<void()> function) : _function(function) { }
+
+    static void runAndWait(std::function<void()> function) {
+        OtherThread thread(function);
+        thread.start();
+        thread.wait();
+    }
+
+protected:
+    virtual void run() { _function(); }
+
+private:
+    std::function<void()> _function;
+};
+
+static bool testStripeContaining(bool verbose) {
+    OctreeLock lock;
+    lock.setStripeDepth(2);
+    bool fail = false;
+
+    if (lock.getNumStripes() != 64) {
+        qDebug() << "\t FAIL number of stripes" << lock.getNumStripes() << "expected" << 64;
+        fail = true;
+    }
+
+    // the elements at the stripe depth and below each map to the one stripe they lie in
+    struct CubeStripe {
+        glm::vec3 corner;
+        float scale;
+        int stripe;
+    } cubeStripes[] = {
+        { glm::vec3(0.0f), 1.0f, ALL_STRIPES },
+        { glm::vec3(0.5f, 0.0f, 0.0f), 0.5f, ALL_STRIPES },
+        { glm::vec3(0.0f), 0.25f, 0 },
+        { glm::vec3(0.75f), 0.25f, 63 },
+        { glm::vec3(0.25f, 0.5f, 0.75f), 0.25f, 1 * 16 + 2 * 4 + 3 },
+        { glm::vec3(0.25f, 0.5f, 0.875f), 0.125f, 1 * 16 + 2 * 4 + 3 },
+        { glm::vec3(0.125f, 0.0f, 0.0f), 0.25f, ALL_STRIPES },
+        { glm::vec3(1.0f, 0.0f, 0.0f), 0.25f, ALL_STRIPES }
+    };
+    int numCubes = sizeof(cubeStripes) / sizeof(cubeStripes[0]);
+    for (int i = 0; i < numCubes; i++) {
+        int stripe = lock.stripeContaining(AACube(cubeStripes[i].corner, cubeStripes[i].scale));
+        if (stripe != cubeStripes[i].stripe) {
+            qDebug() << "\t FAIL cube" << i << "in stripe" << stripe << "expected" << cubeStripes[i].stripe;
+            fail = true;
+        } else if (verbose) {
+            qDebug() << "\t cube" << i << "in stripe" << stripe;
+        }
+    }
+
+    lock.setStripeDepth(0);
+    if (lock.stripeContaining(AACube(glm::vec3(0.0f), 1.0f)) != 0) {
+        qDebug() << "\t FAIL the root isn't in the only stripe at depth 0";
+        fail = true;
+    }
+    return !fail;
+}
+
+static bool testExclusion(bool verbose) {
+    OctreeLock lock;
+    lock.setStripeDepth(1);
+    bool fail = false;
+    bool gotLock = false;
+
+    // a stripe writer shuts out whole tree readers and writers, but not the holders of other stripes
+    lock.lockSpineForRead();
+    lock.lockStripeForWrite(3);
+    OtherThread::runAndWait([&] {
+        if (lock.tryLockForRead()) {
+            lock.unlock();
+            qDebug() << "\t FAIL read the whole tree while a stripe was written";
+            fail = true;
+        }
+        if (lock.tryLockForWrite()) {
+            lock.unlock();
+            qDebug() << "\t FAIL wrote the whole tree while a stripe was written";
+            fail = true;
+        }
+        lock.lockSpineForRead();
+        lock.lockStripeForWrite(4);
+        lock.unlockStripe(4);
+        lock.unlockSpine();
+    });
+    lock.unlockStripe(3);
+    lock.unlockSpine();
+
+    OtherThread::runAndWait([&] {
+        gotLock = lock.tryLockForRead();
+        if (gotLock) {
+            lock.unlock();
+        }
+    });
+    if (!gotLock) {
+        qDebug() << "\t FAIL couldn't read the whole tree once the stripe was released";
+        fail = true;
+    }
+
+    // a whole tree writer may read and take the spine and stripes again, and still owns the tree until it lets go
+    lock.lockForWrite();
+    lock.lockForRead();
+    lock.lockSpineForRead();
+    lock.lockStripeForRead(ALL_STRIPES);
+    lock.unlockStripe(ALL_STRIPES);
+    lock.unlockSpine();
+    lock.unlock();
+    OtherThread::runAndWait([&] {
+        gotLock = lock.tryLockForRead();
+        if (gotLock) {
+            lock.unlock();
+        }
+    });
+    if (gotLock) {
+        qDebug() << "\t FAIL read the whole tree while it was written";
+        fail = true;
+    }
+    lock.unlock();
+
+    OtherThread::runAndWait([&] {
+        gotLock = lock.tryLockForWrite();
+        if (gotLock) {
+            lock.unlock();
+        }
+    });
+    if (!gotLock) {
+        qDebug() << "\t FAIL couldn't write the whole tree once the writer was done";
+        fail = true;
+    }
+
+    OctreeLockStats stripeStats = lock.getStripeStats(3);
+    if (stripeStats.acquisitions == 0) {
+        qDebug() << "\t FAIL stripe 3 has no acquisitions counted";
+        fail = true;
+    } else if (verbose) {
+        qDebug() << "\t stripe 3 acquisitions" << stripeStats.acquisitions << "contended" << stripeStats.contended;
+    }
+    return !fail;
+}
+
+void OctreeLockTests::runAllTests(bool verbose) {
+    qDebug() << "testing octree lock stripes...";
+    if (testStripeContaining(verbose)) {
+        qDebug() << "\t PASS";
+    }
+
+    qDebug() << "testing octree lock exclusion...";
+    if (testExclusion(verbose)) {
+        qDebug() << "\t PASS";
+    }
+}
@@ -0,0 +1,19 @@
+//
+//  OctreeLockTests.h
+//  tests/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeLockTests_h
+#define hifi_OctreeLockTests_h
+
+namespace OctreeLockTests {
+
+    void runAllTests(bool verbose);
+}
+
+#endif // hifi_OctreeLockTests_h
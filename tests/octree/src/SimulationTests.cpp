@@ -0,0 +1,276 @@
+//
+//  SimulationTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+#include <vector>
+
+#include <QDebug>
+
+#include <BoxEntityItem.h>
+#include <EntityTree.h>
+#include <EntityTreeElement.h>
+#include <SharedUtil.h>
+#include <SimpleEntitySimulation.h>
+
+#include "SimulationTests.h"
+
+// steps the simulation at chosen times, instead of the clock's as updateEntities() does
+class SteppedSimulation : public SimpleEntitySimulation {
+public:
+    void step(quint64 now) { updateEntitiesInternal(now); }
+
+    /// also re-sorts what the regions left for the whole tree, as updateEntities() does
+    void stepAndSort(quint64 now) {
+        updateEntitiesInternal(now);
+        sortEntitiesThatMoved();
+    }
+};
+
+const quint64 START_TIME = USECS_PER_SECOND;
+const quint64 STEP_USECS = USECS_PER_SECOND / 60;
+
+// the same entities every time, a mix of the ones that drift, fall, spin, and slow down to a stop
+static void createEntities(std::vector<EntityItem*>& entities, int numEntities) {
+    for (int i = 0; i < numEntities; i++) {
+        EntityItem* entity = new BoxEntityItem(EntityItemID(QUuid::createUuid()), EntityItemProperties());
+        float offset = (float)(i % 97) / 97.0f;
+        entity->setPosition(glm::vec3(0.25f + 0.5f * offset, 0.5f, 0.75f - 0.5f * offset));
+        entity->setVelocity(glm::vec3(0.001f * (offset - 0.5f), 0.0005f, -0.001f * offset));
+        if (i % 3 == 0) {
+            entity->setGravity(glm::vec3(0.0f, -0.001f, 0.0f));
+        }
+        if (i % 4 == 0) {
+            entity->setAngularVelocity(glm::vec3(30.0f * offset, 90.0f, 0.0f));
+            entity->setAngularDamping(0.5f);
+        }
+        if (i % 5 == 0) {
+            // slow enough to come to a stop during the test, and leave the simulation
+            entity->setVelocity(glm::vec3(0.0f, 0.0f, 0.0001f));
+            entity->setDamping(0.99f);
+        } else {
+            entity->setDamping(0.2f * offset);
+        }
+        entity->setLastSimulated(START_TIME);
+        entities.push_back(entity);
+    }
+}
+
+static bool closeEnough(const glm::vec3& a, const glm::vec3& b) {
+    return glm::length(a - b) <= 1.0e-5f * glm::max(glm::length(a), glm::length(b));
+}
+
+static bool closeEnough(const glm::quat& a, const glm::quat& b) {
+    return fabsf(glm::dot(a, b)) >= 1.0f - 1.0e-6f;
+}
+
+// the simulation's arrays step an entity the way EntityItem::simulate() would have
+static bool testMatchesEntitySimulate(bool verbose) {
+    struct MotionCase {
+        const char* name;
+        glm::vec3 velocity;
+        glm::vec3 gravity;
+        float damping;
+        glm::vec3 angularVelocity;
+        float angularDamping;
+    } motionCases[] = {
+        { "damping", glm::vec3(0.001f, 0.0f, 0.0f), glm::vec3(0.0f), 0.5f, glm::vec3(0.0f), 0.0f },
+        { "gravity", glm::vec3(0.0f, 0.001f, 0.0f), glm::vec3(0.0f, -0.002f, 0.0f), 0.0f, glm::vec3(0.0f), 0.0f },
+        { "spin", glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, 90.0f, 30.0f), 0.0f },
+        { "angular stop", glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f), 0.9f },
+        { "linear stop", glm::vec3(0.0f, 0.0f, 1.0e-6f), glm::vec3(0.0f), 0.9f, glm::vec3(0.0f), 0.0f }
+    };
+    const int NUM_CASES = sizeof(motionCases) / sizeof(motionCases[0]);
+    const int NUM_STEPS = 120;
+
+    std::vector<EntityItem*> simulatedEntities;
+    std::vector<EntityItem*> steppedEntities;
+    for (int i = 0; i < NUM_CASES; i++) {
+        for (int copy = 0; copy < 2; copy++) {
+            EntityItem* entity = new BoxEntityItem(EntityItemID(QUuid::createUuid()), EntityItemProperties());
+            entity->setPosition(glm::vec3(0.5f));
+            entity->setVelocity(motionCases[i].velocity);
+            entity->setGravity(motionCases[i].gravity);
+            entity->setDamping(motionCases[i].damping);
+            entity->setAngularVelocity(motionCases[i].angularVelocity);
+            entity->setAngularDamping(motionCases[i].angularDamping);
+            entity->setLastSimulated(START_TIME);
+            entity->clearDirtyFlags();
+            (copy == 0 ? simulatedEntities : steppedEntities).push_back(entity);
+        }
+    }
+
+    bool fail = false;
+    {
+        SteppedSimulation simulation;
+        for (int i = 0; i < NUM_CASES; i++) {
+            simulation.addEntity(simulatedEntities[i]);
+        }
+
+        // uneven steps, some longer than a physics substep
+        quint64 now = START_TIME;
+        for (int step = 1; step <= NUM_STEPS; step++) {
+            now += (step % 3 + 1) * STEP_USECS / 2;
+            simulation.step(now);
+            for (int i = 0; i < NUM_CASES; i++) {
+                steppedEntities[i]->simulate(now);
+            }
+        }
+
+        for (int i = 0; i < NUM_CASES; i++) {
+            const EntityItem* simulated = simulatedEntities[i];
+            const EntityItem* stepped = steppedEntities[i];
+            bool matches = closeEnough(simulated->getPosition(), stepped->getPosition())
+                && closeEnough(simulated->getRotation(), stepped->getRotation())
+                && closeEnough(simulated->getVelocity(), stepped->getVelocity())
+                && closeEnough(simulated->getAngularVelocity(), stepped->getAngularVelocity())
+                && (simulated->getDirtyFlags() & EntityItem::DIRTY_MOTION_TYPE)
+                    == (stepped->getDirtyFlags() & EntityItem::DIRTY_MOTION_TYPE);
+            if (!matches) {
+                qDebug() << "\t FAIL" << motionCases[i].name << "simulated differently from EntityItem::simulate()";
+                fail = true;
+            } else if (verbose) {
+                qDebug() << "\t" << motionCases[i].name << "matches";
+            }
+        }
+
+        // the stop cases are only worth anything if the arrays stopped them
+        if (simulatedEntities[3]->hasAngularVelocity() || simulatedEntities[4]->hasVelocity()) {
+            qDebug() << "\t FAIL the simulation didn't bring the stop cases to a stop";
+            fail = true;
+        }
+    }
+
+    qDeleteAll(simulatedEntities);
+    qDeleteAll(steppedEntities);
+    return !fail;
+}
+
+static bool testThreadedStepMatchesSingleThread(bool verbose) {
+    const int NUM_ENTITIES = 1000;
+    const int NUM_STEPS = 120;
+    const int NUM_THREADS = 4;
+
+    std::vector<EntityItem*> singleEntities;
+    std::vector<EntityItem*> threadedEntities;
+    createEntities(singleEntities, NUM_ENTITIES);
+    createEntities(threadedEntities, NUM_ENTITIES);
+
+    bool fail = false;
+    {
+        SteppedSimulation singleSimulation;
+        SteppedSimulation threadedSimulation;
+        threadedSimulation.setNumSimulationThreads(NUM_THREADS);
+        for (int i = 0; i < NUM_ENTITIES; i++) {
+            singleSimulation.addEntity(singleEntities[i]);
+            threadedSimulation.addEntity(threadedEntities[i]);
+        }
+
+        for (int step = 1; step <= NUM_STEPS; step++) {
+            singleSimulation.step(START_TIME + step * STEP_USECS);
+            threadedSimulation.step(START_TIME + step * STEP_USECS);
+        }
+
+        for (int i = 0; i < NUM_ENTITIES; i++) {
+            const EntityItem* single = singleEntities[i];
+            const EntityItem* threaded = threadedEntities[i];
+            if (single->getPosition() != threaded->getPosition() || single->getRotation() != threaded->getRotation()
+                    || single->getVelocity() != threaded->getVelocity()
+                    || single->getAngularVelocity() != threaded->getAngularVelocity()
+                    || single->getLastSimulated() != threaded->getLastSimulated()) {
+                qDebug() << "\t FAIL entity" << i << "stepped on" << NUM_THREADS << "threads differs from one thread";
+                fail = true;
+                break;
+            }
+        }
+        if (verbose) {
+            qDebug() << "\t compared" << NUM_ENTITIES << "entities after" << NUM_STEPS << "steps";
+        }
+    }
+
+    qDeleteAll(singleEntities);
+    qDeleteAll(threadedEntities);
+    return !fail;
+}
+
+// movers re-sorted by their region's job end up where the tree's own re-sort would have put them
+static bool testTreeStaysSorted(bool verbose) {
+    const int NUM_ENTITIES = 500;
+    const int NUM_STEPS = 120;
+    const int NUM_THREADS = 4;
+
+    SteppedSimulation simulation;
+    simulation.setNumSimulationThreads(NUM_THREADS);
+    EntityTree tree;
+    simulation.setEntityTree(&tree);
+    tree.setSimulation(&simulation);
+
+    // small and fast around the middle of the domain, so they change elements and cross between regions
+    std::vector<EntityItem*> entities;
+    for (int i = 0; i < NUM_ENTITIES; i++) {
+        EntityItemID entityID(QUuid::createUuid());
+        entityID.isKnownID = false; // added as a local tree entity
+        float offset = (float)(i % 97) / 97.0f;
+        EntityItemProperties properties;
+        properties.setType(EntityTypes::Box);
+        properties.setPosition(glm::vec3(0.3f + 0.4f * offset, 0.5f - 0.1f * offset, 0.7f - 0.4f * offset)
+            * (float)TREE_SCALE);
+        properties.setVelocity(glm::vec3(0.1f * (0.5f - offset), 0.05f, 0.1f * offset) * (float)TREE_SCALE);
+        properties.setDimensions(glm::vec3(0.001f + 0.01f * offset) * (float)TREE_SCALE);
+        EntityItem* entity = tree.addEntity(entityID, properties);
+        if (entity) {
+            entities.push_back(entity);
+        }
+    }
+
+    // the entities were last simulated when they were added
+    quint64 startTime = usecTimestampNow();
+
+    bool fail = entities.size() != (size_t)NUM_ENTITIES;
+    if (fail) {
+        qDebug() << "\t FAIL only added" << entities.size() << "of" << NUM_ENTITIES << "entities";
+    }
+    for (int step = 1; step <= NUM_STEPS && !fail; step++) {
+        simulation.stepAndSort(startTime + step * STEP_USECS);
+        for (size_t i = 0; i < entities.size(); i++) {
+            EntityItem* entity = entities[i];
+            EntityTreeElement* element = entity->getElement();
+            if (!element || tree.getContainingElement(entity->getEntityItemID()) != element
+                    || !element->bestFitBounds(entity->getMaximumAACube())) {
+                qDebug() << "\t FAIL entity" << i << "isn't in its best fit element after step" << step;
+                fail = true;
+                break;
+            }
+        }
+    }
+    if (verbose && !fail) {
+        qDebug() << "\t checked" << entities.size() << "entities after each of" << NUM_STEPS << "steps";
+    }
+
+    // the tree deletes the entities
+    tree.setSimulation(NULL);
+    return !fail;
+}
+
+void SimulationTests::runAllTests(bool verbose) {
+    qDebug() << "testing simple simulation against EntityItem::simulate()...";
+    if (testMatchesEntitySimulate(verbose)) {
+        qDebug() << "\t PASS";
+    }
+
+    qDebug() << "testing threaded simple simulation...";
+    if (testThreadedStepMatchesSingleThread(verbose)) {
+        qDebug() << "\t PASS";
+    }
+
+    qDebug() << "testing threaded simple simulation keeps the tree sorted...";
+    if (testTreeStaysSorted(verbose)) {
+        qDebug() << "\t PASS";
+    }
+}
@@ -0,0 +1,19 @@
+//
+//  SimulationTests.h
+//  tests/octree/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SimulationTests_h
+#define hifi_SimulationTests_h
+
+namespace SimulationTests {
+
+    void runAllTests(bool verbose);
+}
+
+#endif // hifi_SimulationTests_h
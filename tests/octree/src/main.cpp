@@ -10,8 +10,10 @@
 
 #include "AABoxCubeTests.h"
 #include "ModelTests.h" // needs to be EntityTests.h soon
+#include "OctreeLockTests.h"
 #include "OctreeTests.h"
 #include "SharedUtil.h"
+#include "SimulationTests.h"
 
 int main(int argc, const char* argv[]) {
     const char* VERBOSE = "--verbose";
@@ -20,5 +22,7 @@ int main(int argc, const char* argv[]) {
     //OctreeTests::runAllTests(verbose);
     //AABoxCubeTests::runAllTests(verbose);
     EntityTests::runAllTests(verbose);
+    OctreeLockTests::runAllTests(verbose);
+    SimulationTests::runAllTests(verbose);
     return 0;
 }
@@ -0,0 +1,89 @@
+//
+//  IndexedMinHeapTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+
+#include <QDebug>
+#include <QMap>
+
+#include "IndexedMinHeap.h"
+
+#include "IndexedMinHeapTests.h"
+
+const int NUM_ITEMS = 200;
+const int NUM_OPERATIONS = 20000;
+
+// the item with the lowest priority in the reference map, ties going to the lowest item
+static int lowestItem(const QMap<int, int>& priorities) {
+    int lowest = -1;
+    for (QMap<int, int>::const_iterator itr = priorities.constBegin(); itr != priorities.constEnd(); ++itr) {
+        if (lowest == -1 || itr.value() < priorities.value(lowest)) {
+            lowest = itr.key();
+        }
+    }
+    return lowest;
+}
+
+void IndexedMinHeapTests::runAllTests() {
+    qDebug() << "testing indexed min heap against a map...";
+
+    // random inserts, priority changes, removes and pops, checking the top after each
+    IndexedMinHeap<int, int> heap;
+    QMap<int, int> priorities;
+    bool fail = false;
+
+    srand(1);
+    for (int i = 0; i < NUM_OPERATIONS && !fail; i++) {
+        int item = rand() % NUM_ITEMS;
+        int operation = rand() % 4;
+        if (operation < 2) {
+            int priority = rand() % 1000;
+            heap.insertOrUpdate(item, priority);
+            priorities.insert(item, priority);
+        } else if (operation == 2) {
+            if (heap.remove(item) != priorities.contains(item)) {
+                qDebug() << "\t FAIL removing" << item << "at operation" << i;
+                fail = true;
+            }
+            priorities.remove(item);
+        } else if (!priorities.isEmpty()) {
+            int expectedPriority = priorities.value(lowestItem(priorities));
+            if (heap.topPriority() != expectedPriority) {
+                qDebug() << "\t FAIL popping, got priority" << heap.topPriority() << "expected" << expectedPriority;
+                fail = true;
+            }
+            priorities.remove(heap.pop());
+        }
+
+        if (heap.size() != priorities.size()) {
+            qDebug() << "\t FAIL size" << heap.size() << "expected" << priorities.size() << "at operation" << i;
+            fail = true;
+        } else if (!priorities.isEmpty() && heap.topPriority() != priorities.value(lowestItem(priorities))) {
+            qDebug() << "\t FAIL top priority at operation" << i;
+            fail = true;
+        }
+    }
+
+    // draining what is left comes out in priority order
+    int lastPriority = -1;
+    while (!fail && !heap.isEmpty()) {
+        int priority = heap.topPriority();
+        int item = heap.pop();
+        if (priority < lastPriority || heap.contains(item)) {
+            qDebug() << "\t FAIL draining at priority" << priority;
+            fail = true;
+        }
+        lastPriority = priority;
+    }
+
+    if (!fail) {
+        qDebug() << "\t PASS";
+    }
+}
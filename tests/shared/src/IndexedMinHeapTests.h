@@ -0,0 +1,19 @@
+//
+//  IndexedMinHeapTests.h
+//  tests/shared/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_IndexedMinHeapTests_h
+#define hifi_IndexedMinHeapTests_h
+
+namespace IndexedMinHeapTests {
+
+    void runAllTests();
+}
+
+#endif // hifi_IndexedMinHeapTests_h
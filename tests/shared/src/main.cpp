@@ -9,6 +9,7 @@
 //
 
 #include "AngularConstraintTests.h"
+#include "IndexedMinHeapTests.h"
 #include "MovingPercentileTests.h"
 #include "MovingMinMaxAvgTests.h"
 
@@ -16,6 +17,7 @@ int main(int argc, char** argv) {
     MovingMinMaxAvgTests::runAllTests();
     MovingPercentileTests::runAllTests();
     AngularConstraintTests::runAllTests();
+    IndexedMinHeapTests::runAllTests();
     printf("tests complete, press enter to exit\n");
     getchar();
     return 0;
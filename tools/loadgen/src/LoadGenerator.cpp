@@ -0,0 +1,212 @@
+//
+//  LoadGenerator.cpp
+//  tools/loadgen/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+
+#include <NodeList.h>
+#include <ScriptEngine.h>
+#include <SharedUtil.h>
+
+#include "LoadGenerator.h"
+
+const int REPORT_INTERVAL_MSECS = 5 * 1000;
+
+// after a stall the frames missed are caught up to this many at a time, the rest are dropped like a late script frame
+const int MAX_CATCH_UP_FRAMES = 5;
+
+LoadGenerator::LoadGenerator(const LoadGeneratorConfig& config, const QString& reportFilename, QObject* parent) :
+    QObject(parent),
+    _config(config),
+    _reportFilename(reportFilename),
+    _framesSent(0),
+    _lastReportStats(SyntheticAgent::NUM_MIXERS),
+    _lastReportPacketsSent(0),
+    _lastReportBytesSent(0),
+    _lastReportMsecs(0),
+    _succeeded(false)
+{
+    connect(&_frameTimer, &QTimer::timeout, this, &LoadGenerator::sendFrames);
+    connect(&_checkInTimer, &QTimer::timeout, this, &LoadGenerator::sendDomainCheckIns);
+    connect(&_pingTimer, &QTimer::timeout, this, &LoadGenerator::sendPings);
+    connect(&_reportTimer, &QTimer::timeout, this, &LoadGenerator::printReport);
+}
+
+bool LoadGenerator::start() {
+    _agents.reserve(_config.numAgents);
+    for (int i = 0; i < _config.numAgents; i++) {
+        SyntheticAgent* agent = new SyntheticAgent(i, _config, this);
+        if (!agent->bindSocket()) {
+            return false;
+        }
+        _agents.append(agent);
+    }
+
+    qDebug() << "Starting" << _config.numAgents << "agents against the domain at" << _config.domainSockAddr;
+
+    _runTimer.start();
+
+    _frameTimer.setTimerType(Qt::PreciseTimer);
+    _frameTimer.start(SCRIPT_DATA_CALLBACK_USECS / USECS_PER_MSEC);
+
+    sendDomainCheckIns();
+    _checkInTimer.start(DOMAIN_SERVER_CHECK_IN_MSECS);
+
+    if (_config.pingRate > 0.0f) {
+        _pingTimer.start(MSECS_PER_SECOND / _config.pingRate);
+    }
+
+    _reportTimer.start(REPORT_INTERVAL_MSECS);
+
+    if (_config.durationSecs > 0) {
+        QTimer::singleShot(_config.durationSecs * MSECS_PER_SECOND, this, SLOT(stop()));
+    }
+    return true;
+}
+
+void LoadGenerator::sendFrames() {
+    quint64 framesDue = (_runTimer.nsecsElapsed() / 1000) / SCRIPT_DATA_CALLBACK_USECS;
+    if (framesDue > _framesSent + MAX_CATCH_UP_FRAMES) {
+        _framesSent = framesDue - MAX_CATCH_UP_FRAMES;
+    }
+
+    const float FRAME_SECONDS = (float)SCRIPT_DATA_CALLBACK_USECS / USECS_PER_SECOND;
+    for (; _framesSent < framesDue; _framesSent++) {
+        foreach (SyntheticAgent* agent, _agents) {
+            agent->sendFrame(FRAME_SECONDS);
+        }
+    }
+}
+
+void LoadGenerator::sendDomainCheckIns() {
+    foreach (SyntheticAgent* agent, _agents) {
+        agent->sendDomainCheckIn();
+    }
+}
+
+void LoadGenerator::sendPings() {
+    foreach (SyntheticAgent* agent, _agents) {
+        agent->sendPings();
+    }
+}
+
+QJsonObject LoadGenerator::reportSince(const QVector<MixerLinkStats>& lastStats, quint64 lastPacketsSent,
+                                       quint64 lastBytesSent, float seconds) {
+    QVector<MixerLinkStats> stats(SyntheticAgent::NUM_MIXERS);
+    quint64 packetsSent = 0;
+    quint64 bytesSent = 0;
+    int numConnected = 0;
+
+    foreach (SyntheticAgent* agent, _agents) {
+        for (int i = 0; i < SyntheticAgent::NUM_MIXERS; i++) {
+            stats[i].merge(agent->getMixerStats(i));
+        }
+        packetsSent += agent->getPacketsSent();
+        bytesSent += agent->getBytesSent();
+        numConnected += agent->isConnected() ? 1 : 0;
+    }
+
+    QJsonObject report;
+    report["seconds"] = seconds;
+    report["agents"] = _agents.size();
+    report["connected_agents"] = numConnected;
+    report["sent_packets_per_second"] = (packetsSent - lastPacketsSent) / seconds;
+    report["sent_kbps"] = (bytesSent - lastBytesSent) * BITS_IN_BYTE / (seconds * 1000.0f);
+
+    QJsonObject mixers;
+    for (int i = 0; i < SyntheticAgent::NUM_MIXERS; i++) {
+        const MixerLinkStats& now = stats[i];
+        const MixerLinkStats& last = lastStats[i];
+
+        // counts are over the interval, the max round trip and the jitter are as of now
+        quint64 pingsSent = now.pingsSent - last.pingsSent;
+        quint64 pingsReplied = now.pingsReplied - last.pingsReplied;
+        quint64 streamReceived = now.streamPacketsReceived - last.streamPacketsReceived;
+        quint64 streamLost = now.streamPacketsLost - last.streamPacketsLost;
+
+        QJsonObject mixer;
+        mixer["avg_rtt_msecs"] = pingsReplied > 0
+            ? (double)(now.totalRoundTripUsecs - last.totalRoundTripUsecs) / pingsReplied / USECS_PER_MSEC : 0.0;
+        mixer["max_rtt_msecs"] = (double)now.maxRoundTripUsecs / USECS_PER_MSEC;
+        mixer["jitter_msecs"] = now.jitterUsecs / USECS_PER_MSEC;
+        mixer["ping_loss"] = pingsSent > 0 && pingsSent >= pingsReplied
+            ? (double)(pingsSent - pingsReplied) / pingsSent : 0.0;
+        mixer["received_packets_per_second"] = (now.packetsReceived - last.packetsReceived) / seconds;
+        mixer["received_kbps"] = (now.bytesReceived - last.bytesReceived) * BITS_IN_BYTE / (seconds * 1000.0f);
+        if (i == SyntheticAgent::AudioMixer) {
+            mixer["stream_loss"] = streamReceived + streamLost > 0
+                ? (double)streamLost / (streamReceived + streamLost) : 0.0;
+        }
+        mixers[SyntheticAgent::nameForMixer(i)] = mixer;
+    }
+    report["mixers"] = mixers;
+
+    _lastReportStats = stats;
+    _lastReportPacketsSent = packetsSent;
+    _lastReportBytesSent = bytesSent;
+    return report;
+}
+
+static void debugReport(const QJsonObject& report) {
+    qDebug("%d/%d agents connected, sending %.0f packets/s, %.0f kbps", report["connected_agents"].toInt(),
+           report["agents"].toInt(), report["sent_packets_per_second"].toDouble(), report["sent_kbps"].toDouble());
+
+    QJsonObject mixers = report["mixers"].toObject();
+    for (int i = 0; i < SyntheticAgent::NUM_MIXERS; i++) {
+        QJsonObject mixer = mixers[SyntheticAgent::nameForMixer(i)].toObject();
+        qDebug("  %-14s rtt avg %.2f ms max %.2f ms, jitter %.2f ms, ping loss %.2f%%, receiving %.0f packets/s %.0f kbps",
+               SyntheticAgent::nameForMixer(i), mixer["avg_rtt_msecs"].toDouble(), mixer["max_rtt_msecs"].toDouble(),
+               mixer["jitter_msecs"].toDouble(), mixer["ping_loss"].toDouble() * 100.0,
+               mixer["received_packets_per_second"].toDouble(), mixer["received_kbps"].toDouble());
+        if (mixer.contains("stream_loss")) {
+            qDebug("  %-14s stream loss %.2f%%", "", mixer["stream_loss"].toDouble() * 100.0);
+        }
+    }
+}
+
+void LoadGenerator::printReport() {
+    qint64 nowMsecs = _runTimer.elapsed();
+    float seconds = (float)(nowMsecs - _lastReportMsecs) / MSECS_PER_SECOND;
+    if (seconds <= 0.0f) {
+        return;
+    }
+    debugReport(reportSince(_lastReportStats, _lastReportPacketsSent, _lastReportBytesSent, seconds));
+    _lastReportMsecs = nowMsecs;
+}
+
+void LoadGenerator::stop() {
+    _frameTimer.stop();
+    _checkInTimer.stop();
+    _pingTimer.stop();
+    _reportTimer.stop();
+
+    foreach (SyntheticAgent* agent, _agents) {
+        agent->stop();
+    }
+
+    // the final report covers the whole run
+    float seconds = (float)_runTimer.elapsed() / MSECS_PER_SECOND;
+    QJsonObject report = reportSince(QVector<MixerLinkStats>(SyntheticAgent::NUM_MIXERS), 0, 0, seconds);
+    qDebug() << "Finished after" << seconds << "seconds";
+    debugReport(report);
+
+    if (!_reportFilename.isEmpty()) {
+        QFile reportFile(_reportFilename);
+        if (reportFile.open(QIODevice::WriteOnly)) {
+            reportFile.write(QJsonDocument(report).toJson());
+        } else {
+            qDebug() << "ERROR writing report" << _reportFilename << "-" << reportFile.errorString();
+        }
+    }
+
+    _succeeded = report["connected_agents"].toInt() > 0;
+    emit finished();
+}
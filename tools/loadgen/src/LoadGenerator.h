@@ -0,0 +1,69 @@
+//
+//  LoadGenerator.h
+//  tools/loadgen/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_LoadGenerator_h
+#define hifi_LoadGenerator_h
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+
+#include "SyntheticAgent.h"
+
+/// Runs every synthetic agent on one event loop: frames at the script frame rate, domain check-ins, pings, and a
+/// report of what each mixer did for the agents every few seconds and once more at the end.
+class LoadGenerator : public QObject {
+    Q_OBJECT
+public:
+    LoadGenerator(const LoadGeneratorConfig& config, const QString& reportFilename, QObject* parent = 0);
+
+    bool start();
+
+    /// true once the run ended with at least one agent connected
+    bool succeeded() const { return _succeeded; }
+
+signals:
+    void finished();
+
+public slots:
+    void stop();
+
+private slots:
+    void sendFrames();
+    void sendDomainCheckIns();
+    void sendPings();
+    void printReport();
+
+private:
+    QJsonObject reportSince(const QVector<MixerLinkStats>& lastStats, quint64 lastPacketsSent, quint64 lastBytesSent,
+                            float seconds);
+
+    LoadGeneratorConfig _config;
+    QString _reportFilename;
+    QVector<SyntheticAgent*> _agents;
+
+    QTimer _frameTimer;
+    QTimer _checkInTimer;
+    QTimer _pingTimer;
+    QTimer _reportTimer;
+    QElapsedTimer _runTimer;
+    quint64 _framesSent;
+
+    QVector<MixerLinkStats> _lastReportStats;
+    quint64 _lastReportPacketsSent;
+    quint64 _lastReportBytesSent;
+    qint64 _lastReportMsecs;
+
+    bool _succeeded;
+};
+
+#endif // hifi_LoadGenerator_h
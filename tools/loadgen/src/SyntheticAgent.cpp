@@ -0,0 +1,578 @@
+//
+//  SyntheticAgent.cpp
+//  tools/loadgen/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtNetwork/QHostAddress>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <AudioConstants.h>
+#include <DependencyManager.h>
+#include <DomainHandler.h>
+#include <EntityItemProperties.h>
+#include <LimitedNodeList.h>
+#include <PacketAuthenticator.h>
+#include <PacketHeaders.h>
+#include <ScriptEngine.h>
+#include <SharedUtil.h>
+
+#include "SyntheticAgent.h"
+
+const int SYNTHETIC_AUDIO_BUFFER_SAMPLES = floor(((SCRIPT_DATA_CALLBACK_USECS * AudioConstants::SAMPLE_RATE)
+                                                  / (1000 * 1000)) + 0.5);
+
+// agents speak in bursts of this length, the duty cycle sets how much of each period is speech
+const float SPEECH_PERIOD_SECONDS = 4.0f;
+const float SPEECH_TONE_HZ = 220.0f;
+const int16_t SPEECH_TONE_AMPLITUDE = 4000;
+
+// the entity an agent edits floats above it, and lives a little past the end of the run in case the erase is lost
+const glm::vec3 AGENT_ENTITY_OFFSET = glm::vec3(0.0f, 2.0f, 0.0f);
+const glm::vec3 AGENT_ENTITY_DIMENSIONS = glm::vec3(0.25f, 0.25f, 0.25f);
+const float AGENT_ENTITY_LIFETIME_GRACE_SECONDS = 60.0f;
+const float AGENT_ENTITY_LIFETIME_UNBOUNDED_SECONDS = 3600.0f;
+
+// RFC 3550 smooths the jitter estimate over this many samples
+const float JITTER_SMOOTHING_SAMPLES = 16.0f;
+
+LoadGeneratorConfig::LoadGeneratorConfig() :
+    domainSockAddr(QHostAddress::LocalHost, DEFAULT_DOMAIN_SERVER_PORT),
+    numAgents(100),
+    durationSecs(60),
+    center(100.0f, 1.0f, 100.0f),
+    spread(20.0f),
+    moveSpeed(1.5f),
+    speechDutyCycle(0.25f),
+    entityEditRate(1.0f),
+    pingRate(5.0f)
+{
+}
+
+MixerLinkStats::MixerLinkStats() :
+    pingsSent(0),
+    pingsReplied(0),
+    totalRoundTripUsecs(0),
+    maxRoundTripUsecs(0),
+    jitterUsecs(0.0f),
+    numJitterSources(0),
+    packetsReceived(0),
+    bytesReceived(0),
+    streamPacketsReceived(0),
+    streamPacketsLost(0),
+    _lastRoundTripUsecs(0),
+    _hasStreamSequence(false),
+    _lastStreamSequence(0)
+{
+}
+
+void MixerLinkStats::merge(const MixerLinkStats& other) {
+    pingsSent += other.pingsSent;
+    pingsReplied += other.pingsReplied;
+    totalRoundTripUsecs += other.totalRoundTripUsecs;
+    maxRoundTripUsecs = std::max(maxRoundTripUsecs, other.maxRoundTripUsecs);
+    packetsReceived += other.packetsReceived;
+    bytesReceived += other.bytesReceived;
+    streamPacketsReceived += other.streamPacketsReceived;
+    streamPacketsLost += other.streamPacketsLost;
+
+    // the merged jitter is the mean across the agents that measured one
+    int otherSources = other.numJitterSources > 0 ? other.numJitterSources : (other.pingsReplied > 1 ? 1 : 0);
+    if (otherSources > 0) {
+        jitterUsecs = (jitterUsecs * numJitterSources + other.jitterUsecs * otherSources)
+            / (numJitterSources + otherSources);
+        numJitterSources += otherSources;
+    }
+}
+
+void MixerLinkStats::pingReplied(quint64 roundTripUsecs) {
+    if (pingsReplied > 0) {
+        float difference = fabsf((float)roundTripUsecs - (float)_lastRoundTripUsecs);
+        jitterUsecs += (difference - jitterUsecs) / JITTER_SMOOTHING_SAMPLES;
+    }
+    _lastRoundTripUsecs = roundTripUsecs;
+
+    pingsReplied++;
+    totalRoundTripUsecs += roundTripUsecs;
+    maxRoundTripUsecs = std::max(maxRoundTripUsecs, roundTripUsecs);
+}
+
+void MixerLinkStats::streamSequenceReceived(quint16 sequence) {
+    streamPacketsReceived++;
+    if (_hasStreamSequence) {
+        quint16 gap = sequence - _lastStreamSequence;
+        if (gap == 0 || gap > std::numeric_limits<quint16>::max() / 2) {
+            // a duplicate or a late packet, whatever it filled was already counted as lost
+            return;
+        }
+        streamPacketsLost += gap - 1;
+    }
+    _hasStreamSequence = true;
+    _lastStreamSequence = sequence;
+}
+
+const char* SyntheticAgent::nameForMixer(int mixer) {
+    switch (mixer) {
+        case AudioMixer:
+            return "audio-mixer";
+        case AvatarMixer:
+            return "avatar-mixer";
+        case EntityServer:
+            return "entity-server";
+        default:
+            return "unknown";
+    }
+}
+
+static int mixerForNodeType(NodeType_t nodeType) {
+    switch (nodeType) {
+        case NodeType::AudioMixer:
+            return SyntheticAgent::AudioMixer;
+        case NodeType::AvatarMixer:
+            return SyntheticAgent::AvatarMixer;
+        case NodeType::EntityServer:
+            return SyntheticAgent::EntityServer;
+        default:
+            return -1;
+    }
+}
+
+SyntheticAgent::SyntheticAgent(int index, const LoadGeneratorConfig& config, QObject* parent) :
+    QObject(parent),
+    _index(index),
+    _config(config),
+    _domainListVersion(0),
+    _pendingDomainListVersion(0),
+    _numPendingDomainListPackets(0),
+    _walkAngle(0.0f),
+    _walkRadius(0.0f),
+    _speechPhase(0.0f),
+    _audioSequence(0),
+    _entityID(EntityItemID::createInvalidEntityID()),
+    _hasSentEntityAdd(false),
+    _entityEditsDue(0.0f),
+    _entityEditSequence(0),
+    _packetsSent(0),
+    _bytesSent(0)
+{
+    // spread the agents out so they don't all walk the same circle or start speaking on the same frame
+    _walkAngle = randFloatInRange(0.0f, TWO_PI);
+    _walkRadius = randFloatInRange(0.1f, 1.0f) * _config.spread;
+    _speechPhase = randFloatInRange(0.0f, 1.0f);
+
+    _avatarData.setForceFaceshiftConnected(true);
+    _avatarData.setFaceModelURL(QUrl());
+    _avatarData.setSkeletonModelURL(QUrl());
+    _avatarData.setDisplayName(QString("loadgen-%1").arg(_index));
+
+    connect(&_socket, &QUdpSocket::readyRead, this, &SyntheticAgent::readPendingDatagrams);
+}
+
+bool SyntheticAgent::bindSocket() {
+    if (!_socket.bind(QHostAddress::AnyIPv4, 0)) {
+        qDebug() << "Agent" << _index << "could not bind a socket -" << _socket.errorString();
+        return false;
+    }
+
+    // the domain and the mixers all run locally, so the agent is reachable at the same socket publicly and locally
+    _localSockAddr = HifiSockAddr(QHostAddress::LocalHost, _socket.localPort());
+    return true;
+}
+
+void SyntheticAgent::sendDomainCheckIn() {
+    PacketType domainPacketType = isConnected() ? PacketTypeDomainListRequest : PacketTypeDomainConnectRequest;
+
+    QByteArray domainServerPacket = byteArrayWithPopulatedHeader(domainPacketType, _sessionUUID);
+    QDataStream packetStream(&domainServerPacket, QIODevice::Append);
+
+    QList<NodeType_t> nodeTypesOfInterest;
+    nodeTypesOfInterest << NodeType::AudioMixer << NodeType::AvatarMixer << NodeType::EntityServer;
+
+    packetStream << (NodeType_t)NodeType::Agent << _localSockAddr << _localSockAddr << nodeTypesOfInterest;
+
+    if (domainPacketType == PacketTypeDomainListRequest) {
+        packetStream << _domainListVersion;
+    } else {
+        // agents connect without an account, the domain lets local connections in without one
+        packetStream << QString();
+    }
+
+    writeDatagram(domainServerPacket, _config.domainSockAddr, SharedNodePointer());
+}
+
+void SyntheticAgent::sendPings() {
+    auto nodeList = DependencyManager::get<LimitedNodeList>();
+    for (int i = 0; i < NUM_MIXERS; i++) {
+        const SharedNodePointer& mixer = _mixers[i];
+        if (!mixer) {
+            continue;
+        }
+
+        // until a reply picks a socket, ping both like NodeList does for inactive nodes
+        if (mixer->getActiveSocket()) {
+            QByteArray pingPacket = nodeList->constructPingPacket(PingType::Agnostic, true, _sessionUUID);
+            writeDatagram(pingPacket, *mixer->getActiveSocket(), mixer);
+        } else {
+            QByteArray localPingPacket = nodeList->constructPingPacket(PingType::Local, true, _sessionUUID);
+            writeDatagram(localPingPacket, mixer->getLocalSocket(), mixer);
+
+            QByteArray publicPingPacket = nodeList->constructPingPacket(PingType::Public, true, _sessionUUID);
+            writeDatagram(publicPingPacket, mixer->getPublicSocket(), mixer);
+        }
+        _mixerStats[i].pingsSent++;
+    }
+}
+
+void SyntheticAgent::sendFrame(float deltaTime) {
+    if (!isConnected()) {
+        return;
+    }
+
+    // walk a circle around the center, turning to face along it
+    if (_walkRadius > 0.0f) {
+        _walkAngle = fmodf(_walkAngle + _config.moveSpeed * deltaTime / _walkRadius, TWO_PI);
+    }
+    glm::vec3 position = _config.center + glm::vec3(cosf(_walkAngle), 0.0f, sinf(_walkAngle)) * _walkRadius;
+    glm::quat orientation = glm::angleAxis(-_walkAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+    _avatarData.setPosition(position);
+    _avatarData.setOrientation(orientation);
+
+    if (_mixers[AvatarMixer]) {
+        QByteArray avatarPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarData, _sessionUUID);
+        avatarPacket.append(_avatarData.toByteArray());
+        writeToMixer(avatarPacket, AvatarMixer);
+    }
+
+    if (_mixers[AudioMixer]) {
+        _speechPhase = fmodf(_speechPhase + deltaTime / SPEECH_PERIOD_SECONDS, 1.0f);
+        sendAudioFrame();
+    }
+
+    if (_mixers[EntityServer] && _config.entityEditRate > 0.0f) {
+        _entityEditsDue += _config.entityEditRate * deltaTime;
+        if (_entityEditsDue >= 1.0f) {
+            _entityEditsDue -= 1.0f;
+            sendEntityEdit();
+        }
+    }
+}
+
+void SyntheticAgent::sendAudioFrame() {
+    bool silentFrame = _speechPhase >= _config.speechDutyCycle;
+
+    QByteArray audioPacket = byteArrayWithPopulatedHeader(silentFrame
+                                                          ? PacketTypeSilentAudioFrame
+                                                          : PacketTypeMicrophoneAudioNoEcho, _sessionUUID);
+    QDataStream packetStream(&audioPacket, QIODevice::Append);
+
+    // the sequence is packed in native order, as the ScriptEngine does
+    packetStream.writeRawData(reinterpret_cast<const char*>(&_audioSequence), sizeof(quint16));
+    _audioSequence++;
+
+    if (silentFrame) {
+        // write the number of silent samples so the audio-mixer can uphold timing
+        int16_t numSilentSamples = SYNTHETIC_AUDIO_BUFFER_SAMPLES;
+        packetStream.writeRawData(reinterpret_cast<const char*>(&numSilentSamples), sizeof(int16_t));
+    } else {
+        // mono
+        packetStream << (quint8)0;
+    }
+
+    packetStream.writeRawData(reinterpret_cast<const char*>(&_avatarData.getPosition()), sizeof(glm::vec3));
+    glm::quat orientation = _avatarData.getOrientation();
+    packetStream.writeRawData(reinterpret_cast<const char*>(&orientation), sizeof(glm::quat));
+
+    if (!silentFrame) {
+        // a tone, so the mixer has something to mix that isn't silence
+        int16_t samples[SYNTHETIC_AUDIO_BUFFER_SAMPLES];
+        float phaseStep = TWO_PI * SPEECH_TONE_HZ / AudioConstants::SAMPLE_RATE;
+        quint64 firstSample = (quint64)(_audioSequence - 1) * SYNTHETIC_AUDIO_BUFFER_SAMPLES;
+        for (int i = 0; i < SYNTHETIC_AUDIO_BUFFER_SAMPLES; i++) {
+            samples[i] = (int16_t)(SPEECH_TONE_AMPLITUDE * sinf(fmodf((firstSample + i) * phaseStep, TWO_PI)));
+        }
+        packetStream.writeRawData(reinterpret_cast<const char*>(samples), sizeof(samples));
+    }
+
+    writeToMixer(audioPacket, AudioMixer);
+}
+
+void SyntheticAgent::sendEntityEdit() {
+    if (!_hasSentEntityAdd) {
+        _entityID = EntityItemID(NEW_ENTITY, EntityItemID::getNextCreatorTokenID(), false);
+        _hasSentEntityAdd = true;
+    } else if (!_entityID.isKnownID) {
+        // still waiting to hear the add took
+        return;
+    }
+
+    EntityItemProperties properties;
+    properties.setPosition(_avatarData.getPosition() + AGENT_ENTITY_OFFSET);
+    if (!_entityID.isKnownID) {
+        properties.setType(EntityTypes::Box);
+        properties.setDimensions(AGENT_ENTITY_DIMENSIONS);
+        properties.setLifetime(_config.durationSecs > 0
+                               ? _config.durationSecs + AGENT_ENTITY_LIFETIME_GRACE_SECONDS
+                               : AGENT_ENTITY_LIFETIME_UNBOUNDED_SECONDS);
+        xColor color = { (unsigned char)(_index * 37), (unsigned char)(_index * 91), (unsigned char)(_index * 151) };
+        properties.setColor(color);
+    }
+
+    unsigned char editBuffer[MAX_PACKET_SIZE];
+    int editLength = 0;
+    if (!EntityItemProperties::encodeEntityEditPacket(PacketTypeEntityAddOrEdit, _entityID, properties,
+                                                      editBuffer, MAX_PACKET_SIZE, editLength)) {
+        return;
+    }
+
+    // an edit packet is its header, a sequence number and the time it was sent, then the edit messages
+    QByteArray editPacket = byteArrayWithPopulatedHeader(PacketTypeEntityAddOrEdit, _sessionUUID);
+    quint64 now = usecTimestampNow();
+    editPacket.append(reinterpret_cast<const char*>(&_entityEditSequence), sizeof(quint16));
+    editPacket.append(reinterpret_cast<const char*>(&now), sizeof(quint64));
+    editPacket.append(reinterpret_cast<const char*>(editBuffer), editLength);
+    _entityEditSequence++;
+
+    writeToMixer(editPacket, EntityServer);
+}
+
+void SyntheticAgent::stop() {
+    if (!_mixers[EntityServer] || !_entityID.isKnownID) {
+        return;
+    }
+
+    unsigned char eraseBuffer[MAX_PACKET_SIZE];
+    size_t eraseLength = 0;
+    if (!EntityItemProperties::encodeEraseEntityMessage(_entityID, eraseBuffer, MAX_PACKET_SIZE, eraseLength)) {
+        return;
+    }
+
+    QByteArray erasePacket = byteArrayWithPopulatedHeader(PacketTypeEntityErase, _sessionUUID);
+    quint64 now = usecTimestampNow();
+    erasePacket.append(reinterpret_cast<const char*>(&_entityEditSequence), sizeof(quint16));
+    erasePacket.append(reinterpret_cast<const char*>(&now), sizeof(quint64));
+    erasePacket.append(reinterpret_cast<const char*>(eraseBuffer), eraseLength);
+    _entityEditSequence++;
+
+    writeToMixer(erasePacket, EntityServer);
+    _entityID = EntityItemID::createInvalidEntityID();
+}
+
+void SyntheticAgent::writeDatagram(QByteArray& packet, const HifiSockAddr& destination,
+                                   const SharedNodePointer& authenticatingNode) {
+    if (authenticatingNode && !authenticatingNode->getAuthenticationKey().isNull()) {
+        PacketAuthenticator::authenticatePacket(packet.data(), packet.size(), authenticatingNode->getAuthenticationKey(),
+                                                authenticatingNode->getAuthenticationMode());
+    }
+
+    qint64 bytesWritten = _socket.writeDatagram(packet, destination.getAddress(), destination.getPort());
+    if (bytesWritten > 0) {
+        _packetsSent++;
+        _bytesSent += bytesWritten;
+    }
+}
+
+void SyntheticAgent::writeToMixer(QByteArray& packet, int mixer) {
+    const SharedNodePointer& node = _mixers[mixer];
+    if (node && node->getActiveSocket()) {
+        writeDatagram(packet, *node->getActiveSocket(), node);
+    }
+}
+
+int SyntheticAgent::mixerForSender(const QByteArray& packet) const {
+    QUuid senderUUID = uuidFromPacketHeader(packet);
+    for (int i = 0; i < NUM_MIXERS; i++) {
+        if (_mixers[i] && _mixers[i]->getUUID() == senderUUID) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void SyntheticAgent::readPendingDatagrams() {
+    QByteArray packet;
+    HifiSockAddr senderSockAddr;
+
+    while (_socket.hasPendingDatagrams()) {
+        packet.resize(_socket.pendingDatagramSize());
+        _socket.readDatagram(packet.data(), packet.size(),
+                             senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+
+        PacketType packetType = packetTypeForPacket(packet);
+        if (versionFromPacketHeader(packet.constData()) != versionForPacketType(packetType)) {
+            continue;
+        }
+
+        if (packetType == PacketTypeDomainList) {
+            processDomainList(packet);
+            continue;
+        }
+
+        int mixer = mixerForSender(packet);
+        if (mixer < 0) {
+            continue;
+        }
+
+        const SharedNodePointer& mixerNode = _mixers[mixer];
+        if (!NON_VERIFIED_PACKETS.contains(packetType)) {
+            if (!PacketAuthenticator::isPacketAuthentic(packet.constData(), packet.size(),
+                                                        mixerNode->getAuthenticationKey())) {
+                continue;
+            }
+            mixerNode->setAcceptsSipHash(PacketAuthenticator::senderAcceptsSipHash(packet.constData()));
+        }
+
+        MixerLinkStats& stats = _mixerStats[mixer];
+        stats.packetsReceived++;
+        stats.bytesReceived += packet.size();
+
+        switch (packetType) {
+            case PacketTypePing:
+                processPing(packet, senderSockAddr, mixer);
+                break;
+            case PacketTypePingReply:
+                processPingReply(packet, mixer);
+                break;
+            case PacketTypeMixedAudio:
+            case PacketTypeSilentAudioFrame: {
+                // the mixer's stream carries a sequence number right after the header, gaps in it are lost packets
+                int numBytesPacketHeader = numBytesForPacketHeader(packet);
+                if (packet.size() >= numBytesPacketHeader + (int)sizeof(quint16)) {
+                    quint16 sequence;
+                    memcpy(&sequence, packet.constData() + numBytesPacketHeader, sizeof(quint16));
+                    stats.streamSequenceReceived(sequence);
+                }
+                break;
+            }
+            case PacketTypeEntityAddResponse:
+                processEntityAddResponse(packet);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void SyntheticAgent::processDomainList(const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    QUuid sessionUUID;
+    packetStream >> sessionUUID;
+    if (_sessionUUID != sessionUUID) {
+        _sessionUUID = sessionUUID;
+        _avatarData.setSessionUUID(sessionUUID);
+    }
+
+    quint32 listVersion;
+    bool isFullList;
+    quint16 packetNumber, numPackets;
+    packetStream >> listVersion >> isFullList >> packetNumber >> numPackets;
+
+    qint8 nodeType;
+    QUuid nodeUUID, connectionSecret;
+    HifiSockAddr nodePublicSocket, nodeLocalSocket;
+
+    while (packetStream.device()->pos() < packet.size()) {
+        packetStream >> nodeType >> nodeUUID;
+
+        if (nodeType == NodeType::Unassigned) {
+            // a removal, drop the mixer if it's one of ours
+            for (int i = 0; i < NUM_MIXERS; i++) {
+                if (_mixers[i] && _mixers[i]->getUUID() == nodeUUID) {
+                    _mixers[i].clear();
+                }
+            }
+            continue;
+        }
+
+        packetStream >> nodePublicSocket >> nodeLocalSocket >> connectionSecret;
+
+        int mixer = mixerForNodeType(nodeType);
+        if (mixer < 0) {
+            continue;
+        }
+
+        // if the public socket address is 0 then it's reachable at the same IP as the domain server
+        if (nodePublicSocket.getAddress().isNull()) {
+            nodePublicSocket.setAddress(_config.domainSockAddr.getAddress());
+        }
+
+        SharedNodePointer& mixerNode = _mixers[mixer];
+        if (!mixerNode || mixerNode->getUUID() != nodeUUID) {
+            mixerNode = SharedNodePointer(new Node(nodeUUID, nodeType, nodePublicSocket, nodeLocalSocket),
+                                          &QObject::deleteLater);
+        } else {
+            mixerNode->setPublicSocket(nodePublicSocket);
+            mixerNode->setLocalSocket(nodeLocalSocket);
+        }
+        mixerNode->setConnectionSecret(connectionSecret);
+    }
+
+    // the same bookkeeping NodeList does, a version is only ours once all of its packets are in
+    if (listVersion != _pendingDomainListVersion) {
+        _pendingDomainListVersion = listVersion;
+        _numPendingDomainListPackets = 0;
+    }
+    if (++_numPendingDomainListPackets >= numPackets) {
+        _domainListVersion = listVersion;
+        _numPendingDomainListPackets = 0;
+    }
+}
+
+void SyntheticAgent::processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr, int mixer) {
+    auto nodeList = DependencyManager::get<LimitedNodeList>();
+    QByteArray replyPacket = nodeList->constructPingReplyPacket(packet, _sessionUUID);
+    writeDatagram(replyPacket, senderSockAddr, _mixers[mixer]);
+}
+
+void SyntheticAgent::processPingReply(const QByteArray& packet, int mixer) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    quint8 pingType;
+    quint64 ourOriginalTime, othersReplyTime;
+    packetStream >> pingType >> ourOriginalTime >> othersReplyTime;
+
+    const SharedNodePointer& mixerNode = _mixers[mixer];
+    if (!mixerNode->getActiveSocket()) {
+        if (pingType == PingType::Local) {
+            mixerNode->activateLocalSocket();
+        } else if (pingType == PingType::Public) {
+            mixerNode->activatePublicSocket();
+        }
+    }
+
+    quint64 now = usecTimestampNow();
+    if (now > ourOriginalTime) {
+        _mixerStats[mixer].pingReplied(now - ourOriginalTime);
+    }
+}
+
+void SyntheticAgent::processEntityAddResponse(const QByteArray& packet) {
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+    if (packet.size() < numBytesPacketHeader + (int)sizeof(uint32_t) + NUM_BYTES_RFC4122_UUID) {
+        return;
+    }
+
+    uint32_t creatorTokenID;
+    memcpy(&creatorTokenID, packet.constData() + numBytesPacketHeader, sizeof(creatorTokenID));
+    if (_entityID.isKnownID || creatorTokenID != _entityID.creatorTokenID) {
+        return;
+    }
+
+    QUuid entityID = QUuid::fromRfc4122(packet.mid(numBytesPacketHeader + sizeof(creatorTokenID),
+                                                   NUM_BYTES_RFC4122_UUID));
+    _entityID = EntityItemID(entityID);
+}
@@ -0,0 +1,146 @@
+//
+//  SyntheticAgent.h
+//  tools/loadgen/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SyntheticAgent_h
+#define hifi_SyntheticAgent_h
+
+#include <QtCore/QObject>
+#include <QtNetwork/QUdpSocket>
+
+#include <glm/glm.hpp>
+
+#include <AvatarData.h>
+#include <EntityItemID.h>
+#include <HifiSockAddr.h>
+#include <Node.h>
+
+/// what every synthetic agent does, set from the command line
+class LoadGeneratorConfig {
+public:
+    LoadGeneratorConfig();
+
+    HifiSockAddr domainSockAddr;
+    int numAgents;
+    int durationSecs; // 0 runs until interrupted
+    glm::vec3 center;
+    float spread; // agents walk circles within this many meters of the center
+    float moveSpeed; // meters per second
+    float speechDutyCycle; // the fraction of the time an agent sends audio instead of silent frames
+    float entityEditRate; // edits per second per agent to an entity it owns, 0 for none
+    float pingRate; // pings per second per agent to each mixer, the latency samples
+};
+
+/// what one agent saw of one mixer, merged across agents for the report
+class MixerLinkStats {
+public:
+    MixerLinkStats();
+
+    void merge(const MixerLinkStats& other);
+
+    void pingReplied(quint64 roundTripUsecs);
+    void streamSequenceReceived(quint16 sequence);
+
+    quint64 pingsSent;
+    quint64 pingsReplied;
+    quint64 totalRoundTripUsecs;
+    quint64 maxRoundTripUsecs;
+    float jitterUsecs; // smoothed difference between consecutive round trips, as in RFC 3550
+    int numJitterSources; // the agents averaged into jitterUsecs once merged
+
+    quint64 packetsReceived;
+    quint64 bytesReceived;
+
+    quint64 streamPacketsReceived; // sequenced packets the mixer streams, like mixed audio
+    quint64 streamPacketsLost;
+
+private:
+    quint64 _lastRoundTripUsecs;
+    bool _hasStreamSequence;
+    quint16 _lastStreamSequence;
+};
+
+/// One agent on the domain: it connects and checks in like NodeList, then sends avatar data and audio to the mixers
+/// every script frame like an Agent running a script, plus the entity edits it is configured for. It answers the
+/// mixers' pings and pings them to time the round trip.
+///
+/// Every agent has its own socket, mixers address a node by its socket so agents can't share one.
+class SyntheticAgent : public QObject {
+    Q_OBJECT
+public:
+    enum Mixer {
+        AudioMixer,
+        AvatarMixer,
+        EntityServer,
+        NUM_MIXERS
+    };
+
+    static const char* nameForMixer(int mixer);
+
+    SyntheticAgent(int index, const LoadGeneratorConfig& config, QObject* parent = 0);
+
+    bool bindSocket();
+
+    bool isConnected() const { return !_sessionUUID.isNull(); }
+
+    /// sends this frame's avatar data and audio, and any entity edits that are due
+    void sendFrame(float deltaTime);
+    void sendDomainCheckIn();
+    void sendPings();
+
+    /// erases the entity this agent made
+    void stop();
+
+    const MixerLinkStats& getMixerStats(int mixer) const { return _mixerStats[mixer]; }
+    quint64 getPacketsSent() const { return _packetsSent; }
+    quint64 getBytesSent() const { return _bytesSent; }
+
+private slots:
+    void readPendingDatagrams();
+
+private:
+    void processDomainList(const QByteArray& packet);
+    void processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr, int mixer);
+    void processPingReply(const QByteArray& packet, int mixer);
+    void processEntityAddResponse(const QByteArray& packet);
+    int mixerForSender(const QByteArray& packet) const;
+
+    void sendAudioFrame();
+    void sendEntityEdit();
+    void writeDatagram(QByteArray& packet, const HifiSockAddr& destination, const SharedNodePointer& authenticatingNode);
+    void writeToMixer(QByteArray& packet, int mixer);
+
+    int _index;
+    const LoadGeneratorConfig& _config;
+    QUdpSocket _socket;
+    HifiSockAddr _localSockAddr;
+
+    QUuid _sessionUUID;
+    quint32 _domainListVersion;
+    quint32 _pendingDomainListVersion;
+    quint16 _numPendingDomainListPackets;
+    SharedNodePointer _mixers[NUM_MIXERS];
+    MixerLinkStats _mixerStats[NUM_MIXERS];
+
+    AvatarData _avatarData;
+    float _walkAngle;
+    float _walkRadius;
+    float _speechPhase;
+    quint16 _audioSequence;
+
+    EntityItemID _entityID;
+    bool _hasSentEntityAdd;
+    float _entityEditsDue;
+    quint16 _entityEditSequence;
+
+    quint64 _packetsSent;
+    quint64 _bytesSent;
+};
+
+#endif // hifi_SyntheticAgent_h
@@ -0,0 +1,118 @@
+//
+//  main.cpp
+//  tools/loadgen/src
+//
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <iostream>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
+
+#include <DependencyManager.h>
+#include <DomainHandler.h>
+#include <LimitedNodeList.h>
+#include <Node.h>
+#include <SharedUtil.h>
+
+#include "LoadGenerator.h"
+
+using namespace std;
+
+static void printUsage() {
+    cerr << "Usage: loadgen [options]" << endl
+        << "  --domain <host[:port]>       domain-server to connect to, default localhost:"
+            << DEFAULT_DOMAIN_SERVER_PORT << endl
+        << "  --agents <count>             number of agents to simulate, default 100" << endl
+        << "  --duration <seconds>         how long to run, 0 runs until interrupted, default 60" << endl
+        << "  --center <x,y,z>             point the agents walk around, in meters, default 100,1,100" << endl
+        << "  --spread <meters>            farthest an agent walks from the center, default 20" << endl
+        << "  --speed <meters/second>      how fast the agents walk, default 1.5" << endl
+        << "  --speech <fraction>          fraction of the time each agent sends audio, default 0.25" << endl
+        << "  --entity-edits <per second>  edits each agent makes to an entity it owns, default 1" << endl
+        << "  --ping-rate <per second>     latency pings each agent sends each mixer, default 5" << endl
+        << "  --report <file>              write the final report to a JSON file" << endl;
+}
+
+int main(int argc, const char* argv[]) {
+    QCoreApplication app(argc, const_cast<char**>(argv));
+
+    if (cmdOptionExists(argc, argv, "--help") || cmdOptionExists(argc, argv, "-h")) {
+        printUsage();
+        return 0;
+    }
+
+    NodeType::init();
+
+    // the agents build their packets with the shared header helpers, which fall back to this node list's session
+    // UUID, a null one, for packets sent before the domain assigns one
+    DependencyManager::set<LimitedNodeList>();
+
+    LoadGeneratorConfig config;
+
+    const char* domainOption = getCmdOption(argc, argv, "--domain");
+    if (domainOption) {
+        QStringList hostAndPort = QString(domainOption).split(':');
+        quint16 port = hostAndPort.size() > 1 ? hostAndPort[1].toUShort() : DEFAULT_DOMAIN_SERVER_PORT;
+        config.domainSockAddr = HifiSockAddr(hostAndPort[0], port, true);
+        if (config.domainSockAddr.getAddress().isNull()) {
+            cerr << "Could not look up domain " << domainOption << endl;
+            return 1;
+        }
+    }
+
+    const char* centerOption = getCmdOption(argc, argv, "--center");
+    if (centerOption) {
+        QStringList components = QString(centerOption).split(',');
+        if (components.size() != 3) {
+            printUsage();
+            return 1;
+        }
+        config.center = glm::vec3(components[0].toFloat(), components[1].toFloat(), components[2].toFloat());
+    }
+
+    const char* option;
+    if ((option = getCmdOption(argc, argv, "--agents"))) {
+        config.numAgents = atoi(option);
+    }
+    if ((option = getCmdOption(argc, argv, "--duration"))) {
+        config.durationSecs = atoi(option);
+    }
+    if ((option = getCmdOption(argc, argv, "--spread"))) {
+        config.spread = atof(option);
+    }
+    if ((option = getCmdOption(argc, argv, "--speed"))) {
+        config.moveSpeed = atof(option);
+    }
+    if ((option = getCmdOption(argc, argv, "--speech"))) {
+        config.speechDutyCycle = glm::clamp((float)atof(option), 0.0f, 1.0f);
+    }
+    if ((option = getCmdOption(argc, argv, "--entity-edits"))) {
+        config.entityEditRate = atof(option);
+    }
+    if ((option = getCmdOption(argc, argv, "--ping-rate"))) {
+        config.pingRate = atof(option);
+    }
+
+    if (config.numAgents <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    const char* reportOption = getCmdOption(argc, argv, "--report");
+    LoadGenerator generator(config, reportOption ? QString(reportOption) : QString());
+    QObject::connect(&generator, &LoadGenerator::finished, &app, &QCoreApplication::quit);
+
+    if (!generator.start()) {
+        return 1;
+    }
+
+    app.exec();
+
+    // so a CI job fails when no agent got onto the domain
+    return generator.succeeded() ? 0 : 1;
+}